@@ -250,7 +250,7 @@ bool BlockchainExplorerDataBuilder::fillBlockDetails(const Block &block, BlockDe
   }
   blockDetails.transactions.push_back(std::move(transactionDetails));
 
-  std::list<Transaction> found;
+  std::list<CachedTransaction> found;
   std::list<Crypto::Hash> missed;
   core.getTransactions(block.transactionHashes, found, missed, blockDetails.isOrphaned);
   if (found.size() != block.transactionHashes.size()) {
@@ -259,7 +259,7 @@ bool BlockchainExplorerDataBuilder::fillBlockDetails(const Block &block, BlockDe
 
   blockDetails.totalFeeAmount = 0;
 
-  for (const Transaction& tx : found) {
+  for (const CachedTransaction& tx : found) {
     TransactionDetails transactionDetails;
     if (!fillTransactionDetails(tx, transactionDetails, block.timestamp)) {
       return false;
@@ -271,7 +271,12 @@ bool BlockchainExplorerDataBuilder::fillBlockDetails(const Block &block, BlockDe
 }
 
 bool BlockchainExplorerDataBuilder::fillTransactionDetails(const Transaction& transaction, TransactionDetails& transactionDetails, uint64_t timestamp) {
-  Crypto::Hash hash = getObjectHash(transaction);
+  return fillTransactionDetails(CachedTransaction(transaction), transactionDetails, timestamp);
+}
+
+bool BlockchainExplorerDataBuilder::fillTransactionDetails(const CachedTransaction& cachedTransaction, TransactionDetails& transactionDetails, uint64_t timestamp) {
+  const Transaction& transaction = cachedTransaction.getTransaction();
+  const Crypto::Hash& hash = cachedTransaction.getTransactionHash();
   transactionDetails.hash = hash;
   transactionDetails.version = transaction.version;
   transactionDetails.timestamp = timestamp;
@@ -294,7 +299,7 @@ bool BlockchainExplorerDataBuilder::fillTransactionDetails(const Transaction& tr
       transactionDetails.timestamp = block.timestamp;
     }
   }
-  transactionDetails.size = getObjectBinarySize(transaction);
+  transactionDetails.size = cachedTransaction.getTransactionBinarySize();
   transactionDetails.unlockTime = transaction.unlockTime;
   transactionDetails.totalOutputsAmount = get_outs_money_amount(transaction);
 
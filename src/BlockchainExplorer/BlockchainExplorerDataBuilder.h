@@ -41,6 +41,7 @@
 #include <array>
 
 #include "DynexCNProtocol/IDynexCNProtocolQuery.h"
+#include "DynexCNCore/CachedTransaction.h"
 #include "DynexCNCore/ICore.h"
 #include "BlockchainExplorerData.h"
 
@@ -59,6 +60,7 @@ public:
 
   bool fillBlockDetails(const Block& block, BlockDetails& blockDetails);
   bool fillTransactionDetails(const Transaction &tx, TransactionDetails& txRpcInfo, uint64_t timestamp = 0);
+  bool fillTransactionDetails(const CachedTransaction &tx, TransactionDetails& txRpcInfo, uint64_t timestamp = 0);
 
   static bool getPaymentId(const Transaction& transaction, Crypto::Hash& paymentId);
   //non-privacy functions:
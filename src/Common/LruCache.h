@@ -0,0 +1,107 @@
+// Copyright (c) 2021-2023, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#pragma once 
+
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+// Bounded map that drops the least recently used entry when full, safe to share between threads.
+template < typename Key, typename Value, typename Hash = std::hash<Key> >
+class LruCache {
+public:
+
+  LruCache(size_t maxSize) :
+    m_maxSize(maxSize) {}
+
+  bool get(const Key& key, Value& value) {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    auto it = m_index.find(key);
+    if (it == m_index.end()) {
+      return false;
+    }
+
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    value = it->second->second;
+    return true;
+  }
+
+  void put(const Key& key, const Value& value) {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    auto it = m_index.find(key);
+    if (it != m_index.end()) {
+      it->second->second = value;
+      m_entries.splice(m_entries.begin(), m_entries, it->second);
+      return;
+    }
+
+    if (m_entries.size() >= m_maxSize && !m_entries.empty()) {
+      m_index.erase(m_entries.back().first);
+      m_entries.pop_back();
+    }
+
+    m_entries.emplace_front(key, value);
+    m_index.emplace(key, m_entries.begin());
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    m_index.clear();
+    m_entries.clear();
+  }
+
+  size_t size() {
+    std::lock_guard<std::mutex> lk(m_mutex);
+    return m_entries.size();
+  }
+
+  size_t capacity() const {
+    return m_maxSize;
+  }
+
+private:
+
+  typedef std::list<std::pair<Key, Value>> Entries;
+
+  const size_t m_maxSize;
+  std::mutex m_mutex;
+  Entries m_entries;
+  std::unordered_map<Key, typename Entries::iterator, Hash> m_index;
+};
@@ -53,6 +53,19 @@ bool MemoryInputStream::endOfStream() const {
   return position == bufferSize;
 }
 
+const void* MemoryInputStream::unreadData() const {
+  return buffer + position;
+}
+
+size_t MemoryInputStream::unreadSize() const {
+  return bufferSize - position;
+}
+
+void MemoryInputStream::skip(size_t size) {
+  assert(size <= bufferSize - position);
+  position += size;
+}
+
 size_t MemoryInputStream::readSome(void* data, size_t size) {
   assert(position <= bufferSize);
   size_t readSize = std::min(size, bufferSize - position);
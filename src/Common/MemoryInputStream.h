@@ -46,6 +46,11 @@ namespace Common {
     MemoryInputStream(const void* buffer, size_t bufferSize);
     size_t getPosition() const;
     bool endOfStream() const;
+
+    // The unread part of the buffer, for readers that parse it in place and skip() what they used.
+    const void* unreadData() const;
+    size_t unreadSize() const;
+    void skip(size_t size);
     
     // IInputStream
     virtual size_t readSome(void* data, size_t size) override;
@@ -0,0 +1,102 @@
+// Copyright (c) 2021-2023, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#include "RecursiveSharedMutex.h"
+
+#include <stdexcept>
+#include <unordered_map>
+
+namespace Tools {
+
+RecursiveSharedMutex::RecursiveSharedMutex() : m_owner(std::thread::id()), m_exclusiveDepth(0) {
+}
+
+void RecursiveSharedMutex::lock() {
+  if (m_owner.load(std::memory_order_relaxed) == std::this_thread::get_id()) {
+    ++m_exclusiveDepth;
+    return;
+  }
+
+  if (sharedDepth() != 0) {
+    throw std::logic_error("RecursiveSharedMutex: shared lock can't be upgraded to exclusive");
+  }
+
+  std::lock_guard<std::mutex> gate(m_writerGate);
+  m_mutex.lock();
+  m_owner.store(std::this_thread::get_id(), std::memory_order_relaxed);
+  m_exclusiveDepth = 1;
+}
+
+void RecursiveSharedMutex::unlock() {
+  if (--m_exclusiveDepth == 0) {
+    m_owner.store(std::thread::id(), std::memory_order_relaxed);
+    m_mutex.unlock();
+  }
+}
+
+void RecursiveSharedMutex::lock_shared() {
+  if (m_owner.load(std::memory_order_relaxed) == std::this_thread::get_id()) {
+    ++m_exclusiveDepth;
+    return;
+  }
+
+  size_t& depth = sharedDepth();
+  if (depth == 0) {
+    std::lock_guard<std::mutex> gate(m_writerGate);
+    m_mutex.lock_shared();
+  }
+
+  ++depth;
+}
+
+void RecursiveSharedMutex::unlock_shared() {
+  if (m_owner.load(std::memory_order_relaxed) == std::this_thread::get_id()) {
+    unlock();
+    return;
+  }
+
+  if (--sharedDepth() == 0) {
+    m_mutex.unlock_shared();
+  }
+}
+
+size_t& RecursiveSharedMutex::sharedDepth() {
+  thread_local std::unordered_map<const RecursiveSharedMutex*, size_t> depths;
+  return depths[this];
+}
+
+}
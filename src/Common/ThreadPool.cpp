@@ -0,0 +1,172 @@
+// Copyright (c) 2021-2023, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+#include "ThreadPool.h"
+
+namespace Tools {
+
+ThreadPool::ThreadPool(size_t threadCount) :
+  m_jobId(0),
+  m_activeWorkers(0),
+  m_stop(false),
+  m_task(nullptr),
+  m_failed(false) {
+
+  if (threadCount == 0) {
+    threadCount = std::thread::hardware_concurrency();
+    if (threadCount == 0) {
+      threadCount = 2;
+    }
+  }
+
+  m_slices.reset(new Slice[threadCount]);
+  for (size_t i = 1; i < threadCount; ++i) {
+    m_threads.emplace_back([this, i] { workerProcedure(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::unique_lock<std::mutex> lk(m_mutex);
+    m_stop = true;
+  }
+
+  m_hasJob.notify_all();
+  for (auto& thread : m_threads) {
+    thread.join();
+  }
+}
+
+size_t ThreadPool::getThreadCount() const {
+  return m_threads.size() + 1;
+}
+
+bool ThreadPool::run(size_t count, const std::function<bool(size_t)>& task) {
+  if (count == 0) {
+    return true;
+  }
+
+  std::unique_lock<std::mutex> runLock(m_runMutex);
+
+  size_t sliceCount = getThreadCount();
+  for (size_t i = 0; i < sliceCount; ++i) {
+    m_slices[i].next = count * i / sliceCount;
+    m_slices[i].end = count * (i + 1) / sliceCount;
+  }
+
+  m_task = &task;
+  m_failed = false;
+  m_exception = nullptr;
+
+  {
+    std::unique_lock<std::mutex> lk(m_mutex);
+    m_activeWorkers = m_threads.size();
+    ++m_jobId;
+  }
+
+  m_hasJob.notify_all();
+  processSlices(0);
+
+  {
+    std::unique_lock<std::mutex> lk(m_mutex);
+    m_jobDone.wait(lk, [this] { return m_activeWorkers == 0; });
+  }
+
+  m_task = nullptr;
+  if (m_exception) {
+    std::rethrow_exception(m_exception);
+  }
+
+  return !m_failed;
+}
+
+void ThreadPool::workerProcedure(size_t worker) {
+  uint64_t lastJobId = 0;
+
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lk(m_mutex);
+      m_hasJob.wait(lk, [this, lastJobId] { return m_stop || m_jobId != lastJobId; });
+      if (m_stop) {
+        return;
+      }
+
+      lastJobId = m_jobId;
+    }
+
+    processSlices(worker);
+
+    std::unique_lock<std::mutex> lk(m_mutex);
+    if (--m_activeWorkers == 0) {
+      m_jobDone.notify_one();
+    }
+  }
+}
+
+void ThreadPool::processSlices(size_t worker) {
+  size_t sliceCount = getThreadCount();
+
+  // own slice first, then help the others
+  for (size_t k = 0; k < sliceCount; ++k) {
+    Slice& slice = m_slices[(worker + k) % sliceCount];
+
+    for (;;) {
+      if (m_failed.load(std::memory_order_relaxed)) {
+        return;
+      }
+
+      size_t i = slice.next.fetch_add(1, std::memory_order_relaxed);
+      if (i >= slice.end) {
+        break;
+      }
+
+      try {
+        if (!(*m_task)(i)) {
+          m_failed = true;
+        }
+      } catch (...) {
+        std::unique_lock<std::mutex> lk(m_mutex);
+        if (!m_exception) {
+          m_exception = std::current_exception();
+        }
+
+        m_failed = true;
+      }
+    }
+  }
+}
+
+}
@@ -0,0 +1,95 @@
+// Copyright (c) 2021-2023, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Tools {
+
+// Long-lived worker threads that process a batch of independent items in parallel.
+// Every thread starts with its own contiguous slice of the batch and then steals from the slices of the others.
+// Batches submitted from several threads run one after another; a task must not submit a batch itself.
+class ThreadPool {
+public:
+  // threadCount == 0 means one thread per hardware core; the thread calling run() is one of them
+  explicit ThreadPool(size_t threadCount = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  size_t getThreadCount() const;
+
+  // Calls task(i) for every i in [0, count) and waits until all calls have finished.
+  // Once a task returns false no new indices are handed out and run() returns false.
+  // An exception thrown by a task is rethrown here.
+  bool run(size_t count, const std::function<bool(size_t)>& task);
+
+private:
+  struct Slice {
+    std::atomic<size_t> next;
+    size_t end;
+  };
+
+  void workerProcedure(size_t worker);
+  void processSlices(size_t worker);
+
+  std::vector<std::thread> m_threads;
+  std::unique_ptr<Slice[]> m_slices;
+
+  std::mutex m_runMutex;
+  std::mutex m_mutex;
+  std::condition_variable m_hasJob;
+  std::condition_variable m_jobDone;
+  uint64_t m_jobId;
+  size_t m_activeWorkers;
+  bool m_stop;
+
+  const std::function<bool(size_t)>* m_task;
+  std::atomic<bool> m_failed;
+  std::exception_ptr m_exception;
+};
+
+}
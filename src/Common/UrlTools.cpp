@@ -39,6 +39,7 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 #include <string>
 #include <regex>
 #include "DynexCNConfig.h"
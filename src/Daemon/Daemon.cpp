@@ -515,6 +515,16 @@ int main(int argc, char* argv[])
             logger(INFO, BRIGHT_RED) << "File " << parameters::CRYPTONOTE_BLOCKINDEXES_FILENAME << " removed!";
         }
 
+        if(Tools::remove_blockchain_file(coreConfig.configFolder+"/"+parameters::CRYPTONOTE_BLOCKHEADERS_FILENAME))
+        {
+            logger(INFO, BRIGHT_RED) << "File " << parameters::CRYPTONOTE_BLOCKHEADERS_FILENAME << " removed!";
+        }
+
+        if(Tools::remove_blockchain_file(coreConfig.configFolder+"/"+parameters::CRYPTONOTE_BLOCKSCACHE_JOURNAL_FILENAME))
+        {
+            logger(INFO, BRIGHT_RED) << "File " << parameters::CRYPTONOTE_BLOCKSCACHE_JOURNAL_FILENAME << " removed!";
+        }
+
         if(Tools::remove_blockchain_file(coreConfig.configFolder+"/"+parameters::CRYPTONOTE_POOLDATA_FILENAME))
         {
             logger(INFO, BRIGHT_RED) << "File " << parameters::CRYPTONOTE_POOLDATA_FILENAME << " removed!";
@@ -104,6 +104,7 @@ const uint64_t CRYPTONOTE_LOCKED_TX_ALLOWED_DELTA_SECONDS    = DIFFICULTY_TARGET
 const uint64_t CRYPTONOTE_MEMPOOL_TX_LIVETIME                = 60 * 60 * 24;     //seconds, one day
 const uint64_t CRYPTONOTE_MEMPOOL_TX_FROM_ALT_BLOCK_LIVETIME = 60 * 60 * 24 * 7; //seconds, one week
 const uint64_t CRYPTONOTE_NUMBER_OF_PERIODS_TO_FORGET_TX_DELETED_FROM_POOL = 7;  
+const uint64_t CRYPTONOTE_BLOCKS_CACHE_DEFAULT_SIZE          = 64;               //megabytes of decoded blocks kept in memory
 const size_t   FUSION_TX_MAX_SIZE                            = CRYPTONOTE_BLOCK_GRANTED_FULL_REWARD_ZONE * 30 / 100;
 const size_t   FUSION_TX_MIN_INPUT_COUNT                     = 12;
 const size_t   FUSION_TX_MIN_IN_OUT_COUNT_RATIO              = 4;
@@ -118,6 +119,8 @@ static_assert(UPGRADE_VOTING_WINDOW > 1, "Bad UPGRADE_VOTING_WINDOW");
 const char     CRYPTONOTE_BLOCKS_FILENAME[]                  = "blocks.dat";
 const char     CRYPTONOTE_BLOCKINDEXES_FILENAME[]            = "blockindexes.dat";
 const char     CRYPTONOTE_BLOCKSCACHE_FILENAME[]             = "blockscache.dat";
+const char     CRYPTONOTE_BLOCKHEADERS_FILENAME[]            = "blockheaders.dat";
+const char     CRYPTONOTE_BLOCKSCACHE_JOURNAL_FILENAME[]     = "blockscachejournal.dat";
 const char     CRYPTONOTE_POOLDATA_FILENAME[]                = "poolstate.bin";
 const char     P2P_NET_DATA_FILENAME[]                       = "p2pstate.bin";
 const char     CRYPTONOTE_BLOCKCHAIN_INDICES_FILENAME[]      = "blockchainindices.dat";
@@ -165,6 +168,9 @@ const uint32_t P2P_IDLE_CONNECTION_KILL_INTERVAL             = (5 * 60);      //
 const uint64_t GENESIS_TIMESTAMP                             = 1663331870;    // September 16, 2022 12:37:50 PM GMT
 
 const int      AUTH_TIMEOUT = 3; // 3 sec
+const size_t   AUTH_CONNECTIONS = 8;        // authorization requests in flight at once
+const size_t   AUTH_PENDING_LIMIT = 1000;   // blocks queued for authorization ahead of their import
+const size_t   AUTH_CACHE_SIZE = 10000;     // remembered block approvals
 
 const std::initializer_list<const char*> AUTH_ENDPOINTS = { 
   "https://networkv2.dynexcoin.org", 
@@ -58,25 +58,170 @@ static size_t WriteCallback(void *contents, size_t size, size_t nmemb, void *use
 	return size * nmemb;
 }
 
-bool AuthBlock(uint32_t height, uint32_t nonce, ILogger& log) {
-	static LoggerRef logger(log, "auth");
-	static CURL* curl = curl_easy_init(); // curl_easy_cleanup(curl)
-	//static struct curl_slist* slist = curl_slist_append(NULL, "Accept: application/json"); // curl_slist_free_all
-	static std::vector<const char*> endpoints(AUTH_ENDPOINTS);
+namespace {
 
+uint64_t authKey(uint32_t height, uint32_t nonce) {
+	return (static_cast<uint64_t>(height) << 32) | nonce;
+}
+
+}
+
+BlockAuthorizer::BlockAuthorizer(ILogger& log) :
+	logger(log, "auth"),
+	m_endpoints(AUTH_ENDPOINTS.begin(), AUTH_ENDPOINTS.end()),
+	m_authorized(AUTH_CACHE_SIZE),
+	m_requests(AUTH_PENDING_LIMIT),
+	m_stopping(false) {
+	// handles are created here, curl_easy_init is not safe to call first from several threads
+	for (size_t i = 0; i <= AUTH_CONNECTIONS; ++i) {
+		CURL* curl = curl_easy_init();
+		if (curl) {
+			m_handles.push_back(curl);
+		}
+	}
+}
+
+BlockAuthorizer::~BlockAuthorizer() {
+	{
+		std::lock_guard<std::mutex> lk(m_mutex);
+		m_stopping = true;
+	}
+
+	m_requests.close();
+	for (auto& worker : m_workers) {
+		worker.join();
+	}
+
+	for (void* curl : m_handles) {
+		curl_easy_cleanup(static_cast<CURL*>(curl));
+	}
+}
+
+void BlockAuthorizer::setEndpoints(const std::vector<std::string>& endpoints) {
+	std::lock_guard<std::mutex> lk(m_mutex);
+	m_endpoints = endpoints;
+}
+
+void BlockAuthorizer::prefetch(uint32_t height, uint32_t nonce) {
+	if (!height || height == UINT32_MAX) return;
+
+	bool authorized;
+	if (m_authorized.get(authKey(height, nonce), authorized)) return;
+
+	Request request = { height, nonce, std::make_shared<std::promise<bool>>() };
+	{
+		std::lock_guard<std::mutex> lk(m_mutex);
+		// the queue never holds more than the pending requests, so pushing below does not block
+		if (m_stopping || m_pending.size() >= AUTH_PENDING_LIMIT || m_pending.count(authKey(height, nonce)) != 0) return;
+
+		m_pending.emplace(authKey(height, nonce), request.result->get_future().share());
+		if (m_workers.size() < AUTH_CONNECTIONS && m_workers.size() < m_pending.size()) {
+			m_workers.emplace_back(&BlockAuthorizer::workerLoop, this);
+		}
+	}
+
+	std::shared_ptr<std::promise<bool>> result = request.result;
+	if (!m_requests.push(std::move(request))) {
+		// closed by the destructor in the meantime
+		complete(height, nonce, false);
+		result->set_value(false);
+	}
+}
+
+void BlockAuthorizer::wait(uint32_t height, uint32_t nonce) {
+	std::shared_future<bool> result = pending(height, nonce);
+	if (result.valid()) {
+		result.wait();
+	}
+}
+
+bool BlockAuthorizer::authorize(uint32_t height, uint32_t nonce) {
+	if (!height || height == UINT32_MAX) return false;
+
+	bool authorized;
+	if (m_authorized.get(authKey(height, nonce), authorized)) {
+		logger(DEBUGGING) << "Block " << height << " authorized earlier";
+		return authorized;
+	}
+
+	std::shared_future<bool> result = pending(height, nonce);
+	if (result.valid() && result.get()) {
+		return true;
+	}
+
+	// nothing was queued, or the queued request failed and may succeed now that the endpoints know the block
+	authorized = request(height, nonce);
+	complete(height, nonce, authorized);
+	return authorized;
+}
+
+std::shared_future<bool> BlockAuthorizer::pending(uint32_t height, uint32_t nonce) {
+	std::lock_guard<std::mutex> lk(m_mutex);
+	auto it = m_pending.find(authKey(height, nonce));
+	return it == m_pending.end() ? std::shared_future<bool>() : it->second;
+}
+
+// Only approvals are remembered, a refusal or an error is asked again the next time.
+void BlockAuthorizer::complete(uint32_t height, uint32_t nonce, bool authorized) {
+	if (authorized) {
+		m_authorized.put(authKey(height, nonce), true);
+	}
+
+	std::lock_guard<std::mutex> lk(m_mutex);
+	m_pending.erase(authKey(height, nonce));
+}
+
+void BlockAuthorizer::workerLoop() {
+	Request next;
+	while (m_requests.pop(next)) {
+		bool stopping;
+		{
+			std::lock_guard<std::mutex> lk(m_mutex);
+			stopping = m_stopping;
+		}
+
+		bool authorized = !stopping && request(next.height, next.nonce);
+		complete(next.height, next.nonce, authorized);
+		next.result->set_value(authorized);
+	}
+}
+
+void* BlockAuthorizer::acquireHandle() {
+	{
+		std::lock_guard<std::mutex> lk(m_mutex);
+		if (!m_handles.empty()) {
+			void* curl = m_handles.back();
+			m_handles.pop_back();
+			return curl;
+		}
+	}
+
+	return curl_easy_init();
+}
+
+void BlockAuthorizer::releaseHandle(void* curl) {
+	std::lock_guard<std::mutex> lk(m_mutex);
+	m_handles.push_back(curl);
+}
+
+bool BlockAuthorizer::request(uint32_t height, uint32_t nonce) {
+	CURL* curl = static_cast<CURL*>(acquireHandle());
 	if (!curl) {
 		logger(ERROR) << "Curl init error";
 		return false;
 	}
 
-	if (!height || height == UINT32_MAX) return false;
+	std::vector<std::string> endpoints;
+	{
+		std::lock_guard<std::mutex> lk(m_mutex);
+		endpoints = m_endpoints;
+	}
 
-	//curl_easy_reset(curl);
 	curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, AUTH_TIMEOUT);
 	curl_easy_setopt(curl, CURLOPT_TIMEOUT, AUTH_TIMEOUT);
+	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
 	curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
 	curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
-	//curl_easy_setopt(curl, CURLOPT_HTTPHEADER, slist);
 	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
 
 	curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
@@ -88,9 +233,10 @@ bool AuthBlock(uint32_t height, uint32_t nonce, ILogger& log) {
 
 	std::stringstream ss; ss << std::hex << std::setfill('0') << std::setw(8) << __builtin_bswap32(nonce);
 
+	bool authorized = false;
 	for (size_t i = 0; i < endpoints.size(); ++i) {
 
-		std::string url(std::string(endpoints[i]) + "/api/v2/node?method=verify_block&height=" + std::to_string(height) + "&nonce=" + ss.str());
+		std::string url(endpoints[i] + "/api/v2/node?method=verify_block&height=" + std::to_string(height) + "&nonce=" + ss.str());
 		logger(DEBUGGING) << "Authentication request: " << url;
 
 		std::string readBuffer;
@@ -110,13 +256,13 @@ bool AuthBlock(uint32_t height, uint32_t nonce, ILogger& log) {
 				JsonValue json;
 				stream >> json;
 				if (json.contains("status") && json("status").isBool()) {
-					if (json("status").getBool()) {
+					authorized = json("status").getBool();
+					if (authorized) {
 						logger(INFO) << "Block " << height << " authorized [" << endpoints[i] << "] [" << resp << "ms]";
-						return true;
 					} else {
 						logger(WARNING) << "Block " << height << " not authorized [" << endpoints[i] << "] [" << resp << "ms]";
-						return false;
 					}
+					break;
 				}
 			}
 			catch(const std::exception&) {
@@ -125,7 +271,9 @@ bool AuthBlock(uint32_t height, uint32_t nonce, ILogger& log) {
 		}
 		logger(ERROR) << "Block " << height << " authorization error [" << endpoints[i] << "] [" << resp << "ms]";
 	}
-	return false;
+
+	releaseHandle(curl);
+	return authorized;
 }
 
 bool UpdateLatestCheckpoint(bool testnet, ILogger& log, uint32_t& height, std::string& hash) {
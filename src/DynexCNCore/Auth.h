@@ -36,7 +36,16 @@
 
 #pragma once
 
+#include <cstdint>
+#include <future>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Common/BlockingQueue.h"
+#include "Common/LruCache.h"
 #include "Logging/ILogger.h"
 #include "Logging/LoggerRef.h"
 
@@ -46,7 +55,49 @@ using namespace Logging;
 
 namespace DynexCN {
 
-bool AuthBlock(uint32_t height, uint32_t nonce, ILogger& log);
+// Asks the authorization endpoints whether a block may be added to the chain. Requests run on a
+// small pool of workers, each keeping its own connection alive, so that the blocks of a sync batch
+// can be authorized ahead of their import. Approvals are remembered by (height, nonce).
+class BlockAuthorizer {
+public:
+  BlockAuthorizer(ILogger& log);
+  ~BlockAuthorizer();
+
+  void setEndpoints(const std::vector<std::string>& endpoints);
+
+  // Queues the request unless the answer is already known or on its way.
+  void prefetch(uint32_t height, uint32_t nonce);
+  // Waits for a queued request, if there is one.
+  void wait(uint32_t height, uint32_t nonce);
+  // Uses a remembered approval or a queued request, otherwise asks the endpoints directly.
+  bool authorize(uint32_t height, uint32_t nonce);
+
+private:
+  struct Request {
+    uint32_t height;
+    uint32_t nonce;
+    std::shared_ptr<std::promise<bool>> result;
+  };
+
+  bool request(uint32_t height, uint32_t nonce);
+  void complete(uint32_t height, uint32_t nonce, bool authorized);
+  std::shared_future<bool> pending(uint32_t height, uint32_t nonce);
+  void* acquireHandle();
+  void releaseHandle(void* curl);
+  void workerLoop();
+
+  LoggerRef logger;
+  std::mutex m_mutex;
+  std::vector<std::string> m_endpoints;
+  // idle CURL easy handles, each one keeps its connection open between requests
+  std::vector<void*> m_handles;
+  std::unordered_map<uint64_t, std::shared_future<bool>> m_pending;
+  LruCache<uint64_t, bool> m_authorized;
+  BlockingQueue<Request> m_requests;
+  std::vector<std::thread> m_workers;
+  bool m_stopping;
+};
+
 bool UpdateLatestCheckpoint(bool testnet, ILogger& log, uint32_t& height, std::string& hash);
 
 }
@@ -53,6 +53,11 @@ namespace DynexCN
     BlockIndex() : 
       m_index(m_container.get<1>()) {}
 
+    BlockIndex(const BlockIndex& other) :
+      m_container(other.m_container), m_index(m_container.get<1>()) {}
+
+    BlockIndex& operator=(const BlockIndex& other) = delete;
+
     void pop() {
       m_container.pop_back();
     }
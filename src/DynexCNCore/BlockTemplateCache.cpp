@@ -0,0 +1,100 @@
+// Copyright (c) 2021-2023, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+#include "BlockTemplateCache.h"
+
+#include "crypto/crypto.h"
+
+namespace DynexCN {
+
+namespace {
+
+const size_t MAX_CACHED_TEMPLATES = 16;
+
+bool sameAddress(const AccountPublicAddress& lhs, const AccountPublicAddress& rhs) {
+  return lhs.spendPublicKey == rhs.spendPublicKey && lhs.viewPublicKey == rhs.viewPublicKey;
+}
+
+}
+
+BlockTemplateCache::BlockTemplateCache() : m_version(0) {
+}
+
+uint64_t BlockTemplateCache::version() const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_version;
+}
+
+bool BlockTemplateCache::find(const Crypto::Hash& tailId, const AccountPublicAddress& address, const BinaryArray& extraNonce, Entry& entry) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (const auto& cached : m_entries) {
+    if (cached.block.previousBlockHash == tailId && sameAddress(cached.address, address) && cached.extraNonce == extraNonce) {
+      entry = cached;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void BlockTemplateCache::store(uint64_t version, const Entry& entry) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (version != m_version) {
+    return;
+  }
+
+  if (m_entries.size() >= MAX_CACHED_TEMPLATES) {
+    m_entries.erase(m_entries.begin());
+  }
+
+  m_entries.push_back(entry);
+}
+
+void BlockTemplateCache::blockchainUpdated() {
+  invalidate();
+}
+
+void BlockTemplateCache::poolUpdated() {
+  invalidate();
+}
+
+void BlockTemplateCache::invalidate() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  ++m_version;
+  m_entries.clear();
+}
+
+}
@@ -0,0 +1,83 @@
+// Copyright (c) 2021-2023, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "DynexCN.h"
+#include "DynexCNCore/Difficulty.h"
+#include "DynexCNCore/ICoreObserver.h"
+
+namespace DynexCN {
+
+// Keeps the block templates built on top of the current tail, one per miner address and extra
+// nonce, so miners polling for work get the same template until the chain or the pool changes.
+// The core's observer notifications invalidate it; a template is stored together with the version
+// it was built at, one built while a notification came in is not kept.
+class BlockTemplateCache : public ICoreObserver {
+public:
+  struct Entry {
+    Block block;
+    difficulty_type difficulty;
+    uint32_t height;
+    // the lower bound of the template timestamp, it is raised to the current time on each request
+    uint64_t minimalTimestamp;
+    AccountPublicAddress address;
+    BinaryArray extraNonce;
+  };
+
+  BlockTemplateCache();
+
+  uint64_t version() const;
+  bool find(const Crypto::Hash& tailId, const AccountPublicAddress& address, const BinaryArray& extraNonce, Entry& entry) const;
+  void store(uint64_t version, const Entry& entry);
+
+  // ICoreObserver
+  virtual void blockchainUpdated() override;
+  virtual void poolUpdated() override;
+
+private:
+  void invalidate();
+
+  mutable std::mutex m_mutex;
+  uint64_t m_version;
+  std::vector<Entry> m_entries;
+};
+
+}
@@ -53,6 +53,7 @@
 #include "TransactionExtra.h"
 
 #include "Auth.h"
+#include "BlockchainExplorer/BlockchainExplorerDataBuilder.h"
 
 using namespace Logging;
 using namespace Common;
@@ -69,6 +70,23 @@ std::string appendPath(const std::string& path, const std::string& fileName) {
   return result;
 }
 
+// Smallest memory budget of the decoded blocks cache, smaller configured budgets are raised to it.
+const uint64_t MIN_BLOCK_CACHE_SIZE = 1024 * 1024;
+
+// Most blocks decoded ahead of the merge during rebuildCache, and how often a partial
+// rebuild is saved so that an interrupted one resumes instead of starting over.
+const uint32_t REBUILD_BATCH_SIZE = 1000;
+const std::chrono::minutes REBUILD_CHECKPOINT_INTERVAL(10);
+
+// Blocks journaled before the cache is saved again and the journal starts over.
+const size_t JOURNAL_COMPACTION_BLOCKS = 10000;
+
+// Transactions whose check_non_privacy result is remembered, enough for a full mempool.
+const size_t NON_PRIVACY_CACHE_SIZE = 50000;
+
+// Proofs of work computed ahead of pushBlock, more than the blocks a synchronization downloads ahead.
+const size_t PROOF_OF_WORK_CACHE_SIZE = 8000;
+
 }
 
 namespace std {
@@ -149,7 +167,7 @@ void serialize(Blockchain::TransactionIndex& value, ISerializer& s) {
   s(value.transaction, "tx");
 }
 
-void serialize(Blockchain::SpentKeyImage& value, ISerializer& s) {
+void serialize(SpentKeyImage& value, ISerializer& s) {
   s(value.blockIndex, "block_index");
   s(value.keyImage, "key_image");
 }
@@ -158,7 +176,13 @@ class BlockCacheSerializer {
 
 public:
   BlockCacheSerializer(Blockchain& bs, const Crypto::Hash lastBlockHash, ILogger& logger) :
-    m_bs(bs), m_lastBlockHash(lastBlockHash), m_loaded(false), logger(logger, "BlockCacheSerializer") {
+    logger(logger, "BlockCacheSerializer"), m_loaded(false), m_blockIndex(bs.m_blockIndex), m_transactionMap(bs.m_transactionMap),
+    m_spentKeyImages(bs.spentKeyImages), m_outputs(bs.m_outputs), m_multisignatureOutputs(bs.m_multisignatureOutputs), m_lastBlockHash(lastBlockHash) {
+  }
+
+  BlockCacheSerializer(Blockchain::CacheSnapshot& snapshot, ILogger& logger) :
+    logger(logger, "BlockCacheSerializer"), m_loaded(false), m_blockIndex(snapshot.blockIndex), m_transactionMap(snapshot.transactionMap),
+    m_spentKeyImages(snapshot.spentKeyImages), m_outputs(snapshot.outputs), m_multisignatureOutputs(snapshot.multisignatureOutputs), m_lastBlockHash(snapshot.tailId) {
   }
 
   void load(const std::string& filename) {
@@ -176,16 +200,26 @@ public:
     }
   }
 
+  // Written next to the target and renamed over it, so a crash while saving keeps the previous cache.
   bool save(const std::string& filename) {
+    std::string tempFileName = filename + ".tmp";
     try {
-      std::ofstream file(filename, std::ios::binary);
-      if (!file) {
-        return false;
+      {
+        std::ofstream file(tempFileName, std::ios::binary);
+        if (!file) {
+          return false;
+        }
+
+        StdOutputStream stream(file);
+        BinaryOutputStreamSerializer s(stream);
+        DynexCN::serialize(*this, s);
+        file.flush();
+        if (!file) {
+          return false;
+        }
       }
 
-      StdOutputStream stream(file);
-      BinaryOutputStreamSerializer s(stream);
-      DynexCN::serialize(*this, s);
+      boost::filesystem::rename(tempFileName, filename);
     } catch (std::exception&) {
       return false;
     }
@@ -209,33 +243,48 @@ public:
       Crypto::Hash blockHash;
       s(blockHash, "last_block");
 
-      if (blockHash != m_lastBlockHash) {
-        return;
-      }
-
+      // A cache saved at another height is still loaded, the caller replays the journal on
+      // top of it, checks that the result is a prefix of the chain and rebuilds the rest.
     } else {
       operation = "- saving ";
       s(m_lastBlockHash, "last_block");
     }
 
     logger(INFO) << operation << "block index...";
-    s(m_bs.m_blockIndex, "block_index");
+    s(m_blockIndex, "block_index");
 
     logger(INFO) << operation << "transaction map...";
-    s(m_bs.m_transactionMap, "transactions");
+    s(m_transactionMap, "transactions");
 
     logger(INFO) << operation << "spent keys...";
+    // written in the order of spending, as a sequence of (block index, key image)
     if (s.type() == ISerializer::OUTPUT) {
-      writeSequence<Blockchain::SpentKeyImage>(m_bs.spentKeyImages.begin(), m_bs.spentKeyImages.end(), "spent_key_images", s);
+      size_t count = m_spentKeyImages.size();
+      s.beginArray(count, "spent_key_images");
+      m_spentKeyImages.forEach([&s](const SpentKeyImage& spentKeyImage) {
+        s(const_cast<SpentKeyImage&>(spentKeyImage), "");
+      });
+      s.endArray();
     } else {
-      readSequence<Blockchain::SpentKeyImage>(std::inserter(m_bs.spentKeyImages, m_bs.spentKeyImages.end()), "spent_key_images", s);
+      size_t count = 0;
+      // array of zero size is not written in KVBinaryOutputStreamSerializer
+      if (s.beginArray(count, "spent_key_images")) {
+        m_spentKeyImages.reserve(count);
+        while (count--) {
+          SpentKeyImage spentKeyImage;
+          s(spentKeyImage, "");
+          m_spentKeyImages.insert(spentKeyImage.keyImage, spentKeyImage.blockIndex);
+        }
+
+        s.endArray();
+      }
     }
 
     logger(INFO) << operation << "outputs...";
-    s(m_bs.m_outputs, "outputs");
+    s(m_outputs, "outputs");
 
     logger(INFO) << operation << "multi-signature outputs...";
-    s(m_bs.m_multisignatureOutputs, "multisig_outputs");
+    s(m_multisignatureOutputs, "multisig_outputs");
 
     auto dur = std::chrono::steady_clock::now() - start;
 
@@ -252,7 +301,11 @@ private:
 
   LoggerRef logger;
   bool m_loaded;
-  Blockchain& m_bs;
+  BlockIndex& m_blockIndex;
+  Blockchain::TransactionMap& m_transactionMap;
+  SpentKeyImageSet& m_spentKeyImages;
+  Blockchain::outputs_container& m_outputs;
+  Blockchain::MultisignatureOutputsContainer& m_multisignatureOutputs;
   Crypto::Hash m_lastBlockHash;
 };
 
@@ -260,7 +313,13 @@ class BlockchainIndicesSerializer {
 
 public:
   BlockchainIndicesSerializer(Blockchain& bs, const Crypto::Hash lastBlockHash, ILogger& logger) :
-    m_bs(bs), m_lastBlockHash(lastBlockHash), m_loaded(false), logger(logger, "BlockchainIndicesSerializer") {
+    logger(logger, "BlockchainIndicesSerializer"), m_loaded(false), m_addressIndex(bs.m_addressindex), m_paymentIdIndex(bs.m_paymentIdIndex),
+    m_timestampIndex(bs.m_timestampIndex), m_generatedTransactionsIndex(bs.m_generatedTransactionsIndex), m_lastBlockHash(lastBlockHash) {
+  }
+
+  BlockchainIndicesSerializer(Blockchain::CacheSnapshot& snapshot, ILogger& logger) :
+    logger(logger, "BlockchainIndicesSerializer"), m_loaded(false), m_addressIndex(snapshot.addressIndex), m_paymentIdIndex(snapshot.paymentIdIndex),
+    m_timestampIndex(snapshot.timestampIndex), m_generatedTransactionsIndex(snapshot.generatedTransactionsIndex), m_lastBlockHash(snapshot.tailId) {
   }
 
   void serialize(ISerializer& s) {
@@ -291,16 +350,16 @@ public:
     }
 
     logger(INFO) << operation << "Address index...";
-    s(m_bs.m_addressindex, "addressindex");
+    s(m_addressIndex, "addressindex");
 
     logger(INFO) << operation << "paymentID index...";
-    s(m_bs.m_paymentIdIndex, "paymentIdIndex");
+    s(m_paymentIdIndex, "paymentIdIndex");
 
     logger(INFO) << operation << "timestamp index...";
-    s(m_bs.m_timestampIndex, "timestampIndex");
+    s(m_timestampIndex, "timestampIndex");
 
     logger(INFO) << operation << "generated transactions index...";
-    s(m_bs.m_generatedTransactionsIndex, "generatedTransactionsIndex");
+    s(m_generatedTransactionsIndex, "generatedTransactionsIndex");
 
     m_loaded = true;
   }
@@ -327,16 +386,16 @@ public:
     }
 
     logger(INFO) << operation << "Address index...";
-    ar & m_bs.m_addressindex;
+    ar & m_addressIndex;
 
     logger(INFO) << operation << "paymentID index...";
-    ar & m_bs.m_paymentIdIndex;
+    ar & m_paymentIdIndex;
 
     logger(INFO) << operation << "timestamp index...";
-    ar & m_bs.m_timestampIndex;
+    ar & m_timestampIndex;
 
     logger(INFO) << operation << "generated transactions index...";
-    ar & m_bs.m_generatedTransactionsIndex;
+    ar & m_generatedTransactionsIndex;
 
     m_loaded = true;
   }
@@ -348,7 +407,10 @@ public:
 private:
   LoggerRef logger;
   bool m_loaded;
-  Blockchain& m_bs;
+  AddressIndex& m_addressIndex;
+  PaymentIdIndex& m_paymentIdIndex;
+  TimestampBlocksIndex& m_timestampIndex;
+  GeneratedTransactionsIndex& m_generatedTransactionsIndex;
   Crypto::Hash m_lastBlockHash;
 };
 
@@ -359,10 +421,15 @@ m_currency(currency),
 m_tx_pool(tx_pool),
 m_current_block_cumul_sz_limit(0),
 m_is_in_checkpoint_zone(false),
+m_cacheStorePending(false),
 m_upgradeDetectorV2(currency, m_blocks, BLOCK_MAJOR_VERSION_2, logger),
 m_upgradeDetectorV3(currency, m_blocks, BLOCK_MAJOR_VERSION_3, logger),
 m_upgradeDetectorV4(currency, m_blocks, BLOCK_MAJOR_VERSION_4, logger),
 m_checkpoints(logger),
+m_blockCacheSize(parameters::CRYPTONOTE_BLOCKS_CACHE_DEFAULT_SIZE * 1024 * 1024),
+m_nonPrivacyCache(NON_PRIVACY_CACHE_SIZE),
+m_proofOfWorkCache(PROOF_OF_WORK_CACHE_SIZE),
+m_authorizer(logger),
 m_paymentIdIndex(blockchainIndexesEnabled),
 m_addressindex(blockchainIndexesEnabled),
 m_timestampIndex(blockchainIndexesEnabled),
@@ -384,11 +451,11 @@ bool Blockchain::removeObserver(IBlockchainStorageObserver* observer) {
   return m_observerManager.remove(observer);
 }
 
-bool Blockchain::checkTransactionInputs(const DynexCN::Transaction& tx, BlockInfo& maxUsedBlock) {
+bool Blockchain::checkTransactionInputs(const DynexCN::CachedTransaction& tx, BlockInfo& maxUsedBlock) {
   return checkTransactionInputs(tx, maxUsedBlock.height, maxUsedBlock.id);
 }
 
-bool Blockchain::checkTransactionInputs(const DynexCN::Transaction& tx, BlockInfo& maxUsedBlock, BlockInfo& lastFailed) {
+bool Blockchain::checkTransactionInputs(const DynexCN::CachedTransaction& tx, BlockInfo& maxUsedBlock, BlockInfo& lastFailed) {
 
   BlockInfo tail;
 
@@ -444,12 +511,12 @@ bool Blockchain::checkTransactionSize(size_t blobSize) {
 }
 
 bool Blockchain::haveTransaction(const Crypto::Hash &id) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return m_transactionMap.find(id) != m_transactionMap.end();
 }
 
 bool Blockchain::have_tx_keyimg_as_spent(const Crypto::KeyImage &key_im) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return  checkIfSpent(key_im);
 }
 
@@ -459,18 +526,18 @@ bool Blockchain::check_tx_inputs_keyimages_domain(const Crypto::KeyImage& keyIma
 }
 
 bool Blockchain::checkIfSpent(const Crypto::KeyImage& keyImage, uint32_t blockIndex) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  auto it = spentKeyImages.get<KeyImageTag>().find(keyImage);
-  if (check_tx_inputs_keyimages_domain(keyImage) && it == spentKeyImages.get<KeyImageTag>().end()) {
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  uint32_t spentIndex;
+  if (!spentKeyImages.find(keyImage, spentIndex)) {
     return false;
   }
 
-  return it->blockIndex <= blockIndex;
+  return spentIndex <= blockIndex;
 }
 
 bool Blockchain::checkIfSpent(const Crypto::KeyImage& keyImage) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  if (check_tx_inputs_keyimages_domain(keyImage) && spentKeyImages.get<KeyImageTag>().count(keyImage) != 0) {
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  if (check_tx_inputs_keyimages_domain(keyImage) && spentKeyImages.contains(keyImage)) {
     return true;
   }
 
@@ -478,7 +545,7 @@ bool Blockchain::checkIfSpent(const Crypto::KeyImage& keyImage) {
 }
 
 uint32_t Blockchain::getCurrentBlockchainHeight() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return static_cast<uint32_t>(m_blocks.size());
 }
 
@@ -491,38 +558,91 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
 
   m_config_folder = config_folder;
 
+  if (m_blockCacheSize < MIN_BLOCK_CACHE_SIZE) {
+    logger(WARNING, BRIGHT_YELLOW) << "Block cache size of " << m_blockCacheSize << " bytes is below the minimum, using " << MIN_BLOCK_CACHE_SIZE << " bytes";
+    m_blockCacheSize = MIN_BLOCK_CACHE_SIZE;
+  }
+
   logger(INFO, BRIGHT_WHITE) << "Loading blockchain...";
-  if (!m_blocks.open(appendPath(config_folder, m_currency.blocksFileName()), appendPath(config_folder, m_currency.blockIndexesFileName()), 1024)) {
+  if (!m_blocks.open(appendPath(config_folder, m_currency.blocksFileName()), appendPath(config_folder, m_currency.blockIndexesFileName()), m_blockCacheSize)) {
+    logger(ERROR, BRIGHT_RED) << "Failed to open blocks file " << appendPath(config_folder, m_currency.blocksFileName());
     return false;
   }
 
+  const std::string journalFileName = appendPath(config_folder, m_currency.blocksCacheJournalFileName());
   if (load_existing && !m_blocks.empty()) {
-    bool needRebuild = false;
-
-    BlockCacheSerializer loader(*this, get_block_hash(m_blocks.back().bl), logger.getLogger());
+    bool cacheLoaded = false;
+    BlockCacheSerializer loader(*this, get_block_hash(m_blocks.back()->bl), logger.getLogger());
     loader.load(appendPath(config_folder, m_currency.blocksCacheFileName()));
-    if (!loader.loaded()) {
-      logger(WARNING, BRIGHT_YELLOW) << "No actual blockchain cache found, rebuilding internal structures...";
-      needRebuild = true;
+    if (loader.loaded() && m_blockIndex.size() != 0) {
+      cacheLoaded = true;
+      if (m_blockchainIndexesEnabled) {
+        logger(INFO, BRIGHT_WHITE) << "Loading blockchain indices for BlockchainExplorer...";
+        BlockchainIndicesSerializer indicesLoader(*this, m_blockIndex.getTailId(), logger.getLogger());
+
+        loadFromBinaryFile(indicesLoader, appendPath(m_config_folder, m_currency.blockchainIndicesFileName()));
+
+        if (!indicesLoader.loaded()) {
+          logger(WARNING, BRIGHT_YELLOW) << "No actual blockchain indices for BlockchainExplorer found, rebuilding...";
+          cacheLoaded = false;
+        }
+      }
     }
 
-    if (!needRebuild && m_blockchainIndexesEnabled) {
-      logger(INFO, BRIGHT_WHITE) << "Loading blockchain indices for BlockchainExplorer...";
-      BlockchainIndicesSerializer loader(*this, get_block_hash(m_blocks.back().bl), logger.getLogger());
+    if (!cacheLoaded) {
+      clearCache();
+    }
+
+    // The journal either continues the loaded cache or, when its base is the empty chain, replaces it.
+    std::vector<BlockchainJournal::Record> records;
+    bool journalReplayed = false;
+    if (m_journal.load(journalFileName, records)) {
+      Crypto::Hash cacheTailId = m_blockIndex.size() == 0 ? NULL_HASH : m_blockIndex.getTailId();
+      bool journalMatches = m_journal.baseHeight() == m_blockIndex.size() && m_journal.baseHash() == cacheTailId;
+      if (!journalMatches && m_journal.baseHeight() == 0 && m_journal.baseHash() == NULL_HASH) {
+        clearCache();
+        journalMatches = true;
+      }
 
-      loadFromBinaryFile(loader, appendPath(m_config_folder, m_currency.blockchainIndicesFileName()));
+      if (journalMatches) {
+        if (!records.empty()) {
+          logger(INFO, BRIGHT_WHITE) << "Replaying " << records.size() << " blockchain journal records...";
+        }
 
-      if (!loader.loaded()) {
-        logger(WARNING, BRIGHT_YELLOW) << "No actual blockchain indices for BlockchainExplorer found, rebuilding...";
-        needRebuild = true;
+        journalReplayed = replayJournal(records) && m_journal.isOpened();
       }
     }
 
-    if (needRebuild) {
-      rebuildCache();
+    uint32_t cachedHeight = m_blockIndex.size();
+    if (cachedHeight != 0 && (cachedHeight > m_blocks.size() || get_block_hash(m_blocks[cachedHeight - 1]->bl) != m_blockIndex.getTailId())) {
+      clearCache();
+      cachedHeight = 0;
+    }
+
+    if (cachedHeight == 0) {
+      logger(WARNING, BRIGHT_YELLOW) << "No actual blockchain cache found, rebuilding internal structures...";
+      rebuildCache(0);
+    } else if (cachedHeight < m_blocks.size()) {
+      logger(WARNING, BRIGHT_YELLOW) << "Blockchain cache ends at height " << cachedHeight << " of " << m_blocks.size() << ", rebuilding the rest...";
+      rebuildCache(cachedHeight);
+    }
+
+    // Keep appending only to a journal that describes exactly the cache built above,
+    // otherwise save a new snapshot for a fresh journal to start from.
+    if (!journalReplayed || cachedHeight != m_blocks.size()) {
+      storeCache();
     }
   } else {
     m_blocks.clear();
+    if (!m_journal.reset(journalFileName, NULL_HASH, 0)) {
+      logger(ERROR, BRIGHT_RED) << "Failed to create blockchain journal: " << journalFileName;
+      return false;
+    }
+  }
+
+  if (!loadBlockHeaders()) {
+    logger(ERROR, BRIGHT_RED) << "Failed to load block headers";
+    return false;
   }
 
   if (m_blocks.empty()) {
@@ -535,7 +655,7 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
       return false;
     }
   } else {
-    Crypto::Hash firstBlockHash = get_block_hash(m_blocks[0].bl);
+    Crypto::Hash firstBlockHash = get_block_hash(m_blocks[0]->bl);
     if (!(firstBlockHash == m_currency.genesisBlockHash())) {
       logger(ERROR, BRIGHT_RED) << "Failed to init: genesis block mismatch. "
         "Probably you set --testnet flag with data "
@@ -560,19 +680,19 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
   if (!checkUpgradeHeight(m_upgradeDetectorV2)) {
     uint32_t upgradeHeight = m_upgradeDetectorV2.upgradeHeight();
     assert(upgradeHeight != UpgradeDetectorBase::UNDEF_HEIGHT);
-    logger(WARNING, BRIGHT_YELLOW) << "Invalid block version at " << upgradeHeight + 1 << ": real=" << static_cast<int>(m_blocks[upgradeHeight + 1].bl.majorVersion) <<
+    logger(WARNING, BRIGHT_YELLOW) << "Invalid block version at " << upgradeHeight + 1 << ": real=" << static_cast<int>(m_blocks[upgradeHeight + 1]->bl.majorVersion) <<
       " expected=" << static_cast<int>(m_upgradeDetectorV2.targetVersion()) << ". Rollback blockchain to height=" << upgradeHeight;
     rollbackBlockchainTo(upgradeHeight);
     reinitUpgradeDetectors = true;
   } else if (!checkUpgradeHeight(m_upgradeDetectorV3)) {
     uint32_t upgradeHeight = m_upgradeDetectorV3.upgradeHeight();
-    logger(WARNING, BRIGHT_YELLOW) << "Invalid block version at " << upgradeHeight + 1 << ": real=" << static_cast<int>(m_blocks[upgradeHeight + 1].bl.majorVersion) <<
+    logger(WARNING, BRIGHT_YELLOW) << "Invalid block version at " << upgradeHeight + 1 << ": real=" << static_cast<int>(m_blocks[upgradeHeight + 1]->bl.majorVersion) <<
       " expected=" << static_cast<int>(m_upgradeDetectorV3.targetVersion()) << ". Rollback blockchain to height=" << upgradeHeight;
     rollbackBlockchainTo(upgradeHeight);
     reinitUpgradeDetectors = true;
   } else if (!checkUpgradeHeight(m_upgradeDetectorV4)) {
     uint32_t upgradeHeight = m_upgradeDetectorV4.upgradeHeight();
-    logger(WARNING, BRIGHT_YELLOW) << "Invalid block version at " << upgradeHeight + 1 << ": real=" << static_cast<int>(m_blocks[upgradeHeight + 1].bl.majorVersion) <<
+    logger(WARNING, BRIGHT_YELLOW) << "Invalid block version at " << upgradeHeight + 1 << ": real=" << static_cast<int>(m_blocks[upgradeHeight + 1]->bl.majorVersion) <<
       " expected=" << static_cast<int>(m_upgradeDetectorV4.targetVersion()) << ". Rollback blockchain to height=" << upgradeHeight;
     rollbackBlockchainTo(upgradeHeight);
     reinitUpgradeDetectors = true;
@@ -585,8 +705,8 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
 
   update_next_cumulative_size_limit();
 
-  uint64_t timestamp_diff = time(NULL) - m_blocks.back().bl.timestamp;
-  if (!m_blocks.back().bl.timestamp) {
+  uint64_t timestamp_diff = time(NULL) - m_blockHeaders.back().timestamp;
+  if (!m_blockHeaders.back().timestamp) {
     timestamp_diff = time(NULL) - GENESIS_TIMESTAMP;
   }
 
@@ -597,8 +717,7 @@ bool Blockchain::init(const std::string& config_folder, bool load_existing) {
   return true;
 }
 
-void Blockchain::rebuildCache() {
-  std::chrono::steady_clock::time_point timePoint = std::chrono::steady_clock::now();
+void Blockchain::clearCache() {
   m_blockIndex.clear();
   m_transactionMap.clear();
   spentKeyImages.clear();
@@ -610,84 +729,395 @@ void Blockchain::rebuildCache() {
   m_paymentIdIndex.clear();
   m_timestampIndex.clear();
   m_generatedTransactionsIndex.clear();
+}
+
+void Blockchain::rebuildCache(uint32_t startHeight) {
+  std::chrono::steady_clock::time_point timePoint = std::chrono::steady_clock::now();
+  if (startHeight == 0) {
+    clearCache();
+  }
 
   if (m_blocks.empty()) return;
 
-  auto nextBlock = std::cref(m_blocks[0]);
+  // Blocks are decoded and hashed by the pool one batch ahead of the merge. The merge is one
+  // more task of the same run and stays sequential, so every container is filled in height order.
+  // The two batches in flight take half of the block cache budget, the cache keeps the rest.
+  uint64_t batchBudget = m_blockCacheSize / 4;
+  m_blocks.setCacheBudget(m_blockCacheSize - 2 * batchBudget);
+
+  uint32_t height = static_cast<uint32_t>(m_blocks.size());
+  std::vector<BlockIndexDelta> batch;
+  std::vector<BlockIndexDelta> nextBatch;
+  // a single block gives the first estimate of the batch size
+  batch.resize(1);
+  makeRebuildDelta(startHeight, batch[0]);
+
+  std::chrono::steady_clock::time_point checkpointTime = std::chrono::steady_clock::now();
+  for (uint32_t b = startHeight; b < height;) {
+    uint32_t nextBatchHeight = b + static_cast<uint32_t>(batch.size());
+    uint64_t blockSize = std::max<uint64_t>(1, rebuildBatchSize(batch) / batch.size());
+    uint64_t budgetedCount = std::max<uint64_t>(1, std::min<uint64_t>(REBUILD_BATCH_SIZE, batchBudget / blockSize));
+    uint32_t nextBatchCount = static_cast<uint32_t>(std::min<uint64_t>(height - nextBatchHeight, budgetedCount));
+    nextBatch.clear();
+    nextBatch.resize(nextBatchCount);
+
+    // workers touch only m_blocks, which is safe for concurrent reads
+    m_threadPool.run(nextBatchCount + 1, [&](size_t i) {
+      if (i != 0) {
+        makeRebuildDelta(nextBatchHeight + static_cast<uint32_t>(i - 1), nextBatch[i - 1]);
+        return true;
+      }
+
+      for (const BlockIndexDelta& delta : batch) {
+        if (b % 10000 == 0 && b) {
+          logger(INFO, BRIGHT_WHITE) << "Height " << b << " of " << m_blocks.size();
+        }
+
+        assert(delta.height == b);
+        applyBlockIndexDelta(delta);
+        ++b;
+      }
+
+      return true;
+    });
+
+    batch.swap(nextBatch);
 
-  for (uint32_t b = 0; b < m_blocks.size(); ++b) {
-    if (b % 10000 == 0 && b) {
-      logger(INFO, BRIGHT_WHITE) << "Height " << b << " of " << m_blocks.size();
+    if (b < height && std::chrono::steady_clock::now() - checkpointTime >= REBUILD_CHECKPOINT_INTERVAL) {
+      logger(INFO, BRIGHT_WHITE) << "Saving rebuild progress at height " << b << "...";
+      storeCache();
+      checkpointTime = std::chrono::steady_clock::now();
     }
+  }
 
-    const BlockEntry& block = nextBlock;
-    Crypto::Hash blockHash;
+  m_blocks.setCacheBudget(m_blockCacheSize);
 
-    if (b + 1 < m_blocks.size()) {
-      nextBlock = std::cref(m_blocks[b+1]);
-      const BlockEntry& bei = nextBlock;
-      blockHash = bei.bl.previousBlockHash;
-      assert(blockHash == get_block_hash(block.bl));
-    } else {
-      blockHash = get_block_hash(block.bl);
+  std::chrono::duration<double> duration = std::chrono::steady_clock::now() - timePoint;
+  logger(INFO, BRIGHT_WHITE) << "Rebuilding internal structures took: " << duration.count();
+}
+
+void Blockchain::makeRebuildDelta(uint32_t height, BlockIndexDelta& delta) {
+  std::shared_ptr<const BlockEntry> block = m_blocks[height];
+  makeBlockIndexDelta(*block, get_block_hash(block->bl), delta);
+}
+
+// Approximate memory held by a batch of decoded blocks.
+uint64_t Blockchain::rebuildBatchSize(const std::vector<BlockIndexDelta>& batch) {
+  uint64_t size = batch.capacity() * sizeof(BlockIndexDelta);
+  for (const BlockIndexDelta& delta : batch) {
+    size += delta.transactions.capacity() * sizeof(TransactionIndexDelta);
+    for (const TransactionIndexDelta& transaction : delta.transactions) {
+      size += transaction.keyImages.capacity() * sizeof(Crypto::KeyImage);
+      size += transaction.multisignatureInputs.capacity() * sizeof(MultisignatureInputDelta);
+      size += transaction.outputs.capacity() * sizeof(OutputDelta);
+      for (const std::string& address : transaction.addresses) {
+        size += sizeof(std::string) + address.capacity();
+      }
     }
-    m_blockIndex.push(blockHash);
+  }
 
-    // blockchain indicies
-    m_timestampIndex.add(block.bl.timestamp, blockHash);
-    m_generatedTransactionsIndex.add(block.bl);
+  return size;
+}
+
+void Blockchain::makeBlockIndexDelta(const BlockEntry& block, const Crypto::Hash& blockHash, BlockIndexDelta& delta) const {
+  assert(block.bl.transactionHashes.size() + 1 == block.transactions.size());
+
+  delta.hash = blockHash;
+  delta.height = block.height;
+  delta.timestamp = block.bl.timestamp;
+  delta.transactions.resize(block.transactions.size());
+  for (size_t t = 0; t < block.transactions.size(); ++t) {
+    const Transaction& tx = block.transactions[t].tx;
+    TransactionIndexDelta& transaction = delta.transactions[t];
+    if (t) {
+      transaction.hash = block.bl.transactionHashes[t - 1];
+      assert(transaction.hash == getObjectHash(tx));
+    } else {
+      transaction.hash = getObjectHash(tx);
+    }
 
-    assert(block.bl.transactionHashes.size() + 1 == block.transactions.size());
+    transaction.keyImages.clear();
+    transaction.multisignatureInputs.clear();
+    for (const auto& input : tx.inputs) {
+      if (input.type() == typeid(KeyInput)) {
+        transaction.keyImages.push_back(::boost::get<KeyInput>(input).keyImage);
+      } else if (input.type() == typeid(MultisignatureInput)) {
+        const auto& in = ::boost::get<MultisignatureInput>(input);
+        transaction.multisignatureInputs.push_back(MultisignatureInputDelta{ in.amount, in.outputIndex });
+      }
+    }
 
-    for (uint16_t t = 0; t < block.transactions.size(); ++t) {
-      const TransactionEntry& transaction = block.transactions[t];
-      Crypto::Hash transactionHash;
-      if (t) {
-        transactionHash = block.bl.transactionHashes[t - 1];
-        assert(transactionHash == getObjectHash(transaction.tx));
+    transaction.outputs.resize(tx.outputs.size());
+    for (size_t o = 0; o < tx.outputs.size(); ++o) {
+      const auto& out = tx.outputs[o];
+      transaction.outputs[o].amount = out.amount;
+      if (out.target.type() == typeid(KeyOutput)) {
+        transaction.outputs[o].type = OutputDelta::KEY;
+      } else if (out.target.type() == typeid(MultisignatureOutput)) {
+        transaction.outputs[o].type = OutputDelta::MULTISIGNATURE;
       } else {
-        transactionHash = getObjectHash(transaction.tx);
+        transaction.outputs[o].type = OutputDelta::OTHER;
       }
+    }
 
-      TransactionIndex transactionIndex = { b, t };
-      m_transactionMap.insert(std::make_pair(transactionHash, transactionIndex));
+    transaction.hasPaymentId = false;
+    transaction.paymentId = NULL_HASH;
+    transaction.addresses.clear();
+    if (m_blockchainIndexesEnabled) {
+      transaction.hasPaymentId = BlockchainExplorerDataBuilder::getPaymentId(tx, transaction.paymentId);
+      BlockchainExplorerDataBuilder::getAddresses(tx, transaction.addresses);
+    }
+  }
+}
 
-      // blockchain indicies
-      m_paymentIdIndex.add(transaction.tx, transactionHash);
-      m_addressindex.add(transaction.tx, transactionHash);
+void Blockchain::applyBlockIndexDelta(const BlockIndexDelta& delta) {
+  uint32_t b = delta.height;
+  assert(b == m_blockIndex.size());
+  m_blockIndex.push(delta.hash);
 
-      // process inputs
-      for (const auto& it : transaction.tx.inputs) {
-          if (it.type() == typeid(KeyInput)) {
-              spentKeyImages.get<BlockIndexTag>().insert(SpentKeyImage{ b, ::boost::get<KeyInput>(it).keyImage });
-          }
-          else if (it.type() == typeid(MultisignatureInput)) {
-              const auto& out = ::boost::get<MultisignatureInput>(it);
-              m_multisignatureOutputs[out.amount][out.outputIndex].isUsed = true;
-          }
+  // blockchain indicies
+  m_timestampIndex.add(delta.timestamp, delta.hash);
+  m_generatedTransactionsIndex.add(b, delta.transactions.size());
+
+  for (uint16_t t = 0; t < delta.transactions.size(); ++t) {
+    const TransactionIndexDelta& transaction = delta.transactions[t];
+
+    TransactionIndex transactionIndex = { b, t };
+    m_transactionMap.insert(std::make_pair(transaction.hash, transactionIndex));
+
+    // blockchain indicies
+    if (transaction.hasPaymentId) {
+      m_paymentIdIndex.add(transaction.paymentId, transaction.hash);
+    }
+
+    m_addressindex.add(transaction.addresses, transaction.hash);
+
+    // process inputs
+    for (const auto& keyImage : transaction.keyImages) {
+      spentKeyImages.insert(keyImage, b);
+    }
+
+    for (const auto& in : transaction.multisignatureInputs) {
+      m_multisignatureOutputs[in.amount][in.outputIndex].isUsed = true;
+    }
+
+    // process outputs
+    for (uint16_t o = 0; o < transaction.outputs.size(); ++o) {
+      const auto& out = transaction.outputs[o];
+      if (out.type == OutputDelta::KEY) {
+        m_outputs[out.amount].push_back(std::make_pair<>(transactionIndex, o));
+      } else if (out.type == OutputDelta::MULTISIGNATURE) {
+        MultisignatureOutputUsage usage = { transactionIndex, o, false };
+        m_multisignatureOutputs[out.amount].push_back(usage);
       }
+    }
+  }
+}
+
+// Undoes applyBlockIndexDelta for the last block, in the order removeLastBlock pops a block.
+void Blockchain::revertBlockIndexDelta(const BlockIndexDelta& delta) {
+  assert(delta.height + 1 == m_blockIndex.size());
+
+  for (size_t i = 0; i < delta.transactions.size(); ++i) {
+    const TransactionIndexDelta& transaction = delta.transactions[delta.transactions.size() - 1 - i];
+
+    for (size_t o = 0; o < transaction.outputs.size(); ++o) {
+      const auto& out = transaction.outputs[transaction.outputs.size() - 1 - o];
+      if (out.type == OutputDelta::KEY) {
+        auto amountOutputs = m_outputs.find(out.amount);
+        if (amountOutputs == m_outputs.end() || amountOutputs->second.empty()) {
+          logger(ERROR, BRIGHT_RED) << "Blockchain consistency broken - cannot find output to revert.";
+          continue;
+        }
 
-      // process outputs
-      for (uint16_t o = 0; o < transaction.tx.outputs.size(); ++o) {
-        const auto& out = transaction.tx.outputs[o];
-        if (out.target.type() == typeid(KeyOutput)) {
-          m_outputs[out.amount].push_back(std::make_pair<>(transactionIndex, o));
-        } else if (out.target.type() == typeid(MultisignatureOutput)) {
-          MultisignatureOutputUsage usage = { transactionIndex, o, false };
-          m_multisignatureOutputs[out.amount].push_back(usage);
+        amountOutputs->second.pop_back();
+        if (amountOutputs->second.empty()) {
+          m_outputs.erase(amountOutputs);
+        }
+      } else if (out.type == OutputDelta::MULTISIGNATURE) {
+        auto amountOutputs = m_multisignatureOutputs.find(out.amount);
+        if (amountOutputs == m_multisignatureOutputs.end() || amountOutputs->second.empty()) {
+          logger(ERROR, BRIGHT_RED) << "Blockchain consistency broken - cannot find output to revert.";
+          continue;
+        }
+
+        amountOutputs->second.pop_back();
+        if (amountOutputs->second.empty()) {
+          m_multisignatureOutputs.erase(amountOutputs);
         }
       }
     }
+
+    for (const auto& keyImage : transaction.keyImages) {
+      if (!spentKeyImages.erase(keyImage)) {
+        logger(ERROR, BRIGHT_RED) << "Blockchain consistency broken - cannot find spent key.";
+      }
+    }
+
+    for (const auto& in : transaction.multisignatureInputs) {
+      m_multisignatureOutputs[in.amount][in.outputIndex].isUsed = false;
+    }
+
+    if (transaction.hasPaymentId) {
+      m_paymentIdIndex.remove(transaction.paymentId, transaction.hash);
+    }
+
+    m_addressindex.remove(transaction.addresses, transaction.hash);
+    m_transactionMap.erase(transaction.hash);
   }
-  std::chrono::duration<double> duration = std::chrono::steady_clock::now() - timePoint;
-  logger(INFO, BRIGHT_WHITE) << "Rebuilding internal structures took: " << duration.count();
+
+  m_timestampIndex.remove(delta.timestamp, delta.hash);
+  m_generatedTransactionsIndex.remove(delta.height);
+  m_blockIndex.pop();
+}
+
+bool Blockchain::replayJournal(const std::vector<BlockchainJournal::Record>& records) {
+  // Blocks pushed by the journal on top of the chain, needed to unwind the ones blocks.dat lost.
+  std::vector<BlockIndexDelta> pushed;
+  bool replayed = true;
+  for (const auto& record : records) {
+    BlockIndexDelta delta;
+    if (!fromBinaryArray(delta, record.data)) {
+      logger(WARNING, BRIGHT_YELLOW) << "Invalid blockchain journal record, ignoring the rest of the journal";
+      replayed = false;
+      break;
+    }
+
+    if (record.type == BlockchainJournal::BLOCK_PUSHED) {
+      if (delta.height != m_blockIndex.size()) {
+        logger(WARNING, BRIGHT_YELLOW) << "Blockchain journal pushes block " << delta.height << " at height " << m_blockIndex.size() << ", ignoring the rest of the journal";
+        replayed = false;
+        break;
+      }
+
+      applyBlockIndexDelta(delta);
+      pushed.push_back(std::move(delta));
+    } else {
+      if (delta.height + 1 != m_blockIndex.size() || delta.hash != m_blockIndex.getTailId()) {
+        logger(WARNING, BRIGHT_YELLOW) << "Blockchain journal pops block " << delta.height << " which is not the last one, ignoring the rest of the journal";
+        replayed = false;
+        break;
+      }
+
+      revertBlockIndexDelta(delta);
+      if (!pushed.empty()) {
+        pushed.pop_back();
+      }
+    }
+  }
+
+  // blocks.dat may end earlier after a crash, the missing blocks have to be rolled back
+  while (m_blockIndex.size() > m_blocks.size() && !pushed.empty()) {
+    revertBlockIndexDelta(pushed.back());
+    pushed.pop_back();
+    replayed = false;
+  }
+
+  return replayed;
 }
 
+void Blockchain::journalBlock(BlockchainJournal::RecordType type, const BlockEntry& block, const Crypto::Hash& blockHash) {
+  if (!m_journal.isOpened()) {
+    return;
+  }
+
+  BlockIndexDelta delta;
+  makeBlockIndexDelta(block, blockHash, delta);
+  if (!m_journal.append(type, toBinaryArray(delta))) {
+    logger(WARNING, BRIGHT_YELLOW) << "Failed to write blockchain journal, the cache will be rebuilt from the last save on restart";
+  }
+}
+
+bool Blockchain::loadBlockHeaders() {
+  const std::string headersFileName = appendPath(m_config_folder, m_currency.blockHeadersFileName());
+  try {
+    try {
+      m_blockHeaders.open(headersFileName, Common::FileMappedVectorOpenMode::OPEN_OR_CREATE);
+    } catch (std::exception& e) {
+      logger(WARNING, BRIGHT_YELLOW) << "Failed to open block headers file, recreating: " << e.what();
+      if (m_blockHeaders.isOpened()) {
+        m_blockHeaders.close();
+      }
+
+      boost::filesystem::remove(headersFileName);
+      m_blockHeaders.open(headersFileName, Common::FileMappedVectorOpenMode::CREATE);
+    }
+
+    // blocks are flushed on deinit, entries lost on a crash are detected below
+    m_blockHeaders.setAutoFlush(false);
+
+    // keep only the prefix matching the main chain, the tail could be stale after an unclean shutdown
+    uint64_t validCount = std::min<uint64_t>(m_blockHeaders.size(), m_blocks.size());
+    for (uint64_t i = 0; i < validCount; ++i) {
+      if (m_blockHeaders[i].hash != m_blockIndex.getBlockId(static_cast<uint32_t>(i))) {
+        validCount = i;
+        break;
+      }
+    }
+
+    if (validCount < m_blockHeaders.size()) {
+      m_blockHeaders.erase(m_blockHeaders.begin() + validCount, m_blockHeaders.end());
+    }
+
+    if (m_blockHeaders.size() < m_blocks.size()) {
+      logger(INFO, BRIGHT_WHITE) << "Building block headers from height " << m_blockHeaders.size() << "...";
+      m_blockHeaders.reserve(m_blocks.size());
+      for (uint64_t i = m_blockHeaders.size(); i < m_blocks.size(); ++i) {
+        pushBlockHeader(*m_blocks[i], m_blockIndex.getBlockId(static_cast<uint32_t>(i)));
+      }
+
+      m_blockHeaders.flush();
+    }
+  } catch (std::exception& e) {
+    logger(ERROR, BRIGHT_RED) << "Failed to load block headers: " << e.what();
+    return false;
+  }
+
+  return true;
+}
+
+void Blockchain::pushBlockHeader(const BlockEntry& block, const Crypto::Hash& blockHash) {
+  BlockHeaderEntry header = boost::value_initialized<BlockHeaderEntry>();
+  header.timestamp = block.bl.timestamp;
+  header.cumulative_difficulty = block.cumulative_difficulty;
+  header.already_generated_coins = block.already_generated_coins;
+  header.block_cumulative_size = block.block_cumulative_size;
+  header.hash = blockHash;
+  header.majorVersion = block.bl.majorVersion;
+  m_blockHeaders.push_back(header);
+}
+
+Blockchain::CacheSnapshot::CacheSnapshot(const Blockchain& bs) :
+  tailId(bs.m_blockIndex.size() == 0 ? NULL_HASH : bs.m_blockIndex.getTailId()),
+  height(bs.m_blockIndex.size()),
+  journalRecordCount(bs.m_journal.recordCount()),
+  blockIndex(bs.m_blockIndex),
+  transactionMap(bs.m_transactionMap),
+  spentKeyImages(bs.spentKeyImages),
+  outputs(bs.m_outputs),
+  multisignatureOutputs(bs.m_multisignatureOutputs),
+  paymentIdIndex(bs.m_paymentIdIndex),
+  addressIndex(bs.m_addressindex),
+  timestampIndex(bs.m_timestampIndex),
+  generatedTransactionsIndex(bs.m_generatedTransactionsIndex) {
+}
+
+// The shared lock keeps writers out only while the cache state is copied, the copy is written
+// after it is released. The journal then starts again on top of the copy, keeping the records
+// appended while it was written. m_cacheStoreMutex is taken before the blockchain lock.
 bool Blockchain::storeCache() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::lock_guard<std::mutex> storeLock(m_cacheStoreMutex);
 
-  logger(INFO, BRIGHT_WHITE) << "Saving blockchain at height " << m_blocks.size() - 1 << "...";
-  BlockCacheSerializer ser(*this, getTailId(), logger.getLogger());
+  std::unique_ptr<CacheSnapshot> snapshot;
+  {
+    std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+    // the journal is cut below, blocks it covered must not be lost from blocks.dat
+    m_blocks.flush();
+    snapshot.reset(new CacheSnapshot(*this));
+  }
+
+  logger(INFO, BRIGHT_WHITE) << "Saving blockchain at height " << snapshot->height - 1 << "...";
+  BlockCacheSerializer ser(*snapshot, logger.getLogger());
   if (!ser.save(appendPath(m_config_folder, m_currency.blocksCacheFileName()))) {
     logger(ERROR, BRIGHT_RED) << "Failed to save blockchain cache";
     return false;
@@ -695,7 +1125,7 @@ bool Blockchain::storeCache() {
 
   if (m_blockchainIndexesEnabled) {
     logger(INFO, BRIGHT_WHITE) << "Saving blockchain indices...";
-    BlockchainIndicesSerializer ser(*this, getTailId(), logger.getLogger());
+    BlockchainIndicesSerializer ser(*snapshot, logger.getLogger());
 
     if (!storeToBinaryFile(ser, appendPath(m_config_folder, m_currency.blockchainIndicesFileName()))) {
       logger(ERROR, BRIGHT_RED) << "Failed to save blockchain indices";
@@ -703,11 +1133,31 @@ bool Blockchain::storeCache() {
     }
   }
 
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  if (!m_journal.rebase(appendPath(m_config_folder, m_currency.blocksCacheJournalFileName()), snapshot->tailId, snapshot->height, snapshot->journalRecordCount)) {
+    logger(ERROR, BRIGHT_RED) << "Failed to reset blockchain journal";
+    return false;
+  }
+
   return true;
 }
 
+// Compactions due are only marked while blocks are pushed or popped under the exclusive lock and
+// are written once it has been released.
+void Blockchain::storeCacheIfPending() {
+  if (m_cacheStorePending.exchange(false)) {
+    storeCache();
+  }
+}
+
 bool Blockchain::deinit() {
   storeCache();
+  m_journal.close();
+  m_blocks.flush();
+  if (m_blockHeaders.isOpened()) {
+    m_blockHeaders.flush();
+  }
+
   assert(m_messageQueueList.empty());
   return true;
 }
@@ -715,6 +1165,7 @@ bool Blockchain::deinit() {
 bool Blockchain::resetAndSetGenesisBlock(const Block& b) {
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   m_blocks.clear();
+  m_blockHeaders.clear();
   m_blockIndex.clear();
   m_transactionMap.clear();
 
@@ -728,6 +1179,10 @@ bool Blockchain::resetAndSetGenesisBlock(const Block& b) {
   m_generatedTransactionsIndex.clear();
   m_orphanBlocksIndex.clear();
 
+  if (!m_journal.reset(appendPath(m_config_folder, m_currency.blocksCacheJournalFileName()), NULL_HASH, 0)) {
+    logger(ERROR, BRIGHT_RED) << "Failed to reset blockchain journal";
+  }
+
   block_verification_context bvc = boost::value_initialized<block_verification_context>();
   addNewBlock(b, bvc);
   return bvc.m_added_to_main_chain && !bvc.m_verification_failed;
@@ -735,24 +1190,24 @@ bool Blockchain::resetAndSetGenesisBlock(const Block& b) {
 
 Crypto::Hash Blockchain::getTailId(uint32_t& height) {
   assert(!m_blocks.empty());
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   height = getCurrentBlockchainHeight() - 1;
   return getTailId();
 }
 
 Crypto::Hash Blockchain::getTailId() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return m_blocks.empty() ? NULL_HASH : m_blockIndex.getTailId();
 }
 
 std::vector<Crypto::Hash> Blockchain::buildSparseChain() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   assert(m_blockIndex.size() != 0);
   return doBuildSparseChain(m_blockIndex.getTailId());
 }
 
 std::vector<Crypto::Hash> Blockchain::buildSparseChain(const Crypto::Hash& startBlockId) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   assert(haveBlock(startBlockId));
   return doBuildSparseChain(startBlockId);
 }
@@ -789,18 +1244,18 @@ std::vector<Crypto::Hash> Blockchain::doBuildSparseChain(const Crypto::Hash& sta
 }
 
 Crypto::Hash Blockchain::getBlockIdByHeight(uint32_t height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   assert(height < m_blockIndex.size());
   return m_blockIndex.getBlockId(height);
 }
 
 bool Blockchain::getBlockByHash(const Crypto::Hash& blockHash, Block& b) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   uint32_t height = 0;
 
   if (m_blockIndex.getBlockHeight(blockHash, height)) {
-    b = m_blocks[height].bl;
+    b = m_blocks[height]->bl;
     return true;
   }
 
@@ -816,12 +1271,12 @@ bool Blockchain::getBlockByHash(const Crypto::Hash& blockHash, Block& b) {
 }
 
 bool Blockchain::getBlockHeight(const Crypto::Hash& blockId, uint32_t& blockHeight) {
-  std::lock_guard<decltype(m_blockchain_lock)> lock(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lock(m_blockchain_lock);
   return m_blockIndex.getBlockHeight(blockId, blockHeight);
 }
 
 difficulty_type Blockchain::getDifficultyForNextBlock() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   std::vector<uint64_t> timestamps;
   std::vector<difficulty_type> cumulative_difficulties;
   uint8_t BlockMajorVersion = getBlockMajorVersionForHeight(static_cast<uint32_t>(m_blocks.size()));
@@ -832,20 +1287,20 @@ difficulty_type Blockchain::getDifficultyForNextBlock() {
     ++offset;
   }
   for (; offset < m_blocks.size(); offset++) {
-    timestamps.push_back(m_blocks[offset].bl.timestamp);
-    cumulative_difficulties.push_back(m_blocks[offset].cumulative_difficulty);
+    timestamps.push_back(m_blockHeaders[offset].timestamp);
+    cumulative_difficulties.push_back(m_blockHeaders[offset].cumulative_difficulty);
   }
   return m_currency.nextDifficulty(static_cast<uint32_t>(m_blocks.size()), BlockMajorVersion, timestamps, cumulative_difficulties);
 }
 
 difficulty_type Blockchain::getAvgDifficultyForHeight(uint32_t height, uint32_t window) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   height = std::min<uint32_t>(height, (uint32_t)m_blocks.size() - 1);
   if (height <= 1)
     return 1;
 
   if (window == height) {
-    return m_blocks[height].cumulative_difficulty / height;
+    return m_blockHeaders[height].cumulative_difficulty / height;
   }
 
   size_t offset;
@@ -853,17 +1308,17 @@ difficulty_type Blockchain::getAvgDifficultyForHeight(uint32_t height, uint32_t
   if (offset == 0) {
     ++offset;
   }
-  difficulty_type cumulDiffForPeriod = m_blocks[height].cumulative_difficulty - m_blocks[offset].cumulative_difficulty;
+  difficulty_type cumulDiffForPeriod = m_blockHeaders[height].cumulative_difficulty - m_blockHeaders[offset].cumulative_difficulty;
   return cumulDiffForPeriod / std::min<uint32_t>(static_cast<uint32_t>(m_blocks.size() - 1), window);
 }
 
 uint64_t Blockchain::getBlockTimestamp(uint32_t height) {
   assert(height < m_blocks.size());
-  return m_blocks[height].bl.timestamp;
+  return m_blockHeaders[height].timestamp;
 }
 
 uint64_t Blockchain::getMinimalFee(uint32_t height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (height == 0 || m_blocks.size() <= 1) {
     return 0;
   }
@@ -885,21 +1340,21 @@ uint64_t Blockchain::getMinimalFee(uint32_t height) {
   // calculate average difficulty for ~last month
   uint64_t avgDifficultyCurrent = getAvgDifficultyForHeight(height, window * 7 * 4);
   // historical reference trailing average difficulty
-  uint64_t avgDifficultyHistorical = m_blocks[height].cumulative_difficulty / height;
+  uint64_t avgDifficultyHistorical = m_blockHeaders[height].cumulative_difficulty / height;
   // calculate average reward for ~last day (base, excluding fees)
-  uint64_t avgRewardCurrent = (m_blocks[height].already_generated_coins - m_blocks[offset].already_generated_coins) / window;
+  uint64_t avgRewardCurrent = (m_blockHeaders[height].already_generated_coins - m_blockHeaders[offset].already_generated_coins) / window;
   // historical reference trailing average reward
-  uint64_t avgRewardHistorical = m_blocks[height].already_generated_coins / height;
+  uint64_t avgRewardHistorical = m_blockHeaders[height].already_generated_coins / height;
 
   return m_currency.getMinimalFee(avgDifficultyCurrent, avgRewardCurrent, avgDifficultyHistorical, avgRewardHistorical, height);
 }
 
 uint64_t Blockchain::getCoinsInCirculation() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (m_blocks.empty()) {
     return 0;
   } else {
-    return m_blocks.back().already_generated_coins;
+    return m_blockHeaders.back().already_generated_coins;
   }
 }
 
@@ -1022,7 +1477,7 @@ bool Blockchain::switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::
   // Compare transactions in proposed alt chain vs current main chain and reject if some transaction is missing in the alt chain
   std::vector<Crypto::Hash> mainChainTxHashes, altChainTxHashes;
   for (size_t i = m_blocks.size() - 1; i >= split_height; i--) {
-    Block b = m_blocks[i].bl;
+    Block b = m_blocks[i]->bl;
     std::copy(b.transactionHashes.begin(), b.transactionHashes.end(), std::inserter(mainChainTxHashes, mainChainTxHashes.end()));
   }
   for (auto alt_ch_iter = alt_chain.begin(); alt_ch_iter != alt_chain.end(); alt_ch_iter++) {
@@ -1045,7 +1500,7 @@ bool Blockchain::switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::
   //disconnecting old chain
   std::list<Block> disconnected_chain;
   for (size_t i = m_blocks.size() - 1; i >= split_height; i--) {
-    Block b = m_blocks[i].bl;
+    Block b = m_blocks[i]->bl;
     popBlock();
     //if (!(r)) { logger(ERROR, BRIGHT_RED) << "failed to remove block on chain switching"; return false; }
     disconnected_chain.push_front(b);
@@ -1114,7 +1569,7 @@ difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const std:
   // if the alt chain isn't long enough to calculate the difficulty target
   // based on its blocks alone, need to get more blocks from the main chain
   if (alt_chain.size() < m_currency.difficultyBlocksCountByBlockVersion(BlockMajorVersion)) {
-    std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+    std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
     size_t main_chain_stop_offset = alt_chain.size() ? alt_chain.front()->second.height : bei.height;
     size_t main_chain_count = m_currency.difficultyBlocksCountByBlockVersion(BlockMajorVersion) - std::min(m_currency.difficultyBlocksCountByBlockVersion(BlockMajorVersion), alt_chain.size());
     main_chain_count = std::min(main_chain_count, main_chain_stop_offset);
@@ -1125,8 +1580,8 @@ difficulty_type Blockchain::get_next_difficulty_for_alternative_chain(const std:
 
     // get difficulties and timestamps from relevant main chain blocks
     for (; main_chain_start_offset < main_chain_stop_offset; ++main_chain_start_offset) {
-      timestamps.push_back(m_blocks[main_chain_start_offset].bl.timestamp);
-      cumulative_difficulties.push_back(m_blocks[main_chain_start_offset].cumulative_difficulty);
+      timestamps.push_back(m_blockHeaders[main_chain_start_offset].timestamp);
+      cumulative_difficulties.push_back(m_blockHeaders[main_chain_start_offset].cumulative_difficulty);
     }
 
     // make sure we haven't accidentally grabbed too many blocks... ???
@@ -1237,7 +1692,7 @@ bool Blockchain::validate_miner_transaction(const Block& b, uint32_t height, siz
 }
 
 bool Blockchain::getBackwardBlocksSize(size_t from_height, std::vector<size_t>& sz, size_t count) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (!(from_height < m_blocks.size())) {
     logger(ERROR, BRIGHT_RED)
       << "Internal error: get_backward_blocks_sizes called with from_height="
@@ -1246,14 +1701,14 @@ bool Blockchain::getBackwardBlocksSize(size_t from_height, std::vector<size_t>&
   }
   size_t start_offset = (from_height + 1) - std::min((from_height + 1), count);
   for (size_t i = start_offset; i != from_height + 1; i++) {
-    sz.push_back(m_blocks[i].block_cumulative_size);
+    sz.push_back(m_blockHeaders[i].block_cumulative_size);
   }
 
   return true;
 }
 
 bool Blockchain::get_last_n_blocks_sizes(std::vector<size_t>& sz, size_t count) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (!m_blocks.size()) {
     return true;
   }
@@ -1269,12 +1724,12 @@ bool Blockchain::complete_timestamps_vector(uint8_t blockMajorVersion, uint64_t
   if (timestamps.size() >= m_currency.timestampCheckWindow(blockMajorVersion))
     return true;
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   size_t need_elements = m_currency.timestampCheckWindow(blockMajorVersion) - timestamps.size();
   if (!(start_top_height < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "internal error: passed start_height = " << start_top_height << " not less then m_blocks.size()=" << m_blocks.size(); return false; }
   size_t stop_offset = start_top_height > need_elements ? start_top_height - need_elements : 0;
   do {
-    timestamps.push_back(m_blocks[start_top_height].bl.timestamp);
+    timestamps.push_back(m_blockHeaders[start_top_height].timestamp);
     if (start_top_height == 0)
       break;
     --start_top_height;
@@ -1346,8 +1801,7 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
       // make sure alt chain doesn't somehow start past the end of the main chain
       if (!(m_blocks.size() > alt_chain.front()->second.height)) { logger(ERROR, BRIGHT_RED) << "main blockchain wrong height"; return false; }
       // make sure block connects correctly to the main chain
-      Crypto::Hash h = NULL_HASH;
-      get_block_hash(m_blocks[alt_chain.front()->second.height - 1].bl, h);
+      Crypto::Hash h = m_blockHeaders[alt_chain.front()->second.height - 1].hash;
       if (!(h == alt_chain.front()->second.bl.previousBlockHash)) { logger(ERROR, BRIGHT_RED) << "alternative chain have wrong connection to main chain"; return false; }
       complete_timestamps_vector(b.majorVersion, alt_chain.front()->second.height - 1, timestamps);
     } else {
@@ -1392,7 +1846,7 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
     difficulty_type current_diff = get_next_difficulty_for_alternative_chain(alt_chain, bei);
     if (!(current_diff)) { logger(ERROR, BRIGHT_RED) << "!!!!!!! DIFFICULTY OVERHEAD !!!!!!!"; return false; }
     Crypto::Hash proof_of_work = NULL_HASH;
-    if (!m_currency.checkProofOfWork(m_cn_context, bei.bl, current_diff, proof_of_work)) {
+    if (!checkProofOfWork(bei.bl, id, current_diff, proof_of_work)) {
       logger(INFO, BRIGHT_RED) <<
         "Block with id: " << id
         << ENDL << " for alternative chain, have not enough proof of work: " << proof_of_work
@@ -1408,7 +1862,7 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
       return false;
     }
 
-    bei.cumulative_difficulty = alt_chain.size() ? it_prev->second.cumulative_difficulty : m_blocks[mainPrevHeight].cumulative_difficulty;
+    bei.cumulative_difficulty = alt_chain.size() ? it_prev->second.cumulative_difficulty : m_blockHeaders[mainPrevHeight].cumulative_difficulty;
     bei.cumulative_difficulty += current_diff;
 
 #ifdef _DEBUG
@@ -1436,11 +1890,11 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
         bvc.m_verification_failed = true;
       }
       return r;
-    } else if (m_blocks.back().cumulative_difficulty < bei.cumulative_difficulty) //check if difficulty bigger then in main chain
+    } else if (m_blockHeaders.back().cumulative_difficulty < bei.cumulative_difficulty) //check if difficulty bigger then in main chain
     {
       //do reorganize!
       logger(INFO, BRIGHT_GREEN) <<
-        "###### REORGANIZE on height: " << alt_chain.front()->second.height << " of " << m_blocks.size() - 1 << " with cum_difficulty " << m_blocks.back().cumulative_difficulty
+        "###### REORGANIZE on height: " << alt_chain.front()->second.height << " of " << m_blocks.size() - 1 << " with cum_difficulty " << m_blockHeaders.back().cumulative_difficulty
         << ENDL << " alternative blockchain size: " << alt_chain.size() << " with cum_difficulty " << bei.cumulative_difficulty;
       bool r = switch_to_alternative_blockchain(alt_chain, false);
       if (r) {
@@ -1472,13 +1926,13 @@ bool Blockchain::handle_alternative_block(const Block& b, const Crypto::Hash& id
 }
 
 bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks, std::list<Transaction>& txs) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (start_offset >= m_blocks.size())
     return false;
   for (size_t i = start_offset; i < start_offset + count && i < m_blocks.size(); i++) {
-    blocks.push_back(m_blocks[i].bl);
+    blocks.push_back(m_blocks[i]->bl);
     std::list<Crypto::Hash> missed_ids;
-    getTransactions(m_blocks[i].bl.transactionHashes, txs, missed_ids);
+    getTransactions(m_blocks[i]->bl.transactionHashes, txs, missed_ids);
     if (!(!missed_ids.size())) { logger(ERROR, BRIGHT_RED) << "have missed transactions in own block in main blockchain"; return false; }
   }
 
@@ -1486,26 +1940,26 @@ bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Bloc
 }
 
 bool Blockchain::getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (start_offset >= m_blocks.size()) {
     return false;
   }
 
   for (uint32_t i = start_offset; i < start_offset + count && i < m_blocks.size(); i++) {
-    blocks.push_back(m_blocks[i].bl);
+    blocks.push_back(m_blocks[i]->bl);
   }
 
   return true;
 }
 
 bool Blockchain::handleGetObjects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTIFY_RESPONSE_GET_OBJECTS::request& rsp) { //Deprecated. Should be removed with DynexCNProtocolHandler.
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   rsp.current_blockchain_height = getCurrentBlockchainHeight();
   std::list<Block> blocks;
   getBlocks(arg.blocks, blocks, rsp.missed_ids);
   for (const auto& bl : blocks) {
     std::list<Crypto::Hash> missed_tx_id;
-    std::list<Transaction> txs;
+    std::list<CachedTransaction> txs;
     getTransactions(bl.transactionHashes, txs, rsp.missed_ids);
     if (!(!missed_tx_id.size())) { logger(ERROR, BRIGHT_RED) << "Internal error: have missed missed_tx_id.size()=" << missed_tx_id.size() << ENDL << "for block id = " << get_block_hash(bl); return false; } //WTF???
     rsp.blocks.push_back(block_complete_entry());
@@ -1513,24 +1967,24 @@ bool Blockchain::handleGetObjects(NOTIFY_REQUEST_GET_OBJECTS::request& arg, NOTI
     //pack block
     e.block = asString(toBinaryArray(bl));
     //pack transactions
-    for (Transaction& tx : txs) {
-      e.txs.push_back(asString(toBinaryArray(tx)));
+    for (const CachedTransaction& tx : txs) {
+      e.txs.push_back(asString(tx.getTransactionBinaryArray()));
     }
   }
 
   //get another transactions, if need
-  std::list<Transaction> txs;
+  std::list<CachedTransaction> txs;
   getTransactions(arg.txs, txs, rsp.missed_ids);
   //pack aside transactions
   for (const auto& tx : txs) {
-    rsp.txs.push_back(asString(toBinaryArray(tx)));
+    rsp.txs.push_back(asString(tx.getTransactionBinaryArray()));
   }
 
   return true;
 }
 
 bool Blockchain::getAlternativeBlocks(std::list<Block>& blocks) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   for (auto& alt_bl : m_alternative_chains) {
     blocks.push_back(alt_bl.second.bl);
   }
@@ -1539,13 +1993,14 @@ bool Blockchain::getAlternativeBlocks(std::list<Block>& blocks) {
 }
 
 uint32_t Blockchain::getAlternativeBlocksCount() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return static_cast<uint32_t>(m_alternative_chains.size());
 }
 
 bool Blockchain::add_out_to_get_random_outs(std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs, uint64_t amount, size_t i) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
-  const Transaction& tx = transactionByIndex(amount_outs[i].first).tx;
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_ptr<const TransactionEntry> entry = transactionByIndex(amount_outs[i].first);
+  const Transaction& tx = entry->tx;
   if (!(tx.outputs.size() > amount_outs[i].second)) {
     logger(ERROR, BRIGHT_RED) << "internal error: in global outs index, transaction out index="
       << amount_outs[i].second << " more than transaction outputs = " << tx.outputs.size() << ", for tx id = " << getObjectHash(tx); return false;
@@ -1563,7 +2018,7 @@ bool Blockchain::add_out_to_get_random_outs(std::vector<std::pair<TransactionInd
 }
 
 size_t Blockchain::find_end_of_allowed_index(const std::vector<std::pair<TransactionIndex, uint16_t>>& amount_outs) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (amount_outs.empty()) {
     return 0;
   }
@@ -1580,7 +2035,7 @@ size_t Blockchain::find_end_of_allowed_index(const std::vector<std::pair<Transac
 }
 
 bool Blockchain::getRandomOutsByAmount(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   for (uint64_t amount : req.amounts) {
     COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount& result_outs = *res.outs.insert(res.outs.end(), COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::outs_for_amount());
@@ -1629,7 +2084,7 @@ uint32_t Blockchain::findBlockchainSupplement(const std::vector<Crypto::Hash>& q
   assert(!qblock_ids.empty());
   assert(qblock_ids.back() == m_blockIndex.getBlockId(0));
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   uint32_t blockIndex = 0;
   // assert above guarantees that method returns true
   m_blockIndex.findSupplement(qblock_ids, blockIndex);
@@ -1637,24 +2092,24 @@ uint32_t Blockchain::findBlockchainSupplement(const std::vector<Crypto::Hash>& q
 }
 
 uint64_t Blockchain::blockDifficulty(size_t i) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (!(i < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "wrong block index i = " << i << " at Blockchain::block_difficulty()"; return false; }
   if (i == 0)
-    return m_blocks[i].cumulative_difficulty;
+    return m_blockHeaders[i].cumulative_difficulty;
 
-  return m_blocks[i].cumulative_difficulty - m_blocks[i - 1].cumulative_difficulty;
+  return m_blockHeaders[i].cumulative_difficulty - m_blockHeaders[i - 1].cumulative_difficulty;
 }
 
 uint64_t Blockchain::blockCumulativeDifficulty(size_t i) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (!(i < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "wrong block index i = " << i << " at Blockchain::block_difficulty()"; return false; }
 
-  return m_blocks[i].cumulative_difficulty;
+  return m_blockHeaders[i].cumulative_difficulty;
 }
 
 void Blockchain::print_blockchain(uint64_t start_index, uint64_t end_index) {
   std::stringstream ss;
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (start_index >= m_blocks.size()) {
     logger(INFO, BRIGHT_WHITE) <<
       "Wrong starter index set: " << start_index << ", expected max index " << m_blocks.size() - 1;
@@ -1662,9 +2117,9 @@ void Blockchain::print_blockchain(uint64_t start_index, uint64_t end_index) {
   }
 
   for (size_t i = start_index; i != m_blocks.size() && i != end_index; i++) {
-    ss << "height " << i << ", timestamp " << m_blocks[i].bl.timestamp << ", cumul_dif " << m_blocks[i].cumulative_difficulty << ", cumul_size " << m_blocks[i].block_cumulative_size
-      << "\nid\t\t" << get_block_hash(m_blocks[i].bl)
-      << "\ndifficulty\t\t" << blockDifficulty(i) << ", nonce " << m_blocks[i].bl.nonce << ", tx_count " << m_blocks[i].bl.transactionHashes.size() << ENDL;
+    ss << "height " << i << ", timestamp " << m_blocks[i]->bl.timestamp << ", cumul_dif " << m_blocks[i]->cumulative_difficulty << ", cumul_size " << m_blocks[i]->block_cumulative_size
+      << "\nid\t\t" << get_block_hash(m_blocks[i]->bl)
+      << "\ndifficulty\t\t" << blockDifficulty(i) << ", nonce " << m_blocks[i]->bl.nonce << ", tx_count " << m_blocks[i]->bl.transactionHashes.size() << ENDL;
   }
   logger(DEBUGGING) <<
     "Current blockchain:" << ENDL << ss.str();
@@ -1674,7 +2129,7 @@ void Blockchain::print_blockchain(uint64_t start_index, uint64_t end_index) {
 
 void Blockchain::print_blockchain_index() {
   std::stringstream ss;
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   std::vector<Crypto::Hash> blockIds = m_blockIndex.getBlockIds(0, std::numeric_limits<uint32_t>::max());
   logger(INFO, BRIGHT_WHITE) << "Current blockchain index:";
@@ -1688,13 +2143,13 @@ void Blockchain::print_blockchain_index() {
 
 void Blockchain::print_blockchain_outs(const std::string& file) {
   std::stringstream ss;
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   for (const outputs_container::value_type& v : m_outputs) {
     const std::vector<std::pair<TransactionIndex, uint16_t>>& vals = v.second;
     if (!vals.empty()) {
       ss << "amount: " << v.first << ENDL;
       for (size_t i = 0; i != vals.size(); i++) {
-        ss << "\t" << getObjectHash(transactionByIndex(vals[i].first).tx) << ": " << vals[i].second << ENDL;
+        ss << "\t" << getObjectHash(transactionByIndex(vals[i].first)->tx) << ": " << vals[i].second << ENDL;
       }
     }
   }
@@ -1714,7 +2169,7 @@ std::vector<Crypto::Hash> Blockchain::findBlockchainSupplement(const std::vector
   assert(!remoteBlockIds.empty());
   assert(remoteBlockIds.back() == m_blockIndex.getBlockId(0));
 
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   totalBlockCount = getCurrentBlockchainHeight();
   startBlockIndex = findBlockchainSupplement(remoteBlockIds);
 
@@ -1722,7 +2177,7 @@ std::vector<Crypto::Hash> Blockchain::findBlockchainSupplement(const std::vector
 }
 
 bool Blockchain::haveBlock(const Crypto::Hash& id) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (m_blockIndex.hasBlock(id))
     return true;
 
@@ -1733,30 +2188,30 @@ bool Blockchain::haveBlock(const Crypto::Hash& id) {
 }
 
 size_t Blockchain::getTotalTransactions() {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return m_transactionMap.size();
 }
 
 bool Blockchain::getTransactionOutputGlobalIndexes(const Crypto::Hash& tx_id, std::vector<uint32_t>& indexs) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   auto it = m_transactionMap.find(tx_id);
   if (it == m_transactionMap.end()) {
     logger(WARNING, YELLOW) << "warning: get_tx_outputs_gindexs failed to find transaction with id = " << tx_id;
     return false;
   }
 
-  const TransactionEntry& tx = transactionByIndex(it->second);
-  if (!(tx.m_global_output_indexes.size())) { logger(ERROR, BRIGHT_RED) << "internal error: global indexes for transaction " << tx_id << " is empty"; return false; }
-  indexs.resize(tx.m_global_output_indexes.size());
-  for (size_t i = 0; i < tx.m_global_output_indexes.size(); ++i) {
-    indexs[i] = tx.m_global_output_indexes[i];
+  std::shared_ptr<const TransactionEntry> tx = transactionByIndex(it->second);
+  if (!(tx->m_global_output_indexes.size())) { logger(ERROR, BRIGHT_RED) << "internal error: global indexes for transaction " << tx_id << " is empty"; return false; }
+  indexs.resize(tx->m_global_output_indexes.size());
+  for (size_t i = 0; i < tx->m_global_output_indexes.size(); ++i) {
+    indexs[i] = tx->m_global_output_indexes[i];
   }
 
   return true;
 }
 
 bool Blockchain::get_out_by_msig_gindex(uint64_t amount, uint64_t gindex, MultisignatureOutput& out) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   auto it = m_multisignatureOutputs.find(amount);
   if (it == m_multisignatureOutputs.end()) {
     return false;
@@ -1767,7 +2222,8 @@ bool Blockchain::get_out_by_msig_gindex(uint64_t amount, uint64_t gindex, Multis
   }
 
   auto msigUsage = it->second[gindex];
-  auto& targetOut = transactionByIndex(msigUsage.transactionIndex).tx.outputs[msigUsage.outputIndex].target;
+  std::shared_ptr<const TransactionEntry> transaction = transactionByIndex(msigUsage.transactionIndex);
+  auto& targetOut = transaction->tx.outputs[msigUsage.outputIndex].target;
   if (targetOut.type() != typeid(MultisignatureOutput)) {
     return false;
   }
@@ -1778,8 +2234,8 @@ bool Blockchain::get_out_by_msig_gindex(uint64_t amount, uint64_t gindex, Multis
 
 
 
-bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t& max_used_block_height, Crypto::Hash& max_used_block_id, BlockInfo* tail) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+bool Blockchain::checkTransactionInputs(const CachedTransaction& tx, uint32_t& max_used_block_height, Crypto::Hash& max_used_block_id, BlockInfo* tail) {
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   if (tail)
     tail->id = getTailId(tail->height);
@@ -1787,7 +2243,7 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t& max_use
   bool res = checkTransactionInputs(tx, &max_used_block_height);
   if (!res) return false;
   if (!(max_used_block_height < m_blocks.size())) { logger(ERROR, BRIGHT_RED) << "internal error: max used block index=" << max_used_block_height << " is not less then blockchain size = " << m_blocks.size(); return false; }
-  get_block_hash(m_blocks[max_used_block_height].bl, max_used_block_id);
+  max_used_block_id = m_blockHeaders[max_used_block_height].hash;
   return true;
 }
 
@@ -1803,18 +2259,16 @@ bool Blockchain::haveTransactionKeyImagesAsSpent(const Transaction &tx) {
   return false;
 }
 
-bool Blockchain::checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height) {
-  Crypto::Hash tx_prefix_hash = getObjectHash(*static_cast<const TransactionPrefix*>(&tx));
-  return checkTransactionInputs(tx, tx_prefix_hash, pmax_used_block_height);
-}
-
-bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height) {
+// With ringSignatureChecks set the ring signatures are only collected there, the caller has to verify them.
+bool Blockchain::checkTransactionInputs(const CachedTransaction& transaction, uint32_t* pmax_used_block_height, std::vector<RingSignatureCheck>* ringSignatureChecks) {
   size_t inputIndex = 0;
   if (pmax_used_block_height) {
     *pmax_used_block_height = 0;
   }
 
-  Crypto::Hash transactionHash = getObjectHash(tx);
+  const Transaction& tx = transaction.getTransaction();
+  const Crypto::Hash& transactionHash = transaction.getTransactionHash();
+  const Crypto::Hash& tx_prefix_hash = transaction.getTransactionPrefixHash();
   for (const auto& txin : tx.inputs) {
     assert(inputIndex < tx.signatures.size());
     if (txin.type() == typeid(KeyInput)) {
@@ -1828,7 +2282,7 @@ bool Blockchain::checkTransactionInputs(const Transaction& tx, const Crypto::Has
         return false;
       }
 
-      if (!check_tx_input(in_to_key, tx_prefix_hash, tx.signatures[inputIndex], pmax_used_block_height)) {
+      if (!check_tx_input(in_to_key, tx_prefix_hash, tx.signatures[inputIndex], pmax_used_block_height, ringSignatureChecks)) {
         logger(INFO, BRIGHT_WHITE) <<
           "Failed to check ring signature for tx " << transactionHash;
         return false;
@@ -1882,14 +2336,14 @@ bool Blockchain::is_tx_spendtime_unlocked(uint64_t unlock_time, uint32_t height)
   return false;
 }
 
-bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height, std::vector<RingSignatureCheck>* ringSignatureChecks) {
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   struct outputs_visitor {
-    std::vector<const Crypto::PublicKey *>& m_results_collector;
+    std::vector<Crypto::PublicKey>& m_results_collector;
     Blockchain& m_bch;
     LoggerRef logger;
-    outputs_visitor(std::vector<const Crypto::PublicKey *>& results_collector, Blockchain& bch, ILogger& logger) :m_results_collector(results_collector), m_bch(bch), logger(logger, "outputs_visitor") {
+    outputs_visitor(std::vector<Crypto::PublicKey>& results_collector, Blockchain& bch, ILogger& logger) :m_results_collector(results_collector), m_bch(bch), logger(logger, "outputs_visitor") {
     }
 
     bool handle_output(const Transaction& tx, const TransactionOutput& out, size_t transactionOutputIndex) {
@@ -1906,7 +2360,8 @@ bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_pre
         return false;
       }
 
-      m_results_collector.push_back(&boost::get<KeyOutput>(out.target).key);
+      // the output belongs to a cached block that may be evicted before the key is used
+      m_results_collector.push_back(boost::get<KeyOutput>(out.target).key);
       return true;
     }
   };
@@ -1918,7 +2373,7 @@ bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_pre
   }
 
   //check ring signature
-  std::vector<const Crypto::PublicKey *> output_keys;
+  std::vector<Crypto::PublicKey> output_keys;
   outputs_visitor vi(output_keys, *this, logger.getLogger());
   if (!scanOutputKeysForIndexes(txin, vi, pmax_related_block_height)) {
     logger(INFO, BRIGHT_WHITE) <<
@@ -1938,13 +2393,54 @@ bool Blockchain::check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_pre
     return true;
   }
 
-  bool check_tx_ring_signature = Crypto::check_ring_signature(tx_prefix_hash, txin.keyImage, output_keys, sig.data());
+  if (ringSignatureChecks) {
+    RingSignatureCheck check;
+    check.prefixHash = tx_prefix_hash;
+    check.keyImage = txin.keyImage;
+    check.outputKeys = std::move(output_keys);
+    check.signatures = sig;
+    ringSignatureChecks->push_back(std::move(check));
+    return true;
+  }
+
+  std::vector<const Crypto::PublicKey*> output_key_ptrs;
+  output_key_ptrs.reserve(output_keys.size());
+  for (const Crypto::PublicKey& key : output_keys) {
+    output_key_ptrs.push_back(&key);
+  }
+
+  bool check_tx_ring_signature = Crypto::check_ring_signature(tx_prefix_hash, txin.keyImage, output_key_ptrs, sig.data());
   if (!check_tx_ring_signature) {
     logger(ERROR) << "Failed to check ring signature for keyImage: " << txin.keyImage;
   }
   return check_tx_ring_signature;
 }
 
+// Spreads the checks over the verification threads. Only the checks themselves are read, so the
+// workers need no blockchain lock and the caller may keep holding it exclusively.
+bool Blockchain::checkRingSignatures(const std::vector<RingSignatureCheck>& checks, size_t& failedCheck) {
+  std::atomic<size_t> firstFailed(checks.size());
+  m_threadPool.run(checks.size(), [&checks, &firstFailed](size_t i) {
+    const RingSignatureCheck& check = checks[i];
+    std::vector<const Crypto::PublicKey*> keys;
+    keys.reserve(check.outputKeys.size());
+    for (const Crypto::PublicKey& key : check.outputKeys) {
+      keys.push_back(&key);
+    }
+
+    if (!Crypto::check_ring_signature(check.prefixHash, check.keyImage, keys, check.signatures.data())) {
+      size_t expected = checks.size();
+      firstFailed.compare_exchange_strong(expected, i);
+      return false;
+    }
+
+    return true;
+  });
+
+  failedCheck = firstFailed;
+  return failedCheck == checks.size();
+}
+
 uint64_t Blockchain::get_adjusted_time() {
   //TODO: add collecting median time
   return time(NULL);
@@ -1960,7 +2456,7 @@ bool Blockchain::check_block_timestamp_main(const Block& b) {
   std::vector<uint64_t> timestamps;
   size_t offset = m_blocks.size() <= m_currency.timestampCheckWindow(b.majorVersion) ? 0 : m_blocks.size() - m_currency.timestampCheckWindow(b.majorVersion);
   for (; offset != m_blocks.size(); ++offset) {
-    timestamps.push_back(m_blocks[offset].bl.timestamp);
+    timestamps.push_back(m_blockHeaders[offset].timestamp);
   }
 
   return check_block_timestamp(std::move(timestamps), b);
@@ -2030,6 +2526,14 @@ bool Blockchain::checkParentBlockSize(const Block& b, const Crypto::Hash& blockH
   return true;
 }
 
+bool Blockchain::checkProofOfWork(const Block& block, const Crypto::Hash& blockHash, difficulty_type currentDifficulty, Crypto::Hash& proofOfWork) {
+  if (m_proofOfWorkCache.get(blockHash, proofOfWork)) {
+    return m_currency.checkProofOfWork(block, currentDifficulty, proofOfWork);
+  }
+
+  return m_currency.checkProofOfWork(m_cn_context, block, currentDifficulty, proofOfWork);
+}
+
 bool Blockchain::checkCumulativeBlockSize(const Crypto::Hash& blockId, size_t cumulativeBlockSize, uint64_t height) {
   size_t maxBlockCumulativeSize = m_currency.maxBlockCumulativeSize(height);
   if (cumulativeBlockSize > maxBlockCumulativeSize) {
@@ -2113,6 +2617,8 @@ bool Blockchain::addNewBlock(const Block& bl_, block_verification_context& bvc)
     }
   }
 
+  storeCacheIfPending();
+
   if (add_result && bvc.m_added_to_main_chain) {
     m_observerManager.notify(&IBlockchainStorageObserver::blockchainUpdated);
   }
@@ -2120,12 +2626,14 @@ bool Blockchain::addNewBlock(const Block& bl_, block_verification_context& bvc)
   return add_result;
 }
 
-const Blockchain::TransactionEntry& Blockchain::transactionByIndex(TransactionIndex index) {
-  return m_blocks[index.block].transactions[index.transaction];
+// The entry shares ownership of its block, so it stays valid when the block leaves the cache.
+std::shared_ptr<const Blockchain::TransactionEntry> Blockchain::transactionByIndex(TransactionIndex index) {
+  std::shared_ptr<const BlockEntry> block = m_blocks[index.block];
+  return std::shared_ptr<const TransactionEntry>(block, &block->transactions[index.transaction]);
 }
 
 bool Blockchain::pushBlock(const Block& blockData, block_verification_context& bvc) {
-  std::vector<Transaction> transactions;
+  std::vector<CachedTransaction> transactions;
   if (!loadTransactions(blockData, transactions)) {
     bvc.m_verification_failed = true;
     return false;
@@ -2139,20 +2647,91 @@ bool Blockchain::pushBlock(const Block& blockData, block_verification_context& b
   return true;
 }
 
-bool Blockchain::check_non_privacy(const Transaction& tx) {
+// Mirrors the condition under which pushBlock authorizes a block. The segment has to link to the
+// tail and each block has to carry a proof of work, so that peers cannot make the node query the
+// endpoints for made up blocks.
+void Blockchain::prefetchBlockAuthorization(const std::vector<const Block*>& blocks) {
+  if (blocks.empty()) {
+    return;
+  }
 
-  // purge?:
-  const Crypto::Hash txhash = getObjectHash(tx);
-  if (PrivacyMemBC.size()>1000) {
-    logger(DEBUGGING) << "DEBUG (Blockchain.cpp): memory purged ";
-    PrivacyMemBC.clear();
-  } else {
-    // check only once
-    auto it = PrivacyMemBC.find(txhash);
-    if (it != PrivacyMemBC.end()) {
-      logger(DEBUGGING) << "DEBUG (Blockchain.cpp): using check_non_privacy memory for transaction " << txhash;
-      return it->second;
+  uint32_t height;
+  Crypto::Hash previousHash;
+  difficulty_type difficulty;
+  {
+    std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+    if (m_blocks.empty()) {
+      return;
+    }
+
+    height = static_cast<uint32_t>(m_blocks.size());
+    previousHash = m_blockIndex.getTailId();
+    difficulty = getDifficultyForNextBlock();
+  }
+
+  for (const Block* block : blocks) {
+    if (block->previousBlockHash != previousHash || get_block_height(*block) != height) {
+      break;
+    }
+
+    previousHash = get_block_hash(*block);
+    int64_t block_diff = (int64_t)m_lastKnownBlockHeight - static_cast<int64_t>(height);
+    if (!m_checkpoints.is_in_checkpoint_zone(height) && (block_diff <= 100 || block_diff%100 == 0)) {
+      // the proof of work is usually there already, computed by precomputeProofOfWork
+      Crypto::Hash proofOfWork;
+      if (!m_proofOfWorkCache.get(previousHash, proofOfWork)) {
+        precomputeProofOfWork(*block);
+        if (!m_proofOfWorkCache.get(previousHash, proofOfWork)) {
+          break;
+        }
+      }
+
+      if (!m_currency.checkProofOfWork(*block, difficulty, proofOfWork)) {
+        break;
+      }
+
+      m_authorizer.prefetch(height, block->nonce);
     }
+
+    ++height;
+  }
+}
+
+void Blockchain::precomputeProofOfWork(const Block& block) {
+  if (m_checkpoints.is_in_checkpoint_zone(get_block_height(block))) {
+    return;
+  }
+
+  // the scratchpad is too big to allocate per block, so contexts are borrowed from a free list
+  std::unique_ptr<Crypto::cn_context> context;
+  {
+    std::lock_guard<std::mutex> lock(m_hashContextsMutex);
+    if (!m_hashContexts.empty()) {
+      context = std::move(m_hashContexts.back());
+      m_hashContexts.pop_back();
+    }
+  }
+
+  if (!context) {
+    context.reset(new Crypto::cn_context());
+  }
+
+  Crypto::Hash proofOfWork;
+  if (get_block_longhash(*context, block, proofOfWork)) {
+    m_proofOfWorkCache.put(get_block_hash(block), proofOfWork);
+  }
+
+  std::lock_guard<std::mutex> lock(m_hashContextsMutex);
+  m_hashContexts.push_back(std::move(context));
+}
+
+bool Blockchain::check_non_privacy(const Transaction& tx, const Crypto::Hash& txhash) {
+
+  // check only once, a transaction verified on relay is not verified again when its block arrives
+  bool cachedResult;
+  if (m_nonPrivacyCache.get(txhash, cachedResult)) {
+    logger(DEBUGGING) << "DEBUG (Blockchain.cpp): using check_non_privacy memory for transaction " << txhash;
+    return cachedResult;
   }
 
   logger(DEBUGGING) << "DEBUG (Blockchain.cpp): check_non_privacy invoked for transaction " << txhash;
@@ -2183,7 +2762,7 @@ bool Blockchain::check_non_privacy(const Transaction& tx) {
   if (amount.empty() || to_address.empty()) {
      {
         logger(ERROR) << "Transaction " << txhash << " rejected: privacy transaction";
-        PrivacyMemBC.insert({txhash, false});
+        m_nonPrivacyCache.put(txhash, false);
         return false;
       }
   }
@@ -2197,7 +2776,7 @@ bool Blockchain::check_non_privacy(const Transaction& tx) {
       if (!Crypto::generate_key_derivation(address.viewPublicKey, tx_key, derivation))
       {
         logger(ERROR) << "Failed to generate key derivation from transaction";
-        PrivacyMemBC.insert({txhash, false});
+        m_nonPrivacyCache.put(txhash, false);
         return false;
       }
       
@@ -2222,22 +2801,22 @@ bool Blockchain::check_non_privacy(const Transaction& tx) {
       catch (...)
       {
         logger(ERROR) << "Failed to parse transaction outputs";
-        PrivacyMemBC.insert({txhash, false});
+        m_nonPrivacyCache.put(txhash, false);
         return false;
       }
 
       if ((uint64_t)amount[i] != received) {
         logger(ERROR) << "Error: transaction addresses & output amount mismatch";
-        PrivacyMemBC.insert({txhash, false});
+        m_nonPrivacyCache.put(txhash, false);
         return false;
       }
   }
   logger(DEBUGGING) << "PASSED non_privacy transaction validation: " << txhash;
-  PrivacyMemBC.insert({txhash, true});
+  m_nonPrivacyCache.put(txhash, true);
   return true;
 }
 
-bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction>& transactions, block_verification_context& bvc) {
+bool Blockchain::pushBlock(const Block& blockData, const std::vector<CachedTransaction>& transactions, block_verification_context& bvc) {
   std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   auto blockProcessingStart = std::chrono::steady_clock::now();
@@ -2304,7 +2883,7 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
       return false;
     }
   } else {
-    if (!m_currency.checkProofOfWork(m_cn_context, blockData, currentDifficulty, proof_of_work)) {
+    if (!checkProofOfWork(blockData, blockHash, currentDifficulty, proof_of_work)) {
       logger(INFO, BRIGHT_WHITE) <<
         "Block " << blockHash << ", has too weak proof of work: " << proof_of_work << ", expected difficulty: " << currentDifficulty;
       bvc.m_verification_failed = true;
@@ -2335,17 +2914,22 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
   size_t coinbase_blob_size = getObjectBinarySize(blockData.baseTransaction);
   size_t cumulative_block_size = coinbase_blob_size;
   uint64_t fee_summary = 0;
+  // Inputs are resolved transaction by transaction, the ring signatures of the whole block
+  // are verified together once all of them are known.
+  std::vector<RingSignatureCheck> ringSignatureChecks;
   for (size_t i = 0; i < transactions.size(); ++i) {
     const Crypto::Hash& tx_id = blockData.transactionHashes[i];
     block.transactions.resize(block.transactions.size() + 1);
     size_t blob_size = 0;
     uint64_t fee = 0;
-    block.transactions.back().tx = transactions[i];
+    block.transactions.back().tx = transactions[i].getTransaction();
+    block.transactions.back().binary = transactions[i].getTransactionBinaryArray();
 
-    blob_size = toBinaryArray(block.transactions.back().tx).size();
+    blob_size = transactions[i].getTransactionBinarySize();
     fee = getInputAmount(block.transactions.back().tx) - getOutputAmount(block.transactions.back().tx);
 
-    if (!checkTransactionInputs(block.transactions.back().tx)) {
+    size_t ringSignatureChecksCount = ringSignatureChecks.size();
+    if (!checkTransactionInputs(transactions[i], NULL, &ringSignatureChecks)) {
       logger(INFO, BRIGHT_WHITE) <<
         "Block " << blockHash << " has at least one transaction with wrong inputs: " << tx_id;
       bvc.m_verification_failed = true;
@@ -2357,7 +2941,7 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
 
     // validate non-privacy transactions:
     if (!in_checkpoint_zone) {
-      if (!check_non_privacy(block.transactions.back().tx)) {
+      if (!check_non_privacy(block.transactions.back().tx, tx_id)) {
         logger(INFO, BRIGHT_WHITE) <<
         "Block " << blockHash << " has at least one transaction with incorrect non-privacy data: " << tx_id;
         bvc.m_verification_failed = true;
@@ -2368,6 +2952,10 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     }
     // ----
 
+    for (size_t c = ringSignatureChecksCount; c < ringSignatureChecks.size(); ++c) {
+      ringSignatureChecks[c].transactionHash = tx_id;
+    }
+
     ++transactionIndex.transaction;
     pushTransaction(block, tx_id, transactionIndex);
 
@@ -2375,6 +2963,16 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
     fee_summary += fee;
   }
 
+  size_t failedCheck = 0;
+  if (!checkRingSignatures(ringSignatureChecks, failedCheck)) {
+    logger(INFO, BRIGHT_WHITE) <<
+      "Block " << blockHash << " has at least one transaction with wrong ring signature: " << ringSignatureChecks[failedCheck].transactionHash <<
+      ", key image " << ringSignatureChecks[failedCheck].keyImage;
+    bvc.m_verification_failed = true;
+    popTransactions(block, minerTransactionHash);
+    return false;
+  }
+
   if (!checkCumulativeBlockSize(blockHash, cumulative_block_size, m_blocks.size())) {
     bvc.m_verification_failed = true;
     return false;
@@ -2382,7 +2980,7 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
 
   int64_t emissionChange = 0;
   uint64_t reward = 0;
-  uint64_t already_generated_coins = m_blocks.empty() ? 0 : m_blocks.back().already_generated_coins;
+  uint64_t already_generated_coins = m_blocks.empty() ? 0 : m_blockHeaders.back().already_generated_coins;
   if (!validate_miner_transaction(blockData, static_cast<uint32_t>(m_blocks.size()), cumulative_block_size, already_generated_coins, fee_summary, reward, emissionChange)) {
     logger(INFO, BRIGHT_WHITE) << "Block " << blockHash << " has invalid coinbase transaction";
     bvc.m_verification_failed = true;
@@ -2391,7 +2989,7 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
   }
 
   int64_t block_diff = (int64_t)m_lastKnownBlockHeight - static_cast<int64_t>(m_blocks.size());
-  if (!in_checkpoint_zone && (block_diff <= 100 || block_diff%100 == 0) && !AuthBlock(static_cast<uint32_t>(m_blocks.size()), blockData.nonce, logger.getLogger())) {
+  if (!in_checkpoint_zone && (block_diff <= 100 || block_diff%100 == 0) && !m_authorizer.authorize(static_cast<uint32_t>(m_blocks.size()), blockData.nonce)) {
     logger(INFO, BRIGHT_MAGENTA) << "Unauthorized block " << static_cast<uint32_t>(m_blocks.size()) << " with nonce " << std::hex << std::setfill('0') << std::setw(8) << blockData.nonce;
     bvc.m_verification_failed = true;
     popTransactions(block, minerTransactionHash);
@@ -2403,10 +3001,11 @@ bool Blockchain::pushBlock(const Block& blockData, const std::vector<Transaction
   block.cumulative_difficulty = currentDifficulty;
   block.already_generated_coins = already_generated_coins + emissionChange;
   if (m_blocks.size() > 0) {
-    block.cumulative_difficulty += m_blocks.back().cumulative_difficulty;
+    block.cumulative_difficulty += m_blockHeaders.back().cumulative_difficulty;
   }
 
   pushBlock(block);
+  m_tx_pool.on_blockchain_inc(block.height, blockHash);
 
   auto block_processing_time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - blockProcessingStart).count();
 
@@ -2433,6 +3032,7 @@ bool Blockchain::pushBlock(BlockEntry& block) {
   Crypto::Hash blockHash = get_block_hash(block.bl);
 
   m_blocks.push_back(block);
+  pushBlockHeader(block, blockHash);
   m_blockIndex.push(blockHash);
 
   m_timestampIndex.add(block.bl.timestamp, blockHash);
@@ -2440,23 +3040,33 @@ bool Blockchain::pushBlock(BlockEntry& block) {
 
   assert(m_blockIndex.size() == m_blocks.size());
 
+  journalBlock(BlockchainJournal::BLOCK_PUSHED, block, blockHash);
+  if (m_journal.recordCount() >= JOURNAL_COMPACTION_BLOCKS) {
+    m_cacheStorePending = true;
+  }
+
   return true;
 }
 
 void Blockchain::popBlock() {
+  std::lock_guard<decltype(m_tx_pool)> poolLock(m_tx_pool);
+  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (m_blocks.empty()) {
     logger(ERROR, BRIGHT_RED) <<
       "Attempt to pop block from empty blockchain.";
     return;
   }
 
-  std::vector<Transaction> transactions(m_blocks.back().transactions.size() - 1);
-  for (size_t i = 0; i < m_blocks.back().transactions.size() - 1; ++i) {
-    transactions[i] = m_blocks.back().transactions[1 + i].tx;
+  std::shared_ptr<const BlockEntry> block = m_blocks.back();
+  std::vector<CachedTransaction> transactions;
+  transactions.reserve(block->transactions.size() - 1);
+  for (size_t i = 0; i < block->transactions.size() - 1; ++i) {
+    appendTransaction(transactions, block->transactions[1 + i], block->bl.transactionHashes[i]);
   }
 
   saveTransactions(transactions);
   removeLastBlock();
+  m_tx_pool.on_blockchain_dec(m_blocks.size() - 1, getTailId());
 
   m_upgradeDetectorV2.blockPopped();
   m_upgradeDetectorV3.blockPopped();
@@ -2482,14 +3092,14 @@ bool Blockchain::pushTransaction(BlockEntry& block, const Crypto::Hash& transact
 
   for (size_t i = 0; i < transaction.tx.inputs.size(); ++i) {
     if (transaction.tx.inputs[i].type() == typeid(KeyInput)) {
-      auto result = spentKeyImages.get<KeyImageTag>().insert(SpentKeyImage{ block.height, ::boost::get<KeyInput>(transaction.tx.inputs[i]).keyImage });
-      if (check_tx_inputs_keyimages_domain(::boost::get<KeyInput>(transaction.tx.inputs[i]).keyImage) && !result.second) {
+      bool inserted = spentKeyImages.insert(::boost::get<KeyInput>(transaction.tx.inputs[i]).keyImage, block.height);
+      if (check_tx_inputs_keyimages_domain(::boost::get<KeyInput>(transaction.tx.inputs[i]).keyImage) && !inserted) {
         logger(ERROR, BRIGHT_RED) <<
           "Double spending transaction was pushed to blockchain.";
         for (size_t j = 0; j < i; ++j) {
-          auto& imagesIndex = spentKeyImages.get<KeyImageTag>();
-          auto it = imagesIndex.find(::boost::get<KeyInput>(transaction.tx.inputs[i - 1 - j]).keyImage);
-          imagesIndex.erase(it);
+          if (transaction.tx.inputs[i - 1 - j].type() == typeid(KeyInput)) {
+            spentKeyImages.erase(::boost::get<KeyInput>(transaction.tx.inputs[i - 1 - j]).keyImage);
+          }
         }
         
         m_transactionMap.erase(transactionHash);
@@ -2601,13 +3211,10 @@ void Blockchain::popTransaction(const Transaction& transaction, const Crypto::Ha
 
   for (auto& input : transaction.inputs) {
     if (input.type() == typeid(KeyInput)) {
-      auto& imagesIndex = spentKeyImages.get<KeyImageTag>();
-      auto it = imagesIndex.find(::boost::get<KeyInput>(input).keyImage);
-      if (it == imagesIndex.end()) {
+      if (!spentKeyImages.erase(::boost::get<KeyInput>(input).keyImage)) {
         logger(ERROR, BRIGHT_RED) <<
           "Blockchain consistency broken - cannot find spent key.";
       }
-      imagesIndex.erase(it);
     } else if (input.type() == typeid(MultisignatureInput)) {
       const MultisignatureInput& in = ::boost::get<MultisignatureInput>(input);
       auto& amountOutputs = m_multisignatureOutputs[in.amount];
@@ -2660,7 +3267,8 @@ bool Blockchain::validateInput(const MultisignatureInput& input, const Crypto::H
     return false;
   }
 
-  const Transaction& outputTransaction = m_blocks[outputIndex.transactionIndex.block].transactions[outputIndex.transactionIndex.transaction].tx;
+  std::shared_ptr<const TransactionEntry> outputEntry = transactionByIndex(outputIndex.transactionIndex);
+  const Transaction& outputTransaction = outputEntry->tx;
   if (!is_tx_spendtime_unlocked(outputTransaction.unlockTime)) {
     logger(DEBUGGING) <<
       "Transaction << " << transactionHash << " contains multisignature input which points to a locked transaction.";
@@ -2713,9 +3321,18 @@ bool Blockchain::checkCheckpoints(uint32_t& lastValidCheckpointHeight) {
 }
 
 void Blockchain::rollbackBlockchainTo(uint32_t height) {
-  while (height + 1 < m_blocks.size()) {
-    removeLastBlock();
+  {
+    // the pool is notified, so it is locked first as in addNewBlock
+    std::lock_guard<decltype(m_tx_pool)> poolLock(m_tx_pool);
+    std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+    while (height + 1 < m_blocks.size()) {
+      removeLastBlock();
+    }
+
+    m_tx_pool.on_blockchain_dec(m_blocks.size() - 1, getTailId());
   }
+
+  storeCacheIfPending();
 }
 
 void Blockchain::removeLastBlock() {
@@ -2725,24 +3342,32 @@ void Blockchain::removeLastBlock() {
     return;
   }
 
-  logger(DEBUGGING) << "Removing last block with height " << m_blocks.back().height;
-  popTransactions(m_blocks.back(), getObjectHash(m_blocks.back().bl.baseTransaction));
+  std::shared_ptr<const BlockEntry> block = m_blocks.back();
+  logger(DEBUGGING) << "Removing last block with height " << block->height;
+  Crypto::Hash blockHash = getBlockIdByHeight(block->height);
+  journalBlock(BlockchainJournal::BLOCK_POPPED, *block, blockHash);
 
-  Crypto::Hash blockHash = getBlockIdByHeight(m_blocks.back().height);
-  m_timestampIndex.remove(m_blocks.back().bl.timestamp, blockHash);
-  m_generatedTransactionsIndex.remove(m_blocks.back().bl);
+  popTransactions(*block, getObjectHash(block->bl.baseTransaction));
+
+  m_timestampIndex.remove(block->bl.timestamp, blockHash);
+  m_generatedTransactionsIndex.remove(block->bl);
 
   m_blocks.pop_back();
+  m_blockHeaders.pop_back();
   m_blockIndex.pop();
 
   assert(m_blockIndex.size() == m_blocks.size());
+
+  if (m_journal.recordCount() >= JOURNAL_COMPACTION_BLOCKS) {
+    m_cacheStorePending = true;
+  }
 }
 
 bool Blockchain::checkUpgradeHeight(const UpgradeDetector& upgradeDetector) {
   uint32_t upgradeHeight = upgradeDetector.upgradeHeight();
   if (upgradeHeight != UpgradeDetectorBase::UNDEF_HEIGHT && upgradeHeight + 1 < m_blocks.size()) {
     logger(INFO) << "Checking block version at " << upgradeHeight + 1;
-    if (m_blocks[upgradeHeight + 1].bl.majorVersion != upgradeDetector.targetVersion()) {
+    if (m_blockHeaders[upgradeHeight + 1].majorVersion != upgradeDetector.targetVersion()) {
       return false;
     }
   }
@@ -2751,45 +3376,45 @@ bool Blockchain::checkUpgradeHeight(const UpgradeDetector& upgradeDetector) {
 }
 
 bool Blockchain::getLowerBound(uint64_t timestamp, uint64_t startOffset, uint32_t& height) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   assert(startOffset < m_blocks.size());
 
-  auto bound = std::lower_bound(m_blocks.begin() + startOffset, m_blocks.end(), timestamp - m_currency.blockFutureTimeLimit(),
-    [](const BlockEntry& b, uint64_t timestamp) { return b.bl.timestamp < timestamp; });
+  auto bound = std::lower_bound(m_blockHeaders.cbegin() + startOffset, m_blockHeaders.cend(), timestamp - m_currency.blockFutureTimeLimit(),
+    [](const BlockHeaderEntry& b, uint64_t timestamp) { return b.timestamp < timestamp; });
 
-  if (bound == m_blocks.end()) {
+  if (bound == m_blockHeaders.cend()) {
     return false;
   }
 
-  height = static_cast<uint32_t>(std::distance(m_blocks.begin(), bound));
+  height = static_cast<uint32_t>(bound.index());
   return true;
 }
 
 std::vector<Crypto::Hash> Blockchain::getBlockIds(uint32_t startHeight, uint32_t maxCount) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return m_blockIndex.getBlockIds(startHeight, maxCount);
 }
 
 bool Blockchain::getBlockContainingTransaction(const Crypto::Hash& txId, Crypto::Hash& blockId, uint32_t& blockHeight) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   auto it = m_transactionMap.find(txId);
   if (it == m_transactionMap.end()) {
     return false;
   } else {
-    blockHeight = m_blocks[it->second.block].height;
+    blockHeight = it->second.block;
     blockId = getBlockIdByHeight(blockHeight);
     return true;
   }
 }
 
 bool Blockchain::getAlreadyGeneratedCoins(const Crypto::Hash& hash, uint64_t& generatedCoins) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   // try to find block in main chain
   uint32_t height = 0;
   if (m_blockIndex.getBlockHeight(hash, height)) {
-    generatedCoins = m_blocks[height].already_generated_coins;
+    generatedCoins = m_blockHeaders[height].already_generated_coins;
     return true;
   }
 
@@ -2805,12 +3430,12 @@ bool Blockchain::getAlreadyGeneratedCoins(const Crypto::Hash& hash, uint64_t& ge
 }
 
 bool Blockchain::getBlockSize(const Crypto::Hash& hash, size_t& size) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
   // try to find block in main chain
   uint32_t height = 0;
   if (m_blockIndex.getBlockHeight(hash, height)) {
-    size = m_blocks[height].block_cumulative_size;
+    size = m_blockHeaders[height].block_cumulative_size;
     return true;
   }
 
@@ -2826,7 +3451,7 @@ bool Blockchain::getBlockSize(const Crypto::Hash& hash, size_t& size) {
 }
 
 bool Blockchain::getMultisigOutputReference(const MultisignatureInput& txInMultisig, std::pair<Crypto::Hash, size_t>& outputReference) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   MultisignatureOutputsContainer::const_iterator amountIter = m_multisignatureOutputs.find(txInMultisig.amount);
   if (amountIter == m_multisignatureOutputs.end()) {
     logger(DEBUGGING) << "Transaction contains multisignature input with invalid amount.";
@@ -2837,14 +3462,15 @@ bool Blockchain::getMultisigOutputReference(const MultisignatureInput& txInMulti
     return false;
   }
   const MultisignatureOutputUsage& outputIndex = amountIter->second[txInMultisig.outputIndex];
-  const Transaction& outputTransaction = m_blocks[outputIndex.transactionIndex.block].transactions[outputIndex.transactionIndex.transaction].tx;
+  std::shared_ptr<const TransactionEntry> outputEntry = transactionByIndex(outputIndex.transactionIndex);
+  const Transaction& outputTransaction = outputEntry->tx;
   outputReference.first = getObjectHash(outputTransaction);
   outputReference.second = outputIndex.outputIndex;
   return true;
 }
 
 bool Blockchain::getGeneratedTransactionsNumber(uint32_t height, uint64_t& generatedTransactions) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   if (height + 1 == static_cast<uint32_t>(m_blocks.size())) {
     return m_transactionMap.size();
   }
@@ -2852,32 +3478,31 @@ bool Blockchain::getGeneratedTransactionsNumber(uint32_t height, uint64_t& gener
 }
 
 bool Blockchain::getOrphanBlockIdsByHeight(uint32_t height, std::vector<Crypto::Hash>& blockHashes) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return m_orphanBlocksIndex.find(height, blockHashes);
 }
 
 bool Blockchain::getBlockIdsByTimestamp(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t blocksNumberLimit, std::vector<Crypto::Hash>& hashes, uint32_t& blocksNumberWithinTimestamps) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return m_timestampIndex.find(timestampBegin, timestampEnd, blocksNumberLimit, hashes, blocksNumberWithinTimestamps);
 }
 
 bool Blockchain::getTransactionIdsByPaymentId(const Crypto::Hash& paymentId, std::vector<Crypto::Hash>& transactionHashes) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return m_paymentIdIndex.find(paymentId, transactionHashes);
 }
 
 bool Blockchain::getTransactionIdsByAddress(const std::string& address, std::vector<Crypto::Hash>& transactionHashes) {
-  std::lock_guard<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
+  std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
   return m_addressindex.find(address, transactionHashes);
   return true;
 }
 
-bool Blockchain::loadTransactions(const Block& block, std::vector<Transaction>& transactions) {
+bool Blockchain::loadTransactions(const Block& block, std::vector<CachedTransaction>& transactions) {
   transactions.resize(block.transactionHashes.size());
-  size_t transactionSize;
   uint64_t fee;
   for (size_t i = 0; i < block.transactionHashes.size(); ++i) {
-    if (!m_tx_pool.take_tx(block.transactionHashes[i], transactions[i], transactionSize, fee)) {
+    if (!m_tx_pool.take_tx(block.transactionHashes[i], transactions[i], fee)) {
       tx_verification_context context;
       for (size_t j = 0; j < i; ++j) {
         if (!m_tx_pool.add_tx(transactions[i - 1 - j], context, true)) {
@@ -2892,7 +3517,7 @@ bool Blockchain::loadTransactions(const Block& block, std::vector<Transaction>&
   return true;
 }
 
-void Blockchain::saveTransactions(const std::vector<Transaction>& transactions) {
+void Blockchain::saveTransactions(const std::vector<CachedTransaction>& transactions) {
   tx_verification_context context;
   for (size_t i = 0; i < transactions.size(); ++i) {
     if (!m_tx_pool.add_tx(transactions[transactions.size() - 1 - i], context, true)) {
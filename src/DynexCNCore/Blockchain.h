@@ -38,26 +38,29 @@
 #pragma once
 
 #include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <type_traits>
 
 #include "google/sparse_hash_set"
 #include "google/sparse_hash_map"
 
-#include <boost/multi_index_container.hpp>
-#include <boost/multi_index/composite_key.hpp>
-#include <boost/multi_index/hashed_index.hpp>
-#include <boost/multi_index/member.hpp>
-#include <boost/multi_index/mem_fun.hpp>
-#include <boost/multi_index/ordered_index.hpp>
-#include <boost/multi_index/random_access_index.hpp>
-
+#include "Common/FileMappedVector.h"
+#include "Common/LruCache.h"
 #include "Common/ObserverManager.h"
+#include "Common/RecursiveSharedMutex.h"
+#include "Common/ThreadPool.h"
 #include "Common/Util.h"
 
+#include "DynexCNCore/Auth.h"
 #include "DynexCNCore/BlockIndex.h"
+#include "DynexCNCore/BlockchainJournal.h"
+#include "DynexCNCore/CachedTransaction.h"
 #include "DynexCNCore/Checkpoints.h"
 #include "DynexCNCore/Currency.h"
 #include "DynexCNCore/IBlockchainStorageObserver.h"
 #include "DynexCNCore/ITransactionValidator.h"
+#include "DynexCNCore/SpentKeyImageSet.h"
 #include "DynexCNCore/SwappedVector.h"
 #include "DynexCNCore/UpgradeDetector.h"
 #include "DynexCNCore/DynexCNFormatUtils.h"
@@ -93,8 +96,8 @@ namespace DynexCN {
     virtual void lastKnownBlockHeightUpdated(uint32_t height) override;
 
     // ITransactionValidator
-    virtual bool checkTransactionInputs(const DynexCN::Transaction& tx, BlockInfo& maxUsedBlock) override;
-    virtual bool checkTransactionInputs(const DynexCN::Transaction& tx, BlockInfo& maxUsedBlock, BlockInfo& lastFailed) override;
+    virtual bool checkTransactionInputs(const DynexCN::CachedTransaction& tx, BlockInfo& maxUsedBlock) override;
+    virtual bool checkTransactionInputs(const DynexCN::CachedTransaction& tx, BlockInfo& maxUsedBlock, BlockInfo& lastFailed) override;
     virtual bool haveSpentKeyImages(const DynexCN::Transaction& tx) override;
     virtual bool checkTransactionSize(size_t blobSize) override;
 
@@ -106,6 +109,16 @@ namespace DynexCN {
     std::vector<Crypto::Hash> getBlockIds(uint32_t startHeight, uint32_t maxCount);
 
     void setCheckpoints(Checkpoints&& chk_pts) { m_checkpoints = chk_pts; }
+    void setBlockCacheSize(uint64_t size) { m_blockCacheSize = size; }
+    void setAuthEndpoints(const std::vector<std::string>& endpoints) { m_authorizer.setEndpoints(endpoints); }
+    // Starts authorizing blocks about to be pushed in this order, so that pushBlock finds the answers
+    // without a network round trip under the lock. Only a segment extending the main chain is
+    // authorized ahead, up to the first block whose proof of work misses the current difficulty.
+    void prefetchBlockAuthorization(const std::vector<const Block*>& blocks);
+    // Computes the proof of work of a block about to be pushed on the calling thread, pushBlock
+    // then takes it from m_proofOfWorkCache instead of hashing under the lock.
+    void precomputeProofOfWork(const Block& block);
+    SwappedVectorCacheStats getBlockCacheStats() { return m_blocks.getCacheStats(); }
     bool getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks, std::list<Transaction>& txs);
     bool getBlocks(uint32_t start_offset, uint32_t count, std::list<Block>& blocks);
     bool getAlternativeBlocks(std::list<Block>& blocks);
@@ -142,7 +155,7 @@ namespace DynexCN {
     bool getBackwardBlocksSize(size_t from_height, std::vector<size_t>& sz, size_t count);
     bool getTransactionOutputGlobalIndexes(const Crypto::Hash& tx_id, std::vector<uint32_t>& indexs);
     bool get_out_by_msig_gindex(uint64_t amount, uint64_t gindex, MultisignatureOutput& out);
-    bool checkTransactionInputs(const Transaction& tx, uint32_t& pmax_used_block_height, Crypto::Hash& max_used_block_id, BlockInfo* tail = 0);
+    bool checkTransactionInputs(const CachedTransaction& tx, uint32_t& pmax_used_block_height, Crypto::Hash& max_used_block_id, BlockInfo* tail = 0);
     uint64_t getCurrentCumulativeBlocksizeLimit();
     uint64_t blockDifficulty(size_t i);
     uint64_t blockCumulativeDifficulty(size_t i);
@@ -168,7 +181,7 @@ namespace DynexCN {
 
     template<class t_ids_container, class t_blocks_container, class t_missed_container>
     bool getBlocks(const t_ids_container& block_ids, t_blocks_container& blocks, t_missed_container& missed_bs) {
-      std::lock_guard<std::recursive_mutex> lk(m_blockchain_lock);
+      std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
 
       for (const auto& bl_id : block_ids) {
         try {
@@ -178,7 +191,7 @@ namespace DynexCN {
           } else {
             if (!(height < m_blocks.size())) { logger(Logging::ERROR, Logging::BRIGHT_RED) << "Internal error: bl_id=" << Common::podToHex(bl_id)
             << " have index record with offset=" << height << ", bigger then m_blocks.size()=" << m_blocks.size(); return false; }
-            blocks.push_back(m_blocks[height].bl);
+            blocks.push_back(m_blocks[height]->bl);
           }
         } catch (const std::exception& e) {
           logger(Logging::ERROR, Logging::BRIGHT_RED) << "Exception in Core getBlocks: " << e.what();
@@ -190,14 +203,14 @@ namespace DynexCN {
 
     template<class t_ids_container, class t_tx_container, class t_missed_container>
     void getBlockchainTransactions(const t_ids_container& txs_ids, t_tx_container& txs, t_missed_container& missed_txs) {
-      std::lock_guard<decltype(m_blockchain_lock)> bcLock(m_blockchain_lock);
+      std::shared_lock<decltype(m_blockchain_lock)> bcLock(m_blockchain_lock);
 
       for (const auto& tx_id : txs_ids) {
         auto it = m_transactionMap.find(tx_id);
         if (it == m_transactionMap.end()) {
           missed_txs.push_back(tx_id);
         } else {
-          txs.push_back(transactionByIndex(it->second).tx);
+          appendTransaction(txs, *transactionByIndex(it->second), tx_id);
         }
       }
     }
@@ -233,16 +246,6 @@ namespace DynexCN {
       }
     };
 
-    struct SpentKeyImage {
-      uint32_t blockIndex;
-      Crypto::KeyImage keyImage;
-
-      void serialize(ISerializer& s) {
-        s(blockIndex, "block_index");
-        s(keyImage, "key_image");
-      }
-    };
-
     void rollbackBlockchainTo(uint32_t height);
     bool have_tx_keyimg_as_spent(const Crypto::KeyImage &key_im);
     bool checkIfSpent(const Crypto::KeyImage& keyImage, uint32_t blockIndex);
@@ -251,12 +254,10 @@ namespace DynexCN {
     bool is_tx_spendtime_unlocked(uint64_t unlock_time, uint32_t height);
     bool check_tx_inputs_keyimages_domain(const Crypto::KeyImage& keyImage);
     // non-privacy functions:
-    bool check_non_privacy(const Transaction& tx);
+    bool check_non_privacy(const Transaction& tx, const Crypto::Hash& txhash);
 
   private:
 
-    std::unordered_map<Crypto::Hash, bool> PrivacyMemBC;
-
     struct MultisignatureOutputUsage {
       TransactionIndex transactionIndex;
       uint16_t outputIndex;
@@ -272,10 +273,39 @@ namespace DynexCN {
     struct TransactionEntry {
       Transaction tx;
       std::vector<uint32_t> m_global_output_indexes;
+      // tx as it is stored, so it is not serialized again, empty if not known
+      BinaryArray binary;
 
       void serialize(ISerializer& s) {
         s(tx, "tx");
         s(m_global_output_indexes, "indexes");
+        if (s.type() == ISerializer::INPUT) {
+          binary.clear();
+        }
+      }
+
+      // the format of serialize(), without ISerializer
+      void writeBinary(StaticBinaryWriter& writer) const {
+        if (binary.empty()) {
+          DynexCN::writeBinary(writer, tx);
+        } else {
+          writer.binary(binary.data(), binary.size());
+        }
+
+        writer.varint(m_global_output_indexes.size());
+        for (uint32_t index : m_global_output_indexes) {
+          writer.varint(index);
+        }
+      }
+
+      void readBinary(StaticBinaryReader& reader) {
+        const uint8_t* txBegin = reader.data();
+        DynexCN::readBinary(reader, tx);
+        binary.assign(txBegin, reader.data());
+        m_global_output_indexes.resize(reader.count());
+        for (uint32_t& index : m_global_output_indexes) {
+          reader.varint(index);
+        }
       }
     };
 
@@ -295,53 +325,189 @@ namespace DynexCN {
         s(already_generated_coins, "already_generated_coins");
         s(transactions, "transactions");
       }
+
+      // the format of serialize(), without ISerializer, for the blocks SwappedVector
+      void writeBinary(StaticBinaryWriter& writer) const {
+        DynexCN::writeBinary(writer, bl);
+        writer.varint(height);
+        writer.varint(block_cumulative_size);
+        writer.varint(cumulative_difficulty);
+        writer.varint(already_generated_coins);
+        writer.varint(transactions.size());
+        for (const TransactionEntry& transaction : transactions) {
+          transaction.writeBinary(writer);
+        }
+      }
+
+      void readBinary(StaticBinaryReader& reader) {
+        DynexCN::readBinary(reader, bl);
+        reader.varint(height);
+        reader.varint(block_cumulative_size);
+        reader.varint(cumulative_difficulty);
+        reader.varint(already_generated_coins);
+        transactions.resize(reader.count());
+        for (TransactionEntry& transaction : transactions) {
+          transaction.readBinary(reader);
+        }
+      }
+
+      // the transaction blobs kept in memory, charged to the blocks cache on top of the decoded entry
+      uint64_t bufferedSize() const {
+        uint64_t size = 0;
+        for (const TransactionEntry& transaction : transactions) {
+          size += transaction.binary.size();
+        }
+
+        return size;
+      }
+    };
+
+    // Everything a block adds to the cache and the indices, enough to apply or revert it
+    // without the block itself. Built on worker threads by rebuildCache and stored in the journal.
+    struct MultisignatureInputDelta {
+      uint64_t amount;
+      uint32_t outputIndex;
+
+      void serialize(ISerializer& s) {
+        s(amount, "amount");
+        s(outputIndex, "outindex");
+      }
+    };
+
+    struct OutputDelta {
+      enum : uint8_t { KEY = 0, MULTISIGNATURE = 1, OTHER = 2 };
+
+      uint64_t amount;
+      uint8_t type;
+
+      void serialize(ISerializer& s) {
+        s(amount, "amount");
+        s(type, "type");
+      }
+    };
+
+    struct TransactionIndexDelta {
+      Crypto::Hash hash;
+      std::vector<Crypto::KeyImage> keyImages;
+      std::vector<MultisignatureInputDelta> multisignatureInputs;
+      std::vector<OutputDelta> outputs;
+      bool hasPaymentId;
+      Crypto::Hash paymentId;
+      std::vector<std::string> addresses;
+
+      void serialize(ISerializer& s) {
+        s(hash, "hash");
+        s(keyImages, "key_images");
+        s(multisignatureInputs, "multisig_inputs");
+        s(outputs, "outputs");
+        s(hasPaymentId, "has_payment_id");
+        s(paymentId, "payment_id");
+        s(addresses, "addresses");
+      }
+    };
+
+    struct BlockIndexDelta {
+      Crypto::Hash hash;
+      uint32_t height;
+      uint64_t timestamp;
+      std::vector<TransactionIndexDelta> transactions;
+
+      void serialize(ISerializer& s) {
+        s(hash, "hash");
+        s(height, "height");
+        s(timestamp, "timestamp");
+        s(transactions, "transactions");
+      }
+    };
+
+    // Ring signature of a key input with its output keys already resolved, so that it can be
+    // checked after the lookups without touching any blockchain state.
+    struct RingSignatureCheck {
+      Crypto::Hash transactionHash;
+      Crypto::Hash prefixHash;
+      Crypto::KeyImage keyImage;
+      std::vector<Crypto::PublicKey> outputKeys;
+      std::vector<Crypto::Signature> signatures;
+    };
+
+    // Fixed-width per-height copy of the BlockEntry fields used by difficulty, fee,
+    // timestamp and size calculations. Stored in a memory-mapped file so that these
+    // paths never have to deserialize a whole block through m_blocks.
+    struct BlockHeaderEntry {
+      uint64_t timestamp;
+      difficulty_type cumulative_difficulty;
+      uint64_t already_generated_coins;
+      uint64_t block_cumulative_size;
+      Crypto::Hash hash;
+      uint8_t majorVersion;
     };
 
-    struct BlockIndexTag {};
-    struct KeyImageTag {};
-
-    typedef boost::multi_index_container<
-      SpentKeyImage,
-      boost::multi_index::indexed_by<
-      boost::multi_index::ordered_non_unique<
-      boost::multi_index::tag<BlockIndexTag>,
-      BOOST_MULTI_INDEX_MEMBER(SpentKeyImage, uint32_t, blockIndex)
-      >,
-      boost::multi_index::hashed_unique<
-      boost::multi_index::tag<KeyImageTag>,
-      BOOST_MULTI_INDEX_MEMBER(SpentKeyImage, Crypto::KeyImage, keyImage)
-      >
-      >
-    > SpentKeyImagesContainer;
     typedef std::unordered_map<Crypto::Hash, BlockEntry> blocks_ext_by_hash;
     typedef google::sparse_hash_map<uint64_t, std::vector<std::pair<TransactionIndex, uint16_t>>> outputs_container; //Crypto::Hash - tx hash, size_t - index of out in transaction
     typedef google::sparse_hash_map<uint64_t, std::vector<MultisignatureOutputUsage>> MultisignatureOutputsContainer;
 
     const Currency& m_currency;
     tx_memory_pool& m_tx_pool;
-    std::recursive_mutex m_blockchain_lock; // TODO: add here reader/writer lock
+    // Queries take the shared side; block import, popping and chain switching take it exclusively.
+    Tools::RecursiveSharedMutex m_blockchain_lock;
     Crypto::cn_context m_cn_context;
     Tools::ObserverManager<IBlockchainStorageObserver> m_observerManager;
 
-    SpentKeyImagesContainer spentKeyImages;
+    SpentKeyImageSet spentKeyImages;
     size_t m_current_block_cumul_sz_limit;
     blocks_ext_by_hash m_alternative_chains; // Crypto::Hash -> block_extended_info
     outputs_container m_outputs;
 
     std::string m_config_folder;
     Checkpoints m_checkpoints;
+    uint64_t m_blockCacheSize;
+    // check_non_privacy results by transaction hash, shared by transaction relay and block import.
+    LruCache<Crypto::Hash, bool> m_nonPrivacyCache;
+    // proofs of work by block hash, computed ahead by precomputeProofOfWork
+    LruCache<Crypto::Hash, Crypto::Hash> m_proofOfWorkCache;
+    BlockAuthorizer m_authorizer;
+    // long-lived workers for the checks of a block or batch that run on all cores
+    Tools::ThreadPool m_threadPool;
+    // hashing contexts of precomputeProofOfWork, its callers are not long-lived threads
+    std::mutex m_hashContextsMutex;
+    std::vector<std::unique_ptr<Crypto::cn_context>> m_hashContexts;
     std::atomic<bool> m_is_in_checkpoint_zone;
 
     typedef SwappedVector<BlockEntry> Blocks;
+    typedef Common::FileMappedVector<BlockHeaderEntry> BlockHeaders;
     typedef std::unordered_map<Crypto::Hash, uint32_t> BlockMap;
     typedef std::unordered_map<Crypto::Hash, TransactionIndex> TransactionMap;
     typedef BasicUpgradeDetector<Blocks> UpgradeDetector;
 
+    // Cache state copied by storeCache under the lock and written to disk after it is released.
+    struct CacheSnapshot {
+      explicit CacheSnapshot(const Blockchain& bs);
+
+      Crypto::Hash tailId;
+      uint32_t height;
+      size_t journalRecordCount;
+      DynexCN::BlockIndex blockIndex;
+      TransactionMap transactionMap;
+      SpentKeyImageSet spentKeyImages;
+      outputs_container outputs;
+      MultisignatureOutputsContainer multisignatureOutputs;
+      PaymentIdIndex paymentIdIndex;
+      AddressIndex addressIndex;
+      TimestampBlocksIndex timestampIndex;
+      GeneratedTransactionsIndex generatedTransactionsIndex;
+    };
+
     friend class BlockCacheSerializer;
     friend class BlockchainIndicesSerializer;
 
     Blocks m_blocks;
+    BlockHeaders m_blockHeaders;
     DynexCN::BlockIndex m_blockIndex;
+    // Blocks pushed and popped since the cache was last saved, replayed on top of it by init.
+    BlockchainJournal m_journal;
+    // set when the journal is due for compaction, see storeCacheIfPending
+    std::atomic<bool> m_cacheStorePending;
+    std::mutex m_cacheStoreMutex;
     TransactionMap m_transactionMap;
     MultisignatureOutputsContainer m_multisignatureOutputs;
     UpgradeDetector m_upgradeDetectorV2;
@@ -361,8 +527,19 @@ namespace DynexCN {
 
     uint32_t m_lastKnownBlockHeight;
 
-    void rebuildCache();
+    void clearCache();
+    void rebuildCache(uint32_t startHeight);
+    void makeRebuildDelta(uint32_t height, BlockIndexDelta& delta);
+    static uint64_t rebuildBatchSize(const std::vector<BlockIndexDelta>& batch);
+    void makeBlockIndexDelta(const BlockEntry& block, const Crypto::Hash& blockHash, BlockIndexDelta& delta) const;
+    void applyBlockIndexDelta(const BlockIndexDelta& delta);
+    void revertBlockIndexDelta(const BlockIndexDelta& delta);
+    bool replayJournal(const std::vector<BlockchainJournal::Record>& records);
+    void journalBlock(BlockchainJournal::RecordType type, const BlockEntry& block, const Crypto::Hash& blockHash);
     bool storeCache();
+    void storeCacheIfPending();
+    bool loadBlockHeaders();
+    void pushBlockHeader(const BlockEntry& block, const Crypto::Hash& blockHash);
     bool switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::iterator>& alt_chain, bool discard_disconnected_chain);
     bool handle_alternative_block(const Block& b, const Crypto::Hash& id, block_verification_context& bvc, bool sendNewAlternativeBlockMessage = true);
     difficulty_type get_next_difficulty_for_alternative_chain(const std::list<blocks_ext_by_hash::iterator>& alt_chain, BlockEntry& bei);
@@ -378,16 +555,31 @@ namespace DynexCN {
 	bool complete_timestamps_vector(uint8_t blockMajorVersion, uint64_t start_height, std::vector<uint64_t>& timestamps);
     bool checkBlockVersion(const Block& b, const Crypto::Hash& blockHash);
     bool checkParentBlockSize(const Block& b, const Crypto::Hash& blockHash);
+    bool checkProofOfWork(const Block& block, const Crypto::Hash& blockHash, difficulty_type currentDifficulty, Crypto::Hash& proofOfWork);
     bool checkCumulativeBlockSize(const Crypto::Hash& blockId, size_t cumulativeBlockSize, uint64_t height);
     std::vector<Crypto::Hash> doBuildSparseChain(const Crypto::Hash& startBlockId) const;
     bool getBlockCumulativeSize(const Block& block, size_t& cumulativeSize);
     bool update_next_cumulative_size_limit();
-    bool check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height = NULL);
-    bool checkTransactionInputs(const Transaction& tx, const Crypto::Hash& tx_prefix_hash, uint32_t* pmax_used_block_height = NULL);
-    bool checkTransactionInputs(const Transaction& tx, uint32_t* pmax_used_block_height = NULL);
-    const TransactionEntry& transactionByIndex(TransactionIndex index);
+    bool check_tx_input(const KeyInput& txin, const Crypto::Hash& tx_prefix_hash, const std::vector<Crypto::Signature>& sig, uint32_t* pmax_related_block_height = NULL, std::vector<RingSignatureCheck>* ringSignatureChecks = NULL);
+    bool checkTransactionInputs(const CachedTransaction& tx, uint32_t* pmax_used_block_height = NULL, std::vector<RingSignatureCheck>* ringSignatureChecks = NULL);
+    bool checkRingSignatures(const std::vector<RingSignatureCheck>& checks, size_t& failedCheck);
+    std::shared_ptr<const TransactionEntry> transactionByIndex(TransactionIndex index);
+
+    template<class t_tx_container>
+    static void appendTransaction(t_tx_container& txs, const TransactionEntry& transaction, const Crypto::Hash& transactionHash) {
+      if constexpr (std::is_same<typename t_tx_container::value_type, CachedTransaction>::value) {
+        if (transaction.binary.empty()) {
+          txs.push_back(CachedTransaction(transaction.tx));
+        } else {
+          txs.push_back(CachedTransaction(transaction.tx, transaction.binary, transactionHash));
+        }
+      } else {
+        txs.push_back(transaction.tx);
+      }
+    }
+
     bool pushBlock(const Block& blockData, block_verification_context& bvc);
-    bool pushBlock(const Block& blockData, const std::vector<Transaction>& transactions, block_verification_context& bvc);
+    bool pushBlock(const Block& blockData, const std::vector<CachedTransaction>& transactions, block_verification_context& bvc);
     bool pushBlock(BlockEntry& block);
     void popBlock();
     bool pushTransaction(BlockEntry& block, const Crypto::Hash& transactionHash, TransactionIndex transactionIndex);
@@ -398,8 +590,8 @@ namespace DynexCN {
     void removeLastBlock();
     bool checkUpgradeHeight(const UpgradeDetector& upgradeDetector);
 
-    bool loadTransactions(const Block& block, std::vector<Transaction>& transactions);
-    void saveTransactions(const std::vector<Transaction>& transactions);
+    bool loadTransactions(const Block& block, std::vector<CachedTransaction>& transactions);
+    void saveTransactions(const std::vector<CachedTransaction>& transactions);
 
     void sendMessage(const BlockchainMessage& message);
 
@@ -419,11 +611,11 @@ namespace DynexCN {
   private:
 
     Blockchain& m_bc;
-    std::lock_guard<std::recursive_mutex> m_lock;
+    std::shared_lock<Tools::RecursiveSharedMutex> m_lock;
   };
 
   template<class visitor_t> bool Blockchain::scanOutputKeysForIndexes(const KeyInput& tx_in_to_key, visitor_t& vis, uint32_t* pmax_related_block_height) {
-    std::lock_guard<std::recursive_mutex> lk(m_blockchain_lock);
+    std::shared_lock<decltype(m_blockchain_lock)> lk(m_blockchain_lock);
     auto it = m_outputs.find(tx_in_to_key.amount);
     if (it == m_outputs.end() || !tx_in_to_key.outputIndexes.size())
       return false;
@@ -440,7 +632,8 @@ namespace DynexCN {
       //auto tx_it = m_transactionMap.find(amount_outs_vec[i].first);
       //if (!(tx_it != m_transactionMap.end())) { logger(ERROR, BRIGHT_RED) << "Wrong transaction id in output indexes: " << Common::podToHex(amount_outs_vec[i].first); return false; }
 
-      const TransactionEntry& tx = transactionByIndex(amount_outs_vec[i].first);
+      std::shared_ptr<const TransactionEntry> entry = transactionByIndex(amount_outs_vec[i].first);
+      const TransactionEntry& tx = *entry;
 
       if (!(amount_outs_vec[i].second < tx.tx.outputs.size())) {
         logger(Logging::ERROR, Logging::BRIGHT_RED)
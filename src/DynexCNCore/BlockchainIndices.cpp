@@ -63,6 +63,14 @@ bool AddressIndex::add(const Transaction& transaction, const Crypto::Hash& trans
     return false;
   }
 
+  return add(addresses, transactionHash);
+}
+
+bool AddressIndex::add(const std::vector<std::string>& addresses, const Crypto::Hash& transactionHash) {
+  if (!enabled) {
+    return false;
+  }
+
   for (const auto& address : addresses)
   	index.insert(std::make_pair(address, transactionHash));
 
@@ -79,6 +87,14 @@ bool AddressIndex::remove(const Transaction& transaction, const Crypto::Hash& tr
     return false;
   }
 
+  return remove(addresses, transactionHash);
+}
+
+bool AddressIndex::remove(const std::vector<std::string>& addresses, const Crypto::Hash& transactionHash) {
+  if (!enabled) {
+    return false;
+  }
+
   for (const auto& address : addresses) {
 	  auto range = index.equal_range(address);
 	  for (auto iter = range.first; iter != range.second; ++iter){
@@ -149,6 +165,14 @@ bool PaymentIdIndex::add(const Transaction& transaction, const Crypto::Hash& tra
     return false;
   }
 
+  return add(paymentId, transactionHash);
+}
+
+bool PaymentIdIndex::add(const Crypto::Hash& paymentId, const Crypto::Hash& transactionHash) {
+  if (!enabled) {
+    return false;
+  }
+
   index.insert(std::make_pair(paymentId, transactionHash));
 
   return true;
@@ -164,6 +188,14 @@ bool PaymentIdIndex::remove(const Transaction& transaction, const Crypto::Hash&
     return false;
   }
 
+  return remove(paymentId, transactionHash);
+}
+
+bool PaymentIdIndex::remove(const Crypto::Hash& paymentId, const Crypto::Hash& transactionHash) {
+  if (!enabled) {
+    return false;
+  }
+
   auto range = index.equal_range(paymentId);
   for (auto iter = range.first; iter != range.second; ++iter){
     if (iter->second == transactionHash) {
@@ -356,13 +388,21 @@ bool GeneratedTransactionsIndex::add(const Block& block) {
 
   uint32_t blockHeight = boost::get<BaseInput>(block.baseTransaction.inputs.front()).blockIndex;
 
+  return add(blockHeight, block.transactionHashes.size() + 1); //Plus miner tx
+}
+
+bool GeneratedTransactionsIndex::add(uint32_t blockHeight, uint64_t transactionCount) {
+  if (!enabled) {
+    return false;
+  }
+
   if (index.size() != blockHeight) {
     return false;
   } 
 
-  bool status = index.emplace(blockHeight, lastGeneratedTxNumber + block.transactionHashes.size() + 1).second; //Plus miner tx
+  bool status = index.emplace(blockHeight, lastGeneratedTxNumber + transactionCount).second;
   if (status) {
-    lastGeneratedTxNumber += block.transactionHashes.size() + 1;
+    lastGeneratedTxNumber += transactionCount;
   }
   return status;
 }
@@ -374,6 +414,14 @@ bool GeneratedTransactionsIndex::remove(const Block& block) {
 
   uint32_t blockHeight = boost::get<BaseInput>(block.baseTransaction.inputs.front()).blockIndex;
 
+  return remove(blockHeight);
+}
+
+bool GeneratedTransactionsIndex::remove(uint32_t blockHeight) {
+  if (!enabled) {
+    return false;
+  }
+
   if (blockHeight != index.size() - 1) {
     return false;
   }
@@ -41,6 +41,7 @@
 #include <map>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "crypto/hash.h"
 #include "DynexCNBasic.h"
@@ -54,7 +55,9 @@ class AddressIndex {
 public:
   AddressIndex(bool enabled);
   bool add(const Transaction& transaction, const Crypto::Hash& transactionHash);
+  bool add(const std::vector<std::string>& addresses, const Crypto::Hash& transactionHash);
   bool remove(const Transaction& transaction, const Crypto::Hash& transactionHash);
+  bool remove(const std::vector<std::string>& addresses, const Crypto::Hash& transactionHash);
   bool find(const std::string& address, std::vector<Crypto::Hash>& transactionHashes);
   std::vector<Crypto::Hash> find(const std::string& address);
   void clear();
@@ -80,7 +83,9 @@ public:
   PaymentIdIndex(bool enabled);
 
   bool add(const Transaction& transaction, const Crypto::Hash& transactionHash);
+  bool add(const Crypto::Hash& paymentId, const Crypto::Hash& transactionHash);
   bool remove(const Transaction& transaction, const Crypto::Hash& transactionHash);
+  bool remove(const Crypto::Hash& paymentId, const Crypto::Hash& transactionHash);
   bool find(const Crypto::Hash& paymentId, std::vector<Crypto::Hash>& transactionHashes);
   std::vector<Crypto::Hash> find(const Crypto::Hash& paymentId);
   void clear();
@@ -144,7 +149,9 @@ public:
   GeneratedTransactionsIndex(bool enabled);
 
   bool add(const Block& block);
+  bool add(uint32_t blockHeight, uint64_t transactionCount);
   bool remove(const Block& block);
+  bool remove(uint32_t blockHeight);
   bool find(uint32_t height, uint64_t& generatedTransactions);
   void clear();
 
@@ -0,0 +1,199 @@
+// Copyright (c) 2021-2023, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#include "BlockchainJournal.h"
+
+#include <cstring>
+
+namespace DynexCN {
+
+namespace {
+
+const uint8_t JOURNAL_VERSION = 1;
+const size_t JOURNAL_HEADER_SIZE = sizeof(uint8_t) + sizeof(Crypto::Hash) + sizeof(uint32_t);
+const size_t RECORD_HEADER_SIZE = sizeof(uint8_t) + sizeof(uint32_t);
+const size_t RECORD_CHECKSUM_SIZE = sizeof(uint32_t);
+
+uint32_t recordChecksum(const uint8_t* data, size_t size) {
+  Crypto::Hash hash = Crypto::cn_fast_hash(data, size);
+  uint32_t checksum;
+  memcpy(&checksum, hash.data, sizeof(checksum));
+  return checksum;
+}
+
+}
+
+BlockchainJournal::BlockchainJournal() : m_size(0), m_recordCount(0), m_baseHash(NULL_HASH), m_baseHeight(0) {
+}
+
+bool BlockchainJournal::load(const std::string& path, std::vector<Record>& records) {
+  close();
+  records.clear();
+
+  std::error_code ec;
+  m_file.open(path, false, ec);
+  if (ec) {
+    return false;
+  }
+
+  uint64_t fileSize = m_file.size(ec);
+  if (ec || fileSize < JOURNAL_HEADER_SIZE) {
+    close();
+    return false;
+  }
+
+  BinaryArray content(static_cast<size_t>(fileSize));
+  m_file.read(0, content.data(), content.size(), ec);
+  if (ec || content[0] != JOURNAL_VERSION) {
+    close();
+    return false;
+  }
+
+  memcpy(&m_baseHash, content.data() + sizeof(uint8_t), sizeof(m_baseHash));
+  memcpy(&m_baseHeight, content.data() + sizeof(uint8_t) + sizeof(m_baseHash), sizeof(m_baseHeight));
+
+  size_t offset = JOURNAL_HEADER_SIZE;
+  while (content.size() - offset >= RECORD_HEADER_SIZE + RECORD_CHECKSUM_SIZE) {
+    const uint8_t* record = content.data() + offset;
+    uint32_t dataSize;
+    memcpy(&dataSize, record + sizeof(uint8_t), sizeof(dataSize));
+    if (content.size() - offset - RECORD_HEADER_SIZE - RECORD_CHECKSUM_SIZE < dataSize) {
+      break;
+    }
+
+    uint32_t checksum;
+    memcpy(&checksum, record + RECORD_HEADER_SIZE + dataSize, sizeof(checksum));
+    if (checksum != recordChecksum(record, RECORD_HEADER_SIZE + dataSize) ||
+        (record[0] != BLOCK_PUSHED && record[0] != BLOCK_POPPED)) {
+      break;
+    }
+
+    records.push_back(Record{ static_cast<RecordType>(record[0]), BinaryArray(record + RECORD_HEADER_SIZE, record + RECORD_HEADER_SIZE + dataSize) });
+    offset += RECORD_HEADER_SIZE + dataSize + RECORD_CHECKSUM_SIZE;
+  }
+
+  m_size = offset;
+  m_recordCount = records.size();
+  if (offset != content.size()) {
+    close();
+  }
+
+  return true;
+}
+
+bool BlockchainJournal::reset(const std::string& path, const Crypto::Hash& baseHash, uint32_t baseHeight) {
+  close();
+
+  std::error_code ec;
+  m_file.open(path, true, ec);
+  if (ec) {
+    return false;
+  }
+
+  uint8_t header[JOURNAL_HEADER_SIZE];
+  header[0] = JOURNAL_VERSION;
+  memcpy(header + sizeof(uint8_t), &baseHash, sizeof(baseHash));
+  memcpy(header + sizeof(uint8_t) + sizeof(baseHash), &baseHeight, sizeof(baseHeight));
+  m_file.write(0, header, sizeof(header), ec);
+  if (ec) {
+    close();
+    return false;
+  }
+
+  m_size = sizeof(header);
+  m_recordCount = 0;
+  m_baseHash = baseHash;
+  m_baseHeight = baseHeight;
+  return true;
+}
+
+bool BlockchainJournal::rebase(const std::string& path, const Crypto::Hash& baseHash, uint32_t baseHeight, size_t keptFrom) {
+  std::vector<Record> records;
+  if (m_recordCount > keptFrom) {
+    load(path, records);
+  }
+
+  if (!reset(path, baseHash, baseHeight)) {
+    return false;
+  }
+
+  for (size_t i = keptFrom; i < records.size(); ++i) {
+    if (!append(records[i].type, records[i].data)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool BlockchainJournal::append(RecordType type, const BinaryArray& data) {
+  if (!isOpened()) {
+    return false;
+  }
+
+  uint32_t dataSize = static_cast<uint32_t>(data.size());
+  m_writeBuffer.resize(RECORD_HEADER_SIZE + data.size() + RECORD_CHECKSUM_SIZE);
+  m_writeBuffer[0] = type;
+  memcpy(m_writeBuffer.data() + sizeof(uint8_t), &dataSize, sizeof(dataSize));
+  if (!data.empty()) {
+    memcpy(m_writeBuffer.data() + RECORD_HEADER_SIZE, data.data(), data.size());
+  }
+
+  uint32_t checksum = recordChecksum(m_writeBuffer.data(), RECORD_HEADER_SIZE + data.size());
+  memcpy(m_writeBuffer.data() + RECORD_HEADER_SIZE + data.size(), &checksum, sizeof(checksum));
+
+  std::error_code ec;
+  m_file.write(m_size, m_writeBuffer.data(), m_writeBuffer.size(), ec);
+  if (ec) {
+    // the tail may be torn now, nothing more can be appended safely until a reset
+    close();
+    return false;
+  }
+
+  m_size += m_writeBuffer.size();
+  ++m_recordCount;
+  return true;
+}
+
+void BlockchainJournal::close() {
+  std::error_code ignore;
+  m_file.close(ignore);
+  m_size = 0;
+  m_recordCount = 0;
+}
+
+}
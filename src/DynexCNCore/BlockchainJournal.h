@@ -0,0 +1,93 @@
+// Copyright (c) 2021-2023, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "crypto/hash.h"
+#include "DynexCNCore/DynexCNBasic.h"
+#include "System/PositionalFile.h"
+
+namespace DynexCN {
+
+// Append-only log of the blockchain cache changes made since the last saved snapshot.
+// The file starts with the hash and height of the snapshot it extends, followed by
+// records of [type][payload size][payload][checksum], each written with a single write.
+// A record torn by a crash fails its checksum, loading stops there.
+class BlockchainJournal {
+public:
+  enum RecordType : uint8_t {
+    BLOCK_PUSHED = 1,
+    BLOCK_POPPED = 2
+  };
+
+  struct Record {
+    RecordType type;
+    BinaryArray data;
+  };
+
+  BlockchainJournal();
+
+  // Reads the valid records of an existing journal. The file is kept open for appending
+  // only if every record in it is intact, otherwise it has to be reset before use.
+  bool load(const std::string& path, std::vector<Record>& records);
+  // Truncates the journal and starts a new one on top of the given snapshot.
+  bool reset(const std::string& path, const Crypto::Hash& baseHash, uint32_t baseHeight);
+  // Starts a new journal on top of a snapshot taken when the journal had keptFrom records,
+  // keeping the records appended since then.
+  bool rebase(const std::string& path, const Crypto::Hash& baseHash, uint32_t baseHeight, size_t keptFrom);
+  bool append(RecordType type, const BinaryArray& data);
+  void close();
+
+  bool isOpened() const { return m_file.isOpened(); }
+  const Crypto::Hash& baseHash() const { return m_baseHash; }
+  uint32_t baseHeight() const { return m_baseHeight; }
+  size_t recordCount() const { return m_recordCount; }
+
+private:
+  System::PositionalFile m_file;
+  uint64_t m_size;
+  size_t m_recordCount;
+  Crypto::Hash m_baseHash;
+  uint32_t m_baseHeight;
+  BinaryArray m_writeBuffer;
+};
+
+}
@@ -0,0 +1,110 @@
+// Copyright (c) 2021-2023, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+#include "CachedTransaction.h"
+
+#include <stdexcept>
+
+#include "crypto/hash.h"
+#include "DynexCNTools.h"
+
+namespace DynexCN {
+
+CachedTransaction::CachedTransaction() {
+}
+
+CachedTransaction::CachedTransaction(const Transaction& transaction) : m_transaction(transaction) {
+}
+
+CachedTransaction::CachedTransaction(Transaction&& transaction) : m_transaction(std::move(transaction)) {
+}
+
+CachedTransaction::CachedTransaction(Transaction transaction, BinaryArray binaryArray, const Crypto::Hash& transactionHash) :
+  m_transaction(std::move(transaction)), m_binaryArray(std::move(binaryArray)), m_transactionHash(transactionHash) {
+}
+
+bool CachedTransaction::fromBinaryArray(const BinaryArray& binaryArray, CachedTransaction& transaction) {
+  Transaction parsed;
+  if (!DynexCN::fromBinaryArray(parsed, binaryArray)) {
+    return false;
+  }
+
+  transaction.m_transaction = std::move(parsed);
+  transaction.m_binaryArray = binaryArray;
+  transaction.m_transactionHash = boost::none;
+  transaction.m_transactionPrefixHash = boost::none;
+  return true;
+}
+
+const Crypto::Hash& CachedTransaction::getTransactionHash() const {
+  if (!m_transactionHash) {
+    m_transactionHash = getBinaryArrayHash(getTransactionBinaryArray());
+  }
+
+  return *m_transactionHash;
+}
+
+// The prefix is the head of the binary array, only its size is computed, nothing is serialized again.
+const Crypto::Hash& CachedTransaction::getTransactionPrefixHash() const {
+  if (!m_transactionPrefixHash) {
+    size_t prefixSize;
+    const BinaryArray& binaryArray = getTransactionBinaryArray();
+    if (!getObjectBinarySize(static_cast<const TransactionPrefix&>(m_transaction), prefixSize) || prefixSize > binaryArray.size()) {
+      throw std::runtime_error("CachedTransaction, failed to get the transaction prefix size");
+    }
+
+    Crypto::Hash hash;
+    Crypto::cn_fast_hash(binaryArray.data(), prefixSize, hash);
+    m_transactionPrefixHash = hash;
+  }
+
+  return *m_transactionPrefixHash;
+}
+
+const BinaryArray& CachedTransaction::getTransactionBinaryArray() const {
+  if (!m_binaryArray) {
+    BinaryArray binaryArray;
+    if (!toBinaryArray(m_transaction, binaryArray)) {
+      throw std::runtime_error("CachedTransaction, failed to serialize the transaction");
+    }
+
+    m_binaryArray = std::move(binaryArray);
+  }
+
+  return *m_binaryArray;
+}
+
+}
@@ -0,0 +1,74 @@
+// Copyright (c) 2021-2023, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+#pragma once
+
+#include <boost/optional.hpp>
+
+#include "DynexCN.h"
+
+namespace DynexCN {
+
+// A transaction together with its binary array, hash and prefix hash. Each of them is computed
+// once, when it is first asked for, and a transaction received as a binary array keeps that one,
+// so a transaction is serialized and hashed at most once on its way from the network through the
+// pool into a block. The lazy members are not synchronized, an instance is used by one thread at
+// a time or under the lock of the container holding it.
+class CachedTransaction {
+public:
+  CachedTransaction();
+  explicit CachedTransaction(const Transaction& transaction);
+  explicit CachedTransaction(Transaction&& transaction);
+  // The binary array and the hash are trusted to be those of the transaction.
+  CachedTransaction(Transaction transaction, BinaryArray binaryArray, const Crypto::Hash& transactionHash);
+
+  // Parses a transaction received as a binary array, which is kept.
+  static bool fromBinaryArray(const BinaryArray& binaryArray, CachedTransaction& transaction);
+
+  const Transaction& getTransaction() const { return m_transaction; }
+  const Crypto::Hash& getTransactionHash() const;
+  const Crypto::Hash& getTransactionPrefixHash() const;
+  const BinaryArray& getTransactionBinaryArray() const;
+  size_t getTransactionBinarySize() const { return getTransactionBinaryArray().size(); }
+
+private:
+  Transaction m_transaction;
+  mutable boost::optional<BinaryArray> m_binaryArray;
+  mutable boost::optional<Crypto::Hash> m_transactionHash;
+  mutable boost::optional<Crypto::Hash> m_transactionPrefixHash;
+};
+
+}
@@ -63,9 +63,6 @@ using namespace Logging;
 
 using namespace  Common;
 
-std::unordered_map<Crypto::Hash, bool> PrivacyMem;
-
-
 namespace DynexCN {
 
 class BlockWithTransactions : public IBlock {
@@ -100,10 +97,12 @@ m_checkpoints(logger) {
   set_cryptonote_protocol(pprotocol);
   m_blockchain.addObserver(this);
   m_mempool.addObserver(this);
+  m_observerManager.add(&m_blockTemplateCache);
 }
 //-----------------------------------------------------------------------------------------------
 
 core::~core() {
+  m_observerManager.remove(&m_blockTemplateCache);
   m_blockchain.removeObserver(this);
 }
 
@@ -159,6 +158,10 @@ void core::getTransactions(const std::vector<Crypto::Hash>& txs_ids, std::list<T
   m_blockchain.getTransactions(txs_ids, txs, missed_txs, checkTxPool);
 }
 
+void core::getTransactions(const std::vector<Crypto::Hash>& txs_ids, std::list<CachedTransaction>& txs, std::list<Crypto::Hash>& missed_txs, bool checkTxPool) {
+  m_blockchain.getTransactions(txs_ids, txs, missed_txs, checkTxPool);
+}
+
 bool core::get_alternative_blocks(std::list<Block>& blocks) {
   return m_blockchain.getAlternativeBlocks(blocks);
 }
@@ -213,6 +216,10 @@ bool core::init(const CoreConfig& config, bool load_existing) {
   bool r = m_mempool.init(m_config_folder);
   if (!(r)) { logger(ERROR, BRIGHT_RED) << "Failed to initialize memory pool"; return false; }
 
+  m_blockchain.setBlockCacheSize(config.blockCacheSize);
+  if (!config.authEndpoints.empty()) {
+    m_blockchain.setAuthEndpoints(config.authEndpoints);
+  }
   r = m_blockchain.init(m_config_folder, load_existing);
   if (!(r)) { logger(ERROR, BRIGHT_RED) << "Failed to initialize blockchain storage"; return false; }
 
@@ -242,15 +249,11 @@ size_t core::addChain(const std::vector<const IBlock*>& chain) {
   for (const IBlock* block : chain) {
     bool allTransactionsAdded = true;
     for (size_t txNumber = 0; txNumber < block->getTransactionCount(); ++txNumber) {
-      const Transaction& tx = block->getTransaction(txNumber);
-
-      Crypto::Hash txHash = NULL_HASH;
-      size_t blobSize = 0;
-      getObjectHash(tx, txHash, blobSize);
+      CachedTransaction tx(block->getTransaction(txNumber));
       tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
 
-      if (!handleIncomingTransaction(tx, txHash, blobSize, tvc, true, get_block_height(block->getBlock()))) {
-        logger(ERROR, BRIGHT_RED) << "core::addChain() failed to handle transaction " << txHash << " from block " << blocksCounter << "/" << chain.size();
+      if (!handleIncomingTransaction(tx, tvc, true, get_block_height(block->getBlock()))) {
+        logger(ERROR, BRIGHT_RED) << "core::addChain() failed to handle transaction " << tx.getTransactionHash() << " from block " << blocksCounter << "/" << chain.size();
         allTransactionsAdded = false;
         break;
       }
@@ -285,11 +288,8 @@ bool core::handle_incoming_tx(const BinaryArray& tx_blob, tx_verification_contex
     return false;
   }
 
-  Crypto::Hash tx_hash = NULL_HASH;
-  Crypto::Hash tx_prefixt_hash = NULL_HASH;
-  Transaction tx;
-
-  if (!parse_tx_from_blob(tx, tx_hash, tx_prefixt_hash, tx_blob)) {
+  CachedTransaction tx;
+  if (!CachedTransaction::fromBinaryArray(tx_blob, tx)) {
     logger(INFO) << "WRONG TRANSACTION BLOB, Failed to parse, rejected";
     tvc.m_verification_failed = true;
     return false;
@@ -297,9 +297,9 @@ bool core::handle_incoming_tx(const BinaryArray& tx_blob, tx_verification_contex
   
   Crypto::Hash blockId;
   uint32_t blockHeight;
-  bool ok = getBlockContainingTx(tx_hash, blockId, blockHeight);
+  bool ok = getBlockContainingTx(tx.getTransactionHash(), blockId, blockHeight);
   if (!ok) blockHeight = this->get_current_blockchain_height();
-  return handleIncomingTransaction(tx, tx_hash, tx_blob.size(), tvc, keeped_by_block, blockHeight);
+  return handleIncomingTransaction(tx, tvc, keeped_by_block, blockHeight);
 }
 
 bool core::get_stat_info(core_stat_info& st_inf) {
@@ -347,8 +347,6 @@ bool core::check_tx_fee(const Transaction& tx, size_t blobSize, tx_verification_
     return false;
   }
 
-  Crypto::Hash h = NULL_HASH;
-  getObjectHash(tx, h, blobSize);
   const uint64_t fee = inputs_amount - outputs_amount;
   bool isFusionTransaction = fee == 0 && m_currency.isFusionTransaction(tx, blobSize, height);
   bool enough = true;
@@ -485,11 +483,13 @@ size_t core::get_blockchain_total_transactions() {
   return m_blockchain.getTotalTransactions();
 }
 
-bool core::add_new_tx(const Transaction& tx, const Crypto::Hash& tx_hash, size_t blob_size, tx_verification_context& tvc, bool keeped_by_block) {
+bool core::add_new_tx(const CachedTransaction& tx, tx_verification_context& tvc, bool keeped_by_block) {
   //Locking on m_mempool and m_blockchain closes possibility to add tx to memory pool which is already in blockchain 
   std::lock_guard<decltype(m_mempool)> lk(m_mempool);
   LockedBlockchainStorage lbs(m_blockchain);
 
+  const Crypto::Hash& tx_hash = tx.getTransactionHash();
+
   if (m_blockchain.haveTransaction(tx_hash)) {
     logger(TRACE) << "tx " << tx_hash << " is already in blockchain";
     return true;
@@ -500,10 +500,36 @@ bool core::add_new_tx(const Transaction& tx, const Crypto::Hash& tx_hash, size_t
     return true;
   }
 
-  return m_mempool.add_tx(tx, tx_hash, blob_size, tvc, keeped_by_block);
+  return m_mempool.add_tx(tx, tvc, keeped_by_block);
 }
 
 bool core::get_block_template(Block& b, const AccountPublicAddress& adr, difficulty_type& diffic, uint32_t& height, const BinaryArray& ex_nonce) {
+  // miners poll far more often than the tail or the pool change, reuse the template built for
+  // this tail and only move its timestamp
+  BlockTemplateCache::Entry entry;
+  if (m_blockTemplateCache.find(get_tail_id(), adr, ex_nonce, entry)) {
+    b = std::move(entry.block);
+    b.timestamp = std::max<uint64_t>(time(NULL), entry.minimalTimestamp);
+    diffic = entry.difficulty;
+    height = entry.height;
+    return true;
+  }
+
+  uint64_t cacheVersion = m_blockTemplateCache.version();
+  if (!make_block_template(b, adr, diffic, height, ex_nonce, entry.minimalTimestamp)) {
+    return false;
+  }
+
+  entry.block = b;
+  entry.difficulty = diffic;
+  entry.height = height;
+  entry.address = adr;
+  entry.extraNonce = ex_nonce;
+  m_blockTemplateCache.store(cacheVersion, entry);
+  return true;
+}
+
+bool core::make_block_template(Block& b, const AccountPublicAddress& adr, difficulty_type& diffic, uint32_t& height, const BinaryArray& ex_nonce, uint64_t& minimalTimestamp) {
   size_t median_size;
   uint64_t already_generated_coins;
 
@@ -543,6 +569,7 @@ bool core::get_block_template(Block& b, const AccountPublicAddress& adr, difficu
     
     b.previousBlockHash = get_tail_id();
     b.timestamp = time(NULL);
+    minimalTimestamp = 0;
 
     // Don't generate a block template with invalid timestamp
     // Fix by Jagerman
@@ -554,6 +581,7 @@ bool core::get_block_template(Block& b, const AccountPublicAddress& adr, difficu
         timestamps.push_back(m_blockchain.getBlockTimestamp(offset));
       }
       uint64_t median_ts = Common::medianValue(timestamps);
+      minimalTimestamp = median_ts;
       if (b.timestamp < median_ts) {
           b.timestamp = median_ts;
       }
@@ -655,26 +683,53 @@ bool core::getOutByMSigGIndex(uint64_t amount, uint64_t gindex, MultisignatureOu
 void core::on_synchronized() {
 }
 
-bool core::getPoolChanges(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
-                          std::vector<Transaction>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds) {
-  getPoolChanges(knownTxsIds, addedTxs, deletedTxsIds);
+// The caller holds the pool guard, so the version matches the reported difference.
+bool core::getPoolDifference(uint64_t knownPoolVersion, const std::vector<Crypto::Hash>& knownTxsIds, std::vector<Crypto::Hash>& addedTxsIds,
+                             std::vector<Crypto::Hash>& deletedTxsIds, uint64_t& poolVersion) {
+  poolVersion = m_mempool.get_version();
+  if (knownPoolVersion != 0 && m_mempool.get_difference(knownPoolVersion, addedTxsIds, deletedTxsIds)) {
+    return true;
+  }
+
+  m_mempool.get_difference(knownTxsIds, addedTxsIds, deletedTxsIds);
+  return false;
+}
+
+bool core::getPoolChanges(const Crypto::Hash& tailBlockId, uint64_t knownPoolVersion, const std::vector<Crypto::Hash>& knownTxsIds,
+                          std::vector<Transaction>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds, uint64_t& poolVersion, bool& isPoolVersionActual) {
+  {
+    std::vector<Crypto::Hash> addedTxsIds;
+    auto guard = m_mempool.obtainGuard();
+    isPoolVersionActual = getPoolDifference(knownPoolVersion, knownTxsIds, addedTxsIds, deletedTxsIds, poolVersion);
+    std::vector<Crypto::Hash> misses;
+    m_mempool.getTransactions(addedTxsIds, addedTxs, misses);
+    assert(misses.empty());
+  }
+
   return tailBlockId == m_blockchain.getTailId();
 }
 
-bool core::getPoolChangesLite(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
-        std::vector<TransactionPrefixInfo>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds) {
-  std::vector<Transaction> added;
-  bool returnStatus = getPoolChanges(tailBlockId, knownTxsIds, added, deletedTxsIds);
+bool core::getPoolChangesLite(const Crypto::Hash& tailBlockId, uint64_t knownPoolVersion, const std::vector<Crypto::Hash>& knownTxsIds,
+        std::vector<TransactionPrefixInfo>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds, uint64_t& poolVersion, bool& isPoolVersionActual) {
+  std::vector<CachedTransaction> added;
+  {
+    std::vector<Crypto::Hash> addedTxsIds;
+    auto guard = m_mempool.obtainGuard();
+    isPoolVersionActual = getPoolDifference(knownPoolVersion, knownTxsIds, addedTxsIds, deletedTxsIds, poolVersion);
+    std::vector<Crypto::Hash> misses;
+    m_mempool.getTransactions(addedTxsIds, added, misses);
+    assert(misses.empty());
+  }
 
   for (const auto& tx: added) {
     TransactionPrefixInfo tpi;
-    tpi.txPrefix = tx;
-    tpi.txHash = getObjectHash(tx);
+    tpi.txPrefix = tx.getTransaction();
+    tpi.txHash = tx.getTransactionHash();
 
     addedTxs.push_back(std::move(tpi));
   }
 
-  return returnStatus;
+  return tailBlockId == m_blockchain.getTailId();
 }
 
 void core::getPoolChanges(const std::vector<Crypto::Hash>& knownTxsIds, std::vector<Transaction>& addedTxs,
@@ -705,12 +760,13 @@ bool core::handle_incoming_block_blob(const BinaryArray& block_blob, block_verif
 }
 
 bool core::handle_incoming_block(const Block& b, block_verification_context& bvc, bool control_miner, bool relay_block) {
-
+  // the authorization request runs while addNewBlock checks the transactions
+  m_blockchain.prefetchBlockAuthorization({ &b });
   m_blockchain.addNewBlock(b, bvc);
 
   if (relay_block && bvc.m_added_to_main_chain) {
     std::list<Crypto::Hash> missed_txs;
-    std::list<Transaction> txs;
+    std::list<CachedTransaction> txs;
     m_blockchain.getTransactions(b.transactionHashes, txs, missed_txs);
     if (!missed_txs.empty() && getBlockIdByHeight(get_block_height(b)) != get_block_hash(b)) {
       logger(INFO) << "Block added, but it seems that reorganize just happened after that, do not relay this block";
@@ -728,7 +784,7 @@ bool core::handle_incoming_block(const Block& b, block_verification_context& bvc
       if (!(r)) { logger(ERROR, BRIGHT_RED) << "failed to serialize block"; return false; }
       arg.b.block = asString(blockBa);
       for (auto& tx : txs) {
-        arg.b.txs.push_back(asString(toBinaryArray(tx)));
+        arg.b.txs.push_back(asString(tx.getTransactionBinaryArray()));
       }
 
       m_pprotocol->relay_block(arg);
@@ -746,12 +802,12 @@ size_t core::get_pool_transactions_count() {
   return m_mempool.get_transactions_count();
 }
 
-bool core::have_block(const Crypto::Hash& id) {
-  return m_blockchain.haveBlock(id);
+uint64_t core::get_pool_version() {
+  return m_mempool.get_version();
 }
 
-bool core::parse_tx_from_blob(Transaction& tx, Crypto::Hash& tx_hash, Crypto::Hash& tx_prefix_hash, const BinaryArray& blob) {
-  return parseAndValidateTransactionFromBinaryArray(blob, tx, tx_hash, tx_prefix_hash);
+bool core::have_block(const Crypto::Hash& id) {
+  return m_blockchain.haveBlock(id);
 }
 
 bool core::check_tx_syntax(const Transaction& tx) {
@@ -769,6 +825,10 @@ std::vector<Transaction> core::getPoolTransactions() {
   return result;
 }
 
+bool core::havePoolTransaction(const Crypto::Hash& id) {
+  return m_mempool.have_tx(id);
+}
+
 std::list<DynexCN::tx_memory_pool::TransactionDetails> core::getMemoryPool() const {
   //std::list<DynexCN::tx_memory_pool::TransactionDetails> txs;
   //m_mempool.getMemoryPool(txs);
@@ -850,6 +910,10 @@ void core::txDeletedFromPool() {
   poolUpdated();
 }
 
+void core::txValidatedInPool() {
+  poolUpdated();
+}
+
 void core::poolUpdated() {
   m_observerManager.notify(&ICoreObserver::poolUpdated);
 }
@@ -895,7 +959,7 @@ bool core::queryBlocks(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t
 
     if (b.timestamp >= timestamp) {
       // query transactions
-      std::list<Transaction> txs;
+      std::list<CachedTransaction> txs;
       std::list<Crypto::Hash> missedTxs;
       lbs->getTransactions(b.transactionHashes, txs, missedTxs);
 
@@ -903,7 +967,7 @@ bool core::queryBlocks(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t
       block_complete_entry& completeEntry = item;
       completeEntry.block = asString(toBinaryArray(b));
       for (auto& tx : txs) {
-        completeEntry.txs.push_back(asString(toBinaryArray(tx)));
+        completeEntry.txs.push_back(asString(tx.getTransactionBinaryArray()));
       }
     }
 
@@ -982,7 +1046,7 @@ bool core::queryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint6
     item.blockId = get_block_hash(b);
 
     if (b.timestamp >= timestamp) {
-      std::list<Transaction> txs;
+      std::list<CachedTransaction> txs;
       std::list<Crypto::Hash> missedTxs;
       lbs->getTransactions(b.transactionHashes, txs, missedTxs);
 
@@ -990,8 +1054,8 @@ bool core::queryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint6
 
       for (const auto& tx: txs) {
         TransactionPrefixInfo info;
-        info.txPrefix = tx;
-        info.txHash = getObjectHash(tx);
+        info.txPrefix = tx.getTransaction();
+        info.txHash = tx.getTransactionHash();
 
         item.txPrefixes.push_back(std::move(info));
       }
@@ -1134,27 +1198,27 @@ bool core::getTransactionsByPaymentId(const Crypto::Hash& paymentId, std::vector
 }
 
 // new functions:
-bool core::getTransactionsByAddress(const std::string& address, std::vector<Transaction>& transactions) {
+bool core::getTransactionsByAddress(const std::string& address, std::vector<CachedTransaction>& transactions) {
 
   std::vector<Crypto::Hash> blockchainTransactionHashes;
   m_blockchain.getTransactionIdsByAddress(address, blockchainTransactionHashes); // Blockchain.cpp
 
-  std::list<Transaction> txs;
+  std::list<CachedTransaction> txs;
   std::list<Crypto::Hash> missed_txs;
 
   if (blockchainTransactionHashes.empty()) {
     return false;
   }
 
+  // return only unique txs, equal transactions have equal hashes:
+  blockchainTransactionHashes.erase( unique( blockchainTransactionHashes.begin(), blockchainTransactionHashes.end() ), blockchainTransactionHashes.end() );
+
   getTransactions(blockchainTransactionHashes, txs, missed_txs, true);
     if (missed_txs.size() > 0) {
       return false;
   }
 
   transactions.insert(transactions.end(), txs.begin(), txs.end());
-  
-  // return only unique txs:
-  transactions.erase( unique( transactions.begin(), transactions.end() ), transactions.end() );
 
   return true;
 }
@@ -1197,6 +1261,10 @@ uint64_t core::getTotalGeneratedAmount() {
   return m_blockchain.getCoinsInCirculation();
 }
 
+SwappedVectorCacheStats core::getBlockCacheStats() {
+  return m_blockchain.getBlockCacheStats();
+}
+
 uint8_t core::getBlockMajorVersionForHeight(uint32_t height) const {
   return m_blockchain.getBlockMajorVersionForHeight(height);
 }
@@ -1211,7 +1279,10 @@ bool core::getPaymentId(const Transaction& transaction, Crypto::Hash& paymentId)
   return getPaymentIdFromTransactionExtraNonce(extraNonce.nonce, paymentId);
 }
 
-bool core::handleIncomingTransaction(const Transaction& tx, const Crypto::Hash& txHash, size_t blobSize, tx_verification_context& tvc, bool keptByBlock, uint32_t height) {
+bool core::handleIncomingTransaction(const CachedTransaction& cachedTransaction, tx_verification_context& tvc, bool keptByBlock, uint32_t height) {
+  const Transaction& tx = cachedTransaction.getTransaction();
+  const Crypto::Hash& txHash = cachedTransaction.getTransactionHash();
+  const size_t blobSize = cachedTransaction.getTransactionBinarySize();
   if (!check_tx_syntax(tx)) {
     logger(INFO) << "WRONG TRANSACTION BLOB, Failed to check tx " << txHash << " syntax, rejected";
     tvc.m_verification_failed = true;
@@ -1243,7 +1314,7 @@ bool core::handleIncomingTransaction(const Transaction& tx, const Crypto::Hash&
       return false;
 	  }
 
-    if (!m_blockchain.check_non_privacy(tx)) {
+    if (!m_blockchain.check_non_privacy(tx, txHash)) {
       logger(ERROR) << "Transaction verification failed: incorrect non-privacy data " << txHash << ", rejected";
       tvc.m_verification_failed = true;
       return false;      
@@ -1256,7 +1327,7 @@ bool core::handleIncomingTransaction(const Transaction& tx, const Crypto::Hash&
     return false;
   }
 
-  bool r = add_new_tx(tx, txHash, blobSize, tvc, keptByBlock);
+  bool r = add_new_tx(cachedTransaction, tvc, keptByBlock);
   if (tvc.m_verification_failed) {
     if (!tvc.m_tx_fee_too_small) {
       logger(ERROR) << "Transaction verification failed: " << txHash;
@@ -1328,6 +1399,38 @@ bool core::is_tx_spendtime_unlocked(uint64_t unlock_time, uint32_t height) {
   return m_blockchain.is_tx_spendtime_unlocked(unlock_time, height);
 }
 
+void core::prefetchBlockAuthorization(const std::vector<const Block*>& blocks) {
+  m_blockchain.prefetchBlockAuthorization(blocks);
+}
+
+// The costly results, the proof of work and check_non_privacy, are cached in the blockchain, so
+// handle_incoming_tx and handle_incoming_block do not compute them again.
+bool core::precheckBlock(const Block& block, const std::vector<BinaryArray>& transactions) {
+  if (!m_blockchain.isInCheckpointZone(get_block_height(block))) {
+    for (const BinaryArray& transactionBinary : transactions) {
+      Transaction tx;
+      if (!fromBinaryArray(tx, transactionBinary)) {
+        logger(INFO) << "WRONG TRANSACTION BLOB, Failed to parse, rejected";
+        return false;
+      }
+
+      Crypto::Hash txHash = getBinaryArrayHash(transactionBinary);
+      if (!check_tx_semantic(tx, true)) {
+        logger(INFO) << "WRONG TRANSACTION BLOB, Failed to check tx " << txHash << " semantic, rejected";
+        return false;
+      }
+
+      if (!m_blockchain.check_non_privacy(tx, txHash)) {
+        logger(ERROR) << "Transaction verification failed: incorrect non-privacy data " << txHash << ", rejected";
+        return false;
+      }
+    }
+  }
+
+  m_blockchain.precomputeProofOfWork(block);
+  return true;
+}
+
 bool core::addMessageQueue(MessageQueue<BlockchainMessage>& messageQueue) {
   return m_blockchain.addMessageQueue(messageQueue);
 }
@@ -46,6 +46,7 @@
 #include "Currency.h"
 #include "TransactionPool.h"
 #include "Blockchain.h"
+#include "BlockTemplateCache.h"
 #include "ICore.h"
 #include "ICoreObserver.h"
 #include "IBlockHandler.h"
@@ -104,16 +105,19 @@ namespace DynexCN {
      virtual bool getPoolTransactionsByTimestamp(uint64_t timestampBegin, uint64_t timestampEnd, uint32_t transactionsNumberLimit, std::vector<Transaction>& transactions, uint64_t& transactionsNumberWithinTimestamps) override;
      virtual bool getTransactionsByPaymentId(const Crypto::Hash& paymentId, std::vector<Transaction>& transactions) override;
      // non-privacy functions:
-     virtual bool getTransactionsByAddress(const std::string& address, std::vector<Transaction>& transactions);
+     virtual bool getTransactionsByAddress(const std::string& address, std::vector<CachedTransaction>& transactions);
 
      virtual std::vector<Crypto::Hash> getTransactionHashesByPaymentId(const Crypto::Hash& paymentId) override;
      virtual bool getOutByMSigGIndex(uint64_t amount, uint64_t gindex, MultisignatureOutput& out) override;
      virtual std::unique_ptr<IBlock> getBlock(const Crypto::Hash& blocksId) override;
-     virtual bool handleIncomingTransaction(const Transaction& tx, const Crypto::Hash& txHash, size_t blobSize, tx_verification_context& tvc, bool keptByBlock, uint32_t height) override;
+     virtual bool handleIncomingTransaction(const CachedTransaction& tx, tx_verification_context& tvc, bool keptByBlock, uint32_t height) override;
      virtual std::error_code executeLocked(const std::function<std::error_code()>& func) override;
      virtual uint64_t getMinimalFeeForHeight(uint32_t height) override;
      virtual uint64_t getMinimalFee() override;
 
+     virtual void prefetchBlockAuthorization(const std::vector<const Block*>& blocks) override;
+     virtual bool precheckBlock(const Block& block, const std::vector<BinaryArray>& transactions) override;
+
      virtual bool addMessageQueue(MessageQueue<BlockchainMessage>& messageQueue) override;
      virtual bool removeMessageQueue(MessageQueue<BlockchainMessage>& messageQueue) override;
 
@@ -143,6 +147,7 @@ namespace DynexCN {
        uint32_t& resStartHeight, uint32_t& resCurrentHeight, uint32_t& resFullOffset, std::vector<BlockShortInfo>& entries) override;
      virtual Crypto::Hash getBlockIdByHeight(uint32_t height) override;
      void getTransactions(const std::vector<Crypto::Hash>& txs_ids, std::list<Transaction>& txs, std::list<Crypto::Hash>& missed_txs, bool checkTxPool = false) override;
+     void getTransactions(const std::vector<Crypto::Hash>& txs_ids, std::list<CachedTransaction>& txs, std::list<Crypto::Hash>& missed_txs, bool checkTxPool = false) override;
      virtual bool getBlockByHash(const Crypto::Hash &h, Block &blk) override;
      virtual bool getBlockHeight(const Crypto::Hash& blockId, uint32_t& blockHeight) override;
      //void get_all_known_block_ids(std::list<Crypto::Hash> &main, std::list<Crypto::Hash> &alt, std::list<Crypto::Hash> &invalid);
@@ -154,7 +159,9 @@ namespace DynexCN {
      void set_checkpoints(Checkpoints&& chk_pts);
 
      std::vector<Transaction> getPoolTransactions() override;
+     bool havePoolTransaction(const Crypto::Hash& id) override;
      size_t get_pool_transactions_count();
+     uint64_t get_pool_version();
      size_t get_blockchain_total_transactions();
      //bool get_outs(uint64_t amount, std::list<Crypto::PublicKey>& pkeys);
      virtual std::vector<Crypto::Hash> findBlockchainSupplement(const std::vector<Crypto::Hash>& remoteBlockIds, size_t maxCount,
@@ -171,10 +178,10 @@ namespace DynexCN {
      std::string print_pool(bool short_format);
      std::list<DynexCN::tx_memory_pool::TransactionDetails> getMemoryPool() const;
      void print_blockchain_outs(const std::string& file);
-     virtual bool getPoolChanges(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
-                                 std::vector<Transaction>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds) override;
-     virtual bool getPoolChangesLite(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
-                                  std::vector<TransactionPrefixInfo>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds) override;
+     virtual bool getPoolChanges(const Crypto::Hash& tailBlockId, uint64_t knownPoolVersion, const std::vector<Crypto::Hash>& knownTxsIds,
+                                 std::vector<Transaction>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds, uint64_t& poolVersion, bool& isPoolVersionActual) override;
+     virtual bool getPoolChangesLite(const Crypto::Hash& tailBlockId, uint64_t knownPoolVersion, const std::vector<Crypto::Hash>& knownTxsIds,
+                                  std::vector<TransactionPrefixInfo>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds, uint64_t& poolVersion, bool& isPoolVersionActual) override;
      virtual void getPoolChanges(const std::vector<Crypto::Hash>& knownTxsIds, std::vector<Transaction>& addedTxs,
                                  std::vector<Crypto::Hash>& deletedTxsIds) override;
 
@@ -182,6 +189,7 @@ namespace DynexCN {
 
      uint64_t getNextBlockDifficulty();
      uint64_t getTotalGeneratedAmount();
+     SwappedVectorCacheStats getBlockCacheStats();
      uint8_t getBlockMajorVersionForHeight(uint32_t height) const;
      virtual bool getMixin(const Transaction& transaction, uint64_t& mixin) override;
 
@@ -194,9 +202,11 @@ namespace DynexCN {
      std::string slow_hash_param(int param);
      bool slow_hash_test(bool verbose);
 
-     bool add_new_tx(const Transaction& tx, const Crypto::Hash& tx_hash, size_t blob_size, tx_verification_context& tvc, bool keeped_by_block);
+     bool add_new_tx(const CachedTransaction& tx, tx_verification_context& tvc, bool keeped_by_block);
+     bool getPoolDifference(uint64_t knownPoolVersion, const std::vector<Crypto::Hash>& knownTxsIds, std::vector<Crypto::Hash>& addedTxsIds,
+                            std::vector<Crypto::Hash>& deletedTxsIds, uint64_t& poolVersion);
+     bool make_block_template(Block& b, const AccountPublicAddress& adr, difficulty_type& diffic, uint32_t& height, const BinaryArray& ex_nonce, uint64_t& minimalTimestamp);
      bool load_state_data();
-     bool parse_tx_from_blob(Transaction& tx, Crypto::Hash& tx_hash, Crypto::Hash& tx_prefix_hash, const BinaryArray& blob);
 
      bool check_tx_syntax(const Transaction& tx);
      //check correct values, amounts and all lightweight checks not related with database
@@ -215,6 +225,7 @@ namespace DynexCN {
      bool check_tx_inputs_keyimages_diff(const Transaction& tx);
      virtual void blockchainUpdated() override;
      virtual void txDeletedFromPool() override;
+     virtual void txValidatedInPool() override;
      void poolUpdated();
 
      bool findStartAndFullOffsets(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp, uint32_t& startOffset, uint32_t& startFullOffset);
@@ -232,6 +243,7 @@ namespace DynexCN {
      friend class tx_validate_inputs;
      std::atomic<bool> m_starter_message_showed;
      Tools::ObserverManager<ICoreObserver> m_observerManager;
+     BlockTemplateCache m_blockTemplateCache;
      time_t start_time;
    };
 }
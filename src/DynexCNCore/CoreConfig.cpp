@@ -39,11 +39,20 @@
 
 #include "Common/Util.h"
 #include "Common/CommandLine.h"
+#include "DynexCNConfig.h"
 
 namespace DynexCN {
 
+namespace {
+
+const command_line::arg_descriptor<uint64_t> arg_block_cache_size = {"block-cache-size", "Memory budget for decoded blocks cache, in megabytes, at least 1", parameters::CRYPTONOTE_BLOCKS_CACHE_DEFAULT_SIZE};
+const command_line::arg_descriptor<std::vector<std::string>> arg_auth_endpoint = {"auth-endpoint", "Block authorization endpoint to use instead of the built-in ones, can be repeated"};
+
+}
+
 CoreConfig::CoreConfig() {
   configFolder = Tools::getDefaultDataDirectory();
+  blockCacheSize = parameters::CRYPTONOTE_BLOCKS_CACHE_DEFAULT_SIZE * 1024 * 1024;
 }
 
 void CoreConfig::init(const boost::program_options::variables_map& options) {
@@ -51,9 +60,19 @@ void CoreConfig::init(const boost::program_options::variables_map& options) {
     configFolder = command_line::get_arg(options, command_line::arg_data_dir);
     configFolderDefaulted = options[command_line::arg_data_dir.name].defaulted();
   }
+
+  if (options.count(arg_block_cache_size.name) != 0) {
+    blockCacheSize = command_line::get_arg(options, arg_block_cache_size) * 1024 * 1024;
+  }
+
+  if (options.count(arg_auth_endpoint.name) != 0) {
+    authEndpoints = command_line::get_arg(options, arg_auth_endpoint);
+  }
 }
 
 void CoreConfig::initOptions(boost::program_options::options_description& desc) {
+  command_line::add_arg(desc, arg_block_cache_size);
+  command_line::add_arg(desc, arg_auth_endpoint);
 }
 
 } //namespace DynexCN
@@ -37,7 +37,9 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include <boost/program_options.hpp>
 
@@ -52,6 +54,8 @@ public:
 
   std::string configFolder;
   bool configFolderDefaulted = true;
+  uint64_t blockCacheSize;
+  std::vector<std::string> authEndpoints;
     
 };
 
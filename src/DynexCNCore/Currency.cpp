@@ -99,6 +99,8 @@ namespace DynexCN {
 			m_blocksFileName = "testnet_" + m_blocksFileName;
 			m_blocksCacheFileName = "testnet_" + m_blocksCacheFileName;
 			m_blockIndexesFileName = "testnet_" + m_blockIndexesFileName;
+			m_blockHeadersFileName = "testnet_" + m_blockHeadersFileName;
+			m_blocksCacheJournalFileName = "testnet_" + m_blocksCacheJournalFileName;
 			m_txPoolFileName = "testnet_" + m_txPoolFileName;
 			m_blockchainIndicesFileName = "testnet_" + m_blockchainIndicesFileName;
 		}
@@ -674,22 +676,19 @@ namespace DynexCN {
 
 /* checkProofOfWorkV1 */
 
-bool Currency::checkProofOfWorkV1(Crypto::cn_context& context, const Block& block, difficulty_type currentDiffic,
-	Crypto::Hash& proofOfWork) const {
+bool Currency::checkProofOfWorkV1(const Block& block, difficulty_type currentDiffic,
+	const Crypto::Hash& proofOfWork) const {
 	if (BLOCK_MAJOR_VERSION_2 == block.majorVersion || BLOCK_MAJOR_VERSION_3 == block.majorVersion) {
 		return false;
 	}
 //std::cout << "*** DEBUG *** Currency.cpp -> checkProofOfWorkV1" << std::endl; // only for genesis block
-	if (!get_block_longhash(context, block, proofOfWork)) {
-		return false;
-	}
 	return check_hash(proofOfWork, currentDiffic);
 }
 
 /* checkProofOfWorkV2 */
 
-bool Currency::checkProofOfWorkV2(Crypto::cn_context& context, const Block& block, difficulty_type currentDiffic,
-		Crypto::Hash& proofOfWork) const {
+bool Currency::checkProofOfWorkV2(const Block& block, difficulty_type currentDiffic,
+		const Crypto::Hash& proofOfWork) const {
 
     //std::cout << "*** DEBUG *** Currency.cpp -> checkProofOfWorkV2" << std::endl; // <=== MAIN VERIFICATION OF MINED BLOCK
 
@@ -697,10 +696,6 @@ bool Currency::checkProofOfWorkV2(Crypto::cn_context& context, const Block& bloc
 			return false;
 		}
 
-		if (!get_block_longhash(context, block, proofOfWork)) {
-			return false;
-		}
-
 		if (!check_hash(proofOfWork, currentDiffic)) {
 			return false;
 		}
@@ -733,14 +728,31 @@ bool Currency::checkProofOfWorkV2(Crypto::cn_context& context, const Block& bloc
 	}
 
 	bool Currency::checkProofOfWork(Crypto::cn_context& context, const Block& block, difficulty_type currentDiffic, Crypto::Hash& proofOfWork) const {
+		switch (block.majorVersion) {
+		case BLOCK_MAJOR_VERSION_1:
+		case BLOCK_MAJOR_VERSION_2:
+		case BLOCK_MAJOR_VERSION_3:
+		case BLOCK_MAJOR_VERSION_4:
+			if (!get_block_longhash(context, block, proofOfWork)) {
+				return false;
+			}
+
+			return checkProofOfWork(block, currentDiffic, proofOfWork);
+		}
+
+		logger(ERROR, BRIGHT_RED) << "Unknown block major version: " << block.majorVersion << "." << block.minorVersion;
+		return false;
+	}
+
+	bool Currency::checkProofOfWork(const Block& block, difficulty_type currentDiffic, const Crypto::Hash& proofOfWork) const {
 		switch (block.majorVersion) {
 		case BLOCK_MAJOR_VERSION_1:
 		case BLOCK_MAJOR_VERSION_4:
-			return checkProofOfWorkV1(context, block, currentDiffic, proofOfWork);
+			return checkProofOfWorkV1(block, currentDiffic, proofOfWork);
 
 		case BLOCK_MAJOR_VERSION_2:
 		case BLOCK_MAJOR_VERSION_3:
-			return checkProofOfWorkV2(context, block, currentDiffic, proofOfWork);
+			return checkProofOfWorkV2(block, currentDiffic, proofOfWork);
 		}
 
 		logger(ERROR, BRIGHT_RED) << "Unknown block major version: " << block.majorVersion << "." << block.minorVersion;
@@ -835,6 +847,8 @@ bool Currency::checkProofOfWorkV2(Crypto::cn_context& context, const Block& bloc
 		blocksFileName(parameters::CRYPTONOTE_BLOCKS_FILENAME);
 		blocksCacheFileName(parameters::CRYPTONOTE_BLOCKSCACHE_FILENAME);
 		blockIndexesFileName(parameters::CRYPTONOTE_BLOCKINDEXES_FILENAME);
+		blockHeadersFileName(parameters::CRYPTONOTE_BLOCKHEADERS_FILENAME);
+		blocksCacheJournalFileName(parameters::CRYPTONOTE_BLOCKSCACHE_JOURNAL_FILENAME);
 		txPoolFileName(parameters::CRYPTONOTE_POOLDATA_FILENAME);
 		blockchainIndicesFileName(parameters::CRYPTONOTE_BLOCKCHAIN_INDICES_FILENAME);
 
@@ -157,6 +157,8 @@ public:
   const std::string& blocksFileName() const { return m_blocksFileName; }
   const std::string& blocksCacheFileName() const { return m_blocksCacheFileName; }
   const std::string& blockIndexesFileName() const { return m_blockIndexesFileName; }
+  const std::string& blockHeadersFileName() const { return m_blockHeadersFileName; }
+  const std::string& blocksCacheJournalFileName() const { return m_blocksCacheJournalFileName; }
   const std::string& txPoolFileName() const { return m_txPoolFileName; }
   const std::string& blockchainIndicesFileName() const { return m_blockchainIndicesFileName; }
 
@@ -192,9 +194,11 @@ public:
   difficulty_type nextDifficultyDefault(uint32_t height, std::vector<uint64_t> timestamps, std::vector<difficulty_type> Difficulties) const;
   difficulty_type nextDifficultyV4(uint32_t height, std::vector<uint64_t> timestamps, std::vector<difficulty_type> Difficulties) const;  
 
-  bool checkProofOfWorkV1(Crypto::cn_context& context, const Block& block, difficulty_type currentDiffic, Crypto::Hash& proofOfWork) const;
-  bool checkProofOfWorkV2(Crypto::cn_context& context, const Block& block, difficulty_type currentDiffic, Crypto::Hash& proofOfWork) const;
+  bool checkProofOfWorkV1(const Block& block, difficulty_type currentDiffic, const Crypto::Hash& proofOfWork) const;
+  bool checkProofOfWorkV2(const Block& block, difficulty_type currentDiffic, const Crypto::Hash& proofOfWork) const;
   bool checkProofOfWork(Crypto::cn_context& context, const Block& block, difficulty_type currentDiffic, Crypto::Hash& proofOfWork) const;
+  // Same as above for a proof of work computed earlier with get_block_longhash.
+  bool checkProofOfWork(const Block& block, difficulty_type currentDiffic, const Crypto::Hash& proofOfWork) const;
 
   size_t getApproximateMaximumInputCount(size_t transactionSize, size_t outputCount, size_t mixinCount) const;
 
@@ -275,6 +279,8 @@ private:
   std::string m_blocksFileName;
   std::string m_blocksCacheFileName;
   std::string m_blockIndexesFileName;
+  std::string m_blockHeadersFileName;
+  std::string m_blocksCacheJournalFileName;
   std::string m_txPoolFileName;
   std::string m_blockchainIndicesFileName;
 
@@ -366,6 +372,8 @@ public:
   CurrencyBuilder& blocksFileName(const std::string& val) { m_currency.m_blocksFileName = val; return *this; }
   CurrencyBuilder& blocksCacheFileName(const std::string& val) { m_currency.m_blocksCacheFileName = val; return *this; }
   CurrencyBuilder& blockIndexesFileName(const std::string& val) { m_currency.m_blockIndexesFileName = val; return *this; }
+  CurrencyBuilder& blockHeadersFileName(const std::string& val) { m_currency.m_blockHeadersFileName = val; return *this; }
+  CurrencyBuilder& blocksCacheJournalFileName(const std::string& val) { m_currency.m_blocksCacheJournalFileName = val; return *this; }
   CurrencyBuilder& txPoolFileName(const std::string& val) { m_currency.m_txPoolFileName = val; return *this; }
   CurrencyBuilder& blockchainIndicesFileName(const std::string& val) { m_currency.m_blockchainIndicesFileName = val; return *this; }
   
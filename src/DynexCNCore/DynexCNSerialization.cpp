@@ -162,6 +162,113 @@ bool serializeVarintVector(std::vector<uint32_t>& vector, DynexCN::ISerializer&
   return true;
 }
 
+struct StaticInputWriter : boost::static_visitor<> {
+  StaticInputWriter(DynexCN::StaticBinaryWriter& writer) : writer(writer) {}
+
+  void operator()(const DynexCN::BaseInput& gen) {
+    writer.byte(0xff);
+    writer.varint(gen.blockIndex);
+  }
+
+  void operator()(const DynexCN::KeyInput& key) {
+    writer.byte(0x2);
+    writer.varint(key.amount);
+    writer.varint(key.outputIndexes.size());
+    for (uint32_t outputIndex : key.outputIndexes) {
+      writer.varint(outputIndex);
+    }
+
+    writer.pod(key.keyImage);
+  }
+
+  void operator()(const DynexCN::MultisignatureInput& multisignature) {
+    writer.byte(0x3);
+    writer.varint(multisignature.amount);
+    writer.varint(multisignature.signatureCount);
+    writer.varint(multisignature.outputIndex);
+  }
+
+  DynexCN::StaticBinaryWriter& writer;
+};
+
+struct StaticOutputTargetWriter : boost::static_visitor<> {
+  StaticOutputTargetWriter(DynexCN::StaticBinaryWriter& writer) : writer(writer) {}
+
+  void operator()(const DynexCN::KeyOutput& key) {
+    writer.byte(0x2);
+    writer.pod(key.key);
+  }
+
+  void operator()(const DynexCN::MultisignatureOutput& multisignature) {
+    writer.byte(0x3);
+    writer.varint(multisignature.keys.size());
+    for (const Crypto::PublicKey& key : multisignature.keys) {
+      writer.pod(key);
+    }
+
+    writer.varint(multisignature.requiredSignatureCount);
+  }
+
+  DynexCN::StaticBinaryWriter& writer;
+};
+
+void readInput(DynexCN::StaticBinaryReader& reader, DynexCN::TransactionInput& in) {
+  switch (reader.byte()) {
+  case 0xff: {
+    DynexCN::BaseInput v;
+    reader.varint(v.blockIndex);
+    in = v;
+    break;
+  }
+  case 0x2: {
+    DynexCN::KeyInput v;
+    reader.varint(v.amount);
+    v.outputIndexes.resize(reader.count());
+    for (uint32_t& outputIndex : v.outputIndexes) {
+      reader.varint(outputIndex);
+    }
+
+    reader.pod(v.keyImage);
+    in = std::move(v);
+    break;
+  }
+  case 0x3: {
+    DynexCN::MultisignatureInput v;
+    reader.varint(v.amount);
+    reader.varint(v.signatureCount);
+    reader.varint(v.outputIndex);
+    in = v;
+    break;
+  }
+  default:
+    throw std::runtime_error("Unknown variant tag");
+  }
+}
+
+void readOutputTarget(DynexCN::StaticBinaryReader& reader, DynexCN::TransactionOutputTarget& out) {
+  switch (reader.byte()) {
+  case 0x2: {
+    DynexCN::KeyOutput v;
+    reader.pod(v.key);
+    out = v;
+    break;
+  }
+  case 0x3: {
+    DynexCN::MultisignatureOutput v;
+    v.keys.resize(reader.count(sizeof(Crypto::PublicKey)));
+    for (Crypto::PublicKey& key : v.keys) {
+      reader.pod(key);
+    }
+
+    reader.varint(v.requiredSignatureCount);
+    out = std::move(v);
+    break;
+  }
+  default:
+    throw std::runtime_error("Unknown variant tag");
+  }
+}
+
 }
 
 namespace Crypto {
@@ -474,5 +581,183 @@ void serialize(KeyPair& keyPair, ISerializer& serializer) {
   serializer(keyPair.publicKey, "public_key");
 }
 
+void writeBinary(StaticBinaryWriter& writer, const TransactionPrefix& txP) {
+  writer.varint(txP.version);
+
+  if (CURRENT_TRANSACTION_VERSION < txP.version) {
+    throw std::runtime_error("Wrong transaction version");
+  }
+
+  writer.varint(txP.unlockTime);
+
+  StaticInputWriter inputWriter(writer);
+  writer.varint(txP.inputs.size());
+  for (const TransactionInput& in : txP.inputs) {
+    boost::apply_visitor(inputWriter, in);
+  }
+
+  StaticOutputTargetWriter targetWriter(writer);
+  writer.varint(txP.outputs.size());
+  for (const TransactionOutput& output : txP.outputs) {
+    writer.varint(output.amount);
+    boost::apply_visitor(targetWriter, output.target);
+  }
+
+  writer.blob(txP.extra.data(), txP.extra.size());
+}
+
+void writeBinary(StaticBinaryWriter& writer, const Transaction& tx) {
+  writeBinary(writer, static_cast<const TransactionPrefix&>(tx));
+
+  bool signaturesNotExpected = tx.signatures.empty();
+  if (!signaturesNotExpected && tx.inputs.size() != tx.signatures.size()) {
+    throw std::runtime_error("Serialization error: unexpected signatures size");
+  }
+
+  for (size_t i = 0; i < tx.inputs.size(); ++i) {
+    size_t signatureSize = getSignaturesCount(tx.inputs[i]);
+    if (signaturesNotExpected) {
+      if (signatureSize == 0) {
+        continue;
+      } else {
+        throw std::runtime_error("Serialization error: signatures are not expected");
+      }
+    }
+
+    if (signatureSize != tx.signatures[i].size()) {
+      throw std::runtime_error("Serialization error: unexpected signatures size");
+    }
+
+    writer.binary(tx.signatures[i].data(), signatureSize * sizeof(Crypto::Signature));
+  }
+}
+
+void writeBinary(StaticBinaryWriter& writer, const BlockHeader& header) {
+  writer.varint(header.majorVersion);
+  if (header.majorVersion > BLOCK_MAJOR_VERSION_4) {
+    throw std::runtime_error("Wrong major version");
+  }
+
+  writer.varint(header.minorVersion);
+
+  if (header.majorVersion == BLOCK_MAJOR_VERSION_2 || header.majorVersion == BLOCK_MAJOR_VERSION_3) {
+    writer.pod(header.previousBlockHash);
+  } else if (header.majorVersion == BLOCK_MAJOR_VERSION_1 || header.majorVersion >= BLOCK_MAJOR_VERSION_4) {
+    writer.varint(header.timestamp);
+    writer.pod(header.previousBlockHash);
+    writer.pod(header.nonce);
+  } else {
+    throw std::runtime_error("Wrong major version");
+  }
+}
+
+void writeBinary(StaticBinaryWriter& writer, const Block& block) {
+  writeBinary(writer, static_cast<const BlockHeader&>(block));
+
+  // merge mined blocks are rare, their parent block keeps going through ISerializer
+  if (block.majorVersion == BLOCK_MAJOR_VERSION_2 || block.majorVersion == BLOCK_MAJOR_VERSION_3) {
+    BinaryArray parentBlob;
+    VectorOutputStream stream(parentBlob);
+    BinaryOutputStreamSerializer output(stream);
+    auto parentBlockSerializer = makeParentBlockSerializer(block, false, false);
+    serialize(parentBlockSerializer, output);
+    writer.binary(parentBlob.data(), parentBlob.size());
+  }
+
+  writeBinary(writer, block.baseTransaction);
+  writer.varint(block.transactionHashes.size());
+  writer.binary(block.transactionHashes.data(), block.transactionHashes.size() * sizeof(Crypto::Hash));
+}
+
+void readBinary(StaticBinaryReader& reader, TransactionPrefix& txP) {
+  reader.varint(txP.version);
+
+  if (CURRENT_TRANSACTION_VERSION < txP.version) {
+    throw std::runtime_error("Wrong transaction version");
+  }
+
+  reader.varint(txP.unlockTime);
+
+  txP.inputs.resize(reader.count());
+  for (TransactionInput& in : txP.inputs) {
+    readInput(reader, in);
+  }
+
+  txP.outputs.resize(reader.count());
+  for (TransactionOutput& output : txP.outputs) {
+    reader.varint(output.amount);
+    readOutputTarget(reader, output.target);
+  }
+
+  size_t extraSize;
+  const uint8_t* extra = reader.blob(extraSize);
+  txP.extra.assign(extra, extra + extraSize);
+}
+
+void readBinary(StaticBinaryReader& reader, Transaction& tx) {
+  readBinary(reader, static_cast<TransactionPrefix&>(tx));
+
+  // ignore base transaction
+  size_t sigSize = tx.inputs.size();
+  if (!(sigSize == 1 && tx.inputs[0].type() == typeid(BaseInput))) {
+    tx.signatures.resize(sigSize);
+  }
+
+  bool signaturesNotExpected = tx.signatures.empty();
+  if (!signaturesNotExpected && tx.inputs.size() != tx.signatures.size()) {
+    throw std::runtime_error("Serialization error: unexpected signatures size");
+  }
+
+  for (size_t i = 0; i < tx.inputs.size(); ++i) {
+    size_t signatureSize = getSignaturesCount(tx.inputs[i]);
+    if (signaturesNotExpected) {
+      if (signatureSize == 0) {
+        continue;
+      } else {
+        throw std::runtime_error("Serialization error: signatures are not expected");
+      }
+    }
+
+    const uint8_t* signatures = reader.take(signatureSize * sizeof(Crypto::Signature));
+    tx.signatures[i].resize(signatureSize);
+    memcpy(tx.signatures[i].data(), signatures, signatureSize * sizeof(Crypto::Signature));
+  }
+}
+
+void readBinary(StaticBinaryReader& reader, BlockHeader& header) {
+  reader.varint(header.majorVersion);
+  if (header.majorVersion > BLOCK_MAJOR_VERSION_4) {
+    throw std::runtime_error("Wrong major version");
+  }
+
+  reader.varint(header.minorVersion);
+
+  if (header.majorVersion == BLOCK_MAJOR_VERSION_2 || header.majorVersion == BLOCK_MAJOR_VERSION_3) {
+    reader.pod(header.previousBlockHash);
+  } else if (header.majorVersion == BLOCK_MAJOR_VERSION_1 || header.majorVersion >= BLOCK_MAJOR_VERSION_4) {
+    reader.varint(header.timestamp);
+    reader.pod(header.previousBlockHash);
+    reader.pod(header.nonce);
+  } else {
+    throw std::runtime_error("Wrong major version");
+  }
+}
+
+void readBinary(StaticBinaryReader& reader, Block& block) {
+  readBinary(reader, static_cast<BlockHeader&>(block));
+
+  if (block.majorVersion == BLOCK_MAJOR_VERSION_2 || block.majorVersion == BLOCK_MAJOR_VERSION_3) {
+    MemoryInputStream stream(reader.data(), reader.remaining());
+    BinaryInputStreamSerializer input(stream);
+    auto parentBlockSerializer = makeParentBlockSerializer(block, false, false);
+    serialize(parentBlockSerializer, input);
+    reader.take(stream.getPosition());
+  }
+
+  readBinary(reader, block.baseTransaction);
+  block.transactionHashes.resize(reader.count(sizeof(Crypto::Hash)));
+  reader.binary(block.transactionHashes.data(), block.transactionHashes.size() * sizeof(Crypto::Hash));
+}
+
 
 } //namespace DynexCN
@@ -40,6 +40,7 @@
 #include "DynexCNBasic.h"
 #include "crypto/chacha8.h"
 #include "Serialization/ISerializer.h"
+#include "Serialization/StaticBinarySerializer.h"
 #include "crypto/crypto.h"
 
 namespace Crypto {
@@ -84,4 +85,16 @@ void serialize(AccountKeys& keys, ISerializer& s);
 
 void serialize(KeyPair& keyPair, ISerializer& serializer);
 
+// The binary format of the consensus types without ISerializer, byte for byte what serialize()
+// reads and writes with the binary serializers. Errors are thrown as std::runtime_error.
+void writeBinary(StaticBinaryWriter& writer, const TransactionPrefix& txP);
+void writeBinary(StaticBinaryWriter& writer, const Transaction& tx);
+void writeBinary(StaticBinaryWriter& writer, const BlockHeader& header);
+void writeBinary(StaticBinaryWriter& writer, const Block& block);
+
+void readBinary(StaticBinaryReader& reader, TransactionPrefix& txP);
+void readBinary(StaticBinaryReader& reader, Transaction& tx);
+void readBinary(StaticBinaryReader& reader, BlockHeader& header);
+void readBinary(StaticBinaryReader& reader, Block& block);
+
 }
@@ -38,6 +38,49 @@
 #include "DynexCNTools.h"
 #include "DynexCNFormatUtils.h"
 
+namespace {
+
+using namespace DynexCN;
+
+template<class T>
+bool writeStatic(const T& object, BinaryArray& binaryArray) {
+  try {
+    StaticBinaryWriter writer(binaryArray);
+    writeBinary(writer, object);
+  } catch (std::exception&) {
+    return false;
+  }
+
+  return true;
+}
+
+template<class T>
+bool readStatic(T& object, const BinaryArray& binaryArray) {
+  try {
+    StaticBinaryReader reader(binaryArray.data(), binaryArray.size());
+    readBinary(reader, object);
+    return reader.endOfData(); // check that all data was consumed
+  } catch (std::exception&) {
+    return false;
+  }
+}
+
+template<class T>
+bool sizeStatic(const T& object, size_t& size) {
+  try {
+    StaticBinaryWriter writer;
+    writeBinary(writer, object);
+    size = writer.size();
+  } catch (std::exception&) {
+    size = (std::numeric_limits<size_t>::max)();
+    return false;
+  }
+
+  return true;
+}
+
+}
+
 namespace DynexCN {
 template<>
 bool toBinaryArray(const BinaryArray& object, BinaryArray& binaryArray) {
@@ -53,6 +96,66 @@ bool toBinaryArray(const BinaryArray& object, BinaryArray& binaryArray) {
   return true;
 }
 
+template<>
+bool toBinaryArray(const TransactionPrefix& object, BinaryArray& binaryArray) {
+  return writeStatic(object, binaryArray);
+}
+
+template<>
+bool toBinaryArray(const Transaction& object, BinaryArray& binaryArray) {
+  return writeStatic(object, binaryArray);
+}
+
+template<>
+bool toBinaryArray(const BlockHeader& object, BinaryArray& binaryArray) {
+  return writeStatic(object, binaryArray);
+}
+
+template<>
+bool toBinaryArray(const Block& object, BinaryArray& binaryArray) {
+  return writeStatic(object, binaryArray);
+}
+
+template<>
+bool fromBinaryArray(TransactionPrefix& object, const BinaryArray& binaryArray) {
+  return readStatic(object, binaryArray);
+}
+
+template<>
+bool fromBinaryArray(Transaction& object, const BinaryArray& binaryArray) {
+  return readStatic(object, binaryArray);
+}
+
+template<>
+bool fromBinaryArray(BlockHeader& object, const BinaryArray& binaryArray) {
+  return readStatic(object, binaryArray);
+}
+
+template<>
+bool fromBinaryArray(Block& object, const BinaryArray& binaryArray) {
+  return readStatic(object, binaryArray);
+}
+
+template<>
+bool getObjectBinarySize(const TransactionPrefix& object, size_t& size) {
+  return sizeStatic(object, size);
+}
+
+template<>
+bool getObjectBinarySize(const Transaction& object, size_t& size) {
+  return sizeStatic(object, size);
+}
+
+template<>
+bool getObjectBinarySize(const BlockHeader& object, size_t& size) {
+  return sizeStatic(object, size);
+}
+
+template<>
+bool getObjectBinarySize(const Block& object, size_t& size) {
+  return sizeStatic(object, size);
+}
+
 void getBinaryArrayHash(const BinaryArray& binaryArray, Crypto::Hash& hash) {
   cn_fast_hash(binaryArray.data(), binaryArray.size(), hash);
 }
@@ -139,6 +139,20 @@ Crypto::Hash getObjectHash(const T& object) {
   return hash;
 }
 
+// The consensus types skip ISerializer, see writeBinary and readBinary.
+template<> bool toBinaryArray(const TransactionPrefix& object, BinaryArray& binaryArray);
+template<> bool toBinaryArray(const Transaction& object, BinaryArray& binaryArray);
+template<> bool toBinaryArray(const BlockHeader& object, BinaryArray& binaryArray);
+template<> bool toBinaryArray(const Block& object, BinaryArray& binaryArray);
+template<> bool fromBinaryArray(TransactionPrefix& object, const BinaryArray& binaryArray);
+template<> bool fromBinaryArray(Transaction& object, const BinaryArray& binaryArray);
+template<> bool fromBinaryArray(BlockHeader& object, const BinaryArray& binaryArray);
+template<> bool fromBinaryArray(Block& object, const BinaryArray& binaryArray);
+template<> bool getObjectBinarySize(const TransactionPrefix& object, size_t& size);
+template<> bool getObjectBinarySize(const Transaction& object, size_t& size);
+template<> bool getObjectBinarySize(const BlockHeader& object, size_t& size);
+template<> bool getObjectBinarySize(const Block& object, size_t& size);
+
 uint64_t getInputAmount(const Transaction& transaction);
 std::vector<uint64_t> getInputsAmounts(const Transaction& transaction);
 uint64_t getOutputAmount(const Transaction& transaction);
@@ -57,6 +57,7 @@ struct COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS_response;
 struct NOTIFY_RESPONSE_GET_OBJECTS_request;
 struct NOTIFY_REQUEST_GET_OBJECTS_request;
 
+class CachedTransaction;
 class Currency;
 class IBlock;
 class ICoreObserver;
@@ -99,10 +100,14 @@ public:
   virtual i_cn_protocol* get_protocol() = 0;
   virtual bool handle_incoming_tx(const BinaryArray& tx_blob, tx_verification_context& tvc, bool keeped_by_block) = 0; //Deprecated. Should be removed with DynexCNProtocolHandler.
   virtual std::vector<Transaction> getPoolTransactions() = 0;
-  virtual bool getPoolChanges(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
-                              std::vector<Transaction>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds) = 0;
-  virtual bool getPoolChangesLite(const Crypto::Hash& tailBlockId, const std::vector<Crypto::Hash>& knownTxsIds,
-                              std::vector<TransactionPrefixInfo>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds) = 0;
+  virtual bool havePoolTransaction(const Crypto::Hash& id) = 0;
+  // A non-zero knownPoolVersion, as returned in poolVersion before, lets the changes be taken from
+  // the pool change log; isPoolVersionActual tells whether they were. Otherwise they are relative
+  // to knownTxsIds.
+  virtual bool getPoolChanges(const Crypto::Hash& tailBlockId, uint64_t knownPoolVersion, const std::vector<Crypto::Hash>& knownTxsIds,
+                              std::vector<Transaction>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds, uint64_t& poolVersion, bool& isPoolVersionActual) = 0;
+  virtual bool getPoolChangesLite(const Crypto::Hash& tailBlockId, uint64_t knownPoolVersion, const std::vector<Crypto::Hash>& knownTxsIds,
+                              std::vector<TransactionPrefixInfo>& addedTxs, std::vector<Crypto::Hash>& deletedTxsIds, uint64_t& poolVersion, bool& isPoolVersionActual) = 0;
   virtual void getPoolChanges(const std::vector<Crypto::Hash>& knownTxsIds, std::vector<Transaction>& addedTxs,
                               std::vector<Crypto::Hash>& deletedTxsIds) = 0;
   virtual bool queryBlocks(const std::vector<Crypto::Hash>& block_ids, uint64_t timestamp,
@@ -114,6 +119,8 @@ public:
   virtual bool getBlockByHash(const Crypto::Hash &h, Block &blk) = 0;
   virtual bool getBlockHeight(const Crypto::Hash& blockId, uint32_t& blockHeight) = 0;
   virtual void getTransactions(const std::vector<Crypto::Hash>& txs_ids, std::list<Transaction>& txs, std::list<Crypto::Hash>& missed_txs, bool checkTxPool = false) = 0;
+  // with the binary arrays the transactions were stored with, so they need not be serialized again
+  virtual void getTransactions(const std::vector<Crypto::Hash>& txs_ids, std::list<CachedTransaction>& txs, std::list<Crypto::Hash>& missed_txs, bool checkTxPool = false) = 0;
   virtual bool getBackwardBlocksSizes(uint32_t fromHeight, std::vector<size_t>& sizes, size_t count) = 0;
   virtual bool getBlockSize(const Crypto::Hash& hash, size_t& size) = 0;
   virtual bool getAlreadyGeneratedCoins(const Crypto::Hash& hash, uint64_t& generatedCoins) = 0;
@@ -140,9 +147,13 @@ public:
   virtual uint8_t getCurrentBlockMajorVersion() = 0;
 
   virtual std::unique_ptr<IBlock> getBlock(const Crypto::Hash& blocksId) = 0;
-  virtual bool handleIncomingTransaction(const Transaction& tx, const Crypto::Hash& txHash, size_t blobSize, tx_verification_context& tvc, bool keptByBlock, uint32_t height) = 0;
+  virtual bool handleIncomingTransaction(const CachedTransaction& tx, tx_verification_context& tvc, bool keptByBlock, uint32_t height) = 0;
   virtual std::error_code executeLocked(const std::function<std::error_code()>& func) = 0;
 
+  virtual void prefetchBlockAuthorization(const std::vector<const Block*>& blocks) = 0;
+  // Checks of a block about to be added that need no blockchain state, safe to call from any thread.
+  virtual bool precheckBlock(const Block& block, const std::vector<BinaryArray>& transactions) = 0;
+
   virtual bool addMessageQueue(MessageQueue<BlockchainMessage>& messageQueue) = 0;
   virtual bool removeMessageQueue(MessageQueue<BlockchainMessage>& messageQueue) = 0;
 
@@ -37,6 +37,7 @@
 
 #pragma once
 
+#include "DynexCNCore/CachedTransaction.h"
 #include "DynexCNCore/DynexCNBasic.h"
 
 namespace DynexCN {
@@ -63,8 +64,8 @@ namespace DynexCN {
   public:
     virtual ~ITransactionValidator() {}
     
-    virtual bool checkTransactionInputs(const DynexCN::Transaction& tx, BlockInfo& maxUsedBlock) = 0;
-    virtual bool checkTransactionInputs(const DynexCN::Transaction& tx, BlockInfo& maxUsedBlock, BlockInfo& lastFailed) = 0;
+    virtual bool checkTransactionInputs(const DynexCN::CachedTransaction& tx, BlockInfo& maxUsedBlock) = 0;
+    virtual bool checkTransactionInputs(const DynexCN::CachedTransaction& tx, BlockInfo& maxUsedBlock, BlockInfo& lastFailed) = 0;
     virtual bool haveSpentKeyImages(const DynexCN::Transaction& tx) = 0;
     virtual bool checkTransactionSize(size_t blobSize) = 0;
   };
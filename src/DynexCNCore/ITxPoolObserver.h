@@ -44,5 +44,7 @@ public:
   }
 
   virtual void txDeletedFromPool() = 0;
+  // a transaction waiting for validation turned out to be ready for a block
+  virtual void txValidatedInPool() = 0;
 };
 }
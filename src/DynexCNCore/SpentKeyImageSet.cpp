@@ -0,0 +1,225 @@
+// Copyright (c) 2021-2023, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#include "SpentKeyImageSet.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace DynexCN {
+
+namespace {
+
+const size_t MIN_SLOT_COUNT = 1024;
+const size_t NOT_FOUND = SIZE_MAX;
+
+}
+
+SpentKeyImageSet::SpentKeyImageSet() : m_logSize(0), m_size(0), m_seed(Crypto::rand<uint64_t>()) {
+}
+
+// The copy keeps the seed, the slots of the table stay valid for it.
+SpentKeyImageSet::SpentKeyImageSet(const SpentKeyImageSet& other) :
+  m_slots(other.m_slots), m_logSize(other.m_logSize), m_size(other.m_size), m_seed(other.m_seed) {
+  m_log.reserve(other.m_log.size());
+  for (auto& chunk : other.m_log) {
+    m_log.emplace_back(new SpentKeyImage[LOG_CHUNK_SIZE]);
+    std::copy(chunk.get(), chunk.get() + LOG_CHUNK_SIZE, m_log.back().get());
+  }
+}
+
+// The seed keeps key images ground to share a bucket from clustering in the table.
+size_t SpentKeyImageSet::bucket(const Crypto::KeyImage& keyImage) const {
+  uint64_t h;
+  memcpy(&h, keyImage.data, sizeof(h));
+  h ^= m_seed;
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+  h ^= h >> 31;
+  return static_cast<size_t>(h) & (m_slots.size() - 1);
+}
+
+uint32_t SpentKeyImageSet::tag(const Crypto::KeyImage& keyImage) {
+  uint32_t t;
+  memcpy(&t, keyImage.data + sizeof(uint64_t), sizeof(t));
+  return t;
+}
+
+size_t SpentKeyImageSet::findSlot(const Crypto::KeyImage& keyImage) const {
+  if (m_slots.empty()) {
+    return NOT_FOUND;
+  }
+
+  const size_t mask = m_slots.size() - 1;
+  const uint32_t t = tag(keyImage);
+  for (size_t i = bucket(keyImage); m_slots[i].entry != EMPTY; i = (i + 1) & mask) {
+    if (m_slots[i].tag == t && logEntry(m_slots[i].entry).keyImage == keyImage) {
+      return i;
+    }
+  }
+
+  return NOT_FOUND;
+}
+
+void SpentKeyImageSet::place(uint32_t entry) {
+  const Crypto::KeyImage& keyImage = logEntry(entry).keyImage;
+  const size_t mask = m_slots.size() - 1;
+  size_t i = bucket(keyImage);
+  while (m_slots[i].entry != EMPTY) {
+    i = (i + 1) & mask;
+  }
+
+  m_slots[i].tag = tag(keyImage);
+  m_slots[i].entry = entry;
+}
+
+void SpentKeyImageSet::rehash(size_t slotCount) {
+  m_slots.assign(slotCount, Slot{ 0, EMPTY });
+  for (size_t i = 0; i < m_logSize; ++i) {
+    if (logEntry(i).blockIndex != REMOVED) {
+      place(static_cast<uint32_t>(i));
+    }
+  }
+}
+
+bool SpentKeyImageSet::insert(const Crypto::KeyImage& keyImage, uint32_t blockIndex) {
+  if (findSlot(keyImage) != NOT_FOUND) {
+    return false;
+  }
+
+  // at most three quarters of the slots are used, probe sequences stay short
+  if ((m_size + 1) * 4 > m_slots.size() * 3) {
+    rehash(std::max(MIN_SLOT_COUNT, m_slots.size() * 2));
+  }
+
+  if (m_logSize == m_log.size() * LOG_CHUNK_SIZE) {
+    m_log.emplace_back(new SpentKeyImage[LOG_CHUNK_SIZE]);
+  }
+
+  uint32_t entry = static_cast<uint32_t>(m_logSize++);
+  logEntry(entry) = SpentKeyImage{ blockIndex, keyImage };
+  place(entry);
+  ++m_size;
+  return true;
+}
+
+bool SpentKeyImageSet::erase(const Crypto::KeyImage& keyImage) {
+  size_t hole = findSlot(keyImage);
+  if (hole == NOT_FOUND) {
+    return false;
+  }
+
+  logEntry(m_slots[hole].entry).blockIndex = REMOVED;
+  --m_size;
+
+  // shift the following slots of the probe sequence back instead of leaving a tombstone
+  const size_t mask = m_slots.size() - 1;
+  for (size_t i = (hole + 1) & mask; m_slots[i].entry != EMPTY; i = (i + 1) & mask) {
+    size_t home = bucket(logEntry(m_slots[i].entry).keyImage);
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      m_slots[hole] = m_slots[i];
+      hole = i;
+    }
+  }
+
+  m_slots[hole].entry = EMPTY;
+
+  // blocks are popped from the top, so removed entries are normally at the end of the log
+  while (m_logSize > 0 && logEntry(m_logSize - 1).blockIndex == REMOVED) {
+    --m_logSize;
+  }
+
+  if (m_logSize - m_size > m_size / 2 + LOG_CHUNK_SIZE) {
+    compact();
+  }
+
+  while (m_log.size() > (m_logSize >> LOG_CHUNK_BITS) + 2) {
+    m_log.pop_back();
+  }
+
+  return true;
+}
+
+bool SpentKeyImageSet::find(const Crypto::KeyImage& keyImage, uint32_t& blockIndex) const {
+  size_t i = findSlot(keyImage);
+  if (i == NOT_FOUND) {
+    return false;
+  }
+
+  blockIndex = logEntry(m_slots[i].entry).blockIndex;
+  return true;
+}
+
+bool SpentKeyImageSet::contains(const Crypto::KeyImage& keyImage) const {
+  return findSlot(keyImage) != NOT_FOUND;
+}
+
+void SpentKeyImageSet::reserve(size_t count) {
+  size_t slotCount = MIN_SLOT_COUNT;
+  while (slotCount * 3 < count * 4) {
+    slotCount *= 2;
+  }
+
+  if (slotCount > m_slots.size()) {
+    rehash(slotCount);
+  }
+
+  m_log.reserve(count / LOG_CHUNK_SIZE + 1);
+}
+
+void SpentKeyImageSet::clear() {
+  std::vector<Slot>().swap(m_slots);
+  std::vector<std::unique_ptr<SpentKeyImage[]>>().swap(m_log);
+  m_logSize = 0;
+  m_size = 0;
+}
+
+// Drops the removed entries from the middle of the log, only needed if entries were
+// removed out of the order they were added in.
+void SpentKeyImageSet::compact() {
+  size_t live = 0;
+  for (size_t i = 0; i < m_logSize; ++i) {
+    if (logEntry(i).blockIndex != REMOVED) {
+      logEntry(live++) = logEntry(i);
+    }
+  }
+
+  m_logSize = live;
+  rehash(m_slots.size());
+}
+
+}
@@ -0,0 +1,114 @@
+// Copyright (c) 2021-2023, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "crypto/crypto.h"
+
+namespace DynexCN {
+
+struct SpentKeyImage {
+  uint32_t blockIndex;
+  Crypto::KeyImage keyImage;
+};
+
+// Key images spent on the main chain, with the index of the spending block.
+// The key images are stored once, in a log appended in the order they are spent, which is
+// the block order. An open-addressing table of 8-byte slots holds 32 bits of each key image
+// and its position in the log, so checking a key image that is not spent usually reads one
+// cache line of the table and nothing from the log. Popping blocks removes entries from the
+// end of the log.
+class SpentKeyImageSet {
+public:
+  SpentKeyImageSet();
+  SpentKeyImageSet(const SpentKeyImageSet& other);
+  SpentKeyImageSet& operator=(const SpentKeyImageSet& other) = delete;
+
+  // Returns false, without changing anything, if the key image is already spent.
+  bool insert(const Crypto::KeyImage& keyImage, uint32_t blockIndex);
+  bool erase(const Crypto::KeyImage& keyImage);
+  bool find(const Crypto::KeyImage& keyImage, uint32_t& blockIndex) const;
+  bool contains(const Crypto::KeyImage& keyImage) const;
+  void reserve(size_t count);
+  void clear();
+
+  size_t size() const { return m_size; }
+
+  // Visits the key images in the order they were spent.
+  template<class F>
+  void forEach(F f) const {
+    for (size_t i = 0; i < m_logSize; ++i) {
+      const SpentKeyImage& entry = logEntry(i);
+      if (entry.blockIndex != REMOVED) {
+        f(entry);
+      }
+    }
+  }
+
+private:
+  struct Slot {
+    uint32_t tag;
+    uint32_t entry;
+  };
+
+  static const uint32_t EMPTY = UINT32_MAX;
+  static const uint32_t REMOVED = UINT32_MAX;
+  static const size_t LOG_CHUNK_BITS = 12;
+  static const size_t LOG_CHUNK_SIZE = size_t(1) << LOG_CHUNK_BITS;
+
+  SpentKeyImage& logEntry(size_t index) { return m_log[index >> LOG_CHUNK_BITS][index & (LOG_CHUNK_SIZE - 1)]; }
+  const SpentKeyImage& logEntry(size_t index) const { return m_log[index >> LOG_CHUNK_BITS][index & (LOG_CHUNK_SIZE - 1)]; }
+
+  size_t bucket(const Crypto::KeyImage& keyImage) const;
+  static uint32_t tag(const Crypto::KeyImage& keyImage);
+  size_t findSlot(const Crypto::KeyImage& keyImage) const;
+  void place(uint32_t entry);
+  void rehash(size_t slotCount);
+  void compact();
+
+  std::vector<Slot> m_slots;
+  std::vector<std::unique_ptr<SpentKeyImage[]>> m_log;
+  size_t m_logSize;
+  size_t m_size;
+  uint64_t m_seed;
+};
+
+}
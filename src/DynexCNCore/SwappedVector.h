@@ -39,18 +39,37 @@
 
 #include <cstdint>
 #include <cstddef>
-#include <fstream>
-#include <iomanip>
-#include <iostream>
-#include <list>
-#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <type_traits>
 #include <vector>
 
-#include "Common/StdInputStream.h"
-#include "Common/StdOutputStream.h"
+#include "Common/MemoryInputStream.h"
+#include "Common/VectorOutputStream.h"
 #include "Serialization/BinaryInputStreamSerializer.h"
 #include "Serialization/BinaryOutputStreamSerializer.h"
+#include "Serialization/StaticBinarySerializer.h"
+#include "System/PositionalFile.h"
+
+struct SwappedVectorCacheStats {
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+  uint64_t items;
+  uint64_t size;
+  uint64_t budget;
+};
+
+// Items with writeBinary and readBinary members are stored and loaded without ISerializer.
+template<class T, class = void> struct SwappedVectorHasStaticFormat : std::false_type {};
+template<class T> struct SwappedVectorHasStaticFormat<T,
+  std::void_t<decltype(std::declval<T&>().readBinary(std::declval<DynexCN::StaticBinaryReader&>()))>> : std::true_type {};
+
+// Items keeping buffers next to their decoded fields report them with a bufferedSize member.
+template<class T, class = void> struct SwappedVectorHasBufferedSize : std::false_type {};
+template<class T> struct SwappedVectorHasBufferedSize<T,
+  std::void_t<decltype(std::declval<const T&>().bufferedSize())>> : std::true_type {};
 
 template<class T> class SwappedVector {
 public:
@@ -60,8 +79,8 @@ public:
   public:
     typedef ptrdiff_t difference_type;
     typedef std::random_access_iterator_tag iterator_category;
-    typedef const T* pointer;
-    typedef const T& reference;
+    typedef std::shared_ptr<const T> pointer;
+    typedef std::shared_ptr<const T> reference;
     typedef T value_type;
 
     const_iterator() {
@@ -142,15 +161,11 @@ public:
       return const_iterator(m_swappedVector, m_index - n);
     }
 
-    const T& operator*() const {
+    std::shared_ptr<const T> operator*() const {
       return (*m_swappedVector)[m_index];
     }
 
-    const T* operator->() const {
-      return &(*m_swappedVector)[m_index];
-    }
-
-    const T& operator[](difference_type offset) const {
+    std::shared_ptr<const T> operator[](difference_type offset) const {
       return (*m_swappedVector)[m_index + offset];
     }
 
@@ -168,78 +183,125 @@ public:
   ~SwappedVector();
   //SwappedVector& operator=(const SwappedVector&) = delete;
 
-  bool open(const std::string& itemFileName, const std::string& indexFileName, size_t poolSize);
+  bool open(const std::string& itemFileName, const std::string& indexFileName, uint64_t cacheBudget);
   void close();
+  void flush();
 
   bool empty() const;
   uint64_t size() const;
   const_iterator begin();
   const_iterator end();
-  const T& operator[](uint64_t index);
-  const T& front();
-  const T& back();
+  std::shared_ptr<const T> operator[](uint64_t index);
+  std::shared_ptr<const T> front();
+  std::shared_ptr<const T> back();
   void clear();
   void pop_back();
   void push_back(const T& item);
 
+  SwappedVectorCacheStats getCacheStats();
+  // Evicts down to a lowered budget right away, must not run concurrently with other calls.
+  void setCacheBudget(uint64_t cacheBudget);
+
 private:
-  struct ItemEntry;
-  struct CacheEntry;
+  static const uint32_t CACHE_SHARD_COUNT = 16;
+  static const uint32_t EMPTY_SLOT = UINT32_MAX;
+  static const size_t INDEX_FLUSH_BATCH = 64;
+
+  // Items are shared with the pointers handed out by operator[], so evicting a slot never
+  // invalidates an item still in use; freed slots are reused.
+  struct CacheSlot {
+    uint64_t index;
+    uint64_t cost;
+    bool used;
+    bool referenced;
+    std::shared_ptr<const T> item;
+  };
 
-  struct ItemEntry {
-  public:
-    T item;
-    typename std::list<CacheEntry>::iterator cacheIter;
+  struct CacheBucket {
+    uint64_t index;
+    uint32_t slot;
   };
 
-  struct CacheEntry {
-  public:
-    typename std::map<uint64_t, ItemEntry>::iterator itemIter;
+  // Items are spread over shards by index. Each shard is a CLOCK ring of slots with
+  // a flat open-addressing (linear probing) index from item index to slot.
+  struct CacheShard {
+    std::mutex mutex;
+    std::vector<CacheSlot> slots;
+    std::vector<uint32_t> freeSlots;
+    std::vector<CacheBucket> buckets;
+    size_t hand;
+    uint64_t size;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    std::vector<uint8_t> readBuffer;
   };
 
-  std::fstream m_itemsFile;
-  std::fstream m_indexesFile;
-  size_t m_poolSize;
+  System::PositionalFile m_itemsFile;
+  System::PositionalFile m_indexesFile;
+  uint64_t m_cacheBudget;
   std::vector<uint64_t> m_offsets;
   uint64_t m_itemsFileSize;
-  std::map<uint64_t, ItemEntry> m_items;
-  std::list<CacheEntry> m_cache;
-  uint64_t m_cacheHits;
-  uint64_t m_cacheMisses;
-
-  T* prepare(uint64_t index);
+  uint64_t m_indexedCount;
+  std::vector<uint32_t> m_pendingItemSizes;
+  std::vector<uint8_t> m_writeBuffer;
+  CacheShard m_shards[CACHE_SHARD_COUNT];
+
+  CacheShard& shardFor(uint64_t index);
+  uint64_t itemCost(uint64_t index, const T& item) const;
+  void resetCache();
+  void flushIndex(std::error_code& ec);
+  static size_t bucketFor(const CacheShard& shard, uint64_t index);
+  static uint32_t findSlot(const CacheShard& shard, uint64_t index);
+  static void insertBucket(CacheShard& shard, uint64_t index, uint32_t slot);
+  static void eraseBucket(CacheShard& shard, uint64_t index);
+  static void growBuckets(CacheShard& shard);
+  void releaseSlot(CacheShard& shard, uint32_t slot);
+  bool evictOne(CacheShard& shard);
+  void insert(CacheShard& shard, uint64_t index, uint64_t cost, std::shared_ptr<const T> item);
+  static void readItem(T& item, const std::vector<uint8_t>& buffer);
+  static void writeItem(const T& item, std::vector<uint8_t>& buffer);
 };
 
-template<class T> SwappedVector<T>::SwappedVector() {
+template<class T> SwappedVector<T>::SwappedVector() : m_cacheBudget(0), m_itemsFileSize(0), m_indexedCount(0) {
+  resetCache();
 }
 
 template<class T> SwappedVector<T>::~SwappedVector() {
   close();
 }
 
-template<class T> bool SwappedVector<T>::open(const std::string& itemFileName, const std::string& indexFileName, size_t poolSize) {
-  if (poolSize == 0) {
+template<class T> bool SwappedVector<T>::open(const std::string& itemFileName, const std::string& indexFileName, uint64_t cacheBudget) {
+  if (cacheBudget == 0) {
     return false;
   }
 
-  m_itemsFile.open(itemFileName, std::ios::in | std::ios::out | std::ios::binary);
-  m_indexesFile.open(indexFileName, std::ios::in | std::ios::out | std::ios::binary);
-  if (m_itemsFile && m_indexesFile) {
+  close();
+
+  std::error_code itemsError;
+  std::error_code indexesError;
+  m_itemsFile.open(itemFileName, false, itemsError);
+  m_indexesFile.open(indexFileName, false, indexesError);
+  if (!itemsError && !indexesError) {
     uint64_t count;
-    m_indexesFile.read(reinterpret_cast<char*>(&count), sizeof count);
-    if (!m_indexesFile) {
+    std::error_code ec;
+    m_indexesFile.read(0, &count, sizeof count, ec);
+    if (ec) {
       return false;
     }
 
-    std::vector<uint64_t> offsets;
-    uint64_t itemsFileSize = 0;
-    for (uint64_t i = 0; i < count; ++i) {
-      uint32_t itemSize;
-      m_indexesFile.read(reinterpret_cast<char*>(&itemSize), sizeof itemSize);
-      if (!m_indexesFile) {
+    std::vector<uint32_t> itemSizes(static_cast<size_t>(count));
+    if (count != 0) {
+      m_indexesFile.read(sizeof(uint64_t), itemSizes.data(), itemSizes.size() * sizeof(uint32_t), ec);
+      if (ec) {
         return false;
       }
+    }
 
+    std::vector<uint64_t> offsets;
+    offsets.reserve(itemSizes.size());
+    uint64_t itemsFileSize = 0;
+    for (uint32_t itemSize : itemSizes) {
       offsets.emplace_back(itemsFileSize);
       itemsFileSize += itemSize;
     }
@@ -247,32 +309,49 @@ template<class T> bool SwappedVector<T>::open(const std::string& itemFileName, c
     m_offsets.swap(offsets);
     m_itemsFileSize = itemsFileSize;
   } else {
-    m_itemsFile.open(itemFileName, std::ios::out | std::ios::binary);
-    m_itemsFile.close();
-    m_itemsFile.open(itemFileName, std::ios::in | std::ios::out | std::ios::binary);
-    m_indexesFile.open(indexFileName, std::ios::out | std::ios::binary);
+    m_itemsFile.open(itemFileName, true, itemsError);
+    m_indexesFile.open(indexFileName, true, indexesError);
+    if (itemsError || indexesError) {
+      return false;
+    }
+
     uint64_t count = 0;
-    m_indexesFile.write(reinterpret_cast<char*>(&count), sizeof count);
-    if (!m_indexesFile) {
+    std::error_code ec;
+    m_indexesFile.write(0, &count, sizeof count, ec);
+    if (ec) {
       return false;
     }
 
-    m_indexesFile.close();
-    m_indexesFile.open(indexFileName, std::ios::in | std::ios::out | std::ios::binary);
     m_offsets.clear();
     m_itemsFileSize = 0;
   }
 
-  m_poolSize = poolSize;
-  m_items.clear();
-  m_cache.clear();
-  m_cacheHits = 0;
-  m_cacheMisses = 0;
+  m_indexedCount = m_offsets.size();
+  m_pendingItemSizes.clear();
+  m_cacheBudget = cacheBudget;
+  resetCache();
   return true;
 }
 
 template<class T> void SwappedVector<T>::close() {
-  //std::cout << "SwappedVector cache hits: " << m_cacheHits << ", misses: " << m_cacheMisses << " (" << std::fixed << std::setprecision(2) << static_cast<double>(m_cacheMisses) / (m_cacheHits + m_cacheMisses) * 100 << "%)" << std::endl;
+  if (m_indexesFile.isOpened()) {
+    std::error_code ec;
+    flushIndex(ec);
+    m_indexesFile.close(ec);
+  }
+
+  if (m_itemsFile.isOpened()) {
+    std::error_code ec;
+    m_itemsFile.close(ec);
+  }
+}
+
+template<class T> void SwappedVector<T>::flush() {
+  std::error_code ec;
+  flushIndex(ec);
+  if (ec) {
+    throw std::runtime_error("SwappedVector::flush");
+  }
 }
 
 template<class T> bool SwappedVector<T>::empty() const {
@@ -291,139 +370,350 @@ template<class T> typename SwappedVector<T>::const_iterator SwappedVector<T>::en
   return const_iterator(this, m_offsets.size());
 }
 
-template<class T> const T& SwappedVector<T>::operator[](uint64_t index) {
-  auto itemIter = m_items.find(index);
-  if (itemIter != m_items.end()) {
-    if (itemIter->second.cacheIter != --m_cache.end()) {
-      m_cache.splice(m_cache.end(), m_cache, itemIter->second.cacheIter);
-    }
+template<class T> std::shared_ptr<const T> SwappedVector<T>::operator[](uint64_t index) {
+  CacheShard& shard = shardFor(index);
+  std::lock_guard<std::mutex> lock(shard.mutex);
 
-    ++m_cacheHits;
-    return itemIter->second.item;
+  uint32_t slot = findSlot(shard, index);
+  if (slot != EMPTY_SLOT) {
+    CacheSlot& cacheSlot = shard.slots[slot];
+    cacheSlot.referenced = true;
+    ++shard.hits;
+    return cacheSlot.item;
   }
 
   if (index >= m_offsets.size()) {
     throw std::runtime_error("SwappedVector::operator[]");
   }
 
-  if (!m_itemsFile) {
+  if (!m_itemsFile.isOpened()) {
+    throw std::runtime_error("SwappedVector::operator[]");
+  }
+
+  // Positional reads do not touch a shared file position, so shards miss in parallel.
+  uint64_t itemEnd = index + 1 < m_offsets.size() ? m_offsets[index + 1] : m_itemsFileSize;
+  shard.readBuffer.resize(static_cast<size_t>(itemEnd - m_offsets[index]));
+  std::error_code ec;
+  m_itemsFile.read(m_offsets[index], shard.readBuffer.data(), shard.readBuffer.size(), ec);
+  if (ec) {
     throw std::runtime_error("SwappedVector::operator[]");
   }
 
-  m_itemsFile.seekg(m_offsets[index]);
-  T tempItem;
-  
-  Common::StdInputStream stream(m_itemsFile);
-  DynexCN::BinaryInputStreamSerializer archive(stream);
-  serialize(tempItem, archive);
+  std::shared_ptr<T> item = std::make_shared<T>();
+  readItem(*item, shard.readBuffer);
 
-  T* item = prepare(index);
-  std::swap(tempItem, *item);
-  ++m_cacheMisses;
-  return *item;
+  insert(shard, index, itemCost(index, *item), item);
+  ++shard.misses;
+  return item;
 }
 
-template<class T> const T& SwappedVector<T>::front() {
+template<class T> std::shared_ptr<const T> SwappedVector<T>::front() {
   return operator[](0);
 }
 
-template<class T> const T& SwappedVector<T>::back() {
+template<class T> std::shared_ptr<const T> SwappedVector<T>::back() {
   return operator[](m_offsets.size() - 1);
 }
 
 template<class T> void SwappedVector<T>::clear() {
-  if (!m_indexesFile) {
+  if (!m_indexesFile.isOpened()) {
     throw std::runtime_error("SwappedVector::clear");
   }
 
-  m_indexesFile.seekp(0);
   uint64_t count = 0;
-  m_indexesFile.write(reinterpret_cast<char*>(&count), sizeof count);
-  if (!m_indexesFile) {
+  std::error_code ec;
+  m_indexesFile.write(0, &count, sizeof count, ec);
+  if (ec) {
     throw std::runtime_error("SwappedVector::clear");
   }
 
   m_offsets.clear();
   m_itemsFileSize = 0;
-  m_items.clear();
-  m_cache.clear();
+  m_indexedCount = 0;
+  m_pendingItemSizes.clear();
+  resetCache();
 }
 
 template<class T> void SwappedVector<T>::pop_back() {
-  if (!m_indexesFile) {
+  if (!m_indexesFile.isOpened()) {
     throw std::runtime_error("SwappedVector::pop_back");
   }
 
-  m_indexesFile.seekp(0);
-  uint64_t count = m_offsets.size() - 1;
-  m_indexesFile.write(reinterpret_cast<char*>(&count), sizeof count);
-  if (!m_indexesFile) {
-    throw std::runtime_error("SwappedVector::pop_back");
+  if (!m_pendingItemSizes.empty()) {
+    m_pendingItemSizes.pop_back();
+  } else {
+    uint64_t count = m_offsets.size() - 1;
+    std::error_code ec;
+    m_indexesFile.write(0, &count, sizeof count, ec);
+    if (ec) {
+      throw std::runtime_error("SwappedVector::pop_back");
+    }
+
+    m_indexedCount = count;
   }
 
   m_itemsFileSize = m_offsets.back();
   m_offsets.pop_back();
-  auto itemIter = m_items.find(m_offsets.size());
-  if (itemIter != m_items.end()) {
-    m_cache.erase(itemIter->second.cacheIter);
-    m_items.erase(itemIter);
+
+  CacheShard& shard = shardFor(m_offsets.size());
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  uint32_t slot = findSlot(shard, m_offsets.size());
+  if (slot != EMPTY_SLOT) {
+    releaseSlot(shard, slot);
   }
 }
 
 template<class T> void SwappedVector<T>::push_back(const T& item) {
-  uint64_t itemsFileSize;
+  if (!m_itemsFile.isOpened() || !m_indexesFile.isOpened()) {
+    throw std::runtime_error("SwappedVector::push_back");
+  }
+
+  m_writeBuffer.clear();
+  writeItem(item, m_writeBuffer);
+
+  std::error_code ec;
+  m_itemsFile.write(m_itemsFileSize, m_writeBuffer.data(), m_writeBuffer.size(), ec);
+  if (ec) {
+    throw std::runtime_error("SwappedVector::push_back");
+  }
 
-  {
-    if (!m_itemsFile) {
+  m_pendingItemSizes.push_back(static_cast<uint32_t>(m_writeBuffer.size()));
+  if (m_pendingItemSizes.size() >= INDEX_FLUSH_BATCH) {
+    flushIndex(ec);
+    if (ec) {
       throw std::runtime_error("SwappedVector::push_back");
     }
+  }
 
-    m_itemsFile.seekp(m_itemsFileSize);
+  m_offsets.push_back(m_itemsFileSize);
+  m_itemsFileSize += m_writeBuffer.size();
 
-    Common::StdOutputStream stream(m_itemsFile);
-    DynexCN::BinaryOutputStreamSerializer archive(stream);
-    serialize(const_cast<T&>(item), archive);
+  uint64_t index = m_offsets.size() - 1;
+  CacheShard& shard = shardFor(index);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  insert(shard, index, itemCost(index, item), std::make_shared<const T>(item));
+}
 
-    itemsFileSize = m_itemsFile.tellp();
+// Item sizes are appended in one write and the count is updated afterwards, so the
+// index on disk always describes a prefix of the items file.
+template<class T> void SwappedVector<T>::flushIndex(std::error_code& ec) {
+  ec = std::error_code();
+  if (m_pendingItemSizes.empty()) {
+    return;
   }
 
-  {
-    if (!m_indexesFile) {
-      throw std::runtime_error("SwappedVector::push_back");
+  m_indexesFile.write(sizeof(uint64_t) + sizeof(uint32_t) * m_indexedCount, m_pendingItemSizes.data(), sizeof(uint32_t) * m_pendingItemSizes.size(), ec);
+  if (ec) {
+    return;
+  }
+
+  uint64_t count = m_indexedCount + m_pendingItemSizes.size();
+  m_indexesFile.write(0, &count, sizeof count, ec);
+  if (ec) {
+    return;
+  }
+
+  m_indexedCount = count;
+  m_pendingItemSizes.clear();
+}
+
+template<class T> void SwappedVector<T>::setCacheBudget(uint64_t cacheBudget) {
+  m_cacheBudget = cacheBudget;
+  uint64_t shardBudget = m_cacheBudget / CACHE_SHARD_COUNT;
+  for (CacheShard& shard : m_shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    while (shard.size > shardBudget && evictOne(shard)) {
     }
+  }
+}
 
-    m_indexesFile.seekp(sizeof(uint64_t) + sizeof(uint32_t) * m_offsets.size());
-    uint32_t itemSize = static_cast<uint32_t>(itemsFileSize - m_itemsFileSize);
-    m_indexesFile.write(reinterpret_cast<char*>(&itemSize), sizeof itemSize);
-    if (!m_indexesFile) {
-      throw std::runtime_error("SwappedVector::push_back");
+template<class T> SwappedVectorCacheStats SwappedVector<T>::getCacheStats() {
+  SwappedVectorCacheStats stats = { 0, 0, 0, 0, 0, m_cacheBudget };
+  for (CacheShard& shard : m_shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    stats.hits += shard.hits;
+    stats.misses += shard.misses;
+    stats.evictions += shard.evictions;
+    stats.items += shard.slots.size() - shard.freeSlots.size();
+    stats.size += shard.size;
+  }
+
+  return stats;
+}
+
+template<class T> typename SwappedVector<T>::CacheShard& SwappedVector<T>::shardFor(uint64_t index) {
+  return m_shards[index % CACHE_SHARD_COUNT];
+}
+
+// Serialized size is used as the memory cost estimate of the decoded fields of an item.
+template<class T> uint64_t SwappedVector<T>::itemCost(uint64_t index, const T& item) const {
+  uint64_t end = index + 1 < m_offsets.size() ? m_offsets[index + 1] : m_itemsFileSize;
+  uint64_t cost = end - m_offsets[index] + sizeof(CacheSlot);
+  if constexpr (SwappedVectorHasBufferedSize<T>::value) {
+    cost += item.bufferedSize();
+  }
+
+  return cost;
+}
+
+template<class T> void SwappedVector<T>::resetCache() {
+  for (CacheShard& shard : m_shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.slots.clear();
+    shard.freeSlots.clear();
+    shard.buckets.assign(64, CacheBucket{ 0, EMPTY_SLOT });
+    shard.hand = 0;
+    shard.size = 0;
+    shard.hits = 0;
+    shard.misses = 0;
+    shard.evictions = 0;
+  }
+}
+
+template<class T> size_t SwappedVector<T>::bucketFor(const CacheShard& shard, uint64_t index) {
+  return static_cast<size_t>(((index / CACHE_SHARD_COUNT) * UINT64_C(0x9E3779B97F4A7C15)) >> 32) & (shard.buckets.size() - 1);
+}
+
+template<class T> uint32_t SwappedVector<T>::findSlot(const CacheShard& shard, uint64_t index) {
+  size_t mask = shard.buckets.size() - 1;
+  for (size_t bucket = bucketFor(shard, index);; bucket = (bucket + 1) & mask) {
+    const CacheBucket& entry = shard.buckets[bucket];
+    if (entry.slot == EMPTY_SLOT || entry.index == index) {
+      return entry.slot;
+    }
+  }
+}
+
+template<class T> void SwappedVector<T>::insertBucket(CacheShard& shard, uint64_t index, uint32_t slot) {
+  if ((shard.slots.size() - shard.freeSlots.size()) * 2 > shard.buckets.size()) {
+    growBuckets(shard);
+  }
+
+  size_t mask = shard.buckets.size() - 1;
+  size_t bucket = bucketFor(shard, index);
+  while (shard.buckets[bucket].slot != EMPTY_SLOT) {
+    bucket = (bucket + 1) & mask;
+  }
+
+  shard.buckets[bucket] = CacheBucket{ index, slot };
+}
+
+// Backward shift deletion keeps probe sequences intact without tombstones.
+template<class T> void SwappedVector<T>::eraseBucket(CacheShard& shard, uint64_t index) {
+  size_t mask = shard.buckets.size() - 1;
+  size_t hole = bucketFor(shard, index);
+  while (shard.buckets[hole].index != index || shard.buckets[hole].slot == EMPTY_SLOT) {
+    if (shard.buckets[hole].slot == EMPTY_SLOT) {
+      return;
     }
 
-    m_indexesFile.seekp(0);
-    uint64_t count = m_offsets.size() + 1;
-    m_indexesFile.write(reinterpret_cast<char*>(&count), sizeof count);
-    if (!m_indexesFile) {
-      throw std::runtime_error("SwappedVector::push_back");
+    hole = (hole + 1) & mask;
+  }
+
+  for (size_t next = (hole + 1) & mask; shard.buckets[next].slot != EMPTY_SLOT; next = (next + 1) & mask) {
+    size_t home = bucketFor(shard, shard.buckets[next].index);
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      shard.buckets[hole] = shard.buckets[next];
+      hole = next;
     }
   }
 
-  m_offsets.push_back(m_itemsFileSize);
-  m_itemsFileSize = itemsFileSize;
+  shard.buckets[hole].slot = EMPTY_SLOT;
+}
 
-  T* newItem = prepare(m_offsets.size() - 1);
-  *newItem = item;
+template<class T> void SwappedVector<T>::growBuckets(CacheShard& shard) {
+  std::vector<CacheBucket> buckets(shard.buckets.size() * 2, CacheBucket{ 0, EMPTY_SLOT });
+  shard.buckets.swap(buckets);
+  for (const CacheBucket& entry : buckets) {
+    if (entry.slot != EMPTY_SLOT) {
+      size_t mask = shard.buckets.size() - 1;
+      size_t bucket = bucketFor(shard, entry.index);
+      while (shard.buckets[bucket].slot != EMPTY_SLOT) {
+        bucket = (bucket + 1) & mask;
+      }
+
+      shard.buckets[bucket] = entry;
+    }
+  }
+}
+
+template<class T> void SwappedVector<T>::releaseSlot(CacheShard& shard, uint32_t slot) {
+  CacheSlot& cacheSlot = shard.slots[slot];
+  eraseBucket(shard, cacheSlot.index);
+  shard.size -= cacheSlot.cost;
+  cacheSlot.used = false;
+  cacheSlot.referenced = false;
+  cacheSlot.cost = 0;
+  cacheSlot.item.reset();
+  shard.freeSlots.push_back(slot);
+}
+
+// CLOCK: referenced slots get a second chance before eviction.
+template<class T> bool SwappedVector<T>::evictOne(CacheShard& shard) {
+  for (size_t step = 0; step < 2 * shard.slots.size(); ++step) {
+    uint32_t slot = static_cast<uint32_t>(shard.hand);
+    shard.hand = (shard.hand + 1) % shard.slots.size();
+
+    CacheSlot& cacheSlot = shard.slots[slot];
+    if (!cacheSlot.used) {
+      continue;
+    }
+
+    if (cacheSlot.referenced) {
+      cacheSlot.referenced = false;
+      continue;
+    }
+
+    releaseSlot(shard, slot);
+    ++shard.evictions;
+    return true;
+  }
+
+  return false;
+}
+
+template<class T> void SwappedVector<T>::insert(CacheShard& shard, uint64_t index, uint64_t cost, std::shared_ptr<const T> item) {
+  uint64_t shardBudget = m_cacheBudget / CACHE_SHARD_COUNT;
+  while (shard.size + cost > shardBudget && evictOne(shard)) {
+  }
+
+  uint32_t slot;
+  if (!shard.freeSlots.empty()) {
+    slot = shard.freeSlots.back();
+    shard.freeSlots.pop_back();
+  } else {
+    slot = static_cast<uint32_t>(shard.slots.size());
+    shard.slots.emplace_back();
+  }
+
+  CacheSlot& cacheSlot = shard.slots[slot];
+  cacheSlot.index = index;
+  cacheSlot.cost = cost;
+  cacheSlot.used = true;
+  cacheSlot.referenced = true;
+  cacheSlot.item = std::move(item);
+  shard.size += cost;
+  insertBucket(shard, index, slot);
 }
 
-template<class T> T* SwappedVector<T>::prepare(uint64_t index) {
-  if (m_items.size() == m_poolSize) {
-    auto cacheIter = m_cache.begin();
-    m_items.erase(cacheIter->itemIter);
-    m_cache.erase(cacheIter);
+template<class T> void SwappedVector<T>::readItem(T& item, const std::vector<uint8_t>& buffer) {
+  if constexpr (SwappedVectorHasStaticFormat<T>::value) {
+    DynexCN::StaticBinaryReader reader(buffer.data(), buffer.size());
+    item.readBinary(reader);
+  } else {
+    Common::MemoryInputStream stream(buffer.data(), buffer.size());
+    DynexCN::BinaryInputStreamSerializer archive(stream);
+    serialize(item, archive);
   }
+}
 
-  auto itemIter = m_items.insert(std::make_pair(index, ItemEntry()));
-  CacheEntry cacheEntry = { itemIter.first };
-  auto cacheIter = m_cache.insert(m_cache.end(), cacheEntry);
-  itemIter.first->second.cacheIter = cacheIter;
-  return &itemIter.first->second.item;
+template<class T> void SwappedVector<T>::writeItem(const T& item, std::vector<uint8_t>& buffer) {
+  if constexpr (SwappedVectorHasStaticFormat<T>::value) {
+    DynexCN::StaticBinaryWriter writer(buffer);
+    item.writeBinary(writer);
+  } else {
+    Common::VectorOutputStream stream(buffer);
+    DynexCN::BinaryOutputStreamSerializer archive(stream);
+    serialize(const_cast<T&>(item), archive);
+  }
 }
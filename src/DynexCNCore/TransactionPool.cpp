@@ -118,7 +118,10 @@ namespace DynexCN {
 
   using DynexCN::BlockInfo;
 
-  std::unordered_set<Crypto::Hash> m_validated_transactions;
+  namespace {
+    // a change log entry takes about 50 bytes
+    const size_t MAX_POOL_CHANGES = 100000;
+  }
 
   //---------------------------------------------------------------------------------
   tx_memory_pool::tx_memory_pool(
@@ -137,10 +140,16 @@ namespace DynexCN {
     logger(log, "txpool"),
     m_paymentIdIndex(blockchainIndexesEnabled),
     m_addressindex(blockchainIndexesEnabled),
-    m_timestampIndex(blockchainIndexesEnabled) {
+    m_timestampIndex(blockchainIndexesEnabled),
+    m_chainGeneration(0),
+    m_poolVersion(0) {
+    resetPoolChanges();
   }
   //---------------------------------------------------------------------------------
-  bool tx_memory_pool::add_tx(const Transaction &tx, /*const Crypto::Hash& tx_prefix_hash,*/ const Crypto::Hash &id, size_t blobSize, tx_verification_context& tvc, bool keptByBlock) {
+  bool tx_memory_pool::add_tx(const CachedTransaction &transaction, tx_verification_context& tvc, bool keptByBlock) {
+    const Transaction& tx = transaction.getTransaction();
+    const Crypto::Hash& id = transaction.getTransactionHash();
+    const size_t blobSize = transaction.getTransactionBinarySize();
     if (!check_inputs_types_supported(tx)) {
       tvc.m_verification_failed = true;
       return false;
@@ -165,9 +174,11 @@ namespace DynexCN {
     bool isFusionTransaction = fee == 0 && m_currency.isFusionTransaction(tx, blobSize, m_core.get_current_blockchain_height());
 
     //check key images for transaction if it is not kept by block
-    if (!keptByBlock) {
+    uint64_t chainGeneration;
+    {
       std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
-      if (haveSpentInputs(tx)) {
+      chainGeneration = m_chainGeneration;
+      if (!keptByBlock && haveSpentInputs(tx)) {
         logger(INFO) << "Transaction with id= " << id << " used already spent inputs";
         tvc.m_verification_failed = true;
         return false;
@@ -177,7 +188,7 @@ namespace DynexCN {
     BlockInfo maxUsedBlock;
 
     // check inputs
-    bool inputsValid = m_validator.checkTransactionInputs(tx, maxUsedBlock);
+    bool inputsValid = m_validator.checkTransactionInputs(transaction, maxUsedBlock);
 
     if (!inputsValid) {
       if (!keptByBlock) {
@@ -199,6 +210,15 @@ namespace DynexCN {
       }
     }
 
+    // the checks done so far are what the block template needs, so the transaction becomes a
+    // candidate right away unless the chain changed meanwhile
+    bool readyToGo = inputsValid && !m_validator.haveSpentKeyImages(tx);
+    bool feeEnough = false;
+    if (readyToGo) {
+      tx_verification_context feeTvc = boost::value_initialized<tx_verification_context>();
+      feeEnough = m_core.check_tx_fee(tx, blobSize, feeTvc, m_core.get_current_blockchain_height());
+    }
+
     std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
 
     if (!keptByBlock && m_recentlyDeletedTransactions.find(id) != m_recentlyDeletedTransactions.end()) {
@@ -215,7 +235,7 @@ namespace DynexCN {
 
       txd.id = id;
       txd.blobSize = blobSize;
-      txd.tx = tx;
+      txd.transaction = transaction;
       txd.fee = fee;
       txd.keptByBlock = keptByBlock;
       txd.receiveTime = m_timeProvider.now();
@@ -231,6 +251,12 @@ namespace DynexCN {
       m_paymentIdIndex.add(tx, id);
       m_addressindex.add(tx, id);
       m_timestampIndex.add(txd.receiveTime, txd.id);
+
+      if (chainGeneration != m_chainGeneration) {
+        m_pendingValidation.insert(id);
+      } else if (readyToGo) {
+        markValidated(*txd_p.first, feeEnough);
+      }
     }
 
     tvc.m_added_to_pool = true;
@@ -247,13 +273,10 @@ namespace DynexCN {
 
   //---------------------------------------------------------------------------------
   bool tx_memory_pool::add_tx(const Transaction &tx, tx_verification_context& tvc, bool keeped_by_block) {
-    Crypto::Hash h = NULL_HASH;
-    size_t blobSize = 0;
-    getObjectHash(tx, h, blobSize);
-    return add_tx(tx, h, blobSize, tvc, keeped_by_block);
+    return add_tx(CachedTransaction(tx), tvc, keeped_by_block);
   }
   //---------------------------------------------------------------------------------
-  bool tx_memory_pool::take_tx(const Crypto::Hash &id, Transaction &tx, size_t& blobSize, uint64_t& fee) {
+  bool tx_memory_pool::take_tx(const Crypto::Hash &id, CachedTransaction &tx, uint64_t& fee) {
     std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
     auto it = m_transactions.find(id);
     if (it == m_transactions.end()) {
@@ -262,8 +285,7 @@ namespace DynexCN {
 
     auto& txd = *it;
 
-    tx = txd.tx;
-    blobSize = txd.blobSize;
+    tx = txd.transaction;
     fee = txd.fee;
 
     removeTransaction(it);
@@ -278,7 +300,7 @@ namespace DynexCN {
   void tx_memory_pool::get_transactions(std::list<Transaction>& txs) const {
     std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
     for (const auto& tx_vt : m_transactions) {
-      txs.push_back(tx_vt.tx);
+      txs.push_back(tx_vt.transaction.getTransaction());
     }
   }
 
@@ -302,19 +324,7 @@ namespace DynexCN {
   //---------------------------------------------------------------------------------
   void tx_memory_pool::get_difference(const std::vector<Crypto::Hash>& known_tx_ids, std::vector<Crypto::Hash>& new_tx_ids, std::vector<Crypto::Hash>& deleted_tx_ids) const {
     std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
-    std::unordered_set<Crypto::Hash> ready_tx_ids;
-    for (const auto& tx : m_transactions) {
-      TransactionCheckInfo checkInfo(tx);
-	  if (m_validated_transactions.find(tx.id) != m_validated_transactions.end()) {
-		  ready_tx_ids.insert(tx.id);
-		  logger(DEBUGGING) << "MemPool - tx " << tx.id << " loaded from cache";
-	  }
-	  else if (is_transaction_ready_to_go(tx.tx, checkInfo)) {
-		  ready_tx_ids.insert(tx.id);
-		  m_validated_transactions.insert(tx.id);
-		  logger(DEBUGGING) << "MemPool - tx " << tx.id << " added to cache";
-	  }
-    }
+    std::unordered_set<Crypto::Hash> ready_tx_ids(m_validated_transactions);
 
     std::unordered_set<Crypto::Hash> known_set(known_tx_ids.begin(), known_tx_ids.end());
     for (auto it = ready_tx_ids.begin(), e = ready_tx_ids.end(); it != e;) {
@@ -332,21 +342,118 @@ namespace DynexCN {
     deleted_tx_ids.assign(known_set.begin(), known_set.end());
   }
   //---------------------------------------------------------------------------------
+  bool tx_memory_pool::get_difference(uint64_t known_version, std::vector<Crypto::Hash>& new_tx_ids, std::vector<Crypto::Hash>& deleted_tx_ids) const {
+    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    if (known_version < m_compactedVersion || known_version > m_poolVersion) {
+      return false;
+    }
+
+    auto it = std::upper_bound(m_poolChanges.begin(), m_poolChanges.end(), known_version, [](uint64_t version, const PoolChange& change) {
+      return version < change.version;
+    });
+
+    // whether a transaction was there at known_version follows from its first change since then
+    std::unordered_map<Crypto::Hash, bool> wasReady;
+    for (; it != m_poolChanges.end(); ++it) {
+      wasReady.emplace(it->id, !it->added);
+    }
+
+    for (const auto& change : wasReady) {
+      bool isReady = m_validated_transactions.count(change.first) != 0;
+      if (isReady && !change.second) {
+        new_tx_ids.push_back(change.first);
+      } else if (!isReady && change.second) {
+        deleted_tx_ids.push_back(change.first);
+      }
+    }
+
+    return true;
+  }
+  //---------------------------------------------------------------------------------
+  uint64_t tx_memory_pool::get_version() const {
+    std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+    return m_poolVersion;
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::logPoolChange(const Crypto::Hash& id, bool added) {
+    m_poolChanges.push_back({ ++m_poolVersion, id, added });
+    if (m_poolChanges.size() > MAX_POOL_CHANGES) {
+      m_compactedVersion = m_poolChanges.front().version;
+      m_poolChanges.pop_front();
+    }
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::resetPoolChanges() {
+    m_poolVersion = std::max<uint64_t>(m_poolVersion + 1, static_cast<uint64_t>(m_timeProvider.now()) << 24);
+    m_compactedVersion = m_poolVersion;
+    m_poolChanges.clear();
+  }
+  //---------------------------------------------------------------------------------
+  // Called by the blockchain with its lock held, right after a block has been pushed.
   bool tx_memory_pool::on_blockchain_inc(uint64_t new_block_height, const Crypto::Hash& top_block_id) {
     std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
-    if (!m_validated_transactions.empty()) {
-      logger(DEBUGGING) << "MemPool - Block height incremented, cleared " << m_validated_transactions.size() << " cached transaction hashes. New height: " << new_block_height << " Top block: " << top_block_id;
-      m_validated_transactions.clear();
-	}
+    ++m_chainGeneration;
+
+    // a longer chain keeps the inputs of a validated transaction valid unless the new block spent
+    // them, only the fee threshold has to be checked again
+    size_t dropped = 0;
+    for (auto it = m_validated_transactions.begin(); it != m_validated_transactions.end();) {
+      auto txIt = m_transactions.find(*it);
+      ++it;
+      if (txIt == m_transactions.end()) {
+        continue;
+      }
+
+      const TransactionDetails& txd = *txIt;
+      if (m_validator.haveSpentKeyImages(txd.transaction.getTransaction())) {
+        dropValidated(txd);
+        ++dropped;
+      } else {
+        markValidated(txd, isFeeEnough(txd));
+      }
+    }
+
+    // the rest might become valid now
+    for (const auto& txd : m_transactions) {
+      if (m_validated_transactions.count(txd.id) == 0) {
+        m_pendingValidation.insert(txd.id);
+      }
+    }
+
+    logger(DEBUGGING) << "MemPool - Block height incremented, new height: " << new_block_height << ", top block: " << top_block_id
+      << ", candidates: " << m_blockTemplateCandidates.size() << ", dropped: " << dropped << ", pending: " << m_pendingValidation.size();
     return true;
   }
   //---------------------------------------------------------------------------------
+  // Called by the blockchain with its lock held, right after a block has been popped.
   bool tx_memory_pool::on_blockchain_dec(uint64_t new_block_height, const Crypto::Hash& top_block_id) {
     std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
-    if (!m_validated_transactions.empty()) {
-      logger(DEBUGGING, YELLOW) << "MemPool - Block height decremented " << m_validated_transactions.size() << " cached transaction hashes. New height: " << new_block_height << " Top block: " << top_block_id;
-      m_validated_transactions.clear();
-	}
+    ++m_chainGeneration;
+
+    // transactions using outputs of the popped block have to be checked again
+    for (auto it = m_validated_transactions.begin(); it != m_validated_transactions.end();) {
+      auto txIt = m_transactions.find(*it);
+      ++it;
+      if (txIt == m_transactions.end()) {
+        continue;
+      }
+
+      const TransactionDetails& txd = *txIt;
+      if (txd.maxUsedBlock.empty() || txd.maxUsedBlock.height > new_block_height) {
+        dropValidated(txd);
+      } else {
+        markValidated(txd, isFeeEnough(txd));
+      }
+    }
+
+    for (const auto& txd : m_transactions) {
+      if (m_validated_transactions.count(txd.id) == 0) {
+        m_pendingValidation.insert(txd.id);
+      }
+    }
+
+    logger(DEBUGGING, YELLOW) << "MemPool - Block height decremented, new height: " << new_block_height << ", top block: " << top_block_id
+      << ", candidates: " << m_blockTemplateCandidates.size() << ", pending: " << m_pendingValidation.size();
     return true;
   }
   //---------------------------------------------------------------------------------
@@ -371,19 +478,120 @@ namespace DynexCN {
   }
 
   //---------------------------------------------------------------------------------
-  bool tx_memory_pool::is_transaction_ready_to_go(const Transaction& tx, TransactionCheckInfo& txd) const {
+  bool tx_memory_pool::is_transaction_ready_to_go(const CachedTransaction& tx, TransactionCheckInfo& txd) const {
 
     if (!m_validator.checkTransactionInputs(tx, txd.maxUsedBlock, txd.lastFailedBlock))
       return false;
 
     //if we here, transaction seems valid, but, anyway, check for key_images collisions with blockchain, just to be sure
-    if (m_validator.haveSpentKeyImages(tx))
+    if (m_validator.haveSpentKeyImages(tx.getTransaction()))
       return false;
 
     //transaction is ok.
     return true;
   }
   //---------------------------------------------------------------------------------
+  bool tx_memory_pool::isFeeEnough(const TransactionDetails& txd) const {
+    tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
+    return m_core.check_tx_fee(txd.transaction.getTransaction(), txd.blobSize, tvc, m_core.get_current_blockchain_height());
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::markValidated(const TransactionDetails& txd, bool feeEnough) {
+    if (m_validated_transactions.insert(txd.id).second) {
+      logPoolChange(txd.id, true);
+    }
+
+    m_pendingValidation.erase(txd.id);
+    if (feeEnough) {
+      m_blockTemplateCandidates.insert(&txd);
+    } else {
+      m_blockTemplateCandidates.erase(&txd);
+    }
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::dropValidated(const TransactionDetails& txd) {
+    if (m_validated_transactions.erase(txd.id) != 0) {
+      logPoolChange(txd.id, false);
+    }
+
+    m_blockTemplateCandidates.erase(&txd);
+  }
+  //---------------------------------------------------------------------------------
+  void tx_memory_pool::invalidateAll() {
+    ++m_chainGeneration;
+    m_validated_transactions.clear();
+    resetPoolChanges();
+    m_blockTemplateCandidates.clear();
+    m_pendingValidation.clear();
+    for (const auto& txd : m_transactions) {
+      m_pendingValidation.insert(txd.id);
+    }
+  }
+  //---------------------------------------------------------------------------------
+  // Checks the pending transactions without holding the pool lock, so neither block templates nor
+  // incoming transactions wait for the ring signatures.
+  void tx_memory_pool::validatePendingTransactions() {
+    std::vector<TransactionDetails> pending;
+    uint64_t chainGeneration;
+    {
+      std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+      if (m_pendingValidation.empty()) {
+        return;
+      }
+
+      chainGeneration = m_chainGeneration;
+      pending.reserve(m_pendingValidation.size());
+      for (auto it = m_pendingValidation.begin(); it != m_pendingValidation.end();) {
+        auto txIt = m_transactions.find(*it);
+        if (txIt == m_transactions.end()) {
+          it = m_pendingValidation.erase(it);
+        } else {
+          pending.push_back(*txIt);
+          ++it;
+        }
+      }
+    }
+
+    std::vector<uint8_t> ready(pending.size(), 0);
+    std::vector<uint8_t> feeEnough(pending.size(), 0);
+    for (size_t i = 0; i < pending.size(); ++i) {
+      ready[i] = is_transaction_ready_to_go(pending[i].transaction, pending[i]);
+      feeEnough[i] = ready[i] && isFeeEnough(pending[i]);
+    }
+
+    size_t validated = 0;
+    {
+      std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
+      if (chainGeneration != m_chainGeneration) {
+        logger(DEBUGGING) << "MemPool - chain changed while validating " << pending.size() << " transactions, retrying later";
+        return;
+      }
+
+      for (size_t i = 0; i < pending.size(); ++i) {
+        auto txIt = m_transactions.find(pending[i].id);
+        if (txIt == m_transactions.end() || m_pendingValidation.erase(pending[i].id) == 0) {
+          continue;
+        }
+
+        const TransactionCheckInfo& checkInfo = pending[i];
+        m_transactions.modify(txIt, [&checkInfo](TransactionCheckInfo& item) {
+          item = checkInfo;
+        });
+
+        if (ready[i]) {
+          markValidated(*txIt, feeEnough[i] != 0);
+          ++validated;
+        }
+      }
+
+      logger(DEBUGGING) << "MemPool - validated " << validated << " of " << pending.size() << " pending transactions, candidates: " << m_blockTemplateCandidates.size();
+    }
+
+    if (validated != 0) {
+      m_observerManager.notify(&ITxPoolObserver::txValidatedInPool);
+    }
+  }
+  //---------------------------------------------------------------------------------
   std::string tx_memory_pool::print_pool(bool short_format) const {
     std::stringstream ss;
     std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
@@ -391,7 +599,7 @@ namespace DynexCN {
       ss << "id: " << txd.id << std::endl;
       
       if (!short_format) {
-        ss << storeToJson(txd.tx) << std::endl;
+        ss << storeToJson(txd.transaction.getTransaction()) << std::endl;
       }
 
       ss << "blobSize: " << txd.blobSize << std::endl
@@ -401,7 +609,7 @@ namespace DynexCN {
         << "max_used_block_id: " << txd.maxUsedBlock.id << std::endl
         << "last_failed_height: " << txd.lastFailedBlock.height << std::endl
 		<< "last_failed_id: " << txd.lastFailedBlock.id << std::endl
-		<< "amount_out: " << get_outs_money_amount(txd.tx) << std::endl
+		<< "amount_out: " << get_outs_money_amount(txd.transaction.getTransaction()) << std::endl
         << "fee_atomic_units: " << txd.fee << std::endl
         << "received_timestamp: " << txd.receiveTime << std::endl
         << "received: " << std::ctime(&txd.receiveTime) << std::endl;
@@ -422,38 +630,17 @@ namespace DynexCN {
 
     BlockTemplate blockTemplate;
 
-    for (auto i = m_fee_index.begin(); i != m_fee_index.end(); ++i) {
-      const auto& txd = *i;
+    // the candidates are validated and pay enough fee already, only the size limit and conflicts
+    // between them are left to check
+    for (const TransactionDetails* candidate : m_blockTemplateCandidates) {
+      const auto& txd = *candidate;
 
       size_t blockSizeLimit = (txd.fee == 0) ? median_size : max_total_size;
       if (blockSizeLimit < total_size + txd.blobSize) {
         continue;
       }
 
-      tx_verification_context tvc = boost::value_initialized<tx_verification_context>();
-      if (!m_core.check_tx_fee(txd.tx, txd.blobSize, tvc, m_core.get_current_blockchain_height())) {
-        logger(DEBUGGING) << "Transaction " << txd.id << " not included to block template because fee is too small";
-        continue;
-      }
-
-      TransactionCheckInfo checkInfo(txd);
-	  bool ready = false;
-	  if (m_validated_transactions.find(txd.id) != m_validated_transactions.end()) {
-		  ready = true;
-		  logger(DEBUGGING) << "Fill block template - tx added from cache: " << txd.id;
-	  }
-	  else if (is_transaction_ready_to_go(txd.tx, checkInfo)) {
-		  ready = true;
-		  m_validated_transactions.insert(txd.id);
-		  logger(DEBUGGING) << "Fill block template - tx added to cache: " << txd.id;
-	  }
-
-      // update item state
-      m_fee_index.modify(i, [&checkInfo](TransactionCheckInfo& item) {
-        item = checkInfo;
-      });
-
-      if (ready && blockTemplate.addTransaction(txd.id, txd.tx)) {
+      if (blockTemplate.addTransaction(txd.id, txd.transaction.getTransaction())) {
         total_size += txd.blobSize;
         fee += txd.fee;
         logger(DEBUGGING) << "Transaction " << txd.id << " included to block template";
@@ -480,6 +667,7 @@ namespace DynexCN {
       logger(ERROR) << "Failed to load memory pool from file " << state_file_path;
 
       m_transactions.clear();
+      invalidateAll();
       m_spent_key_images.clear();
       m_spentOutputs.clear();
 
@@ -521,7 +709,16 @@ namespace DynexCN {
     s(td.id, "id");
     s(td.blobSize, "blobSize");
     s(td.fee, "fee");
-    s(td.tx, "tx");
+    Transaction tx;
+    if (s.type() == ISerializer::OUTPUT) {
+      tx = td.transaction.getTransaction();
+    }
+
+    s(tx, "tx");
+    if (s.type() == ISerializer::INPUT) {
+      td.transaction = CachedTransaction(std::move(tx));
+    }
+
     s(td.maxUsedBlock.height, "maxUsedBlock.height");
     s(td.maxUsedBlock.id, "maxUsedBlock.id");
     s(td.lastFailedBlock.height, "lastFailedBlock.height");
@@ -546,6 +743,7 @@ namespace DynexCN {
     if (s.type() == ISerializer::INPUT) {
       m_transactions.clear();
       readSequence<TransactionDetails>(std::inserter(m_transactions, m_transactions.end()), "transactions", s);
+      invalidateAll();
     } else {
       writeSequence<TransactionDetails>(m_transactions.begin(), m_transactions.end(), "transactions", s);
     }
@@ -558,6 +756,7 @@ namespace DynexCN {
   //---------------------------------------------------------------------------------
   void tx_memory_pool::on_idle() {
     m_txCheckInterval.call([this](){ return removeExpiredTransactions(); });
+    validatePendingTransactions();
   }
 
   //---------------------------------------------------------------------------------
@@ -600,14 +799,12 @@ namespace DynexCN {
   }
 
   tx_memory_pool::tx_container_t::iterator tx_memory_pool::removeTransaction(tx_memory_pool::tx_container_t::iterator i) {
-    removeTransactionInputs(i->id, i->tx, i->keptByBlock);
-    m_paymentIdIndex.remove(i->tx, i->id);
-    m_addressindex.remove(i->tx, i->id);
+    removeTransactionInputs(i->id, i->transaction.getTransaction(), i->keptByBlock);
+    m_paymentIdIndex.remove(i->transaction.getTransaction(), i->id);
+    m_addressindex.remove(i->transaction.getTransaction(), i->id);
     m_timestampIndex.remove(i->receiveTime, i->id);
-    if (m_validated_transactions.find(i->id) != m_validated_transactions.end()) {
-      m_validated_transactions.erase(i->id);
-      logger(DEBUGGING) << "Removing transaction from MemPool cache " << i->id << ". Cache size: " << m_validated_transactions.size();
-    }
+    dropValidated(*i);
+    m_pendingValidation.erase(i->id);
     return m_transactions.erase(i);
   }
 
@@ -705,8 +902,8 @@ namespace DynexCN {
   void tx_memory_pool::buildIndices() {
     std::lock_guard<std::recursive_mutex> lock(m_transactions_lock);
     for (auto it = m_transactions.begin(); it != m_transactions.end(); it++) {
-      m_paymentIdIndex.add(it->tx, it->id);
-      m_addressindex.add(it->tx, it->id);
+      m_paymentIdIndex.add(it->transaction.getTransaction(), it->id);
+      m_addressindex.add(it->transaction.getTransaction(), it->id);
       m_timestampIndex.add(it->receiveTime, it->id);
     }
   }
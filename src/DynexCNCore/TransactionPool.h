@@ -37,7 +37,10 @@
 
 #pragma once
 
+#include <cstring>
+#include <deque>
 #include <set>
+#include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -56,6 +59,7 @@
 
 #include "DynexCNCore/DynexCNBasic.h"
 #include "DynexCNCore/DynexCNBasicImpl.h"
+#include "DynexCNCore/CachedTransaction.h"
 #include "DynexCNCore/Currency.h"
 #include "DynexCNCore/ITimeProvider.h"
 #include "DynexCNCore/ITransactionValidator.h"
@@ -120,10 +124,10 @@ namespace DynexCN {
     bool deinit();
 
     bool have_tx(const Crypto::Hash &id) const;
-    bool add_tx(const Transaction &tx, const Crypto::Hash &id, size_t blobSize, tx_verification_context& tvc, bool keeped_by_block);
+    bool add_tx(const CachedTransaction &tx, tx_verification_context& tvc, bool keeped_by_block);
     bool add_tx(const Transaction &tx, tx_verification_context& tvc, bool keeped_by_block);
     //gets tx and remove it from pool
-    bool take_tx(const Crypto::Hash &id, Transaction &tx, size_t& blobSize, uint64_t& fee);
+    bool take_tx(const Crypto::Hash &id, CachedTransaction &tx, uint64_t& fee);
 
     bool on_blockchain_inc(uint64_t new_block_height, const Crypto::Hash& top_block_id);
     bool on_blockchain_dec(uint64_t new_block_height, const Crypto::Hash& top_block_id);
@@ -136,6 +140,11 @@ namespace DynexCN {
 
     void get_transactions(std::list<Transaction>& txs) const;
     void get_difference(const std::vector<Crypto::Hash>& known_tx_ids, std::vector<Crypto::Hash>& new_tx_ids, std::vector<Crypto::Hash>& deleted_tx_ids) const;
+    // The changes since known_version, taken from the change log. Returns false if that version is
+    // not covered by the log anymore, the difference has to be computed from the known ids then.
+    bool get_difference(uint64_t known_version, std::vector<Crypto::Hash>& new_tx_ids, std::vector<Crypto::Hash>& deleted_tx_ids) const;
+    // version of the set of transactions get_difference reports, changes whenever that set does
+    uint64_t get_version() const;
     size_t get_transactions_count() const;
     std::string print_pool(bool short_format) const;
 	
@@ -157,7 +166,7 @@ namespace DynexCN {
         if (it == m_transactions.end()) {
           missedTxs.push_back(id);
         } else {
-          txs.push_back(it->tx);
+          appendTransaction(txs, *it);
         }
       }
     }
@@ -171,7 +180,7 @@ namespace DynexCN {
 
     struct TransactionDetails : public TransactionCheckInfo {
       Crypto::Hash id;
-      Transaction tx;
+      CachedTransaction transaction;
       size_t blobSize;
       uint64_t fee;
       bool keptByBlock;
@@ -183,6 +192,15 @@ namespace DynexCN {
 
   private:
 
+    template<class t_tx_container>
+    static void appendTransaction(t_tx_container& txs, const TransactionDetails& txd) {
+      if constexpr (std::is_same<typename t_tx_container::value_type, CachedTransaction>::value) {
+        txs.push_back(txd.transaction);
+      } else {
+        txs.push_back(txd.transaction.getTransaction());
+      }
+    }
+
     struct TransactionPriorityComparator {
       // lhs > hrs
       bool operator()(const TransactionDetails& lhs, const TransactionDetails& rhs) const {
@@ -204,6 +222,22 @@ namespace DynexCN {
       }
     };
 
+    // orders the block template candidates like the fee index, ties are broken by id
+    struct CandidateComparator {
+      bool operator()(const TransactionDetails* lhs, const TransactionDetails* rhs) const {
+        TransactionPriorityComparator priority;
+        if (priority(*lhs, *rhs)) {
+          return true;
+        }
+
+        if (priority(*rhs, *lhs)) {
+          return false;
+        }
+
+        return std::memcmp(&lhs->id, &rhs->id, sizeof(Crypto::Hash)) < 0;
+      }
+    };
+
     typedef hashed_unique<BOOST_MULTI_INDEX_MEMBER(TransactionDetails, Crypto::Hash, id)> main_index_t;
     typedef ordered_non_unique<identity<TransactionDetails>, TransactionPriorityComparator> fee_index_t;
 
@@ -223,7 +257,14 @@ namespace DynexCN {
 
     tx_container_t::iterator removeTransaction(tx_container_t::iterator i);
     bool removeExpiredTransactions();
-    bool is_transaction_ready_to_go(const Transaction& tx, TransactionCheckInfo& txd) const;
+    bool is_transaction_ready_to_go(const CachedTransaction& tx, TransactionCheckInfo& txd) const;
+    bool isFeeEnough(const TransactionDetails& txd) const;
+
+    // block template candidates
+    void markValidated(const TransactionDetails& txd, bool feeEnough);
+    void dropValidated(const TransactionDetails& txd);
+    void invalidateAll();
+    void validatePendingTransactions();
 
     void buildIndices();
 
@@ -243,6 +284,32 @@ namespace DynexCN {
     tx_container_t::nth_index<1>::type& m_fee_index;
     std::unordered_map<Crypto::Hash, uint64_t> m_recentlyDeletedTransactions;
 
+    struct PoolChange {
+      uint64_t version;
+      Crypto::Hash id;
+      bool added;
+    };
+
+    void logPoolChange(const Crypto::Hash& id, bool added);
+    void resetPoolChanges();
+
+    // Transactions whose inputs are valid on top of the current chain. Those of them paying enough
+    // fee for the next block are the block template candidates, kept in fee order. Both are
+    // updated when a transaction is added and when the chain changes, transactions whose state is
+    // unknown wait in m_pendingValidation for the next on_idle.
+    std::unordered_set<Crypto::Hash> m_validated_transactions;
+    std::set<const TransactionDetails*, CandidateComparator> m_blockTemplateCandidates;
+    std::unordered_set<Crypto::Hash> m_pendingValidation;
+    // incremented on each chain change, validation results obtained on another chain are discarded
+    uint64_t m_chainGeneration;
+
+    // Each change of m_validated_transactions gets the next version. The versions start at a value
+    // derived from the start time, so versions handed out before a restart are not mistaken for
+    // current ones. Versions up to m_compactedVersion are no longer covered by m_poolChanges.
+    uint64_t m_poolVersion;
+    uint64_t m_compactedVersion;
+    std::deque<PoolChange> m_poolChanges;
+
     Logging::LoggerRef logger;
 
     PaymentIdIndex m_paymentIdIndex;
@@ -40,6 +40,7 @@
 #include <algorithm>
 #include <cstdint>
 #include <ctime>
+#include <memory>
 
 #include "Common/StringTools.h"
 #include "DynexCNCore/DynexCNBasicImpl.h"
@@ -74,13 +75,13 @@ namespace DynexCN {
         if (m_blockchain.empty()) {
           m_votingCompleteHeight = UNDEF_HEIGHT;
 
-        } else if (m_targetVersion - 1 == m_blockchain.back().bl.majorVersion) {
+        } else if (m_targetVersion - 1 == m_blockchain.back()->bl.majorVersion) {
           m_votingCompleteHeight = findVotingCompleteHeight(static_cast<uint32_t>(m_blockchain.size()) - 1);
 
-        } else if (m_targetVersion <= m_blockchain.back().bl.majorVersion) {
+        } else if (m_targetVersion <= m_blockchain.back()->bl.majorVersion) {
           auto it = std::lower_bound(m_blockchain.begin(), m_blockchain.end(), m_targetVersion,
-            [](const typename BC::value_type& b, uint8_t v) { return b.bl.majorVersion < v; });
-          if (it == m_blockchain.end() || it->bl.majorVersion != m_targetVersion) {
+            [](const std::shared_ptr<const typename BC::value_type>& b, uint8_t v) { return b->bl.majorVersion < v; });
+          if (it == m_blockchain.end() || (*it)->bl.majorVersion != m_targetVersion) {
             logger(Logging::ERROR, Logging::BRIGHT_RED) << "Internal error: upgrade height isn't found";
             return false;
           }
@@ -96,14 +97,14 @@ namespace DynexCN {
         }
       } else if (!m_blockchain.empty()) {
         if (m_blockchain.size() <= upgradeHeight + 1) {
-          if (m_blockchain.back().bl.majorVersion >= m_targetVersion) {
+          if (m_blockchain.back()->bl.majorVersion >= m_targetVersion) {
             logger(Logging::ERROR, Logging::BRIGHT_RED) << "Internal error: block at height " << (m_blockchain.size() - 1) <<
-              " has invalid version " << static_cast<int>(m_blockchain.back().bl.majorVersion) <<
+              " has invalid version " << static_cast<int>(m_blockchain.back()->bl.majorVersion) <<
               ", expected " << static_cast<int>(m_targetVersion - 1) << " or less";
             return false;
           }
         } else {
-          int blockVersionAtUpgradeHeight = m_blockchain[upgradeHeight].bl.majorVersion;
+          int blockVersionAtUpgradeHeight = m_blockchain[upgradeHeight]->bl.majorVersion;
           if (blockVersionAtUpgradeHeight != m_targetVersion - 1) {
             logger(Logging::ERROR, Logging::BRIGHT_RED) << "Internal error: block at height " << upgradeHeight <<
               " has invalid version " << blockVersionAtUpgradeHeight <<
@@ -111,7 +112,7 @@ namespace DynexCN {
             return false;
           }
 
-          int blockVersionAfterUpgradeHeight = m_blockchain[upgradeHeight + 1].bl.majorVersion;
+          int blockVersionAfterUpgradeHeight = m_blockchain[upgradeHeight + 1]->bl.majorVersion;
           if (blockVersionAfterUpgradeHeight != m_targetVersion) {
             logger(Logging::ERROR, Logging::BRIGHT_RED) << "Internal error: block at height " << (upgradeHeight + 1) <<
               " has invalid version " << blockVersionAfterUpgradeHeight <<
@@ -140,16 +141,16 @@ namespace DynexCN {
 
       if (m_currency.upgradeHeight(m_targetVersion) != UNDEF_HEIGHT) {
         if (m_blockchain.size() <= m_currency.upgradeHeight(m_targetVersion) + 1) {
-          assert(m_blockchain.back().bl.majorVersion <= m_targetVersion - 1);
+          assert(m_blockchain.back()->bl.majorVersion <= m_targetVersion - 1);
         } else {
-          assert(m_blockchain.back().bl.majorVersion >= m_targetVersion);
+          assert(m_blockchain.back()->bl.majorVersion >= m_targetVersion);
         }
 
       } else if (m_votingCompleteHeight != UNDEF_HEIGHT) {
         assert(m_blockchain.size() > m_votingCompleteHeight);
 
         if (m_blockchain.size() <= upgradeHeight()) {
-          assert(m_blockchain.back().bl.majorVersion == m_targetVersion - 1);
+          assert(m_blockchain.back()->bl.majorVersion == m_targetVersion - 1);
 
           if (m_blockchain.size() % (60 * 60 / m_currency.difficultyTarget()) == 0) {
             auto interval = m_currency.difficultyTarget() * (upgradeHeight() - m_blockchain.size() + 2);
@@ -160,15 +161,15 @@ namespace DynexCN {
 
             logger(Logging::INFO, Logging::BRIGHT_GREEN) << "###### UPGRADE is going to happen after block index " << upgradeHeight() << " at about " <<
               upgradeTimeStr << " (in " << Common::timeIntervalToString(interval) << ")! Current last block index " << (m_blockchain.size() - 1) <<
-              ", hash " << get_block_hash(m_blockchain.back().bl);
+              ", hash " << get_block_hash(m_blockchain.back()->bl);
           }
         } else if (m_blockchain.size() == upgradeHeight() + 1) {
-          assert(m_blockchain.back().bl.majorVersion == m_targetVersion - 1);
+          assert(m_blockchain.back()->bl.majorVersion == m_targetVersion - 1);
 
           logger(Logging::INFO, Logging::BRIGHT_GREEN) << "###### UPGRADE has happened! Starting from block index " << (upgradeHeight() + 1) <<
             " blocks with major version below " << static_cast<int>(m_targetVersion) << " will be rejected!";
         } else {
-          assert(m_blockchain.back().bl.majorVersion == m_targetVersion);
+          assert(m_blockchain.back()->bl.majorVersion == m_targetVersion);
         }
 
       } else {
@@ -201,7 +202,7 @@ namespace DynexCN {
 
       size_t voteCounter = 0;
       for (size_t i = height + 1 - m_currency.upgradeVotingWindow(); i <= height; ++i) {
-        const auto& b = m_blockchain[i].bl;
+        const auto& b = m_blockchain[i]->bl;
         voteCounter += (b.majorVersion == m_targetVersion - 1) && (b.minorVersion == BLOCK_MINOR_VERSION_1) ? 1 : 0;
       }
 
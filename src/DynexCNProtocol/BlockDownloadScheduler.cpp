@@ -0,0 +1,293 @@
+// Copyright (c) 2021-2023, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#include "BlockDownloadScheduler.h"
+
+#include <algorithm>
+
+#include "DynexCNConfig.h"
+
+namespace DynexCN {
+
+namespace {
+
+// size of the spans of a peer that delivered nothing yet, and of the smallest ones
+const uint32_t SPAN_MIN_BLOCKS = 20;
+// spans are sized to take their peer about this long
+const double SPAN_TARGET_SECONDS = 10;
+// spans are handed out at most this far above the next block to apply, which bounds the
+// memory taken by spans waiting for a slow one below them
+const uint32_t MAX_BLOCKS_AHEAD = 4000;
+// a span goes to a faster peer after three times the time it should take, but not sooner than
+// SPAN_MIN_TIMEOUT, and to any peer after SPAN_TIMEOUT
+const std::chrono::seconds SPAN_MIN_TIMEOUT(20);
+const std::chrono::seconds SPAN_TIMEOUT(60);
+
+const net_connection_id NO_PEER = {};
+
+}
+
+BlockDownloadScheduler::BlockDownloadScheduler() : m_applyHeight(0), m_unassignedHeight(0) {
+}
+
+bool BlockDownloadScheduler::addChain(const net_connection_id& peer, uint32_t startHeight, const std::vector<Crypto::Hash>& blockIds) {
+  Peer& p = m_peers[peer];
+  p.waitingForChain = false;
+  if (blockIds.empty()) {
+    return true;
+  }
+
+  if (empty()) {
+    // a new plan, offers made for the previous one do not apply to it
+    m_applyHeight = startHeight;
+    m_unassignedHeight = startHeight;
+    for (auto& other : m_peers) {
+      other.second.offerEnd = 0;
+      other.second.conflicting = false;
+    }
+  }
+
+  // the ids have to overlap the plan, a matching id proves the peer has every planned block below it
+  bool matches = m_planned.empty() || (startHeight >= m_applyHeight && startHeight < plannedEnd());
+  size_t i = 0;
+  for (uint32_t height = startHeight; matches && i < blockIds.size() && height < plannedEnd(); ++i, ++height) {
+    matches = m_planned[height - m_applyHeight] == blockIds[i];
+  }
+
+  if (!matches) {
+    p.offerEnd = 0;
+    p.conflicting = true;
+    return false;
+  }
+
+  m_planned.insert(m_planned.end(), blockIds.begin() + i, blockIds.end());
+  p.offerEnd = std::max(p.offerEnd, startHeight + static_cast<uint32_t>(blockIds.size()));
+  p.conflicting = false;
+  return true;
+}
+
+bool BlockDownloadScheduler::isPlanned(const Crypto::Hash& blockId) const {
+  return std::find(m_planned.begin(), m_planned.end(), blockId) != m_planned.end();
+}
+
+bool BlockDownloadScheduler::lastPlanned(Crypto::Hash& blockId) const {
+  if (m_planned.empty()) {
+    return false;
+  }
+
+  blockId = m_planned.back();
+  return true;
+}
+
+uint32_t BlockDownloadScheduler::spanSize(const Peer& peer) const {
+  if (peer.rate <= 0) {
+    return SPAN_MIN_BLOCKS;
+  }
+
+  double size = peer.rate * SPAN_TARGET_SECONDS;
+  return static_cast<uint32_t>(std::max<double>(SPAN_MIN_BLOCKS, std::min<double>(size, BLOCKS_SYNCHRONIZING_DEFAULT_COUNT)));
+}
+
+bool BlockDownloadScheduler::stalled(const Span& span, const Peer& thief, Clock::time_point now) const {
+  auto owner = m_peers.find(span.peer);
+  if (owner == m_peers.end()) {
+    return true;
+  }
+
+  auto age = now - owner->second.requested;
+  if (age > SPAN_TIMEOUT) {
+    return true;
+  }
+
+  if (thief.rate <= owner->second.rate) {
+    return false;
+  }
+
+  Clock::duration expected = SPAN_MIN_TIMEOUT;
+  if (owner->second.rate > 0) {
+    expected = std::max(expected, std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(3 * span.count / owner->second.rate)));
+  }
+
+  return age > expected;
+}
+
+bool BlockDownloadScheduler::assign(const net_connection_id& peer, Clock::time_point now, std::vector<Crypto::Hash>& blockIds) {
+  auto it = m_peers.find(peer);
+  if (it == m_peers.end()) {
+    return false;
+  }
+
+  Peer& p = it->second;
+  if (p.busy || p.waitingForChain || p.conflicting) {
+    return false;
+  }
+
+  // the lowest spans hold up applying, so spans left by disconnected or stalled peers go first
+  uint32_t start = 0;
+  uint32_t count = 0;
+  for (auto& entry : m_spans) {
+    const Span& span = entry.second;
+    if (span.delivered || entry.first + span.count > p.offerEnd) {
+      continue;
+    }
+
+    if (span.peer == NO_PEER || (span.peer != peer && stalled(span, p, now))) {
+      start = entry.first;
+      count = span.count;
+      break;
+    }
+  }
+
+  if (count == 0) {
+    uint32_t limit = std::min(std::min(plannedEnd(), p.offerEnd), m_applyHeight + MAX_BLOCKS_AHEAD);
+    if (m_unassignedHeight >= limit) {
+      return false;
+    }
+
+    start = m_unassignedHeight;
+    count = std::min(spanSize(p), limit - start);
+    m_spans.emplace(start, Span{ count, NO_PEER, false, NO_PEER, {} });
+    m_unassignedHeight += count;
+  }
+
+  m_spans[start].peer = peer;
+  p.busy = true;
+  p.span = start;
+  p.requested = now;
+
+  auto first = m_planned.begin() + (start - m_applyHeight);
+  blockIds.assign(first, first + count);
+  return true;
+}
+
+bool BlockDownloadScheduler::deliver(const net_connection_id& peer, Clock::time_point now, const std::vector<Crypto::Hash>& blockIds,
+  std::vector<parsed_block_entry>& blocks) {
+  auto it = m_peers.find(peer);
+  if (it == m_peers.end() || !it->second.busy) {
+    return false;
+  }
+
+  Peer& p = it->second;
+  p.busy = false;
+
+  double seconds = std::max(std::chrono::duration<double>(now - p.requested).count(), 0.001);
+  double rate = blockIds.size() / seconds;
+  p.rate = p.rate > 0 ? 0.7 * p.rate + 0.3 * rate : rate;
+
+  auto spanIt = m_spans.find(p.span);
+  if (spanIt == m_spans.end() || spanIt->second.delivered || spanIt->second.count != blockIds.size() || blockIds.size() != blocks.size()) {
+    return false;
+  }
+
+  std::unordered_map<Crypto::Hash, size_t> positions;
+  for (size_t i = 0; i < blockIds.size(); ++i) {
+    positions.emplace(blockIds[i], i);
+  }
+
+  Span& span = spanIt->second;
+  std::vector<parsed_block_entry> ordered(span.count);
+  for (uint32_t i = 0; i < span.count; ++i) {
+    auto position = positions.find(m_planned[spanIt->first - m_applyHeight + i]);
+    if (position == positions.end()) {
+      return false;
+    }
+
+    ordered[i] = std::move(blocks[position->second]);
+  }
+
+  span.blocks = std::move(ordered);
+  span.delivered = true;
+  span.source = peer;
+  return true;
+}
+
+bool BlockDownloadScheduler::takeReady(std::vector<parsed_block_entry>& blocks, net_connection_id& source) {
+  auto it = m_spans.begin();
+  if (it == m_spans.end() || it->first != m_applyHeight || !it->second.delivered) {
+    return false;
+  }
+
+  blocks = std::move(it->second.blocks);
+  source = it->second.source;
+  m_planned.erase(m_planned.begin(), m_planned.begin() + it->second.count);
+  m_applyHeight += it->second.count;
+  m_spans.erase(it);
+  return true;
+}
+
+void BlockDownloadScheduler::chainRequested(const net_connection_id& peer) {
+  m_peers[peer].waitingForChain = true;
+}
+
+bool BlockDownloadScheduler::canRequestChain(const net_connection_id& peer) const {
+  auto it = m_peers.find(peer);
+  if (it == m_peers.end()) {
+    return true;
+  }
+
+  return !it->second.waitingForChain && (!it->second.conflicting || empty());
+}
+
+bool BlockDownloadScheduler::offerExhausted(const net_connection_id& peer) const {
+  auto it = m_peers.find(peer);
+  return it == m_peers.end() || m_unassignedHeight >= it->second.offerEnd;
+}
+
+void BlockDownloadScheduler::removePeer(const net_connection_id& peer) {
+  for (auto& entry : m_spans) {
+    if (entry.second.peer == peer && !entry.second.delivered) {
+      entry.second.peer = NO_PEER;
+    }
+  }
+
+  m_peers.erase(peer);
+}
+
+// Responses still on the way are ignored, their peers are free for the next plan.
+void BlockDownloadScheduler::clear() {
+  m_planned.clear();
+  m_spans.clear();
+  m_applyHeight = 0;
+  m_unassignedHeight = 0;
+  for (auto& peer : m_peers) {
+    peer.second.busy = false;
+    peer.second.offerEnd = 0;
+    peer.second.conflicting = false;
+  }
+}
+
+}
@@ -0,0 +1,118 @@
+// Copyright (c) 2021-2023, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "DynexCNProtocol/DynexCNProtocolDefinitions.h"
+#include "P2p/P2pProtocolTypes.h"
+
+namespace DynexCN {
+
+// Shares the blocks needed during synchronization among all synchronizing peers.
+// The block ids the peers offer form one planned chain, which is handed out in spans in
+// height order, each span sized to what its peer delivered lately. A span a peer holds for
+// too long goes to a faster idle peer. Delivered spans wait until all the blocks below them
+// have arrived, so blocks are always applied in height order.
+class BlockDownloadScheduler {
+public:
+  typedef std::chrono::steady_clock Clock;
+
+  BlockDownloadScheduler();
+
+  // Adds the block ids a peer offers, the first one at startHeight. Returns false if they do not
+  // continue the planned chain, the peer is then not used until the plan is done.
+  bool addChain(const net_connection_id& peer, uint32_t startHeight, const std::vector<Crypto::Hash>& blockIds);
+  bool isPlanned(const Crypto::Hash& blockId) const;
+  bool lastPlanned(Crypto::Hash& blockId) const;
+
+  // Picks the next span for an idle peer, returns false if there is nothing the peer can download now.
+  bool assign(const net_connection_id& peer, Clock::time_point now, std::vector<Crypto::Hash>& blockIds);
+  // Stores the span requested from the peer, returns false if another peer delivered it already.
+  bool deliver(const net_connection_id& peer, Clock::time_point now, const std::vector<Crypto::Hash>& blockIds,
+    std::vector<parsed_block_entry>& blocks);
+  // Takes the lowest span once it and everything below it has arrived.
+  bool takeReady(std::vector<parsed_block_entry>& blocks, net_connection_id& source);
+
+  // A chain request is outstanding, or the peer has to wait for the plan to be done before asking again.
+  void chainRequested(const net_connection_id& peer);
+  bool canRequestChain(const net_connection_id& peer) const;
+  // The peer offered nothing beyond what is already handed out.
+  bool offerExhausted(const net_connection_id& peer) const;
+
+  void removePeer(const net_connection_id& peer);
+  void clear();
+  bool empty() const { return m_planned.empty() && m_spans.empty(); }
+
+private:
+  struct Span {
+    uint32_t count;
+    net_connection_id peer;
+    bool delivered;
+    net_connection_id source;
+    std::vector<parsed_block_entry> blocks;
+  };
+
+  struct Peer {
+    uint32_t offerEnd = 0;
+    bool busy = false;
+    bool waitingForChain = false;
+    bool conflicting = false;
+    uint32_t span = 0;
+    Clock::time_point requested;
+    double rate = 0;
+  };
+
+  uint32_t plannedEnd() const { return m_applyHeight + static_cast<uint32_t>(m_planned.size()); }
+  uint32_t spanSize(const Peer& peer) const;
+  bool stalled(const Span& span, const Peer& thief, Clock::time_point now) const;
+
+  // ids of the blocks not applied yet, the first one at m_applyHeight
+  std::deque<Crypto::Hash> m_planned;
+  uint32_t m_applyHeight;
+  uint32_t m_unassignedHeight;
+  std::map<uint32_t, Span> m_spans;
+  std::unordered_map<net_connection_id, Peer> m_peers;
+};
+
+}
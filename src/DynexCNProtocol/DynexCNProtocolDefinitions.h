@@ -65,6 +65,17 @@ namespace DynexCN
 
   };
 
+  struct parsed_block_entry
+  {
+    Block block;
+    std::vector<BinaryArray> txs;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(block);
+      KV_MEMBER(txs);
+    }
+  };
+
   struct BlockFullInfo : public block_complete_entry
   {
     Crypto::Hash block_id;
@@ -229,4 +240,26 @@ namespace DynexCN
     const static int ID = BC_COMMANDS_POOL_BASE + 8;
     typedef NOTIFY_REQUEST_TX_POOL_request request;
   };
+
+  /************************************************************************/
+  /*                                                                      */
+  /************************************************************************/
+  // NOTIFY_NEW_BLOCK without the transactions, the block lists their hashes and the receiver
+  // takes them from its pool, asking for the ones it lacks with NOTIFY_REQUEST_GET_OBJECTS
+  struct NOTIFY_NEW_COMPACT_BLOCK_request {
+    std::string block;
+    uint32_t current_blockchain_height;
+    uint32_t hop;
+
+    void serialize(ISerializer& s) {
+      KV_MEMBER(block)
+      KV_MEMBER(current_blockchain_height)
+      KV_MEMBER(hop)
+    }
+  };
+
+  struct NOTIFY_NEW_COMPACT_BLOCK {
+    const static int ID = BC_COMMANDS_POOL_BASE + 9;
+    typedef NOTIFY_NEW_COMPACT_BLOCK_request request;
+  };
 }
@@ -40,7 +40,9 @@
 #include <future>
 #include <boost/scope_exit.hpp>
 #include <System/Dispatcher.h>
+#include <System/RemoteContext.h>
 
+#include "DynexCNCore/CachedTransaction.h"
 #include "DynexCNCore/DynexCNBasicImpl.h"
 #include "DynexCNCore/DynexCNFormatUtils.h"
 #include "DynexCNCore/DynexCNTools.h"
@@ -55,6 +57,9 @@ namespace DynexCN {
 
 namespace {
 
+// a compact block is given up when its transactions do not arrive within this time
+const time_t PENDING_BLOCK_TIMEOUT = 30;
+
 template<class t_parametr>
 bool post_notify(IP2pEndpoint& p2p, typename t_parametr::request& arg, const DynexCNConnectionContext& context) {
   return p2p.invoke_notify_to_peer(t_parametr::ID, LevinProtocol::encode(arg), context);
@@ -74,6 +79,7 @@ DynexCNProtocolHandler::DynexCNProtocolHandler(const Currency& currency, System:
   m_p2p(p_net_layout),
   m_synchronized(false),
   m_stop(false),
+  m_applyingSyncedBlocks(false),
   m_observedHeight(0),
   m_blockchainHeight(0),  
   m_peersCount(0),
@@ -99,6 +105,8 @@ void DynexCNProtocolHandler::onConnectionOpened(DynexCNConnectionContext& contex
 }
 
 void DynexCNProtocolHandler::onConnectionClosed(DynexCNConnectionContext& context) {
+  m_downloads.removePeer(context.m_connection_id);
+
   bool updated = false;
   {
     std::lock_guard<std::mutex> lock(m_observedHeightMutex);
@@ -128,13 +136,8 @@ bool DynexCNProtocolHandler::start_sync(DynexCNConnectionContext& context) {
   logger(Logging::TRACE) << context << "Starting synchronization";
 
   if (context.m_state == DynexCNConnectionContext::state_synchronizing) {
-    assert(context.m_needed_objects.empty());
     assert(context.m_requested_objects.empty());
-
-    NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
-    r.block_ids = m_core.buildSparseChain();
-    logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
-    post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
+    requestChain(context);
   }
 
   return true;
@@ -255,6 +258,7 @@ int DynexCNProtocolHandler::handleCommand(bool is_notify, int command, const Bin
     HANDLE_NOTIFY(NOTIFY_REQUEST_CHAIN, &DynexCNProtocolHandler::handle_request_chain)
     HANDLE_NOTIFY(NOTIFY_RESPONSE_CHAIN_ENTRY, &DynexCNProtocolHandler::handle_response_chain_entry)
     HANDLE_NOTIFY(NOTIFY_REQUEST_TX_POOL, &DynexCNProtocolHandler::handleRequestTxPool)
+    HANDLE_NOTIFY(NOTIFY_NEW_COMPACT_BLOCK, &DynexCNProtocolHandler::handleNewCompactBlock)
 
   default:
     handled = false;
@@ -305,24 +309,162 @@ int DynexCNProtocolHandler::handle_notify_new_block(int command, NOTIFY_NEW_BLOC
   }
   if (bvc.m_added_to_main_chain) {
     ++arg.hop;
-    //TODO: Add here announce protocol usage
-    relay_post_notify<NOTIFY_NEW_BLOCK>(*m_p2p, arg, &context.m_connection_id);
-    // relay_block(arg, context);
+    relayBlock(arg, &context.m_connection_id);
+
+    if (bvc.m_switched_to_alt_chain) {
+      requestMissingPoolTransactions(context);
+    }
+  } else if (bvc.m_marked_as_orphaned) {
+    requestChain(context);
+  }
+
+  return 1;
+}
+
+int DynexCNProtocolHandler::handleNewCompactBlock(int command, NOTIFY_NEW_COMPACT_BLOCK::request& arg, DynexCNConnectionContext& context) {
+  logger(Logging::TRACE) << context << "NOTIFY_NEW_COMPACT_BLOCK (hop " << arg.hop << ")";
+
+  updateObservedHeight(arg.current_blockchain_height, context);
+
+  context.m_remote_blockchain_height = arg.current_blockchain_height;
+
+  if (context.m_state != DynexCNConnectionContext::state_normal) {
+    return 1;
+  }
+
+  Block b;
+  BinaryArray blockBlob = asBinaryArray(arg.block);
+  if (blockBlob.size() > m_currency.maxBlockBlobSize() || !fromBinaryArray(b, blockBlob)) {
+    logger(Logging::DEBUGGING) << context << "sent wrong compact block, dropping connection";
+    m_p2p->drop_connection(context, true);
+    return 1;
+  }
+
+  if (m_core.have_block(get_block_hash(b))) {
+    return 1;
+  }
+
+  NOTIFY_REQUEST_GET_OBJECTS::request missing;
+  for (const auto& transactionHash : b.transactionHashes) {
+    if (!m_core.havePoolTransaction(transactionHash)) {
+      missing.txs.push_back(transactionHash);
+    }
+  }
+
+  if (missing.txs.empty()) {
+    return processCompactBlock(context, b, arg.hop);
+  }
+
+  if (missing.txs.size() > CURRENCY_PROTOCOL_MAX_OBJECT_REQUEST_COUNT) {
+    requestChain(context);
+    return 1;
+  }
+
+  logger(Logging::DEBUGGING) << context << "Requesting " << missing.txs.size() << " of " << b.transactionHashes.size() << " transactions of compact block";
+  context.m_pending_block = std::move(arg.block);
+  context.m_pending_block_hop = arg.hop;
+  context.m_pending_block_time = time(nullptr);
+  context.m_pending_block_txs = std::unordered_set<Crypto::Hash>(missing.txs.begin(), missing.txs.end());
+  post_notify<NOTIFY_REQUEST_GET_OBJECTS>(*m_p2p, missing, context);
+  return 1;
+}
+
+// The transactions of the block are in the pool now, the block takes them from there.
+int DynexCNProtocolHandler::processCompactBlock(DynexCNConnectionContext& context, const Block& b, uint32_t hop) {
+  block_verification_context bvc = boost::value_initialized<block_verification_context>();
+  m_core.handle_incoming_block(b, bvc, true, false);
+  if (bvc.m_verification_failed) {
+    logger(Logging::DEBUGGING) << context << "Block verification failed, dropping connection";
+    m_p2p->drop_connection(context, true);
+    return 1;
+  }
+
+  if (bvc.m_added_to_main_chain) {
+    std::list<CachedTransaction> txs;
+    std::list<Crypto::Hash> missedTxs;
+    m_core.getTransactions(b.transactionHashes, txs, missedTxs);
+    if (missedTxs.empty()) {
+      NOTIFY_NEW_BLOCK::request arg;
+      arg.b.block = asString(toBinaryArray(b));
+      for (const auto& tx : txs) {
+        arg.b.txs.push_back(asString(tx.getTransactionBinaryArray()));
+      }
+
+      arg.current_blockchain_height = m_core.get_current_blockchain_height();
+      arg.hop = hop + 1;
+      relayBlock(arg, &context.m_connection_id);
+    }
 
     if (bvc.m_switched_to_alt_chain) {
       requestMissingPoolTransactions(context);
     }
   } else if (bvc.m_marked_as_orphaned) {
-    context.m_state = DynexCNConnectionContext::state_synchronizing;
-    NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
-    r.block_ids = m_core.buildSparseChain();
-    logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
-    post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
+    requestChain(context);
   }
 
   return 1;
 }
 
+int DynexCNProtocolHandler::processPendingBlockTransactions(NOTIFY_RESPONSE_GET_OBJECTS::request& arg, DynexCNConnectionContext& context) {
+  BinaryArray blockBlob = asBinaryArray(context.m_pending_block);
+  uint32_t hop = context.m_pending_block_hop;
+  std::unordered_set<Crypto::Hash> expectedTxs;
+  expectedTxs.swap(context.m_pending_block_txs);
+  context.m_pending_block.clear();
+
+  if (context.m_state != DynexCNConnectionContext::state_normal) {
+    return 1;
+  }
+
+  for (auto& tx_blob : arg.txs) {
+    auto transactionBinary = asBinaryArray(tx_blob);
+    Crypto::Hash transactionHash = Crypto::cn_fast_hash(transactionBinary.data(), transactionBinary.size());
+    if (expectedTxs.erase(transactionHash) == 0) {
+      logger(Logging::DEBUGGING) << context << "sent transaction " << transactionHash << " that wasn't requested, dropping connection";
+      m_p2p->drop_connection(context, true);
+      return 1;
+    }
+
+    tx_verification_context tvc = boost::value_initialized<decltype(tvc)>();
+    m_core.handle_incoming_tx(transactionBinary, tvc, true);
+    if (tvc.m_verification_failed) {
+      logger(Logging::INFO) << context << "Block verification failed: transaction verification failed, dropping connection";
+      m_p2p->drop_connection(context, true);
+      return 1;
+    }
+  }
+
+  if (!expectedTxs.empty()) {
+    logger(Logging::DEBUGGING) << context << "Peer doesn't have " << expectedTxs.size() << " transactions of compact block, synchronizing";
+    requestChain(context);
+    return 1;
+  }
+
+  Block b;
+  if (!fromBinaryArray(b, blockBlob)) {
+    return 1;
+  }
+
+  return processCompactBlock(context, b, hop);
+}
+
+void DynexCNProtocolHandler::requestChain(DynexCNConnectionContext& context) {
+  context.m_state = DynexCNConnectionContext::state_synchronizing;
+  NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
+
+  // a peer on the planned chain answers with the ids following the plan
+  Crypto::Hash lastPlanned;
+  if (m_downloads.lastPlanned(lastPlanned)) {
+    r.block_ids.push_back(lastPlanned);
+  }
+
+  auto sparseChain = m_core.buildSparseChain();
+  r.block_ids.insert(r.block_ids.end(), sparseChain.begin(), sparseChain.end());
+  m_downloads.chainRequested(context.m_connection_id);
+  logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
+  post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
+}
+
 int DynexCNProtocolHandler::handle_notify_new_transactions(int command, NOTIFY_NEW_TRANSACTIONS::request& arg, DynexCNConnectionContext& context) {
   logger(Logging::TRACE) << context << "NOTIFY_NEW_TRANSACTIONS";
 
@@ -390,6 +532,11 @@ int DynexCNProtocolHandler::handle_request_get_objects(int command, NOTIFY_REQUE
 int DynexCNProtocolHandler::handle_response_get_objects(int command, NOTIFY_RESPONSE_GET_OBJECTS::request& arg, DynexCNConnectionContext& context) {
   logger(Logging::TRACE) << context << "NOTIFY_RESPONSE_GET_OBJECTS";
 
+  // transactions requested for a compact block come without blocks
+  if (arg.blocks.empty() && !context.m_pending_block.empty()) {
+    return processPendingBlockTransactions(arg, context);
+  }
+
   if (context.m_last_response_height > arg.current_blockchain_height) {
     logger(Logging::ERROR) << context << "sent wrong NOTIFY_HAVE_OBJECTS: arg.m_current_blockchain_height=" << arg.current_blockchain_height
       << " < m_last_response_height=" << context.m_last_response_height << ", dropping connection";
@@ -401,39 +548,45 @@ int DynexCNProtocolHandler::handle_response_get_objects(int command, NOTIFY_RESP
 
   context.m_remote_blockchain_height = arg.current_blockchain_height;
 
-  size_t count = 0;
-  std::vector<Crypto::Hash> block_hashes;
-  block_hashes.reserve(arg.blocks.size());
-  std::vector<parsed_block_entry> parsed_blocks;
-  parsed_blocks.reserve(arg.blocks.size());
-  for (const block_complete_entry& block_entry : arg.blocks) {
-    ++count;
-    Block b;
-    BinaryArray block_blob = asBinaryArray(block_entry.block);
-    if (block_blob.size() > m_currency.maxBlockBlobSize()) {
-      logger(Logging::ERROR) << context << "sent wrong block: too big size " << block_blob.size() << ", dropping connection";
-      context.m_state = DynexCNConnectionContext::state_shutdown;
-      return 1;
-    }
-    if (!fromBinaryArray(b, block_blob)) {
-      logger(Logging::ERROR) << context << "sent wrong block: failed to parse and validate block: \r\n"
-        << toHex(block_blob) << "\r\n dropping connection";
-      context.m_state = DynexCNConnectionContext::state_shutdown;
-      return 1;
-    }
+  auto received = BlockDownloadScheduler::Clock::now();
+
+  // parsing and hashing run on worker threads, the dispatcher serves other connections meanwhile
+  size_t blockCount = arg.blocks.size();
+  std::vector<Crypto::Hash> block_hashes(blockCount);
+  std::vector<parsed_block_entry> parsed_blocks(blockCount);
+  std::vector<uint8_t> parsed(blockCount, 0);
+  System::RemoteContext<void>(m_dispatcher, [&] {
+    m_workers.run(blockCount, [&](size_t i) {
+      BinaryArray block_blob = asBinaryArray(arg.blocks[i].block);
+      if (block_blob.size() <= m_currency.maxBlockBlobSize() && fromBinaryArray(parsed_blocks[i].block, block_blob)) {
+        block_hashes[i] = get_block_hash(parsed_blocks[i].block);
+        for (auto& tx_blob : arg.blocks[i].txs) {
+          parsed_blocks[i].txs.push_back(asBinaryArray(tx_blob));
+        }
+
+        parsed[i] = 1;
+      }
 
-    //to avoid concurrency in core between connections, suspend connections which delivered block later then first one
-    auto blockHash = get_block_hash(b);
-    if (count == 2) {
-      if (m_core.have_block(blockHash)) {
-        context.m_state = DynexCNConnectionContext::state_idle;
-        context.m_needed_objects.clear();
-        context.m_requested_objects.clear();
-        logger(Logging::DEBUGGING) << context << "Connection set to idle state.";
-        return 1;
+      return true;
+    });
+  }).get();
+
+  for (size_t i = 0; i < blockCount; ++i) {
+    const block_complete_entry& block_entry = arg.blocks[i];
+    if (!parsed[i]) {
+      if (block_entry.block.size() > m_currency.maxBlockBlobSize()) {
+        logger(Logging::ERROR) << context << "sent wrong block: too big size " << block_entry.block.size() << ", dropping connection";
+      } else {
+        logger(Logging::ERROR) << context << "sent wrong block: failed to parse and validate block: \r\n"
+          << toHex(asBinaryArray(block_entry.block)) << "\r\n dropping connection";
       }
+
+      context.m_state = DynexCNConnectionContext::state_shutdown;
+      return 1;
     }
 
+    const Block& b = parsed_blocks[i].block;
+    const Crypto::Hash& blockHash = block_hashes[i];
     auto req_it = context.m_requested_objects.find(blockHash);
     if (req_it == context.m_requested_objects.end()) {
       logger(Logging::ERROR) << context << "sent wrong NOTIFY_RESPONSE_GET_OBJECTS: block with id=" << Common::podToHex(blockHash)
@@ -449,16 +602,6 @@ int DynexCNProtocolHandler::handle_response_get_objects(int command, NOTIFY_RESP
     }
 
     context.m_requested_objects.erase(req_it);
-
-    block_hashes.push_back(blockHash);
-
-    parsed_block_entry parsedBlock;
-    parsedBlock.block = b;
-    for (auto& tx_blob : block_entry.txs) {
-      auto transactionBinary = asBinaryArray(tx_blob);
-      parsedBlock.txs.push_back(transactionBinary);
-    }
-    parsed_blocks.push_back(parsedBlock);
   }
 
   if (context.m_requested_objects.size()) {
@@ -469,48 +612,93 @@ int DynexCNProtocolHandler::handle_response_get_objects(int command, NOTIFY_RESP
     return 1;
   }
 
-  uint32_t height;
-  Crypto::Hash top;
-  {
-    // we lock all the rest to avoid having multiple connections redo a lot
-    // of the same work, and one of them doing it for nothing: subsequent
-    // connections will wait until the current one's added its blocks, then
-    // will add any extra it has, if any
-    std::lock_guard<std::recursive_mutex> lk(m_sync_lock);
+  // the checks that need no blockchain state run ahead of applying, also off the dispatcher
+  bool prechecked = System::RemoteContext<bool>(m_dispatcher, [&] {
+    return m_workers.run(blockCount, [&](size_t i) {
+      return m_core.precheckBlock(parsed_blocks[i].block, parsed_blocks[i].txs);
+    });
+  }).get();
 
-    // dismiss what another connection might already have done (likely everything)
-    m_core.get_blockchain_top(height, top);
-    uint64_t dismiss = 1;
-    for (const auto &h : block_hashes) {
-      if (top == h) {
-        logger(Logging::DEBUGGING) << "Found current top block in synced blocks, dismissing "
-          << dismiss << "/" << arg.blocks.size() << " blocks";
-        while (dismiss--) {
-          arg.blocks.erase(arg.blocks.begin());
-          parsed_blocks.erase(parsed_blocks.begin());
-        }
-        break;
-      }
-      ++dismiss;
+  if (!prechecked) {
+    logger(Logging::DEBUGGING) << context << "Block verification failed, dropping connection";
+    context.m_state = DynexCNConnectionContext::state_shutdown;
+    return 1;
+  }
+
+  if (!m_downloads.deliver(context.m_connection_id, received, block_hashes, parsed_blocks)) {
+    logger(Logging::DEBUGGING) << context << "Blocks were delivered by another connection already";
+  }
+
+  applySyncedBlocks();
+  requestIdlePeers();
+  return 1;
+}
+
+// Applies the downloaded spans in height order. A connection delivering while blocks are
+// applied only stores its span, the applying one takes it once it gets there.
+void DynexCNProtocolHandler::applySyncedBlocks() {
+  if (m_applyingSyncedBlocks) {
+    return;
+  }
+
+  m_applyingSyncedBlocks = true;
+  BOOST_SCOPE_EXIT_ALL(this) {
+    m_applyingSyncedBlocks = false;
+  };
+
+  std::vector<parsed_block_entry> blocks;
+  net_connection_id source;
+  while (!m_stop && m_downloads.takeReady(blocks, source)) {
+    bool applied;
+    {
+      std::lock_guard<std::recursive_mutex> lk(m_sync_lock);
+      applied = processObjects(source, blocks);
     }
 
-    int result = processObjects(context, parsed_blocks);
-    if (result != 0) {
-      return result;
+    if (!applied) {
+      // the planned chain is bad from here on, synchronization starts over with a new plan
+      m_downloads.clear();
+      m_p2p->for_each_connection([&](DynexCNConnectionContext& context, PeerIdType peerId) {
+        if (context.m_connection_id == source) {
+          logger(Logging::DEBUGGING) << context << "Sent blocks that failed verification, dropping connection";
+          context.m_state = DynexCNConnectionContext::state_shutdown;
+        } else if (context.m_state == DynexCNConnectionContext::state_synchronizing) {
+          context.m_last_response_height = 0;
+        }
+      });
+
+      return;
     }
-  }
 
-  m_core.get_blockchain_top(height, top);
-  logger(DEBUGGING, BRIGHT_GREEN) << "Local blockchain updated, new height = " << height;
+    uint32_t height;
+    Crypto::Hash top;
+    m_core.get_blockchain_top(height, top);
+    logger(DEBUGGING, BRIGHT_GREEN) << "Local blockchain updated, new height = " << height;
+  }
+}
 
-  if (!m_stop && context.m_state == DynexCNConnectionContext::state_synchronizing) {
-    request_missing_objects(context, true);
+void DynexCNProtocolHandler::requestIdlePeers() {
+  if (m_stop) {
+    return;
   }
 
-  return 1;
+  m_p2p->for_each_connection([&](DynexCNConnectionContext& context, PeerIdType peerId) {
+    if (context.m_state == DynexCNConnectionContext::state_synchronizing && context.m_requested_objects.empty()) {
+      request_missing_objects(context);
+    }
+  });
 }
 
-int DynexCNProtocolHandler::processObjects(DynexCNConnectionContext& context, const std::vector<parsed_block_entry>& blocks) {
+bool DynexCNProtocolHandler::processObjects(const net_connection_id& source, const std::vector<parsed_block_entry>& blocks) {
+
+  // start authorizing the whole batch at once, pushBlock then only waits for each answer
+  std::vector<const Block*> batch;
+  batch.reserve(blocks.size());
+  for (const parsed_block_entry& block_entry : blocks) {
+    batch.push_back(&block_entry.block);
+  }
+
+  m_core.prefetchBlockAuthorization(batch);
 
   for (const parsed_block_entry& block_entry : blocks) {
     if (m_stop) {
@@ -525,10 +713,9 @@ int DynexCNProtocolHandler::processObjects(DynexCNConnectionContext& context, co
       tx_verification_context tvc = boost::value_initialized<decltype(tvc)>();
       m_core.handle_incoming_tx(transactionBinary, tvc, true);
       if (tvc.m_verification_failed) {
-        logger(Logging::DEBUGGING) << context << "transaction verification failed on NOTIFY_RESPONSE_GET_OBJECTS, \r\ntx_id = "
-          << Common::podToHex(getBinaryArrayHash(transactionBinary)) << ", dropping connection";
-        context.m_state = DynexCNConnectionContext::state_shutdown;
-        return 1;
+        logger(Logging::DEBUGGING) << "transaction verification failed on NOTIFY_RESPONSE_GET_OBJECTS, \r\ntx_id = "
+          << Common::podToHex(getBinaryArrayHash(transactionBinary));
+        return false;
       }
     }
 
@@ -537,30 +724,35 @@ int DynexCNProtocolHandler::processObjects(DynexCNConnectionContext& context, co
     m_core.handle_incoming_block(block_entry.block, bvc, false, false);
 
     if (bvc.m_verification_failed) {
-      logger(Logging::DEBUGGING) << context << "Block verification failed, dropping connection";
-      context.m_state = DynexCNConnectionContext::state_shutdown;
-      return 1;
+      logger(Logging::DEBUGGING) << "Block verification failed";
+      return false;
     } else if (bvc.m_marked_as_orphaned) {
-      logger(Logging::INFO) << context << "Block received at sync phase was marked as orphaned, dropping connection";
-      context.m_state = DynexCNConnectionContext::state_shutdown;
-      return 1;
-    } else if (bvc.m_already_exists) {
-      logger(Logging::DEBUGGING) << context << "Block already exists, switching to idle state";
-      context.m_state = DynexCNConnectionContext::state_idle;
-      context.m_needed_objects.clear();
-      context.m_requested_objects.clear();
-      return 1;
+      logger(Logging::INFO) << "Block received at sync phase was marked as orphaned";
+      return false;
     }
 
     m_dispatcher.yield();
   }
 
-  return 0;
-
+  return true;
 }
 
 
 bool DynexCNProtocolHandler::on_idle() {
+  // hands spans of stalled connections to idle ones
+  if (!m_downloads.empty()) {
+    requestIdlePeers();
+  }
+
+  time_t now = time(nullptr);
+  m_p2p->for_each_connection([&](DynexCNConnectionContext& context, PeerIdType peerId) {
+    if (!context.m_pending_block.empty() && now - context.m_pending_block_time > PENDING_BLOCK_TIMEOUT) {
+      logger(Logging::DEBUGGING) << context << "Transactions of compact block didn't arrive in time, dropping the block";
+      context.m_pending_block.clear();
+      context.m_pending_block_txs.clear();
+    }
+  });
+
   return m_core.on_idle();
 }
 
@@ -587,39 +779,27 @@ int DynexCNProtocolHandler::handle_request_chain(int command, NOTIFY_REQUEST_CHA
   return 1;
 }
 
-bool DynexCNProtocolHandler::request_missing_objects(DynexCNConnectionContext& context, bool check_having_blocks) {
-  if (context.m_needed_objects.size()) {
-    //we know objects that we need, request this objects
-    NOTIFY_REQUEST_GET_OBJECTS::request req;
-    size_t count = 0;
-    auto it = context.m_needed_objects.begin();
-
-    while (it != context.m_needed_objects.end() && count < BLOCKS_SYNCHRONIZING_DEFAULT_COUNT) {
-      if (!(check_having_blocks && m_core.have_block(*it))) {
-        req.blocks.push_back(*it);
-        ++count;
-        context.m_requested_objects.insert(*it);
-      }
-      it = context.m_needed_objects.erase(it);
-    }
+bool DynexCNProtocolHandler::request_missing_objects(DynexCNConnectionContext& context) {
+  NOTIFY_REQUEST_GET_OBJECTS::request req;
+  if (m_downloads.assign(context.m_connection_id, BlockDownloadScheduler::Clock::now(), req.blocks)) {
+    context.m_requested_objects.insert(req.blocks.begin(), req.blocks.end());
     logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_GET_OBJECTS: blocks.size()=" << req.blocks.size() << ", txs.size()=" << req.txs.size();
     post_notify<NOTIFY_REQUEST_GET_OBJECTS>(*m_p2p, req, context);
+  } else if (!m_downloads.canRequestChain(context.m_connection_id) || m_applyingSyncedBlocks ||
+    (!m_downloads.empty() && !m_downloads.offerExhausted(context.m_connection_id))) {
+    // waiting for a chain entry, or for blocks other connections download, requestIdlePeers comes back here
   } else if (context.m_last_response_height < context.m_remote_blockchain_height - 1) {//we have to fetch more objects ids, request blockchain entry
-
-    NOTIFY_REQUEST_CHAIN::request r = boost::value_initialized<NOTIFY_REQUEST_CHAIN::request>();
-    r.block_ids = m_core.buildSparseChain();
-    logger(Logging::TRACE) << context << "-->>NOTIFY_REQUEST_CHAIN: m_block_ids.size()=" << r.block_ids.size();
-    post_notify<NOTIFY_REQUEST_CHAIN>(*m_p2p, r, context);
+    requestChain(context);
+  } else if (!m_downloads.empty()) {
+    // everything the peer has is downloaded by other connections
   } else {
     if (!(context.m_last_response_height ==
       context.m_remote_blockchain_height - 1 &&
-      !context.m_needed_objects.size() &&
       !context.m_requested_objects.size())) {
       logger(Logging::ERROR, Logging::BRIGHT_RED)
         << "request_missing_blocks final condition failed!"
         << "\r\nm_last_response_height=" << context.m_last_response_height
         << "\r\nm_remote_blockchain_height=" << context.m_remote_blockchain_height
-        << "\r\nm_needed_objects.size()=" << context.m_needed_objects.size()
         << "\r\nm_requested_objects.size()=" << context.m_requested_objects.size() 
         << "\r\non connection [" << context << "]";
       return false;
@@ -665,7 +845,7 @@ int DynexCNProtocolHandler::handle_response_chain_entry(int command, NOTIFY_RESP
     return 1;
   }
 
-  if (!m_core.have_block(arg.m_block_ids.front())) {
+  if (!m_core.have_block(arg.m_block_ids.front()) && !m_downloads.isPlanned(arg.m_block_ids.front())) {
     logger(Logging::ERROR)
       << context << "sent m_block_ids starting from unknown id: "
       << Common::podToHex(arg.m_block_ids.front())
@@ -686,12 +866,19 @@ int DynexCNProtocolHandler::handle_response_chain_entry(int command, NOTIFY_RESP
     context.m_state = DynexCNConnectionContext::state_shutdown;
   }
 
-  for (auto& bl_id : arg.m_block_ids) {
-    if (!m_core.have_block(bl_id))
-      context.m_needed_objects.push_back(bl_id);
+  auto firstNeeded = arg.m_block_ids.begin();
+  while (firstNeeded != arg.m_block_ids.end() && m_core.have_block(*firstNeeded)) {
+    ++firstNeeded;
+  }
+
+  uint32_t startHeight = arg.start_height + static_cast<uint32_t>(firstNeeded - arg.m_block_ids.begin());
+  if (!m_downloads.addChain(context.m_connection_id, startHeight, std::vector<Crypto::Hash>(firstNeeded, arg.m_block_ids.end()))) {
+    // the peer is on another chain, it is asked again once the current plan is done
+    logger(Logging::DEBUGGING) << context << "Chain entry doesn't continue the chain being downloaded";
+    context.m_last_response_height = 0;
   }
 
-  request_missing_objects(context, false);
+  request_missing_objects(context);
   return 1;
 }
 
@@ -720,8 +907,18 @@ int DynexCNProtocolHandler::handleRequestTxPool(int command, NOTIFY_REQUEST_TX_P
 
 
 void DynexCNProtocolHandler::relay_block(NOTIFY_NEW_BLOCK::request& arg) {
-  auto buf = LevinProtocol::encode(arg);
-  m_p2p->externalRelayNotifyToAll(NOTIFY_NEW_BLOCK::ID, buf, nullptr);
+  relayBlock(arg, nullptr);
+}
+
+// Peers that know NOTIFY_NEW_COMPACT_BLOCK get the block without its transactions.
+void DynexCNProtocolHandler::relayBlock(NOTIFY_NEW_BLOCK::request& arg, const net_connection_id* excludeConnection) {
+  NOTIFY_NEW_COMPACT_BLOCK::request compactBlock;
+  compactBlock.block = arg.b.block;
+  compactBlock.current_blockchain_height = arg.current_blockchain_height;
+  compactBlock.hop = arg.hop;
+
+  m_p2p->externalRelayNotifyToAll(P2PProtocolVersion::V2, NOTIFY_NEW_COMPACT_BLOCK::ID, LevinProtocol::encode(compactBlock),
+    NOTIFY_NEW_BLOCK::ID, LevinProtocol::encode(arg), excludeConnection);
 }
 
 void DynexCNProtocolHandler::relay_transactions(NOTIFY_NEW_TRANSACTIONS::request& arg) {
@@ -40,9 +40,11 @@
 #include <atomic>
 
 #include <Common/ObserverManager.h>
+#include <Common/ThreadPool.h>
 
 #include "DynexCNCore/ICore.h"
 
+#include "DynexCNProtocol/BlockDownloadScheduler.h"
 #include "DynexCNProtocol/DynexCNProtocolDefinitions.h"
 #include "DynexCNProtocol/DynexCNProtocolHandlerCommon.h"
 #include "DynexCNProtocol/IDynexCNProtocolObserver.h"
@@ -70,18 +72,6 @@ namespace DynexCN
   {
   public:
 
-
-    struct parsed_block_entry
-    {
-      Block block;
-      std::vector<BinaryArray> txs;
-
-      void serialize(ISerializer& s) {
-        KV_MEMBER(block);
-        KV_MEMBER(txs);
-      }
-    };
-
     DynexCNProtocolHandler(const Currency& currency, System::Dispatcher& dispatcher, ICore& rcore, IP2pEndpoint* p_net_layout, Logging::ILogger& log);
 
     virtual bool addObserver(IDynexCNProtocolObserver* observer) override;
@@ -116,6 +106,7 @@ namespace DynexCN
     int handle_request_chain(int command, NOTIFY_REQUEST_CHAIN::request& arg, DynexCNConnectionContext& context);
     int handle_response_chain_entry(int command, NOTIFY_RESPONSE_CHAIN_ENTRY::request& arg, DynexCNConnectionContext& context);
     int handleRequestTxPool(int command, NOTIFY_REQUEST_TX_POOL::request& arg, DynexCNConnectionContext& context);
+    int handleNewCompactBlock(int command, NOTIFY_NEW_COMPACT_BLOCK::request& arg, DynexCNConnectionContext& context);
 
     //----------------- i_cn_protocol ----------------------------------
     virtual void relay_block(NOTIFY_NEW_BLOCK::request& arg) override;
@@ -123,11 +114,17 @@ namespace DynexCN
     virtual void add_observer(IDynexCNProtocolObserver* observer) override;
     //----------------------------------------------------------------------------------
     uint32_t get_current_blockchain_height();
-    bool request_missing_objects(DynexCNConnectionContext& context, bool check_having_blocks);
+    bool request_missing_objects(DynexCNConnectionContext& context);
     bool on_connection_synchronized();
     void updateObservedHeight(uint32_t peerHeight, const DynexCNConnectionContext& context);
     void recalculateMaxObservedHeight(const DynexCNConnectionContext& context);
-    int processObjects(DynexCNConnectionContext& context, const std::vector<parsed_block_entry>& blocks);
+    bool processObjects(const net_connection_id& source, const std::vector<parsed_block_entry>& blocks);
+    void applySyncedBlocks();
+    void requestIdlePeers();
+    int processCompactBlock(DynexCNConnectionContext& context, const Block& b, uint32_t hop);
+    int processPendingBlockTransactions(NOTIFY_RESPONSE_GET_OBJECTS::request& arg, DynexCNConnectionContext& context);
+    void relayBlock(NOTIFY_NEW_BLOCK::request& arg, const net_connection_id* excludeConnection);
+    void requestChain(DynexCNConnectionContext& context);
     Logging::LoggerRef logger;
 
   private:
@@ -141,6 +138,10 @@ namespace DynexCN
     std::atomic<bool> m_synchronized;
     std::atomic<bool> m_stop;
     std::recursive_mutex m_sync_lock;
+    BlockDownloadScheduler m_downloads;
+    // parses and prechecks downloaded batches, separate from the blockchain workers so the two do not wait on each other
+    Tools::ThreadPool m_workers;
+    bool m_applyingSyncedBlocks;
 
     mutable std::mutex m_observedHeightMutex;
     uint32_t m_observedHeight;
@@ -618,7 +618,9 @@ void InProcessNode::getPoolSymmetricDifferenceAsync(std::vector<Crypto::Hash>&&
   std::error_code ec = std::error_code();
 
   std::vector<TransactionPrefixInfo> added;
-  isBcActual = core.getPoolChangesLite(knownBlockId, knownPoolTxIds, added, deletedTxIds);
+  uint64_t poolVersion;
+  bool isPoolVersionActual;
+  isBcActual = core.getPoolChangesLite(knownBlockId, 0, knownPoolTxIds, added, deletedTxIds, poolVersion, isPoolVersionActual);
 
   try {
     for (const auto& tx: added) {
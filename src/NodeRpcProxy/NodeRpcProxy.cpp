@@ -39,6 +39,7 @@
 #include "NodeErrors.h"
 
 #include <atomic>
+#include <memory>
 #include <system_error>
 #include <thread>
 
@@ -47,10 +48,11 @@
 #include <System/ContextGroup.h>
 #include <System/Dispatcher.h>
 #include <System/Event.h>
-#include <System/EventLock.h>
+#include <System/InterruptedException.h>
 #include <System/Timer.h>
 #include <DynexCNCore/TransactionApi.h>
 
+#include "Common/ScopeExit.h"
 #include "Common/StringTools.h"
 #include "DynexCNCore/DynexCNBasicImpl.h"
 #include "DynexCNCore/DynexCNTools.h"
@@ -70,6 +72,16 @@ namespace DynexCN {
 
 namespace {
 
+const size_t HTTP_CONNECTION_COUNT = 4;
+// how long the node may hold a status request open when nothing changes
+const uint32_t NODE_STATUS_WAIT_TIMEOUT = 30000;
+
+// transfers of many blocks, they are kept off the last free connection
+bool isBulkRequest(const std::string& url) {
+  return url == "/queryblockslite.bin" || url == "/getblocks.bin" ||
+    url == "/get_blocks_details_by_heights" || url == "/get_blocks_details_by_hashes";
+}
+
 std::error_code interpretResponseStatus(const std::string& status) {
   if (CORE_RPC_STATUS_BUSY == status) {
     return make_error_code(error::NODE_BUSY);
@@ -117,6 +129,7 @@ void NodeRpcProxy::resetInternalState() {
   lastLocalBlockHeaderInfo.difficulty = 0;
   lastLocalBlockHeaderInfo.reward = 0;
   m_knownTxs.clear();
+  m_knownPoolVersion = 0;
 }
 
 void NodeRpcProxy::init(const INode::Callback& callback) {
@@ -151,6 +164,8 @@ bool NodeRpcProxy::shutdown() {
 
   m_dispatcher->remoteSpawn([this]() {
     m_stop = true;
+    // the status loop may be waiting for the node
+    m_statusContextGroup->interrupt();
     // Run all spawned contexts
     m_dispatcher->yield();
   });
@@ -169,11 +184,16 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
     m_dispatcher = &dispatcher;
     ContextGroup contextGroup(dispatcher);
     m_context_group = &contextGroup;
-    HttpClient httpClient(dispatcher, m_nodeHost, m_nodePort);
-    m_httpClient = &httpClient;
-    Event httpEvent(dispatcher);
-    m_httpEvent = &httpEvent;
-    m_httpEvent->set();
+    std::vector<std::unique_ptr<HttpClient>> httpClients;
+    for (size_t i = 0; i < HTTP_CONNECTION_COUNT; ++i) {
+      httpClients.emplace_back(new HttpClient(dispatcher, m_nodeHost, m_nodePort));
+      m_freeHttpClients.push_back(httpClients.back().get());
+    }
+    Event httpClientReleased(dispatcher);
+    m_httpClientReleased = &httpClientReleased;
+    m_httpConnected = false;
+    ContextGroup statusContextGroup(dispatcher);
+    m_statusContextGroup = &statusContextGroup;
 
     {
       std::lock_guard<std::mutex> lock(m_mutex);
@@ -186,16 +206,23 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
 
     initialized_callback(std::error_code());
 
-    contextGroup.spawn([this]() {
+    statusContextGroup.spawn([this]() {
       Timer pullTimer(*m_dispatcher);
-      while (!m_stop) {
-        updateNodeStatus();
-        if (!m_stop) {
-          pullTimer.sleep(std::chrono::milliseconds(m_pullInterval));
+      try {
+        while (!m_stop) {
+          // the node answers as soon as its chain or pool moves past ours, nodes without the wait
+          // request are polled, and so is a node that could not tell its tail, as the wait would
+          // return at once
+          bool statusUpdated = updateNodeStatus();
+          if (!m_stop && !(statusUpdated && waitForNodeStatusChange()) && !m_stop) {
+            pullTimer.sleep(std::chrono::milliseconds(m_pullInterval));
+          }
         }
+      } catch (InterruptedException&) {
       }
     });
 
+    statusContextGroup.wait();
     contextGroup.wait();
     // Make sure all remote spawns are executed
     m_dispatcher->yield();
@@ -204,29 +231,43 @@ void NodeRpcProxy::workerThread(const INode::Callback& initialized_callback) {
 
   m_dispatcher = nullptr;
   m_context_group = nullptr;
-  m_httpClient = nullptr;
-  m_httpEvent = nullptr;
+  m_statusContextGroup = nullptr;
+  m_freeHttpClients.clear();
+  m_httpClientReleased = nullptr;
   m_connected = false;
   m_rpcProxyObserverManager.notify(&INodeRpcProxyObserver::connectionStatusUpdated, m_connected);
 }
 
-void NodeRpcProxy::updateNodeStatus() {
+bool NodeRpcProxy::updateNodeStatus() {
   bool updateBlockchain = true;
+  bool blockchainUpdated = false;
   while (updateBlockchain) {
-    updateBlockchainStatus();
+    blockchainUpdated = updateBlockchainStatus();
     updateBlockchain = !updatePoolStatus();
   }
+
+  return blockchainUpdated;
 }
 
 bool NodeRpcProxy::updatePoolStatus() {
-  std::vector<Crypto::Hash> knownTxs = getKnownTxsVector();
+  // once the node handed out a pool version it answers from its change log, the known ids are
+  // only sent without one
+  uint64_t knownPoolVersion = m_knownPoolVersion;
+  std::vector<Crypto::Hash> knownTxs;
+  if (knownPoolVersion == 0) {
+    knownTxs = getKnownTxsVector();
+  }
+
   Crypto::Hash tailBlock = lastLocalBlockHeaderInfo.hash;
 
   bool isBcActual = false;
   std::vector<std::unique_ptr<ITransactionReader>> addedTxs;
   std::vector<Crypto::Hash> deletedTxsIds;
+  uint64_t poolVersion = 0;
+  bool isPoolVersionActual = false;
 
-  std::error_code ec = doGetPoolSymmetricDifference(std::move(knownTxs), tailBlock, isBcActual, addedTxs, deletedTxsIds);
+  std::error_code ec = doGetPoolSymmetricDifference(std::move(knownTxs), tailBlock, knownPoolVersion, isBcActual, addedTxs, deletedTxsIds,
+    poolVersion, isPoolVersionActual);
   if (ec) {
     return true;
   }
@@ -235,6 +276,23 @@ bool NodeRpcProxy::updatePoolStatus() {
     return false;
   }
 
+  if (knownPoolVersion != 0 && !isPoolVersionActual) {
+    // the node no longer has our version, the changes are relative to an empty pool, so every
+    // known transaction that was not added again is gone
+    std::unordered_set<Crypto::Hash> added;
+    for (const auto& tx : addedTxs) {
+      added.insert(tx->getTransactionHash());
+    }
+
+    for (const auto& hash : m_knownTxs) {
+      if (added.count(hash) == 0) {
+        deletedTxsIds.push_back(hash);
+      }
+    }
+  }
+
+  m_knownPoolVersion = poolVersion;
+
   if (!addedTxs.empty() || !deletedTxsIds.empty()) {
     updatePoolState(addedTxs, deletedTxsIds);
     m_observerManager.notify(&INodeObserver::poolChanged);
@@ -243,17 +301,34 @@ bool NodeRpcProxy::updatePoolStatus() {
   return true;
 }
 
-void NodeRpcProxy::updateBlockchainStatus() {
+bool NodeRpcProxy::waitForNodeStatusChange() {
+  DynexCN::COMMAND_RPC_WAIT_FOR_CHANGES::request req = AUTO_VAL_INIT(req);
+  DynexCN::COMMAND_RPC_WAIT_FOR_CHANGES::response rsp = AUTO_VAL_INIT(rsp);
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    req.tailBlockId = lastLocalBlockHeaderInfo.hash;
+  }
+
+  req.poolVersion = m_knownPoolVersion;
+  req.timeout = NODE_STATUS_WAIT_TIMEOUT;
+
+  return !jsonCommand("/wait_for_changes", req, rsp);
+}
+
+// Returns false if the tail block of the node could not be read.
+bool NodeRpcProxy::updateBlockchainStatus() {
   DynexCN::COMMAND_RPC_GET_LAST_BLOCK_HEADER::request req = AUTO_VAL_INIT(req);
   DynexCN::COMMAND_RPC_GET_LAST_BLOCK_HEADER::response rsp = AUTO_VAL_INIT(rsp);
 
   std::error_code ec = jsonRpcCommand("getlastblockheader", req, rsp);
+  bool blockHeaderUpdated = !ec;
 
   if (!ec) {
     Crypto::Hash blockHash;
     Crypto::Hash prevBlockHash;
     if (!parse_hash256(rsp.block_header.hash, blockHash) || !parse_hash256(rsp.block_header.prev_hash, prevBlockHash)) {
-      return;
+      return false;
     }
 
     std::unique_lock<std::mutex> lock(m_mutex);
@@ -296,10 +371,12 @@ void NodeRpcProxy::updateBlockchainStatus() {
 	m_nodeHeight.store(getInfoResp.height, std::memory_order_relaxed);
   }
 
-  if (m_connected != m_httpClient->isConnected()) {
-    m_connected = m_httpClient->isConnected();
+  if (m_connected != m_httpConnected) {
+    m_connected = m_httpConnected;
     m_rpcProxyObserverManager.notify(&INodeRpcProxyObserver::connectionStatusUpdated, m_connected);
   }
+
+  return blockHeaderUpdated;
 }
 
 void NodeRpcProxy::updatePeerCount(size_t peerCount) {
@@ -468,7 +545,10 @@ void NodeRpcProxy::getPoolSymmetricDifference(std::vector<Crypto::Hash>&& knownP
   }
 
   scheduleRequest([this, knownPoolTxIds, knownBlockId, &isBcActual, &newTxs, &deletedTxIds] () mutable -> std::error_code {
-    return this->doGetPoolSymmetricDifference(std::move(knownPoolTxIds), knownBlockId, isBcActual, newTxs, deletedTxIds); } , callback);
+    uint64_t poolVersion;
+    bool isPoolVersionActual;
+    return this->doGetPoolSymmetricDifference(std::move(knownPoolTxIds), knownBlockId, 0, isBcActual, newTxs, deletedTxIds,
+      poolVersion, isPoolVersionActual); } , callback);
 }
 
 void NodeRpcProxy::getMultisignatureOutputByGlobalIndex(uint64_t amount, uint32_t gindex, MultisignatureOutput& out, const Callback& callback) {
@@ -662,13 +742,15 @@ std::error_code NodeRpcProxy::doQueryBlocksLite(const std::vector<Crypto::Hash>&
   return std::error_code();
 }
 
-std::error_code NodeRpcProxy::doGetPoolSymmetricDifference(std::vector<Crypto::Hash>&& knownPoolTxIds, Crypto::Hash knownBlockId, bool& isBcActual,
-        std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<Crypto::Hash>& deletedTxIds) {
+std::error_code NodeRpcProxy::doGetPoolSymmetricDifference(std::vector<Crypto::Hash>&& knownPoolTxIds, Crypto::Hash knownBlockId, uint64_t knownPoolVersion,
+        bool& isBcActual, std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<Crypto::Hash>& deletedTxIds,
+        uint64_t& poolVersion, bool& isPoolVersionActual) {
   DynexCN::COMMAND_RPC_GET_POOL_CHANGES_LITE::request req = AUTO_VAL_INIT(req);
   DynexCN::COMMAND_RPC_GET_POOL_CHANGES_LITE::response rsp = AUTO_VAL_INIT(rsp);
 
   req.tailBlockId = knownBlockId;
-  req.knownTxsIds = knownPoolTxIds;
+  req.knownTxsIds = std::move(knownPoolTxIds);
+  req.poolVersion = knownPoolVersion;
 
   std::error_code ec = binaryCommand("/get_pool_changes_lite.bin", req, rsp);
 
@@ -677,6 +759,8 @@ std::error_code NodeRpcProxy::doGetPoolSymmetricDifference(std::vector<Crypto::H
   }
 
   isBcActual = rsp.isTailBlockActual;
+  poolVersion = rsp.poolVersion;
+  isPoolVersionActual = rsp.isPoolVersionActual;
 
   deletedTxIds = std::move(rsp.deletedTxsIds);
 
@@ -793,8 +877,8 @@ void NodeRpcProxy::scheduleRequest(std::function<std::error_code()>&& procedure,
           callback(std::make_error_code(std::errc::operation_canceled));
         } else {
           std::error_code ec = procedure();
-          if (m_connected != m_httpClient->isConnected()) {
-            m_connected = m_httpClient->isConnected();
+          if (m_connected != m_httpConnected) {
+            m_connected = m_httpConnected;
             m_rpcProxyObserverManager.notify(&INodeRpcProxyObserver::connectionStatusUpdated, m_connected);
           }
           callback(m_stop ? std::make_error_code(std::errc::operation_canceled) : ec);
@@ -803,13 +887,73 @@ void NodeRpcProxy::scheduleRequest(std::function<std::error_code()>&& procedure,
     }, std::move(procedure), callback));
 }
 
+HttpClient& NodeRpcProxy::acquireHttpClient(bool bulk) {
+  // bulk transfers leave the last free connection to status polls, relays and other short calls
+  size_t reserved = bulk ? 1 : 0;
+
+  if (m_freeHttpClients.size() <= reserved) {
+    {
+      std::lock_guard<std::mutex> lock(m_metricsMutex);
+      ++m_metrics.queueDepth;
+      m_metrics.maxQueueDepth = std::max(m_metrics.maxQueueDepth, m_metrics.queueDepth);
+    }
+
+    Tools::ScopeExit dequeue([this] {
+      std::lock_guard<std::mutex> lock(m_metricsMutex);
+      --m_metrics.queueDepth;
+    });
+
+    while (m_freeHttpClients.size() <= reserved) {
+      m_httpClientReleased->clear();
+      m_httpClientReleased->wait();
+    }
+  }
+
+  HttpClient* httpClient = m_freeHttpClients.back();
+  m_freeHttpClients.pop_back();
+
+  std::lock_guard<std::mutex> lock(m_metricsMutex);
+  ++m_metrics.inFlight;
+  return *httpClient;
+}
+
+void NodeRpcProxy::releaseHttpClient(HttpClient& httpClient) {
+  m_httpConnected = httpClient.isConnected();
+  m_freeHttpClients.push_back(&httpClient);
+  m_httpClientReleased->set();
+
+  std::lock_guard<std::mutex> lock(m_metricsMutex);
+  --m_metrics.inFlight;
+}
+
+void NodeRpcProxy::recordRequest(const std::string& name, std::chrono::steady_clock::time_point start, const std::error_code& ec) {
+  uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+  std::lock_guard<std::mutex> lock(m_metricsMutex);
+  RequestMetrics& metrics = m_metrics.requests[name];
+  ++metrics.count;
+  if (ec) {
+    ++metrics.errorCount;
+  }
+
+  metrics.totalLatencyUs += latency;
+  metrics.maxLatencyUs = std::max(metrics.maxLatencyUs, latency);
+}
+
+NodeRpcProxy::Metrics NodeRpcProxy::getMetrics() const {
+  std::lock_guard<std::mutex> lock(m_metricsMutex);
+  return m_metrics;
+}
+
 template <typename Request, typename Response>
 std::error_code NodeRpcProxy::binaryCommand(const std::string& url, const Request& req, Response& res) {
   std::error_code ec;
+  auto start = std::chrono::steady_clock::now();
 
   try {
-    EventLock eventLock(*m_httpEvent);
-    invokeBinaryCommand(*m_httpClient, url, req, res);
+    HttpClient& httpClient = acquireHttpClient(isBulkRequest(url));
+    Tools::ScopeExit releaseClient([this, &httpClient] { releaseHttpClient(httpClient); });
+    invokeBinaryCommand(httpClient, url, req, res);
     ec = interpretResponseStatus(res.status);
   } catch (const ConnectException&) {
     ec = make_error_code(error::CONNECT_ERROR);
@@ -817,16 +961,19 @@ std::error_code NodeRpcProxy::binaryCommand(const std::string& url, const Reques
     ec = make_error_code(error::NETWORK_ERROR);
   }
 
+  recordRequest(url, start, ec);
   return ec;
 }
 
 template <typename Request, typename Response>
 std::error_code NodeRpcProxy::jsonCommand(const std::string& url, const Request& req, Response& res) {
   std::error_code ec;
+  auto start = std::chrono::steady_clock::now();
 
   try {
-    EventLock eventLock(*m_httpEvent);
-    invokeJsonCommand(*m_httpClient, url, req, res);
+    HttpClient& httpClient = acquireHttpClient(isBulkRequest(url));
+    Tools::ScopeExit releaseClient([this, &httpClient] { releaseHttpClient(httpClient); });
+    invokeJsonCommand(httpClient, url, req, res);
     ec = interpretResponseStatus(res.status);
   } catch (const ConnectException&) {
     ec = make_error_code(error::CONNECT_ERROR);
@@ -834,15 +981,18 @@ std::error_code NodeRpcProxy::jsonCommand(const std::string& url, const Request&
     ec = make_error_code(error::NETWORK_ERROR);
   }
 
+  recordRequest(url, start, ec);
   return ec;
 }
 
 template <typename Request, typename Response>
 std::error_code NodeRpcProxy::jsonRpcCommand(const std::string& method, const Request& req, Response& res) {
   std::error_code ec = make_error_code(error::INTERNAL_NODE_ERROR);
+  auto start = std::chrono::steady_clock::now();
 
   try {
-    EventLock eventLock(*m_httpEvent);
+    HttpClient& httpClient = acquireHttpClient(false);
+    Tools::ScopeExit releaseClient([this, &httpClient] { releaseHttpClient(httpClient); });
 
     JsonRpc::JsonRpcRequest jsReq;
 
@@ -856,7 +1006,7 @@ std::error_code NodeRpcProxy::jsonRpcCommand(const std::string& method, const Re
     httpReq.setUrl("/json_rpc");
     httpReq.setBody(jsReq.getBody());
 
-    m_httpClient->request(httpReq, httpRes);
+    httpClient.request(httpReq, httpRes);
 
     JsonRpc::JsonRpcResponse jsRes;
 
@@ -872,6 +1022,7 @@ std::error_code NodeRpcProxy::jsonRpcCommand(const std::string& method, const Re
     ec = make_error_code(error::NETWORK_ERROR);
   }
 
+  recordRequest(method, start, ec);
   return ec;
 }
 
@@ -38,7 +38,9 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <map>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -112,6 +114,25 @@ public:
   unsigned int rpcTimeout() const { return m_rpcTimeout; }
   void rpcTimeout(unsigned int val) { m_rpcTimeout = val; }
 
+  struct RequestMetrics {
+    uint64_t count = 0;
+    uint64_t errorCount = 0;
+    // from the call to its completion, waiting for a free connection included
+    uint64_t totalLatencyUs = 0;
+    uint64_t maxLatencyUs = 0;
+  };
+
+  struct Metrics {
+    // by url or json rpc method
+    std::map<std::string, RequestMetrics> requests;
+    // requests waiting for a free connection
+    size_t queueDepth = 0;
+    size_t maxQueueDepth = 0;
+    size_t inFlight = 0;
+  };
+
+  Metrics getMetrics() const;
+
   const std::string m_nodeHost;
   const unsigned short m_nodePort;
 
@@ -121,9 +142,10 @@ private:
 
   std::vector<Crypto::Hash> getKnownTxsVector() const;
   void pullNodeStatusAndScheduleTheNext();
-  void updateNodeStatus();
-  void updateBlockchainStatus();
+  bool updateNodeStatus();
+  bool updateBlockchainStatus();
   bool updatePoolStatus();
+  bool waitForNodeStatusChange();
   void updatePeerCount(size_t peerCount);
   void updatePoolState(const std::vector<std::unique_ptr<ITransactionReader>>& addedTxs, const std::vector<Crypto::Hash>& deletedTxsIds);
 
@@ -136,8 +158,9 @@ private:
                                                     std::vector<uint32_t>& outsGlobalIndices);
   std::error_code doQueryBlocksLite(const std::vector<Crypto::Hash>& knownBlockIds, uint64_t timestamp,
     std::vector<DynexCN::BlockShortEntry>& newBlocks, uint32_t& startHeight);
-  std::error_code doGetPoolSymmetricDifference(std::vector<Crypto::Hash>&& knownPoolTxIds, Crypto::Hash knownBlockId, bool& isBcActual,
-          std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<Crypto::Hash>& deletedTxIds);
+  std::error_code doGetPoolSymmetricDifference(std::vector<Crypto::Hash>&& knownPoolTxIds, Crypto::Hash knownBlockId, uint64_t knownPoolVersion,
+          bool& isBcActual, std::vector<std::unique_ptr<ITransactionReader>>& newTxs, std::vector<Crypto::Hash>& deletedTxIds,
+          uint64_t& poolVersion, bool& isPoolVersionActual);
   std::error_code doGetBlocksByHeight(const std::vector<uint32_t>& blockHeights, std::vector<std::vector<BlockDetails>>& blocks);
   std::error_code doGetBlocksByHash(const std::vector<Crypto::Hash>& blockHashes, std::vector<BlockDetails>& blocks);
   std::error_code doGetBlock(const uint32_t blockHeight, BlockDetails& block);
@@ -145,6 +168,9 @@ private:
   std::error_code doGetTransactions(const std::vector<Crypto::Hash>& transactionHashes, std::vector<TransactionDetails>& transactions);
 
   void scheduleRequest(std::function<std::error_code()>&& procedure, const Callback& callback);
+  HttpClient& acquireHttpClient(bool bulk);
+  void releaseHttpClient(HttpClient& client);
+  void recordRequest(const std::string& name, std::chrono::steady_clock::time_point start, const std::error_code& ec);
   template <typename Request, typename Response>
   std::error_code binaryCommand(const std::string& url, const Request& req, Response& res);
   template <typename Request, typename Response>
@@ -165,12 +191,19 @@ private:
   std::thread m_workerThread;
   System::Dispatcher* m_dispatcher = nullptr;
   System::ContextGroup* m_context_group = nullptr;
+  System::ContextGroup* m_statusContextGroup = nullptr;
   Tools::ObserverManager<DynexCN::INodeObserver> m_observerManager;
   Tools::ObserverManager<DynexCN::INodeRpcProxyObserver> m_rpcProxyObserverManager;
 
   unsigned int m_rpcTimeout;
-  HttpClient* m_httpClient = nullptr;
-  System::Event* m_httpEvent = nullptr;
+  // keep-alive connections to the node, every request holds one of them while it runs
+  std::vector<HttpClient*> m_freeHttpClients;
+  System::Event* m_httpClientReleased = nullptr;
+  // state of the connection released last
+  bool m_httpConnected = false;
+
+  mutable std::mutex m_metricsMutex;
+  Metrics m_metrics;
 
   uint64_t m_pullInterval;
 
@@ -184,6 +217,8 @@ private:
   BlockHeaderInfo lastLocalBlockHeaderInfo;
   //protect it with mutex if decided to add worker threads
   std::unordered_set<Crypto::Hash> m_knownTxs;
+  // pool version m_knownTxs corresponds to, 0 if the node did not report one
+  uint64_t m_knownPoolVersion = 0;
 
   bool m_connected;
   std::string m_fee_address;
@@ -37,7 +37,6 @@
 
 #pragma once
 
-#include <list>
 #include <ostream>
 #include <unordered_set>
 
@@ -65,10 +64,14 @@ struct DynexCNConnectionContext {
   };
 
   state m_state = state_befor_handshake;
-  std::list<Crypto::Hash> m_needed_objects;
   std::unordered_set<Crypto::Hash> m_requested_objects;
   uint32_t m_remote_blockchain_height = 0;
   uint32_t m_last_response_height = 0;
+  // compact block waiting for the transactions requested from this peer
+  std::string m_pending_block;
+  uint32_t m_pending_block_hop = 0;
+  time_t m_pending_block_time = 0;
+  std::unordered_set<Crypto::Hash> m_pending_block_txs;
 // by CROAT
   uint32_t msg2006 = 0;
   uint32_t msg2007 = 0;
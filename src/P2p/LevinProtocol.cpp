@@ -81,14 +81,7 @@ void LevinProtocol::sendMessage(uint32_t command, const BinaryArray& out, bool n
   head.m_flags = LEVIN_PACKET_REQUEST;
 
   // write header and body in one operation
-  BinaryArray writeBuffer;
-  writeBuffer.reserve(sizeof(head) + out.size());
-
-  Common::VectorOutputStream stream(writeBuffer);
-  stream.writeSome(&head, sizeof(head));
-  stream.writeSome(out.data(), out.size());
-
-  writeStrict(writeBuffer.data(), writeBuffer.size());
+  writeStrict(reinterpret_cast<const uint8_t*>(&head), sizeof(head), out.data(), out.size());
 }
 
 bool LevinProtocol::readCommand(Command& cmd) {
@@ -133,20 +126,21 @@ void LevinProtocol::sendReply(uint32_t command, const BinaryArray& out, int32_t
   head.m_flags = LEVIN_PACKET_RESPONSE;
   head.m_return_code = returnCode;
 
-  BinaryArray writeBuffer;
-  writeBuffer.reserve(sizeof(head) + out.size());
-
-  Common::VectorOutputStream stream(writeBuffer);
-  stream.writeSome(&head, sizeof(head));
-  stream.writeSome(out.data(), out.size());
-
-  writeStrict(writeBuffer.data(), writeBuffer.size());
+  writeStrict(reinterpret_cast<const uint8_t*>(&head), sizeof(head), out.data(), out.size());
 }
 
-void LevinProtocol::writeStrict(const uint8_t* ptr, size_t size) {
-  size_t offset = 0;
-  while (offset < size) {
-    offset += m_conn.write(ptr + offset, size - offset);
+void LevinProtocol::writeStrict(const uint8_t* head, size_t headSize, const uint8_t* body, size_t bodySize) {
+  while (headSize + bodySize != 0) {
+    size_t written = m_conn.write(head, headSize, body, bodySize);
+    if (written < headSize) {
+      head += written;
+      headSize -= written;
+    } else {
+      written -= headSize;
+      headSize = 0;
+      body += written;
+      bodySize -= written;
+    }
   }
 }
 
@@ -126,7 +126,7 @@ public:
 private:
 
   bool readStrict(uint8_t* ptr, size_t size);
-  void writeStrict(const uint8_t* ptr, size_t size);
+  void writeStrict(const uint8_t* head, size_t headSize, const uint8_t* body, size_t bodySize);
   System::TcpConnection& m_conn;
 };
 
@@ -360,8 +360,30 @@ namespace DynexCN
 
   //----------------------------------------------------------------------------------- 
   void NodeServer::externalRelayNotifyToAll(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) {
-    m_dispatcher.remoteSpawn([this, command, data_buff, excludeConnection] {
-      relay_notify_to_all(command, data_buff, excludeConnection);
+    auto buffer = std::make_shared<const BinaryArray>(data_buff);
+    m_dispatcher.remoteSpawn([this, command, buffer, excludeConnection] {
+      relayNotifyToAll(command, buffer, excludeConnection);
+    });
+  }
+
+  //-----------------------------------------------------------------------------------
+  void NodeServer::externalRelayNotifyToAll(uint8_t minVersion, int command, const BinaryArray& data_buff,
+    int fallbackCommand, const BinaryArray& fallbackBuff, const net_connection_id* excludeConnection) {
+    net_connection_id excludeId = excludeConnection ? *excludeConnection : boost::value_initialized<net_connection_id>();
+    auto buffer = std::make_shared<const BinaryArray>(data_buff);
+    auto fallbackBuffer = std::make_shared<const BinaryArray>(fallbackBuff);
+    m_dispatcher.remoteSpawn([this, minVersion, command, buffer, fallbackCommand, fallbackBuffer, excludeId] {
+      forEachConnection([&](P2pConnectionContext& conn) {
+        if (conn.peerId && conn.m_connection_id != excludeId &&
+            (conn.m_state == DynexCNConnectionContext::state_normal ||
+             conn.m_state == DynexCNConnectionContext::state_synchronizing)) {
+          if (conn.version >= minVersion) {
+            conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, buffer));
+          } else {
+            conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, fallbackCommand, fallbackBuffer));
+          }
+        }
+      });
     });
   }
 
@@ -739,7 +761,7 @@ namespace DynexCN
   bool NodeServer::timedSync() {
     COMMAND_TIMED_SYNC::request arg = boost::value_initialized<COMMAND_TIMED_SYNC::request>();
     m_payload_handler.get_payload_sync_data(arg.payload_data);
-    auto cmdBuf = LevinProtocol::encode<COMMAND_TIMED_SYNC::request>(arg);
+    auto cmdBuf = std::make_shared<const BinaryArray>(LevinProtocol::encode<COMMAND_TIMED_SYNC::request>(arg));
 
     forEachConnection([&](P2pConnectionContext& conn) {
       if (conn.peerId && 
@@ -1184,13 +1206,18 @@ namespace DynexCN
   //-----------------------------------------------------------------------------------
   
   void NodeServer::relay_notify_to_all(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) {
+    relayNotifyToAll(command, std::make_shared<const BinaryArray>(data_buff), excludeConnection);
+  }
+
+  //-----------------------------------------------------------------------------------
+  void NodeServer::relayNotifyToAll(int command, const std::shared_ptr<const BinaryArray>& buffer, const net_connection_id* excludeConnection) {
     net_connection_id excludeId = excludeConnection ? *excludeConnection : boost::value_initialized<net_connection_id>();
 
     forEachConnection([&](P2pConnectionContext& conn) {
       if (conn.peerId && conn.m_connection_id != excludeId &&
           (conn.m_state == DynexCNConnectionContext::state_normal ||
            conn.m_state == DynexCNConnectionContext::state_synchronizing)) {
-        conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, data_buff));
+        conn.pushMessage(P2pMessage(P2pMessage::NOTIFY, command, buffer));
       }
     });
   }
@@ -1612,13 +1639,13 @@ namespace DynexCN
           logger(DEBUGGING) << ctx << "msg " << msg.type << ':' << msg.command;
           switch (msg.type) {
           case P2pMessage::COMMAND:
-            proto.sendMessage(msg.command, msg.buffer, true);
+            proto.sendMessage(msg.command, *msg.buffer, true);
             break;
           case P2pMessage::NOTIFY:
-            proto.sendMessage(msg.command, msg.buffer, false);
+            proto.sendMessage(msg.command, *msg.buffer, false);
             break;
           case P2pMessage::REPLY:
-            proto.sendReply(msg.command, msg.buffer, msg.returnCode);
+            proto.sendReply(msg.command, *msg.buffer, msg.returnCode);
             break;
           default:
             assert(false);
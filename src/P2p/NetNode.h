@@ -38,6 +38,7 @@
 #pragma once
 
 #include <functional>
+#include <memory>
 #include <unordered_map>
 
 #include <System/Context.h>
@@ -77,21 +78,26 @@ namespace DynexCN
       NOTIFY
     };
 
-    P2pMessage(Type type, uint32_t command, const BinaryArray& buffer, int32_t returnCode = 0) :
-      type(type), command(command), buffer(buffer), returnCode(returnCode) {
+    P2pMessage(Type type, uint32_t command, std::shared_ptr<const BinaryArray> buffer, int32_t returnCode = 0) :
+      type(type), command(command), buffer(std::move(buffer)), returnCode(returnCode) {
+    }
+
+    P2pMessage(Type type, uint32_t command, BinaryArray&& buffer, int32_t returnCode = 0) :
+      type(type), command(command), buffer(std::make_shared<const BinaryArray>(std::move(buffer))), returnCode(returnCode) {
     }
 
-    P2pMessage(P2pMessage&& msg) :
-      type(msg.type), command(msg.command), buffer(std::move(msg.buffer)), returnCode(msg.returnCode) {
+    P2pMessage(Type type, uint32_t command, const BinaryArray& buffer, int32_t returnCode = 0) :
+      type(type), command(command), buffer(std::make_shared<const BinaryArray>(buffer)), returnCode(returnCode) {
     }
 
-    size_t size() {
-      return buffer.size();
+    size_t size() const {
+      return buffer->size();
     }
 
     Type type;
     uint32_t command;
-    const BinaryArray buffer;
+    // shared by all the connections a message is broadcast to
+    std::shared_ptr<const BinaryArray> buffer;
     int32_t returnCode;
   };
 
@@ -195,6 +201,7 @@ namespace DynexCN
     bool timedSync();
     bool handleTimedSyncResponse(const BinaryArray& in, P2pConnectionContext& context);
     void forEachConnection(std::function<void(P2pConnectionContext&)> action);
+    void relayNotifyToAll(int command, const std::shared_ptr<const BinaryArray>& buffer, const net_connection_id* excludeConnection);
 
     void on_connection_new(P2pConnectionContext& context);
     void on_connection_close(P2pConnectionContext& context);
@@ -205,6 +212,8 @@ namespace DynexCN
     virtual void drop_connection(DynexCNConnectionContext& context, bool add_fail) override;
     virtual void for_each_connection(std::function<void(DynexCN::DynexCNConnectionContext&, PeerIdType)> f) override;
     virtual void externalRelayNotifyToAll(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) override;
+    virtual void externalRelayNotifyToAll(uint8_t minVersion, int command, const BinaryArray& data_buff,
+      int fallbackCommand, const BinaryArray& fallbackBuff, const net_connection_id* excludeConnection) override;
 
     //-----------------------------------------------------------------------------------------------
     bool add_host_fail(const uint32_t address_ip);
@@ -56,6 +56,9 @@ namespace DynexCN {
     virtual void for_each_connection(std::function<void(DynexCN::DynexCNConnectionContext&, PeerIdType)> f) = 0;
     // can be called from external threads
     virtual void externalRelayNotifyToAll(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) = 0;
+    // peers of at least minVersion get the first notification, older ones the fallback
+    virtual void externalRelayNotifyToAll(uint8_t minVersion, int command, const BinaryArray& data_buff,
+      int fallbackCommand, const BinaryArray& fallbackBuff, const net_connection_id* excludeConnection) = 0;
   };
 
   struct p2p_endpoint_stub: public IP2pEndpoint {
@@ -68,5 +71,7 @@ namespace DynexCN {
     virtual void for_each_connection(std::function<void(DynexCN::DynexCNConnectionContext&, PeerIdType)> f) override {}
     virtual uint64_t get_connections_count() override { return 0; }   
     virtual void externalRelayNotifyToAll(int command, const BinaryArray& data_buff, const net_connection_id* excludeConnection) override {}
+    virtual void externalRelayNotifyToAll(uint8_t minVersion, int command, const BinaryArray& data_buff,
+      int fallbackCommand, const BinaryArray& fallbackBuff, const net_connection_id* excludeConnection) override {}
   };
 }
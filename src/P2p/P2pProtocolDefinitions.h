@@ -75,7 +75,8 @@ namespace DynexCN
   enum P2PProtocolVersion : uint8_t {
     V0 = 0,
     V1 = 1,
-    CURRENT = V1
+    V2 = 2, // NOTIFY_NEW_COMPACT_BLOCK
+    CURRENT = V2
   };
 
   struct basic_node_data
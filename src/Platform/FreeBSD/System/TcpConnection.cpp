@@ -25,6 +25,7 @@
 #include <sys/event.h>
 #include <sys/errno.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include "Dispatcher.h"
@@ -153,7 +154,6 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
     throw InterruptedException();
   }
 
-  std::string message;
   if (size == 0) {
     if (shutdown(connection, SHUT_WR) == -1) {
       throw std::runtime_error("TcpConnection::write, shutdown failed, " + lastErrorMessage());
@@ -162,10 +162,31 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
     return 0;
   }
 
-  ssize_t transferred = ::send(connection, (void *)data, size, 0);
+  return write(nullptr, 0, data, size);
+}
+
+size_t TcpConnection::write(const uint8_t* head, size_t headSize, const uint8_t* data, size_t size) {
+  assert(dispatcher != nullptr);
+  assert(writeContext == nullptr);
+  if (dispatcher->interrupted()) {
+    throw InterruptedException();
+  }
+
+  std::string message;
+  assert(headSize + size != 0);
+  iovec buffers[2] = {
+    {const_cast<uint8_t*>(head), headSize},
+    {const_cast<uint8_t*>(data), size}
+  };
+
+  msghdr gather = {};
+  gather.msg_iov = buffers;
+  gather.msg_iovlen = 2;
+
+  ssize_t transferred = ::sendmsg(connection, &gather, 0);
   if (transferred == -1) {
     if (errno != EAGAIN  && errno != EWOULDBLOCK) {
-      message = "send failed, " + lastErrorMessage();
+      message = "sendmsg failed, " + lastErrorMessage();
     } else {
       OperationContext context;
       context.context = dispatcher->getCurrentContext();
@@ -204,11 +225,11 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
           throw InterruptedException();
         }
 
-        ssize_t transferred = ::send(connection, (void *)data, size, 0);
+        ssize_t transferred = ::sendmsg(connection, &gather, 0);
         if (transferred == -1) {
-          message = "send failed, " + lastErrorMessage();
+          message = "sendmsg failed, " + lastErrorMessage();
         } else {
-          assert(transferred <= static_cast<ssize_t>(size));
+          assert(transferred <= static_cast<ssize_t>(headSize + size));
           return transferred;
         }
       }
@@ -217,7 +238,7 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
     throw std::runtime_error("TcpConnection::write, " + message);
   }
 
-  assert(transferred <= static_cast<ssize_t>(size));
+  assert(transferred <= static_cast<ssize_t>(headSize + size));
   return transferred;
 }
 
@@ -37,6 +37,8 @@ public:
   TcpConnection& operator=(TcpConnection&& other);
   std::size_t read(uint8_t* data, std::size_t size);
   std::size_t write(const uint8_t* data, std::size_t size);
+  // Writes from head, then from data, in one operation. Returns the number of bytes written from both.
+  std::size_t write(const uint8_t* head, std::size_t headSize, const uint8_t* data, std::size_t size);
   std::pair<Ipv4Address, uint16_t> getPeerAddressAndPort() const;
 
 private:
@@ -21,6 +21,8 @@
 #include <arpa/inet.h>
 #include <cassert>
 #include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <System/ErrorMessage.h>
@@ -167,7 +169,6 @@ std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
     throw InterruptedException();
   }
 
-  std::string message;
   if(size == 0) {
     if(shutdown(connection, SHUT_WR) == -1) {
       throw std::runtime_error("TcpConnection::write, shutdown failed, " + lastErrorMessage());
@@ -176,10 +177,31 @@ std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
     return 0;
   }
 
-  ssize_t transferred = ::send(connection, (void *)data, size, MSG_NOSIGNAL);
+  return write(nullptr, 0, data, size);
+}
+
+std::size_t TcpConnection::write(const uint8_t* head, size_t headSize, const uint8_t* data, size_t size) {
+  assert(dispatcher != nullptr);
+  assert(contextPair.writeContext == nullptr);
+  if (dispatcher->interrupted()) {
+    throw InterruptedException();
+  }
+
+  std::string message;
+  assert(headSize + size != 0);
+  iovec buffers[2] = {
+    {const_cast<uint8_t*>(head), headSize},
+    {const_cast<uint8_t*>(data), size}
+  };
+
+  msghdr gather = {};
+  gather.msg_iov = buffers;
+  gather.msg_iovlen = 2;
+
+  ssize_t transferred = ::sendmsg(connection, &gather, MSG_NOSIGNAL);
   if (transferred == -1) {
     if (errno != EAGAIN) {
-      message = "send failed, " + lastErrorMessage();
+      message = "sendmsg failed, " + lastErrorMessage();
     } else {
       epoll_event connectionEvent;
       OperationContext operationContext;
@@ -239,11 +261,11 @@ std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
           throw std::runtime_error("TcpConnection::write, events & (EPOLLERR | EPOLLHUP) != 0");
         }
 
-        ssize_t transferred = ::send(connection, (void *)data, size, 0);
+        ssize_t transferred = ::sendmsg(connection, &gather, 0);
         if (transferred == -1) {
-          message = "send failed, "  + lastErrorMessage();
+          message = "sendmsg failed, "  + lastErrorMessage();
         } else {
-          assert(transferred <= static_cast<ssize_t>(size));
+          assert(transferred <= static_cast<ssize_t>(headSize + size));
           return transferred;
         }
       }
@@ -252,7 +274,7 @@ std::size_t TcpConnection::write(const uint8_t* data, size_t size) {
     throw std::runtime_error("TcpConnection::write, " + message);
   }
 
-  assert(transferred <= static_cast<ssize_t>(size));
+  assert(transferred <= static_cast<ssize_t>(headSize + size));
   return transferred;
 }
 
@@ -0,0 +1,187 @@
+// Copyright (c) 2012-2016, The CN developers, The Bytecoin developers
+// Copyright (c) 2017-2019, The CROAT.community developers
+//
+// This file is part of Bytecoin.
+//
+// Bytecoin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Bytecoin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Bytecoin.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "PositionalFile.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <cassert>
+
+namespace System {
+
+PositionalFile::PositionalFile() : m_file(-1) {
+}
+
+PositionalFile::~PositionalFile() {
+  std::error_code ignore;
+  close(ignore);
+}
+
+const std::string& PositionalFile::path() const {
+  assert(isOpened());
+
+  return m_path;
+}
+
+bool PositionalFile::isOpened() const {
+  return m_file != -1;
+}
+
+void PositionalFile::open(const std::string& path, bool create, std::error_code& ec) {
+  if (isOpened()) {
+    close(ec);
+    if (ec) {
+      return;
+    }
+  }
+
+  m_file = ::open(path.c_str(), O_RDWR | (create ? O_CREAT | O_TRUNC : 0), S_IRUSR | S_IWUSR);
+  if (m_file == -1) {
+    ec = std::error_code(errno, std::system_category());
+    return;
+  }
+
+  m_path = path;
+  ec = std::error_code();
+}
+
+void PositionalFile::open(const std::string& path, bool create) {
+  std::error_code ec;
+  open(path, create, ec);
+  if (ec) {
+    throw std::system_error(ec, "PositionalFile::open");
+  }
+}
+
+void PositionalFile::close(std::error_code& ec) {
+  if (m_file != -1) {
+    int result = ::close(m_file);
+    if (result != 0) {
+      ec = std::error_code(errno, std::system_category());
+      return;
+    }
+
+    m_file = -1;
+  }
+
+  ec = std::error_code();
+}
+
+void PositionalFile::close() {
+  std::error_code ec;
+  close(ec);
+  if (ec) {
+    throw std::system_error(ec, "PositionalFile::close");
+  }
+}
+
+uint64_t PositionalFile::size(std::error_code& ec) const {
+  assert(isOpened());
+
+  struct stat fileStat;
+  if (::fstat(m_file, &fileStat) == -1) {
+    ec = std::error_code(errno, std::system_category());
+    return 0;
+  }
+
+  ec = std::error_code();
+  return static_cast<uint64_t>(fileStat.st_size);
+}
+
+uint64_t PositionalFile::size() const {
+  std::error_code ec;
+  uint64_t result = size(ec);
+  if (ec) {
+    throw std::system_error(ec, "PositionalFile::size");
+  }
+
+  return result;
+}
+
+void PositionalFile::read(uint64_t offset, void* data, size_t size, std::error_code& ec) const {
+  assert(isOpened());
+
+  uint8_t* buffer = static_cast<uint8_t*>(data);
+  while (size > 0) {
+    ssize_t result = ::pread(m_file, buffer, size, static_cast<off_t>(offset));
+    if (result == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      ec = std::error_code(errno, std::system_category());
+      return;
+    }
+
+    if (result == 0) {
+      ec = std::make_error_code(std::errc::io_error);
+      return;
+    }
+
+    buffer += result;
+    offset += static_cast<uint64_t>(result);
+    size -= static_cast<size_t>(result);
+  }
+
+  ec = std::error_code();
+}
+
+void PositionalFile::read(uint64_t offset, void* data, size_t size) const {
+  std::error_code ec;
+  read(offset, data, size, ec);
+  if (ec) {
+    throw std::system_error(ec, "PositionalFile::read");
+  }
+}
+
+void PositionalFile::write(uint64_t offset, const void* data, size_t size, std::error_code& ec) {
+  assert(isOpened());
+
+  const uint8_t* buffer = static_cast<const uint8_t*>(data);
+  while (size > 0) {
+    ssize_t result = ::pwrite(m_file, buffer, size, static_cast<off_t>(offset));
+    if (result == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      ec = std::error_code(errno, std::system_category());
+      return;
+    }
+
+    buffer += result;
+    offset += static_cast<uint64_t>(result);
+    size -= static_cast<size_t>(result);
+  }
+
+  ec = std::error_code();
+}
+
+void PositionalFile::write(uint64_t offset, const void* data, size_t size) {
+  std::error_code ec;
+  write(offset, data, size, ec);
+  if (ec) {
+    throw std::system_error(ec, "PositionalFile::write");
+  }
+}
+
+}
@@ -0,0 +1,193 @@
+// Copyright (c) 2012-2016, The CN developers, The Bytecoin developers
+// Copyright (c) 2017-2019, The CROAT.community developers
+//
+// This file is part of Bytecoin.
+//
+// Bytecoin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Bytecoin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Bytecoin.  If not, see <http://www.gnu.org/licenses/>.
+
+#include "PositionalFile.h"
+
+#include <algorithm>
+#include <cassert>
+
+#define NOMINMAX
+#include <windows.h>
+
+namespace System {
+
+PositionalFile::PositionalFile() : m_fileHandle(INVALID_HANDLE_VALUE) {
+}
+
+PositionalFile::~PositionalFile() {
+  std::error_code ignore;
+  close(ignore);
+}
+
+const std::string& PositionalFile::path() const {
+  assert(isOpened());
+
+  return m_path;
+}
+
+bool PositionalFile::isOpened() const {
+  return m_fileHandle != INVALID_HANDLE_VALUE;
+}
+
+void PositionalFile::open(const std::string& path, bool create, std::error_code& ec) {
+  if (isOpened()) {
+    close(ec);
+    if (ec) {
+      return;
+    }
+  }
+
+  m_fileHandle = ::CreateFile(
+    path.c_str(),
+    GENERIC_READ | GENERIC_WRITE,
+    FILE_SHARE_DELETE | FILE_SHARE_READ,
+    NULL,
+    create ? CREATE_ALWAYS : OPEN_EXISTING,
+    FILE_ATTRIBUTE_NORMAL,
+    NULL);
+  if (m_fileHandle == INVALID_HANDLE_VALUE) {
+    ec = std::error_code(::GetLastError(), std::system_category());
+    return;
+  }
+
+  m_path = path;
+  ec = std::error_code();
+}
+
+void PositionalFile::open(const std::string& path, bool create) {
+  std::error_code ec;
+  open(path, create, ec);
+  if (ec) {
+    throw std::system_error(ec, "PositionalFile::open");
+  }
+}
+
+void PositionalFile::close(std::error_code& ec) {
+  if (m_fileHandle != INVALID_HANDLE_VALUE) {
+    BOOL result = ::CloseHandle(m_fileHandle);
+    if (!result) {
+      ec = std::error_code(::GetLastError(), std::system_category());
+      return;
+    }
+
+    m_fileHandle = INVALID_HANDLE_VALUE;
+  }
+
+  ec = std::error_code();
+}
+
+void PositionalFile::close() {
+  std::error_code ec;
+  close(ec);
+  if (ec) {
+    throw std::system_error(ec, "PositionalFile::close");
+  }
+}
+
+uint64_t PositionalFile::size(std::error_code& ec) const {
+  assert(isOpened());
+
+  LARGE_INTEGER fileSize;
+  BOOL result = ::GetFileSizeEx(m_fileHandle, &fileSize);
+  if (!result) {
+    ec = std::error_code(::GetLastError(), std::system_category());
+    return 0;
+  }
+
+  ec = std::error_code();
+  return static_cast<uint64_t>(fileSize.QuadPart);
+}
+
+uint64_t PositionalFile::size() const {
+  std::error_code ec;
+  uint64_t result = size(ec);
+  if (ec) {
+    throw std::system_error(ec, "PositionalFile::size");
+  }
+
+  return result;
+}
+
+void PositionalFile::read(uint64_t offset, void* data, size_t size, std::error_code& ec) const {
+  assert(isOpened());
+
+  uint8_t* buffer = static_cast<uint8_t*>(data);
+  while (size > 0) {
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD transferred = 0;
+    BOOL result = ::ReadFile(m_fileHandle, buffer, static_cast<DWORD>(std::min<size_t>(size, MAXDWORD)), &transferred, &overlapped);
+    if (!result) {
+      ec = std::error_code(::GetLastError(), std::system_category());
+      return;
+    }
+
+    if (transferred == 0) {
+      ec = std::make_error_code(std::errc::io_error);
+      return;
+    }
+
+    buffer += transferred;
+    offset += transferred;
+    size -= transferred;
+  }
+
+  ec = std::error_code();
+}
+
+void PositionalFile::read(uint64_t offset, void* data, size_t size) const {
+  std::error_code ec;
+  read(offset, data, size, ec);
+  if (ec) {
+    throw std::system_error(ec, "PositionalFile::read");
+  }
+}
+
+void PositionalFile::write(uint64_t offset, const void* data, size_t size, std::error_code& ec) {
+  assert(isOpened());
+
+  const uint8_t* buffer = static_cast<const uint8_t*>(data);
+  while (size > 0) {
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD transferred = 0;
+    BOOL result = ::WriteFile(m_fileHandle, buffer, static_cast<DWORD>(std::min<size_t>(size, MAXDWORD)), &transferred, &overlapped);
+    if (!result) {
+      ec = std::error_code(::GetLastError(), std::system_category());
+      return;
+    }
+
+    buffer += transferred;
+    offset += transferred;
+    size -= transferred;
+  }
+
+  ec = std::error_code();
+}
+
+void PositionalFile::write(uint64_t offset, const void* data, size_t size) {
+  std::error_code ec;
+  write(offset, data, size, ec);
+  if (ec) {
+    throw std::system_error(ec, "PositionalFile::write");
+  }
+}
+
+}
@@ -0,0 +1,53 @@
+// Copyright (c) 2012-2016, The CN developers, The Bytecoin developers
+// Copyright (c) 2017-2019, The CROAT.community developers
+//
+// This file is part of Bytecoin.
+//
+// Bytecoin is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Bytecoin is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Bytecoin.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <system_error>
+
+namespace System {
+
+// File accessed by explicit offsets, reads do not share a file position and may run concurrently.
+class PositionalFile {
+public:
+  PositionalFile();
+  ~PositionalFile();
+
+  void open(const std::string& path, bool create, std::error_code& ec);
+  void open(const std::string& path, bool create);
+  void close(std::error_code& ec);
+  void close();
+
+  const std::string& path() const;
+  uint64_t size(std::error_code& ec) const;
+  uint64_t size() const;
+  bool isOpened() const;
+
+  void read(uint64_t offset, void* data, size_t size, std::error_code& ec) const;
+  void read(uint64_t offset, void* data, size_t size) const;
+  void write(uint64_t offset, const void* data, size_t size, std::error_code& ec);
+  void write(uint64_t offset, const void* data, size_t size);
+
+private:
+  void* m_fileHandle;
+  std::string m_path;
+};
+
+}
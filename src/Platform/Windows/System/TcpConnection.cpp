@@ -161,10 +161,24 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
     return 0;
   }
 
-  WSABUF buf{static_cast<ULONG>(size), reinterpret_cast<char*>(const_cast<uint8_t*>(data))};
+  return write(nullptr, 0, data, size);
+}
+
+size_t TcpConnection::write(const uint8_t* head, size_t headSize, const uint8_t* data, size_t size) {
+  assert(dispatcher != nullptr);
+  assert(writeContext == nullptr);
+  if (dispatcher->interrupted()) {
+    throw InterruptedException();
+  }
+
+  assert(headSize + size != 0);
+  WSABUF bufs[2] = {
+    {static_cast<ULONG>(headSize), reinterpret_cast<char*>(const_cast<uint8_t*>(head))},
+    {static_cast<ULONG>(size), reinterpret_cast<char*>(const_cast<uint8_t*>(data))}
+  };
   TcpConnectionContext context;
   context.hEvent = NULL;
-  if (WSASend(connection, &buf, 1, NULL, 0, &context, NULL) != 0) {
+  if (WSASend(connection, bufs, 2, NULL, 0, &context, NULL) != 0) {
     int lastError = WSAGetLastError();
     if (lastError != WSA_IO_PENDING) {
       throw std::runtime_error("TcpConnection::write, WSASend failed, " + errorMessage(lastError));
@@ -210,7 +224,7 @@ size_t TcpConnection::write(const uint8_t* data, size_t size) {
     throw InterruptedException();
   }
 
-  assert(transferred == size);
+  assert(transferred == headSize + size);
   assert(flags == 0);
   return transferred;
 }
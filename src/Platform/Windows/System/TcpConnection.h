@@ -36,6 +36,8 @@ public:
   TcpConnection& operator=(TcpConnection&& other);
   size_t read(uint8_t* data, size_t size);
   size_t write(const uint8_t* data, size_t size);
+  // Writes from head, then from data, in one operation. Returns the number of bytes written from both.
+  size_t write(const uint8_t* head, size_t headSize, const uint8_t* data, size_t size);
   std::pair<Ipv4Address, uint16_t> getPeerAddressAndPort() const;
 
 private:
@@ -127,10 +127,12 @@ struct COMMAND_RPC_GET_POOL_CHANGES {
   struct request {
     Crypto::Hash tailBlockId;
     std::vector<Crypto::Hash> knownTxsIds;
+    uint64_t poolVersion;                    // poolVersion of the last response, 0 if none
 
     void serialize(ISerializer &s) {
       KV_MEMBER(tailBlockId)
       serializeAsBinary(knownTxsIds, "knownTxsIds", s);
+      KV_MEMBER(poolVersion)
     }
   };
 
@@ -138,12 +140,16 @@ struct COMMAND_RPC_GET_POOL_CHANGES {
     bool isTailBlockActual;
     std::vector<BinaryArray> addedTxs;          // Added transactions blobs
     std::vector<Crypto::Hash> deletedTxsIds; // IDs of not found transactions
+    uint64_t poolVersion;
+    bool isPoolVersionActual;                // the changes are relative to the requested poolVersion, not to knownTxsIds
     std::string status;
 
     void serialize(ISerializer &s) {
       KV_MEMBER(isTailBlockActual)
       KV_MEMBER(addedTxs)
       serializeAsBinary(deletedTxsIds, "deletedTxsIds", s);
+      KV_MEMBER(poolVersion)
+      KV_MEMBER(isPoolVersionActual)
       KV_MEMBER(status)
     }
   };
@@ -153,10 +159,12 @@ struct COMMAND_RPC_GET_POOL_CHANGES_LITE {
   struct request {
     Crypto::Hash tailBlockId;
     std::vector<Crypto::Hash> knownTxsIds;
+    uint64_t poolVersion;                    // poolVersion of the last response, 0 if none
 
     void serialize(ISerializer &s) {
       KV_MEMBER(tailBlockId)
       serializeAsBinary(knownTxsIds, "knownTxsIds", s);
+      KV_MEMBER(poolVersion)
     }
   };
 
@@ -164,12 +172,44 @@ struct COMMAND_RPC_GET_POOL_CHANGES_LITE {
     bool isTailBlockActual;
     std::vector<TransactionPrefixInfo> addedTxs;          // Added transactions blobs
     std::vector<Crypto::Hash> deletedTxsIds; // IDs of not found transactions
+    uint64_t poolVersion;
+    bool isPoolVersionActual;                // the changes are relative to the requested poolVersion, not to knownTxsIds
     std::string status;
 
     void serialize(ISerializer &s) {
       KV_MEMBER(isTailBlockActual)
       KV_MEMBER(addedTxs)
       serializeAsBinary(deletedTxsIds, "deletedTxsIds", s);
+      KV_MEMBER(poolVersion)
+      KV_MEMBER(isPoolVersionActual)
+      KV_MEMBER(status)
+    }
+  };
+};
+
+struct COMMAND_RPC_WAIT_FOR_CHANGES {
+  struct request {
+    Crypto::Hash tailBlockId;
+    uint64_t poolVersion;                    // 0 to wait for a new tail block only
+    uint32_t timeout;                        // milliseconds, limited by the node
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(tailBlockId)
+      KV_MEMBER(poolVersion)
+      KV_MEMBER(timeout)
+    }
+  };
+
+  struct response {
+    bool changed;                            // false if the timeout expired first
+    Crypto::Hash tailBlockId;
+    uint64_t poolVersion;
+    std::string status;
+
+    void serialize(ISerializer &s) {
+      KV_MEMBER(changed)
+      KV_MEMBER(tailBlockId)
+      KV_MEMBER(poolVersion)
       KV_MEMBER(status)
     }
   };
@@ -294,6 +334,12 @@ struct COMMAND_RPC_GET_INFO {
     uint8_t block_major_version;
     std::string already_generated_coins;
     std::string contact;   
+    uint64_t block_cache_hits;
+    uint64_t block_cache_misses;
+    uint64_t block_cache_evictions;
+    uint64_t block_cache_items;
+    uint64_t block_cache_size;
+    uint64_t block_cache_budget;
 
     void serialize(ISerializer &s) {
       KV_MEMBER(status)
@@ -322,6 +368,12 @@ struct COMMAND_RPC_GET_INFO {
       KV_MEMBER(block_major_version)
       KV_MEMBER(already_generated_coins)
       KV_MEMBER(contact)      
+      KV_MEMBER(block_cache_hits)
+      KV_MEMBER(block_cache_misses)
+      KV_MEMBER(block_cache_evictions)
+      KV_MEMBER(block_cache_items)
+      KV_MEMBER(block_cache_size)
+      KV_MEMBER(block_cache_budget)
     }
   };
 };
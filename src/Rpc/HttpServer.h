@@ -59,7 +59,7 @@ public:
   HttpServer(System::Dispatcher& dispatcher, Logging::ILogger& log);
 
   void start(const std::string& address, uint16_t port, const std::string& user = "", const std::string& password = "");
-  void stop();
+  virtual void stop();
 
   virtual void processRequest(const HttpRequest& request, HttpResponse& response) = 0;
   virtual size_t get_connections_count() const;
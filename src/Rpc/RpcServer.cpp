@@ -38,9 +38,13 @@
 #include "RpcServer.h"
 #include "version.h"
 
+#include <algorithm>
 #include <future>
 #include <unordered_map>
 
+#include <System/ContextGroupTimeout.h>
+#include <System/InterruptedException.h>
+
 // DynexCN
 #include "BlockchainExplorerData.h"
 #include "Common/StringTools.h"
@@ -68,6 +72,8 @@ namespace DynexCN {
 
 namespace {
 
+const uint32_t MAX_WAIT_FOR_CHANGES_TIMEOUT = 60000;
+
 template <typename Command>
 RpcServer::HandlerFunction binMethod(bool (RpcServer::*handler)(typename Command::request const&, typename Command::response&)) {
   return [handler](RpcServer* obj, const HttpRequest& request, HttpResponse& response) {
@@ -129,6 +135,7 @@ std::unordered_map<std::string, RpcServer::RpcHandler<RpcServer::HandlerFunction
   { "/peers", { jsonMethod<COMMAND_RPC_GET_PEER_LIST>(&RpcServer::on_get_peer_list), true } }, // deprecated
   { "/getpeers", { jsonMethod<COMMAND_RPC_GET_PEER_LIST>(&RpcServer::on_get_peer_list), true } },
   { "/paymentid", { jsonMethod<COMMAND_RPC_GEN_PAYMENT_ID>(&RpcServer::on_get_payment_id), true } },
+  { "/wait_for_changes", { jsonMethod<COMMAND_RPC_WAIT_FOR_CHANGES>(&RpcServer::onWaitForChanges), false } },
 
   // rpc post json handlers
   { "/gettransactions", { jsonMethod<COMMAND_RPC_GET_TRANSACTIONS>(&RpcServer::on_get_transactions), false } },
@@ -152,7 +159,43 @@ std::unordered_map<std::string, RpcServer::RpcHandler<RpcServer::HandlerFunction
 };
 
 RpcServer::RpcServer(System::Dispatcher& dispatcher, Logging::ILogger& log, core& c, NodeServer& p2p, IDynexCNProtocolQuery& protocolQuery) :
-  HttpServer(dispatcher, log), logger(log, "RpcServer"), m_core(c), m_p2p(p2p), m_protocolQuery(protocolQuery), blockchainExplorerDataBuilder(c, protocolQuery) {
+  HttpServer(dispatcher, log), logger(log, "RpcServer"), m_core(c), m_p2p(p2p), m_protocolQuery(protocolQuery), blockchainExplorerDataBuilder(c, protocolQuery),
+  m_statusSignal(std::make_shared<StatusSignal>(dispatcher)) {
+  m_core.addObserver(this);
+}
+
+RpcServer::~RpcServer() {
+  m_core.removeObserver(this);
+}
+
+void RpcServer::stop() {
+  // let waiting requests return before their connections are interrupted
+  m_statusSignal->stopped = true;
+  m_statusSignal->changed.set();
+  HttpServer::stop();
+}
+
+void RpcServer::blockchainUpdated() {
+  wakeUpStatusWaiters();
+}
+
+void RpcServer::poolUpdated() {
+  wakeUpStatusWaiters();
+}
+
+void RpcServer::wakeUpStatusWaiters() {
+  if (m_statusSignal->wakeUpQueued.exchange(true)) {
+    return;
+  }
+
+  std::shared_ptr<StatusSignal> signal = m_statusSignal;
+  m_dispatcher.remoteSpawn([signal] {
+    signal->wakeUpQueued = false;
+    if (!signal->stopped) {
+      signal->changed.set();
+      signal->changed.clear();
+    }
+  });
 }
 
 void RpcServer::processRequest(const HttpRequest& request, HttpResponse& response) {
@@ -472,7 +515,7 @@ bool RpcServer::on_get_random_outs(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOU
 bool RpcServer::onGetPoolChanges(const COMMAND_RPC_GET_POOL_CHANGES::request& req, COMMAND_RPC_GET_POOL_CHANGES::response& rsp) {
   rsp.status = CORE_RPC_STATUS_OK;
   std::vector<DynexCN::Transaction> addedTransactions;
-  rsp.isTailBlockActual = m_core.getPoolChanges(req.tailBlockId, req.knownTxsIds, addedTransactions, rsp.deletedTxsIds);
+  rsp.isTailBlockActual = m_core.getPoolChanges(req.tailBlockId, req.poolVersion, req.knownTxsIds, addedTransactions, rsp.deletedTxsIds, rsp.poolVersion, rsp.isPoolVersionActual);
   for (auto& tx : addedTransactions) {
     BinaryArray txBlob;
     if (!toBinaryArray(tx, txBlob)) {
@@ -488,11 +531,40 @@ bool RpcServer::onGetPoolChanges(const COMMAND_RPC_GET_POOL_CHANGES::request& re
 
 bool RpcServer::onGetPoolChangesLite(const COMMAND_RPC_GET_POOL_CHANGES_LITE::request& req, COMMAND_RPC_GET_POOL_CHANGES_LITE::response& rsp) {
   rsp.status = CORE_RPC_STATUS_OK;
-  rsp.isTailBlockActual = m_core.getPoolChangesLite(req.tailBlockId, req.knownTxsIds, rsp.addedTxs, rsp.deletedTxsIds);
+  rsp.isTailBlockActual = m_core.getPoolChangesLite(req.tailBlockId, req.poolVersion, req.knownTxsIds, rsp.addedTxs, rsp.deletedTxsIds, rsp.poolVersion, rsp.isPoolVersionActual);
 
   return true;
 }
 
+bool RpcServer::onWaitForChanges(const COMMAND_RPC_WAIT_FOR_CHANGES::request& req, COMMAND_RPC_WAIT_FOR_CHANGES::response& rsp) {
+  auto hasChanges = [this, &req] {
+    return m_core.get_tail_id() != req.tailBlockId || (req.poolVersion != 0 && m_core.get_pool_version() != req.poolVersion);
+  };
+
+  if (!hasChanges() && req.timeout != 0) {
+    System::ContextGroup waitGroup(m_dispatcher);
+    System::ContextGroupTimeout waitTimeout(m_dispatcher, waitGroup,
+      std::chrono::milliseconds(std::min(req.timeout, MAX_WAIT_FOR_CHANGES_TIMEOUT)));
+
+    waitGroup.spawn([this, &hasChanges] {
+      try {
+        while (!m_statusSignal->stopped && !hasChanges()) {
+          m_statusSignal->changed.wait();
+        }
+      } catch (System::InterruptedException&) {
+      }
+    });
+
+    waitGroup.wait();
+  }
+
+  rsp.changed = hasChanges();
+  rsp.tailBlockId = m_core.get_tail_id();
+  rsp.poolVersion = m_core.get_pool_version();
+  rsp.status = CORE_RPC_STATUS_OK;
+  return true;
+}
+
 bool RpcServer::onGetBlocksDetailsByHeights(const COMMAND_RPC_GET_BLOCKS_DETAILS_BY_HEIGHTS::request& req, COMMAND_RPC_GET_BLOCKS_DETAILS_BY_HEIGHTS::response& rsp) {
   std::vector<BlockDetails> blockDetails;
   for (const uint32_t& height : req.blockHeights) {
@@ -697,6 +769,14 @@ bool RpcServer::on_get_info(const COMMAND_RPC_GET_INFO::request& req, COMMAND_RP
   res.readable_tx_fee = m_core.currency().formatAmount(m_core.getMinimalFee());
   res.start_time = (uint64_t)m_core.getStartTime();
 
+  SwappedVectorCacheStats blockCacheStats = m_core.getBlockCacheStats();
+  res.block_cache_hits = blockCacheStats.hits;
+  res.block_cache_misses = blockCacheStats.misses;
+  res.block_cache_evictions = blockCacheStats.evictions;
+  res.block_cache_items = blockCacheStats.items;
+  res.block_cache_size = blockCacheStats.size;
+  res.block_cache_budget = blockCacheStats.budget;
+
   uint64_t alreadyGeneratedCoins = m_core.getTotalGeneratedAmount();
   // that large uint64_t number is unsafe in JavaScript environment and therefore as a JSON value so we display it as a formatted string
   res.already_generated_coins = m_core.currency().formatAmount(alreadyGeneratedCoins);
@@ -1018,21 +1098,22 @@ bool RpcServer::f_on_block_json(const F_COMMAND_RPC_GET_BLOCK_DETAILS::request&
 
 
   std::list<Crypto::Hash> missed_txs;
-  std::list<Transaction> txs;
+  std::list<CachedTransaction> txs;
   m_core.getTransactions(blk.transactionHashes, txs, missed_txs);
 
   res.block.totalFeeAmount = 0;
 
-  for (const Transaction& tx : txs) {
+  for (const CachedTransaction& cachedTransaction : txs) {
+    const Transaction& tx = cachedTransaction.getTransaction();
     f_transaction_short_response transaction_short;
     uint64_t amount_in = 0;
     get_inputs_money_amount(tx, amount_in);
     uint64_t amount_out = get_outs_money_amount(tx);
 
-    transaction_short.hash = Common::podToHex(getObjectHash(tx));
+    transaction_short.hash = Common::podToHex(cachedTransaction.getTransactionHash());
     transaction_short.fee = amount_in - amount_out;
     transaction_short.amount_out = amount_out;
-    transaction_short.size = getObjectBinarySize(tx);
+    transaction_short.size = cachedTransaction.getTransactionBinarySize();
     res.block.transactions.push_back(transaction_short);
 
     res.block.totalFeeAmount += transaction_short.fee;
@@ -1157,7 +1238,7 @@ bool RpcServer::f_on_mempool_json(const COMMAND_RPC_GET_MEMPOOL::request& req, C
   auto pool = m_core.getMemoryPool();
   for (const DynexCN::tx_memory_pool::TransactionDetails &txd : pool) {
     f_mempool_transaction_response mempool_transaction;
-    uint64_t amount_out = getOutputAmount(txd.tx);
+    uint64_t amount_out = getOutputAmount(txd.transaction.getTransaction());
 
     mempool_transaction.hash = Common::podToHex(txd.id);
     mempool_transaction.fee = txd.fee;
@@ -1181,7 +1262,7 @@ bool RpcServer::on_get_transactions_pool(const COMMAND_RPC_GET_TRANSACTIONS_POOL
     transaction_pool_response mempool_transaction;
     mempool_transaction.hash = Common::podToHex(txd.id);
     mempool_transaction.fee = txd.fee;
-    mempool_transaction.amount_out = getOutputAmount(txd.tx);
+    mempool_transaction.amount_out = getOutputAmount(txd.transaction.getTransaction());
     mempool_transaction.size = txd.blobSize;
     mempool_transaction.receiveTime = txd.receiveTime;
     res.transactions.push_back(mempool_transaction);
@@ -1332,7 +1413,7 @@ bool RpcServer::on_get_balance_of_address(const COMMAND_RPC_GET_BALANCE_OF_ADDRE
   }
   logger(Logging::DEBUGGING, Logging::WHITE) << "RPC request came: balance of address: " << req.address;
   
-  std::vector<Transaction> transactions;
+  std::vector<CachedTransaction> transactions;
 
   // valid address?
   AccountPublicAddress acc = boost::value_initialized<AccountPublicAddress>();
@@ -1356,9 +1437,10 @@ bool RpcServer::on_get_balance_of_address(const COMMAND_RPC_GET_BALANCE_OF_ADDRE
   int64_t balance = 0;
   bool legacy_wallet = false;
 
-  for (const Transaction& tx : transactions) {
+  for (const CachedTransaction& cachedTransaction : transactions) {
+    const Transaction& tx = cachedTransaction.getTransaction();
     TransactionDetails transactionDetails;
-    if (!blockchainExplorerDataBuilder.fillTransactionDetails(tx, transactionDetails)) {
+    if (!blockchainExplorerDataBuilder.fillTransactionDetails(cachedTransaction, transactionDetails)) {
         throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_INTERNAL_ERROR,
           "Internal error: can't fill transaction details." };
     }
@@ -1425,7 +1507,7 @@ bool RpcServer::on_get_transactions_by_address(const COMMAND_RPC_GET_TRANSACTION
   }
   logger(Logging::DEBUGGING, Logging::WHITE) << "RPC request came: Search by address: " << req.address;
 
-  std::vector<Transaction> transactions;
+  std::vector<CachedTransaction> transactions;
 
   // valid address?
   AccountPublicAddress acc = boost::value_initialized<AccountPublicAddress>();
@@ -1446,20 +1528,21 @@ bool RpcServer::on_get_transactions_by_address(const COMMAND_RPC_GET_TRANSACTION
   uint32_t fromblock = req.height;
   if (fromblock > m_core.get_current_blockchain_height() ) fromblock = 0;
 
-  for (const Transaction& tx : transactions) {
+  for (const CachedTransaction& cachedTransaction : transactions) {
+    const Transaction& tx = cachedTransaction.getTransaction();
     f_transaction_short_response transaction_short;
     uint64_t amount_in = 0;
     get_inputs_money_amount(tx, amount_in);
     uint64_t amount_out = get_outs_money_amount(tx);
 
-    transaction_short.hash = Common::podToHex(getObjectHash(tx));
+    transaction_short.hash = Common::podToHex(cachedTransaction.getTransactionHash());
     transaction_short.fee = amount_in - amount_out;
     transaction_short.amount_out = amount_out;
-    transaction_short.size = getObjectBinarySize(tx);
+    transaction_short.size = cachedTransaction.getTransactionBinarySize();
 
     // non-privacy fields:
     TransactionDetails transactionDetails;
-    if (!blockchainExplorerDataBuilder.fillTransactionDetails(tx, transactionDetails)) {
+    if (!blockchainExplorerDataBuilder.fillTransactionDetails(cachedTransaction, transactionDetails)) {
         throw JsonRpc::JsonRpcError{ CORE_RPC_ERROR_CODE_INTERNAL_ERROR,
           "Internal error: can't fill transaction details." };
     }
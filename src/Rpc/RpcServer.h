@@ -39,13 +39,16 @@
 
 #include "HttpServer.h"
 
+#include <atomic>
 #include <functional>
+#include <memory>
 #include <unordered_map>
 
 #include <Logging/LoggerRef.h>
 #include "ITransaction.h"
 #include "CoreRpcServerCommandsDefinitions.h"
 #include "BlockchainExplorer/BlockchainExplorerDataBuilder.h"
+#include "DynexCNCore/ICoreObserver.h"
 
 #include "Common/Math.h"
 
@@ -56,9 +59,12 @@ class NodeServer;
 class BlockchainExplorer;
 class IDynexCNProtocolQuery;
 
-class RpcServer : public HttpServer {
+class RpcServer : public HttpServer, private ICoreObserver {
 public:
   RpcServer(System::Dispatcher& dispatcher, Logging::ILogger& log, core& c, NodeServer& p2p, IDynexCNProtocolQuery& protocolQuery);
+  ~RpcServer();
+
+  virtual void stop() override;
 
   typedef std::function<bool(RpcServer*, const HttpRequest& request, HttpResponse& response)> HandlerFunction;
   bool restrictRPC(const bool is_resctricted);
@@ -84,6 +90,11 @@ private:
   bool processJsonRpcRequest(const HttpRequest& request, HttpResponse& response);
   bool isCoreReady();
 
+  // ICoreObserver
+  virtual void blockchainUpdated() override;
+  virtual void poolUpdated() override;
+  void wakeUpStatusWaiters();
+
   // binary handlers
   bool on_get_blocks(const COMMAND_RPC_GET_BLOCKS_FAST::request& req, COMMAND_RPC_GET_BLOCKS_FAST::response& res);
   bool on_query_blocks(const COMMAND_RPC_QUERY_BLOCKS::request& req, COMMAND_RPC_QUERY_BLOCKS::response& res);
@@ -111,6 +122,7 @@ private:
   bool onGetTransactionDetailsByHash(const COMMAND_RPC_GET_TRANSACTION_DETAILS_BY_HASH::request& req, COMMAND_RPC_GET_TRANSACTION_DETAILS_BY_HASH::response& rsp);
   bool onGetTransactionHashesByPaymentId(const COMMAND_RPC_GET_TRANSACTION_HASHES_BY_PAYMENT_ID::request& req, COMMAND_RPC_GET_TRANSACTION_HASHES_BY_PAYMENT_ID::response& rsp);
   bool on_get_peers(const COMMAND_RPC_GET_PEER_LIST::request& req, COMMAND_RPC_GET_PEER_LIST::response& res);
+  bool onWaitForChanges(const COMMAND_RPC_WAIT_FOR_CHANGES::request& req, COMMAND_RPC_WAIT_FOR_CHANGES::response& rsp);
 
   // json rpc
   bool on_getblockcount(const COMMAND_RPC_GETBLOCKCOUNT::request& req, COMMAND_RPC_GETBLOCKCOUNT::response& res);
@@ -155,6 +167,18 @@ private:
   std::string m_contact_info;
   Crypto::SecretKey m_view_key = NULL_SECRET_KEY;
   AccountPublicAddress m_fee_acc;
+
+  // Core notifications may come from other threads, so the waiters are woken by a procedure
+  // spawned on the dispatcher, which shares this state in case it runs after the server is gone.
+  struct StatusSignal {
+    explicit StatusSignal(System::Dispatcher& dispatcher) : changed(dispatcher), wakeUpQueued(false), stopped(false) {}
+
+    System::Event changed;
+    std::atomic<bool> wakeUpQueued;
+    bool stopped;
+  };
+
+  std::shared_ptr<StatusSignal> m_statusSignal;
 };
 
 }
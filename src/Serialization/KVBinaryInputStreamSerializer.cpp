@@ -19,179 +19,390 @@ using namespace DynexCN;
 
 namespace {
 
+size_t valueSize(uint8_t type) {
+  switch (type) {
+  case BIN_KV_SERIALIZE_TYPE_INT64:  return sizeof(int64_t);
+  case BIN_KV_SERIALIZE_TYPE_INT32:  return sizeof(int32_t);
+  case BIN_KV_SERIALIZE_TYPE_INT16:  return sizeof(int16_t);
+  case BIN_KV_SERIALIZE_TYPE_INT8:   return sizeof(int8_t);
+  case BIN_KV_SERIALIZE_TYPE_UINT64: return sizeof(uint64_t);
+  case BIN_KV_SERIALIZE_TYPE_UINT32: return sizeof(uint32_t);
+  case BIN_KV_SERIALIZE_TYPE_UINT16: return sizeof(uint16_t);
+  case BIN_KV_SERIALIZE_TYPE_UINT8:  return sizeof(uint8_t);
+  case BIN_KV_SERIALIZE_TYPE_DOUBLE: return sizeof(double);
+  case BIN_KV_SERIALIZE_TYPE_BOOL:   return sizeof(uint8_t);
+  default:
+    return 0;
+  }
+}
+
 template <typename T>
-T readPod(Common::IInputStream& s) {
+T readValue(const char* data) {
   T v;
-  read(s, &v, sizeof(T));
+  memcpy(&v, data, sizeof(T));
   return v;
 }
 
-template <typename T, typename JsonT = T>
-JsonValue readPodJson(Common::IInputStream& s) {
-  JsonValue jv;
-  jv = static_cast<JsonT>(readPod<T>(s));
-  return jv;
 }
 
-template <typename T>
-JsonValue readIntegerJson(Common::IInputStream& s) {
-  return readPodJson<T, int64_t>(s);
-}
+class KVBinaryInputStreamSerializer::PayloadReader {
+public:
+  PayloadReader(const char* data, size_t size) : m_begin(data), m_data(data), m_end(data + size) {
+  }
 
-size_t readVarint(Common::IInputStream& s) {
-  uint8_t b = read<uint8_t>(s);
-  uint8_t size_mask = b & PORTABLE_RAW_SIZE_MARK_MASK;
-  size_t bytesLeft = 0;
+  const char* take(size_t size) {
+    if (size > static_cast<size_t>(m_end - m_data)) {
+      throw std::runtime_error("Unexpected end of binary storage");
+    }
 
-  switch (size_mask){
-  case PORTABLE_RAW_SIZE_MARK_BYTE:
-    bytesLeft = 0;
-    break;
-  case PORTABLE_RAW_SIZE_MARK_WORD:
-    bytesLeft = 1;
-    break;
-  case PORTABLE_RAW_SIZE_MARK_DWORD:
-    bytesLeft = 3;
-    break;
-  case PORTABLE_RAW_SIZE_MARK_INT64:
-    bytesLeft = 7;
-    break;
+    const char* data = m_data;
+    m_data += size;
+    return data;
   }
 
-  size_t value = b;
+  template <typename T>
+  T readPod() {
+    return readValue<T>(take(sizeof(T)));
+  }
 
-  for (size_t i = 1; i <= bytesLeft; ++i) {
-    size_t n = read<uint8_t>(s);
-    value |= n << (i * 8);
+  size_t readVarint() {
+    uint8_t b = readPod<uint8_t>();
+    uint8_t size_mask = b & PORTABLE_RAW_SIZE_MARK_MASK;
+    size_t bytesLeft = 0;
+
+    switch (size_mask){
+    case PORTABLE_RAW_SIZE_MARK_BYTE:
+      bytesLeft = 0;
+      break;
+    case PORTABLE_RAW_SIZE_MARK_WORD:
+      bytesLeft = 1;
+      break;
+    case PORTABLE_RAW_SIZE_MARK_DWORD:
+      bytesLeft = 3;
+      break;
+    case PORTABLE_RAW_SIZE_MARK_INT64:
+      bytesLeft = 7;
+      break;
+    }
+
+    size_t value = b;
+
+    for (size_t i = 1; i <= bytesLeft; ++i) {
+      size_t n = readPod<uint8_t>();
+      value |= n << (i * 8);
+    }
+
+    value >>= 2;
+    return value;
   }
 
-  value >>= 2;
-  return value;
-}
+  // every entry and array item takes at least one byte, so a count can never exceed what is left
+  size_t readCount() {
+    size_t count = readVarint();
+    if (count > static_cast<size_t>(m_end - m_data)) {
+      throw std::runtime_error("Binary storage element count is too big");
+    }
 
-std::string readString(Common::IInputStream& s) {
-  auto size = readVarint(s);
+    return count;
+  }
+
+  size_t consumed() const {
+    return static_cast<size_t>(m_data - m_begin);
+  }
 
-  std::string str;
-  str.resize(size);
-  if (size) {
-    read(s, &str[0], size);
+private:
+  const char* m_begin;
+  const char* m_data;
+  const char* m_end;
+};
+
+KVBinaryInputStreamSerializer::KVBinaryInputStreamSerializer(Common::IInputStream& strm) {
+  char chunk[4096];
+  for (;;) {
+    size_t size = strm.readSome(chunk, sizeof(chunk));
+    if (size == 0) {
+      break;
+    }
+
+    m_buffer.insert(m_buffer.end(), chunk, chunk + size);
   }
-  return str;
+
+  parse(m_buffer.data(), m_buffer.size());
 }
 
-JsonValue readStringJson(Common::IInputStream& s) {
-  return JsonValue(readString(s));
+KVBinaryInputStreamSerializer::KVBinaryInputStreamSerializer(Common::MemoryInputStream& strm) {
+  strm.skip(parse(static_cast<const char*>(strm.unreadData()), strm.unreadSize()));
 }
 
-void readName(Common::IInputStream& s, std::string& name) {
-  uint8_t len = readPod<uint8_t>(s);
-  if (len) {
-    name.resize(len);
-    read(s, &name[0], len);
+size_t KVBinaryInputStreamSerializer::parse(const char* data, size_t size) {
+  PayloadReader reader(data, size);
+  auto hdr = reader.readPod<KVBinaryStorageBlockHeader>();
+
+  if (
+    hdr.m_signature_a != PORTABLE_STORAGE_SIGNATUREA ||
+    hdr.m_signature_b != PORTABLE_STORAGE_SIGNATUREB) {
+    throw std::runtime_error("Invalid binary storage signature");
   }
-}
 
-JsonValue loadValue(Common::IInputStream& stream, uint8_t type);
-JsonValue loadSection(Common::IInputStream& stream);
-JsonValue loadEntry(Common::IInputStream& stream);
-JsonValue loadArray(Common::IInputStream& stream, uint8_t itemType);
+  if (hdr.m_ver != PORTABLE_STORAGE_FORMAT_VER) {
+    throw std::runtime_error("Unknown binary storage format version");
+  }
 
+  loadSection(reader, StringView::NIL);
+  m_chain.push_back(Level{ 0, 1 });
+  return reader.consumed();
+}
 
-JsonValue loadSection(Common::IInputStream& stream) {
-  JsonValue sec(JsonValue::OBJECT);
-  size_t count = readVarint(stream);
-  std::string name;
+void KVBinaryInputStreamSerializer::loadSection(PayloadReader& reader, StringView name) {
+  size_t index = m_entries.size();
+  size_t count = reader.readCount();
+  m_entries.push_back(Entry{ name, BIN_KV_SERIALIZE_TYPE_OBJECT, false, count, nullptr, 0, 0 });
 
   while (count--) {
-    readName(stream, name);
-    sec.insert(name, loadEntry(stream));
+    uint8_t len = reader.readPod<uint8_t>();
+    const char* entryName = reader.take(len);
+    loadEntry(reader, StringView(entryName, len));
   }
 
-  return sec;
+  m_entries[index].end = m_entries.size();
 }
 
-JsonValue loadValue(Common::IInputStream& stream, uint8_t type) {
+void KVBinaryInputStreamSerializer::loadEntry(PayloadReader& reader, StringView name) {
+  uint8_t type = reader.readPod<uint8_t>();
+
+  if (type & BIN_KV_SERIALIZE_FLAG_ARRAY) {
+    type &= ~BIN_KV_SERIALIZE_FLAG_ARRAY;
+    loadArray(reader, name, type);
+    return;
+  }
+
+  loadValue(reader, name, type);
+}
+
+void KVBinaryInputStreamSerializer::loadValue(PayloadReader& reader, StringView name, uint8_t type) {
   switch (type) {
-  case BIN_KV_SERIALIZE_TYPE_INT64:  return readIntegerJson<int64_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_INT32:  return readIntegerJson<int32_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_INT16:  return readIntegerJson<int16_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_INT8:   return readIntegerJson<int8_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_UINT64: return readIntegerJson<uint64_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_UINT32: return readIntegerJson<uint32_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_UINT16: return readIntegerJson<uint16_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_UINT8:  return readIntegerJson<uint8_t>(stream);
-  case BIN_KV_SERIALIZE_TYPE_DOUBLE: return readPodJson<double>(stream);
-  case BIN_KV_SERIALIZE_TYPE_BOOL:   return JsonValue(read<uint8_t>(stream) != 0);
-  case BIN_KV_SERIALIZE_TYPE_STRING: return readStringJson(stream);
-  case BIN_KV_SERIALIZE_TYPE_OBJECT: return loadSection(stream);
-  case BIN_KV_SERIALIZE_TYPE_ARRAY:  return loadArray(stream, type);
-  default:
-    throw std::runtime_error("Unknown data type");
+  case BIN_KV_SERIALIZE_TYPE_STRING: {
+    size_t size = reader.readVarint();
+    const char* data = reader.take(size);
+    m_entries.push_back(Entry{ name, type, false, 0, data, size, m_entries.size() + 1 });
+    break;
+  }
+  case BIN_KV_SERIALIZE_TYPE_OBJECT:
+    loadSection(reader, name);
+    break;
+  case BIN_KV_SERIALIZE_TYPE_ARRAY:
+    // an array nested in an array carries its own item type
+    loadEntry(reader, name);
     break;
+  default: {
+    size_t size = valueSize(type);
+    if (size == 0) {
+      throw std::runtime_error("Unknown data type");
+    }
+
+    m_entries.push_back(Entry{ name, type, false, 0, reader.take(size), size, m_entries.size() + 1 });
+    break;
+  }
   }
 }
 
-JsonValue loadEntry(Common::IInputStream& stream) {
-  uint8_t type = readPod<uint8_t>(stream);
+void KVBinaryInputStreamSerializer::loadArray(PayloadReader& reader, StringView name, uint8_t itemType) {
+  size_t index = m_entries.size();
+  size_t count = reader.readCount();
+  m_entries.push_back(Entry{ name, itemType, true, count, nullptr, 0, 0 });
 
-  if (type & BIN_KV_SERIALIZE_FLAG_ARRAY) {
-    type &= ~BIN_KV_SERIALIZE_FLAG_ARRAY;
-    return loadArray(stream, type);
+  while (count--) {
+    loadValue(reader, StringView::NIL, itemType);
   }
 
-  return loadValue(stream, type);
+  m_entries[index].end = m_entries.size();
 }
 
-JsonValue loadArray(Common::IInputStream& stream, uint8_t itemType) {
-  JsonValue arr(JsonValue::ARRAY);
-  size_t count = readVarint(stream);
+ISerializer::SerializerType KVBinaryInputStreamSerializer::type() const {
+  return ISerializer::INPUT;
+}
 
-  while (count--) {
-    arr.pushBack(loadValue(stream, itemType));
+bool KVBinaryInputStreamSerializer::beginObject(StringView name) {
+  const Entry* entry = getValue(name);
+  if (entry == nullptr) {
+    return false;
   }
 
-  return arr;
+  if (entry->isArray || entry->type != BIN_KV_SERIALIZE_TYPE_OBJECT) {
+    throw std::runtime_error("Binary storage value is not an object");
+  }
+
+  size_t index = static_cast<size_t>(entry - m_entries.data());
+  m_chain.push_back(Level{ index, index + 1 });
+  return true;
 }
 
+void KVBinaryInputStreamSerializer::endObject() {
+  assert(!m_chain.empty());
+  m_chain.pop_back();
+}
 
-JsonValue parseBinary(Common::IInputStream& stream) {
-  auto hdr = readPod<KVBinaryStorageBlockHeader>(stream);
+bool KVBinaryInputStreamSerializer::beginArray(size_t& size, StringView name) {
+  const Entry* entry = getValue(name);
+  if (entry == nullptr) {
+    size = 0;
+    return false;
+  }
 
-  if (
-    hdr.m_signature_a != PORTABLE_STORAGE_SIGNATUREA ||
-    hdr.m_signature_b != PORTABLE_STORAGE_SIGNATUREB) {
-    throw std::runtime_error("Invalid binary storage signature");
+  if (!entry->isArray) {
+    throw std::runtime_error("Binary storage value is not an array");
   }
 
-  if (hdr.m_ver != PORTABLE_STORAGE_FORMAT_VER) {
-    throw std::runtime_error("Unknown binary storage format version");
+  size_t index = static_cast<size_t>(entry - m_entries.data());
+  size = entry->count;
+  m_chain.push_back(Level{ index, index + 1 });
+  return true;
+}
+
+void KVBinaryInputStreamSerializer::endArray() {
+  assert(!m_chain.empty());
+  m_chain.pop_back();
+}
+
+bool KVBinaryInputStreamSerializer::operator()(uint16_t& value, StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(int16_t& value, StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(uint32_t& value, StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(int32_t& value, StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(int64_t& value, StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(uint64_t& value, StringView name) {
+  return getNumber(name, value);
+}
+
+bool KVBinaryInputStreamSerializer::operator()(double& value, StringView name) {
+  auto ptr = getValue(name);
+  if (ptr == nullptr) {
+    return false;
   }
 
-  return loadSection(stream);
+  value = ptr->type == BIN_KV_SERIALIZE_TYPE_DOUBLE ? readValue<double>(ptr->data) : static_cast<double>(getInteger(*ptr));
+  return true;
 }
 
+bool KVBinaryInputStreamSerializer::operator()(uint8_t& value, StringView name) {
+  return getNumber(name, value);
 }
 
-KVBinaryInputStreamSerializer::KVBinaryInputStreamSerializer(Common::IInputStream& strm) : JsonInputValueSerializer(parseBinary(strm)) {
+bool KVBinaryInputStreamSerializer::operator()(std::string& value, StringView name) {
+  auto ptr = getValue(name);
+  if (ptr == nullptr) {
+    return false;
+  }
+
+  if (ptr->isArray || ptr->type != BIN_KV_SERIALIZE_TYPE_STRING) {
+    throw std::runtime_error("Binary storage value is not a string");
+  }
+
+  value.assign(ptr->data, ptr->size);
+  return true;
 }
 
-bool KVBinaryInputStreamSerializer::binary(void* value, size_t size, Common::StringView name) {
-  std::string str;
+bool KVBinaryInputStreamSerializer::operator()(bool& value, StringView name) {
+  auto ptr = getValue(name);
+  if (ptr == nullptr) {
+    return false;
+  }
+
+  if (ptr->isArray || ptr->type != BIN_KV_SERIALIZE_TYPE_BOOL) {
+    throw std::runtime_error("Binary storage value is not a bool");
+  }
+
+  value = readValue<uint8_t>(ptr->data) != 0;
+  return true;
+}
 
-  if (!(*this)(str, name)) {
+bool KVBinaryInputStreamSerializer::binary(void* value, size_t size, StringView name) {
+  auto ptr = getValue(name);
+  if (ptr == nullptr) {
     return false;
   }
 
-  if (str.size() != size) {
+  if (ptr->isArray || ptr->type != BIN_KV_SERIALIZE_TYPE_STRING) {
+    throw std::runtime_error("Binary storage value is not a string");
+  }
+
+  if (ptr->size != size) {
     throw std::runtime_error("Binary block size mismatch");
   }
 
-  memcpy(value, str.data(), size);
+  memcpy(value, ptr->data, size);
   return true;
 }
 
-bool KVBinaryInputStreamSerializer::binary(std::string& value, Common::StringView name) {
+bool KVBinaryInputStreamSerializer::binary(std::string& value, StringView name) {
   return (*this)(value, name); // load as string
 }
 
+const KVBinaryInputStreamSerializer::Entry* KVBinaryInputStreamSerializer::getValue(StringView name) {
+  assert(!m_chain.empty());
+  Level& level = m_chain.back();
+  const Entry& parent = m_entries[level.entry];
+
+  if (parent.isArray) {
+    if (level.next >= parent.end) {
+      throw std::runtime_error("Binary storage array index is out of range");
+    }
+
+    const Entry* item = &m_entries[level.next];
+    level.next = item->end;
+    return item;
+  }
+
+  // Names are usually asked for in the order they were stored in, so the lookup starts after
+  // the entry found last and wraps around to the first one.
+  size_t first = level.entry + 1;
+  size_t start = level.next < parent.end ? level.next : first;
+  for (size_t index = start; index < parent.end; index = m_entries[index].end) {
+    if (m_entries[index].name == name) {
+      level.next = m_entries[index].end;
+      return &m_entries[index];
+    }
+  }
+
+  for (size_t index = first; index < start; index = m_entries[index].end) {
+    if (m_entries[index].name == name) {
+      level.next = m_entries[index].end;
+      return &m_entries[index];
+    }
+  }
+
+  return nullptr;
+}
+
+int64_t KVBinaryInputStreamSerializer::getInteger(const Entry& entry) const {
+  if (entry.isArray) {
+    throw std::runtime_error("Binary storage value is not an integer");
+  }
+
+  switch (entry.type) {
+  case BIN_KV_SERIALIZE_TYPE_INT64:  return readValue<int64_t>(entry.data);
+  case BIN_KV_SERIALIZE_TYPE_INT32:  return readValue<int32_t>(entry.data);
+  case BIN_KV_SERIALIZE_TYPE_INT16:  return readValue<int16_t>(entry.data);
+  case BIN_KV_SERIALIZE_TYPE_INT8:   return readValue<int8_t>(entry.data);
+  case BIN_KV_SERIALIZE_TYPE_UINT64: return static_cast<int64_t>(readValue<uint64_t>(entry.data));
+  case BIN_KV_SERIALIZE_TYPE_UINT32: return readValue<uint32_t>(entry.data);
+  case BIN_KV_SERIALIZE_TYPE_UINT16: return readValue<uint16_t>(entry.data);
+  case BIN_KV_SERIALIZE_TYPE_UINT8:  return readValue<uint8_t>(entry.data);
+  default:
+    throw std::runtime_error("Binary storage value is not an integer");
+  }
+}
@@ -18,18 +18,90 @@
 
 #pragma once
 
+#include <vector>
 #include <Common/IInputStream.h>
+#include <Common/MemoryInputStream.h>
 #include "ISerializer.h"
-#include "JsonInputValueSerializer.h"
 
 namespace DynexCN {
 
-class KVBinaryInputStreamSerializer : public JsonInputValueSerializer {
+// Indexes the whole portable storage payload in one pass and then deserializes straight from
+// the payload. Read from a MemoryInputStream, the payload is indexed in place, so strings and
+// binary blocks are copied only once, into the value they are read into.
+class KVBinaryInputStreamSerializer : public ISerializer {
 public:
+  // reads the stream to its end
   KVBinaryInputStreamSerializer(Common::IInputStream& strm);
+  KVBinaryInputStreamSerializer(Common::MemoryInputStream& strm);
 
+  virtual ISerializer::SerializerType type() const override;
+
+  virtual bool beginObject(Common::StringView name) override;
+  virtual void endObject() override;
+
+  virtual bool beginArray(size_t& size, Common::StringView name) override;
+  virtual void endArray() override;
+
+  virtual bool operator()(uint8_t& value, Common::StringView name) override;
+  virtual bool operator()(int16_t& value, Common::StringView name) override;
+  virtual bool operator()(uint16_t& value, Common::StringView name) override;
+  virtual bool operator()(int32_t& value, Common::StringView name) override;
+  virtual bool operator()(uint32_t& value, Common::StringView name) override;
+  virtual bool operator()(int64_t& value, Common::StringView name) override;
+  virtual bool operator()(uint64_t& value, Common::StringView name) override;
+  virtual bool operator()(double& value, Common::StringView name) override;
+  virtual bool operator()(bool& value, Common::StringView name) override;
+  virtual bool operator()(std::string& value, Common::StringView name) override;
   virtual bool binary(void* value, size_t size, Common::StringView name) override;
   virtual bool binary(std::string& value, Common::StringView name) override;
+
+  template<typename T>
+  bool operator()(T& value, Common::StringView name) {
+    return ISerializer::operator()(value, name);
+  }
+
+private:
+  class PayloadReader;
+
+  struct Entry {
+    Common::StringView name;
+    uint8_t type;
+    bool isArray;
+    size_t count;      // entries of a section, items of an array
+    const char* data;  // value of a scalar or a string
+    size_t size;
+    size_t end;        // index of the entry following this one and everything it contains
+  };
+
+  struct Level {
+    size_t entry;
+    size_t next;  // array item to read next, or section entry to look up a name from first
+  };
+
+  size_t parse(const char* data, size_t size);
+  void loadSection(PayloadReader& reader, Common::StringView name);
+  void loadEntry(PayloadReader& reader, Common::StringView name);
+  void loadValue(PayloadReader& reader, Common::StringView name, uint8_t type);
+  void loadArray(PayloadReader& reader, Common::StringView name, uint8_t itemType);
+
+  const Entry* getValue(Common::StringView name);
+  int64_t getInteger(const Entry& entry) const;
+
+  template <typename T>
+  bool getNumber(Common::StringView name, T& v) {
+    auto ptr = getValue(name);
+
+    if (!ptr) {
+      return false;
+    }
+
+    v = static_cast<T>(getInteger(*ptr));
+    return true;
+  }
+
+  std::vector<char> m_buffer;
+  std::vector<Entry> m_entries;
+  std::vector<Level> m_chain;
 };
 
 }
@@ -0,0 +1,194 @@
+// Copyright (c) 2021-2023, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+#pragma once
+
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#include <DynexCN.h>
+
+namespace DynexCN {
+
+// Writes the format of BinaryOutputStreamSerializer for types that know their fields at compile
+// time, without a virtual call per field. Constructed without an output it only counts the bytes.
+class StaticBinaryWriter {
+public:
+  explicit StaticBinaryWriter(BinaryArray& output) : m_output(&output), m_size(0) {
+  }
+
+  StaticBinaryWriter() : m_output(nullptr), m_size(0) {
+  }
+
+  void varint(uint64_t value) {
+    while (value >= 0x80) {
+      byte(static_cast<uint8_t>(value | 0x80));
+      value >>= 7;
+    }
+
+    byte(static_cast<uint8_t>(value));
+  }
+
+  void byte(uint8_t value) {
+    if (m_output != nullptr) {
+      m_output->push_back(value);
+    }
+
+    ++m_size;
+  }
+
+  void binary(const void* data, size_t size) {
+    if (m_output != nullptr) {
+      const uint8_t* begin = static_cast<const uint8_t*>(data);
+      m_output->insert(m_output->end(), begin, begin + size);
+    }
+
+    m_size += size;
+  }
+
+  template <typename T>
+  void pod(const T& value) {
+    binary(&value, sizeof(value));
+  }
+
+  // a size prefixed string, as ISerializer::binary(std::string&) writes it
+  void blob(const void* data, size_t size) {
+    varint(size);
+    binary(data, size);
+  }
+
+  size_t size() const {
+    return m_size;
+  }
+
+private:
+  BinaryArray* m_output;
+  size_t m_size;
+};
+
+// Reads what StaticBinaryWriter or BinaryOutputStreamSerializer wrote, with the checks of
+// BinaryInputStreamSerializer.
+class StaticBinaryReader {
+public:
+  StaticBinaryReader(const void* data, size_t size) :
+    m_data(static_cast<const uint8_t*>(data)), m_end(static_cast<const uint8_t*>(data) + size) {
+  }
+
+  // Same limits as Common::readVarint: no overflow of T and no redundant trailing zero bytes.
+  template <typename T>
+  void varint(T& value) {
+    static_assert(std::is_unsigned<T>::value, "StaticBinaryReader::varint reads unsigned values");
+    T temp = 0;
+    for (uint8_t shift = 0;; shift += 7) {
+      uint8_t piece = byte();
+      if (shift >= sizeof(temp) * 8 - 7 && piece >= 1 << (sizeof(temp) * 8 - shift)) {
+        throw std::runtime_error("readVarint, value overflow");
+      }
+
+      temp |= static_cast<T>(static_cast<uint64_t>(piece & 0x7f) << shift);
+      if ((piece & 0x80) == 0) {
+        if (piece == 0 && shift != 0) {
+          throw std::runtime_error("readVarint, invalid value representation");
+        }
+
+        break;
+      }
+    }
+
+    value = temp;
+  }
+
+  // The number of elements that follow. Each of them takes at least minSize bytes, so a count
+  // that does not fit in what is left is rejected before anything is allocated for it.
+  size_t count(size_t minSize = 1) {
+    uint64_t value;
+    varint(value);
+    if (minSize != 0 && value > remaining() / minSize) {
+      throw std::runtime_error("Failed to read from IInputStream");
+    }
+
+    return static_cast<size_t>(value);
+  }
+
+  uint8_t byte() {
+    return *take(1);
+  }
+
+  void binary(void* data, size_t size) {
+    memcpy(data, take(size), size);
+  }
+
+  template <typename T>
+  void pod(T& value) {
+    binary(&value, sizeof(value));
+  }
+
+  // a size prefixed string, returned in place
+  const uint8_t* blob(size_t& size) {
+    size = count();
+    return take(size);
+  }
+
+  const uint8_t* take(size_t size) {
+    if (size > remaining()) {
+      throw std::runtime_error("Failed to read from IInputStream");
+    }
+
+    const uint8_t* data = m_data;
+    m_data += size;
+    return data;
+  }
+
+  const uint8_t* data() const {
+    return m_data;
+  }
+
+  size_t remaining() const {
+    return static_cast<size_t>(m_end - m_data);
+  }
+
+  bool endOfData() const {
+    return m_data == m_end;
+  }
+
+private:
+  const uint8_t* m_data;
+  const uint8_t* m_end;
+};
+
+}
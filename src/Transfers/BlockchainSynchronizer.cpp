@@ -37,6 +37,7 @@
 
 #include "BlockchainSynchronizer.h"
 
+#include <algorithm>
 #include <functional>
 #include <iostream>
 #include <sstream>
@@ -308,6 +309,7 @@ void BlockchainSynchronizer::actualizeFutureState() {
   m_currentState = m_futureState;
   switch (m_futureState) {
   case State::stopped:
+    m_prefetchedBlocks.reset();
     break;
   case State::deleteOldTxs:
     m_futureState = State::blockchainSync;
@@ -466,42 +468,102 @@ BlockchainSynchronizer::GetBlocksRequest BlockchainSynchronizer::getCommonHistor
 void BlockchainSynchronizer::startBlockchainSync() {
   m_logger(DEBUGGING) << "Starting blockchain synchronization...";
 
-  GetBlocksResponse response;
-  GetBlocksRequest req = getCommonHistory();
+  std::shared_ptr<BlocksQuery> query = std::move(m_prefetchedBlocks);
+  bool prefetched = query != nullptr;
 
   try {
-    if (!req.knownBlocks.empty()) {
-      auto queryBlocksCompleted = std::promise<std::error_code>();
-      auto queryBlocksWaitFuture = queryBlocksCompleted.get_future();
-
-      m_node.queryBlocks(
-        std::move(req.knownBlocks),
-        req.syncStart.timestamp,
-        response.newBlocks,
-        response.startHeight,
-        [&queryBlocksCompleted](std::error_code ec) {
-          auto detachedPromise = std::move(queryBlocksCompleted);
-          detachedPromise.set_value(ec);
-        });
-
-      std::error_code ec = queryBlocksWaitFuture.get();
-
-      if (ec) {
-        m_logger(ERROR, BRIGHT_RED) << "Failed to query blocks: " << ec << ", " << ec.message();
-        setFutureStateIf(State::idle, [this] { return m_futureState != State::stopped; });
-        m_observerManager.notify(&IBlockchainSynchronizerObserver::synchronizationCompleted, ec);
-      } else {
-        m_logger(DEBUGGING) << "Blocks received, start index " << response.startHeight << ", count " << response.newBlocks.size();
-        processBlocks(response);
+    if (!prefetched) {
+      GetBlocksRequest req = getCommonHistory();
+      if (req.knownBlocks.empty()) {
+        return;
       }
+
+      query = queryBlocks(std::move(req.knownBlocks), req.syncStart.timestamp);
+    }
+
+    std::error_code ec = query->completed.get();
+
+    if (ec) {
+      m_logger(ERROR, BRIGHT_RED) << "Failed to query blocks: " << ec << ", " << ec.message();
+      setFutureStateIf(State::idle, [this] { return m_futureState != State::stopped; });
+      m_observerManager.notify(&IBlockchainSynchronizerObserver::synchronizationCompleted, ec);
+    } else if (prefetched && !isPrefetchApplicable(query->response)) {
+      m_logger(DEBUGGING) << "Prefetched blocks discarded, start index " << query->response.startHeight;
+      setFutureState(State::blockchainSync);
+    } else {
+      m_logger(DEBUGGING) << "Blocks received, start index " << query->response.startHeight << ", count " << query->response.newBlocks.size();
+      prefetchBlocks(*query);
+      processBlocks(query->response);
     }
   } catch (const std::exception& e) {
     m_logger(ERROR, BRIGHT_RED) << "Failed to query and process blocks: " << e.what();
+    m_prefetchedBlocks.reset();
     setFutureStateIf(State::idle,  [this] { return m_futureState != State::stopped; });
     m_observerManager.notify(&IBlockchainSynchronizerObserver::synchronizationCompleted, std::make_error_code(std::errc::invalid_argument));
   }
 }
 
+std::shared_ptr<BlockchainSynchronizer::BlocksQuery> BlockchainSynchronizer::queryBlocks(std::vector<Crypto::Hash>&& knownBlocks, uint64_t syncStartTimestamp) {
+  auto query = std::make_shared<BlocksQuery>();
+  query->syncStartTimestamp = syncStartTimestamp;
+  query->completed = query->promise.get_future();
+
+  // the callback owns the query, so the node can still write the response after the synchronizer has dropped it
+  m_node.queryBlocks(
+    std::move(knownBlocks),
+    syncStartTimestamp,
+    query->response.newBlocks,
+    query->response.startHeight,
+    [query](std::error_code ec) {
+      query->promise.set_value(ec);
+    });
+
+  return query;
+}
+
+void BlockchainSynchronizer::prefetchBlocks(const BlocksQuery& query) {
+  const GetBlocksResponse& response = query.response;
+  if (response.newBlocks.empty() || response.startHeight + response.newBlocks.size() > m_node.getLastKnownBlockHeight()) {
+    return;
+  }
+
+  std::vector<Crypto::Hash> blockHashes;
+  blockHashes.reserve(response.newBlocks.size());
+  for (const auto& block : response.newBlocks) {
+    blockHashes.push_back(block.blockHash);
+  }
+
+  std::vector<Crypto::Hash> knownBlocks;
+  {
+    std::unique_lock<std::mutex> lk(m_consumersMutex);
+    auto shortest = std::min_element(m_consumers.begin(), m_consumers.end(), [](const ConsumersMap::value_type& a, const ConsumersMap::value_type& b) {
+      return a.second->getHeight() < b.second->getHeight();
+    });
+
+    if (shortest == m_consumers.end() || response.startHeight > shortest->second->getHeight()) {
+      return;
+    }
+
+    // consumers are about to receive this batch, so the next one continues from its last block
+    knownBlocks = shortest->second->getShortHistory(response.startHeight, blockHashes);
+  }
+
+  m_logger(DEBUGGING) << "Prefetching blocks after index " << (response.startHeight + response.newBlocks.size() - 1);
+  m_prefetchedBlocks = queryBlocks(std::move(knownBlocks), query.syncStartTimestamp);
+}
+
+/// \pre only called from the working thread after the previous batch was added to all consumers
+bool BlockchainSynchronizer::isPrefetchApplicable(const GetBlocksResponse& response) const {
+  std::unique_lock<std::mutex> lk(m_consumersMutex);
+  for (const auto& kv : m_consumers) {
+    if (response.startHeight > kv.second->getHeight()) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
 void BlockchainSynchronizer::processBlocks(GetBlocksResponse& response) {
   m_logger(DEBUGGING) << "Process blocks, start index " << response.startHeight << ", count " << response.newBlocks.size();
 
@@ -527,6 +589,7 @@ void BlockchainSynchronizer::processBlocks(GetBlocksResponse& response) {
         }
       } catch (const std::exception& e) {
         m_logger(ERROR, BRIGHT_RED) << "Failed to process blocks: " << e.what();
+        m_prefetchedBlocks.reset();
         setFutureStateIf(State::idle, [this] { return m_futureState != State::stopped; });
         m_observerManager.notify(&IBlockchainSynchronizerObserver::synchronizationCompleted, std::make_error_code(std::errc::invalid_argument));
         return;
@@ -545,6 +608,7 @@ void BlockchainSynchronizer::processBlocks(GetBlocksResponse& response) {
 
     switch (result) {
     case UpdateConsumersResult::errorOccurred:
+      m_prefetchedBlocks.reset();
       if (setFutureStateIf(State::idle, [this] { return m_futureState != State::stopped; })) {
         m_observerManager.notify(&IBlockchainSynchronizerObserver::synchronizationCompleted, std::make_error_code(std::errc::invalid_argument));
       }
@@ -576,6 +640,7 @@ void BlockchainSynchronizer::processBlocks(GetBlocksResponse& response) {
 
   if (checkIfShouldStop()) { //Sic!
     m_logger(WARNING, BRIGHT_YELLOW) << "Block processing is interrupted";
+    m_prefetchedBlocks.reset();
     m_observerManager.notify(&IBlockchainSynchronizerObserver::synchronizationCompleted, std::make_error_code(std::errc::interrupted));
   }
 }
@@ -97,6 +97,14 @@ private:
     std::vector<Crypto::Hash> knownBlocks;
   };
 
+  // queryBlocks call that may still be in flight; shared with the node callback so it can be dropped at any time
+  struct BlocksQuery {
+    uint64_t syncStartTimestamp;
+    GetBlocksResponse response;
+    std::promise<std::error_code> promise;
+    std::future<std::error_code> completed;
+  };
+
   struct GetPoolResponse {
     bool isLastKnownBlockActual;
     std::vector<std::unique_ptr<ITransactionReader>> newTxs;
@@ -127,6 +135,9 @@ private:
   void startPoolSync();
   void startBlockchainSync();
 
+  std::shared_ptr<BlocksQuery> queryBlocks(std::vector<Crypto::Hash>&& knownBlocks, uint64_t syncStartTimestamp);
+  void prefetchBlocks(const BlocksQuery& query);
+  bool isPrefetchApplicable(const GetBlocksResponse& response) const;
   void processBlocks(GetBlocksResponse& response);
   UpdateConsumersResult updateConsumers(const BlockchainInterval& interval, const std::vector<CompleteBlock>& blocks);
   std::error_code processPoolTxs(GetPoolResponse& response);
@@ -156,6 +167,8 @@ private:
   const Crypto::Hash m_genesisBlockHash;
 
   Crypto::Hash lastBlockId;
+  // next batch requested while the current one is scanned, owned by the working thread
+  std::shared_ptr<BlocksQuery> m_prefetchedBlocks;
 
   State m_currentState;
   State m_futureState;
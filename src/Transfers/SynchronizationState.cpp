@@ -47,11 +47,13 @@ using namespace Common;
 
 namespace DynexCN {
 
-SynchronizationState::ShortHistory SynchronizationState::getShortHistory(uint32_t localHeight) const {
-  ShortHistory history;
+namespace {
+
+template <typename BlockHashAt>
+SynchronizationState::ShortHistory buildShortHistory(uint32_t sz, BlockHashAt&& blockHashAt) {
+  SynchronizationState::ShortHistory history;
   uint32_t i = 0;
   uint32_t current_multiplier = 1;
-  uint32_t sz = std::min(static_cast<uint32_t>(m_blockchain.size()), localHeight + 1);
 
   if (!sz)
     return history;
@@ -60,7 +62,7 @@ SynchronizationState::ShortHistory SynchronizationState::getShortHistory(uint32_
   bool genesis_included = false;
 
   while (current_back_offset < sz) {
-    history.push_back(m_blockchain[sz - current_back_offset]);
+    history.push_back(blockHashAt(sz - current_back_offset));
     if (sz - current_back_offset == 0)
       genesis_included = true;
     if (i < 10) {
@@ -72,11 +74,27 @@ SynchronizationState::ShortHistory SynchronizationState::getShortHistory(uint32_
   }
 
   if (!genesis_included)
-    history.push_back(m_blockchain[0]);
+    history.push_back(blockHashAt(0));
 
   return history;
 }
 
+}
+
+SynchronizationState::ShortHistory SynchronizationState::getShortHistory(uint32_t localHeight) const {
+  uint32_t sz = std::min(static_cast<uint32_t>(m_blockchain.size()), localHeight + 1);
+  return buildShortHistory(sz, [this](uint32_t i) { return m_blockchain[i]; });
+}
+
+SynchronizationState::ShortHistory SynchronizationState::getShortHistory(uint32_t startHeight, const std::vector<Crypto::Hash>& blockHashes) const {
+  assert(startHeight <= m_blockchain.size());
+
+  uint32_t sz = startHeight + static_cast<uint32_t>(blockHashes.size());
+  return buildShortHistory(sz, [this, startHeight, &blockHashes](uint32_t i) {
+    return i < startHeight ? m_blockchain[i] : blockHashes[i - startHeight];
+  });
+}
+
 SynchronizationState::CheckResult SynchronizationState::checkInterval(const BlockchainInterval& interval) const {
   assert(interval.startHeight <= m_blockchain.size());
 
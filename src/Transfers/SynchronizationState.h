@@ -64,6 +64,8 @@ public:
   }
 
   ShortHistory getShortHistory(uint32_t localHeight) const;
+  // history of the chain known up to startHeight followed by blockHashes, used to request blocks ahead of the state
+  ShortHistory getShortHistory(uint32_t startHeight, const std::vector<Crypto::Hash>& blockHashes) const;
   CheckResult checkInterval(const BlockchainInterval& interval) const;
 
   void detach(uint32_t height);
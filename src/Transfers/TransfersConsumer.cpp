@@ -42,7 +42,6 @@
 
 #include "CommonTypes.h"
 #include "Common/StringTools.h"
-#include "Common/BlockingQueue.h"
 #include "DynexCNCore/DynexCNFormatUtils.h"
 #include "DynexCNCore/TransactionApi.h"
 
@@ -137,9 +136,15 @@ std::vector<Crypto::Hash> getBlockHashes(const DynexCN::CompleteBlock* blocks, s
 
 namespace DynexCN {
 
-TransfersConsumer::TransfersConsumer(const DynexCN::Currency& currency, INode& node, Logging::ILogger& logger, const SecretKey& viewSecret) :
-  m_node(node), m_viewSecret(viewSecret), m_currency(currency), m_logger(logger, "TransfersConsumer") {
+TransfersConsumer::TransfersConsumer(const DynexCN::Currency& currency, INode& node, Logging::ILogger& logger, const SecretKey& viewSecret, Tools::ThreadPool& scanPool,
+  TransfersScanner& scanner) :
+  m_node(node), m_viewSecret(viewSecret), m_currency(currency), m_logger(logger, "TransfersConsumer"), m_scanPool(scanPool), m_scanner(scanner) {
   updateSyncStart();
+  m_scannerKeyId = m_scanner.addViewKey(m_viewSecret, m_spendKeys, m_syncStart);
+}
+
+TransfersConsumer::~TransfersConsumer() {
+  m_scanner.removeViewKey(m_scannerKeyId);
 }
 
 ITransfersSubscription& TransfersConsumer::addSubscription(const AccountSubscription& subscription) {
@@ -152,6 +157,7 @@ ITransfersSubscription& TransfersConsumer::addSubscription(const AccountSubscrip
   if (res.get() == nullptr) {
     res.reset(new TransfersSubscription(m_currency, m_logger.getLogger(), subscription));
     m_spendKeys.insert(subscription.keys.address.spendPublicKey);
+    m_scanner.reset();
     if (m_subscriptions.size() == 1) {
       m_syncStart = res->getSyncStart();
     } else {
@@ -167,6 +173,7 @@ ITransfersSubscription& TransfersConsumer::addSubscription(const AccountSubscrip
 bool TransfersConsumer::removeSubscription(const AccountPublicAddress& address) {
   m_subscriptions.erase(address.spendPublicKey);
   m_spendKeys.erase(address.spendPublicKey);
+  m_scanner.reset();
   updateSyncStart();
   return m_subscriptions.empty();
 }
@@ -226,106 +233,72 @@ bool TransfersConsumer::onNewBlocks(const CompleteBlock* blocks, uint32_t startH
   assert(blocks);
   assert(count > 0);
 
-  struct Tx {
+  struct PreprocessedTx : PreprocessInfo {
     TransactionBlockInfo blockInfo;
     const ITransactionReader* tx;
   };
 
-  struct PreprocessedTx : Tx, PreprocessInfo {};
-
+  // collected in block and transaction order, every scan task fills its own slot
   std::vector<PreprocessedTx> preprocessedTransactions;
-  std::mutex preprocessedTransactionsMutex;
-
-  size_t workers = std::thread::hardware_concurrency();
-  if (workers == 0) {
-    workers = 2;
-  }
-
-  BlockingQueue<Tx> inputQueue(workers * 2);
-
-  std::atomic<bool> stopProcessing(false);
-
-  auto pushingThread = std::async(std::launch::async, [&] {
-    for( uint32_t i = 0; i < count && !stopProcessing; ++i) {
-      const auto& block = blocks[i].block;
-
-      if (!block.is_initialized()) {
-        continue;
-      }
-
-      // filter by syncStartTimestamp
-      if (m_syncStart.timestamp && block->timestamp < m_syncStart.timestamp) {
-        continue;
-      }
 
-      TransactionBlockInfo blockInfo;
-      blockInfo.height = startHeight + i;
-      blockInfo.timestamp = block->timestamp;
-      blockInfo.transactionIndex = 0; // position in block
-
-      for (const auto& tx : blocks[i].transactions) {
-        auto pubKey = tx->getTransactionPublicKey();
-        if (pubKey == NULL_PUBLIC_KEY) {
-          ++blockInfo.transactionIndex;
-          continue;
-        }
+  for (uint32_t i = 0; i < count; ++i) {
+    const auto& block = blocks[i].block;
 
-        Tx item = { blockInfo, tx.get() };
-        inputQueue.push(item);
-        ++blockInfo.transactionIndex;
-      }
+    if (!block.is_initialized()) {
+      continue;
     }
 
-    inputQueue.close();
-  });
-
-  auto processingFunction = [&] {
-    Tx item;
-    std::error_code ec;
-    while (!stopProcessing && inputQueue.pop(item)) {
-      PreprocessedTx output;
-      static_cast<Tx&>(output) = item;
+    // filter by syncStartTimestamp
+    if (m_syncStart.timestamp && block->timestamp < m_syncStart.timestamp) {
+      continue;
+    }
 
-      ec = preprocessOutputs(item.blockInfo, *item.tx, output);
-      if (ec) {
-        stopProcessing = true;
-        break;
+    TransactionBlockInfo blockInfo;
+    blockInfo.height = startHeight + i;
+    blockInfo.timestamp = block->timestamp;
+    blockInfo.transactionIndex = 0; // position in block
+
+    for (const auto& tx : blocks[i].transactions) {
+      auto pubKey = tx->getTransactionPublicKey();
+      if (pubKey != NULL_PUBLIC_KEY) {
+        preprocessedTransactions.emplace_back();
+        preprocessedTransactions.back().blockInfo = blockInfo;
+        preprocessedTransactions.back().tx = tx.get();
       }
 
-      std::lock_guard<std::mutex> lk(preprocessedTransactionsMutex);
-      preprocessedTransactions.push_back(std::move(output));
+      ++blockInfo.transactionIndex;
     }
-    return ec;
-  };
-
-  std::vector<std::future<std::error_code>> processingThreads;
-  for (size_t i = 0; i < workers; ++i) {
-    processingThreads.push_back(std::async(std::launch::async, processingFunction));
   }
 
   std::error_code processingError;
-  for (auto& f : processingThreads) {
-    try {
-      std::error_code ec = f.get();
-      if (!processingError && ec) {
-        processingError = ec;
+  std::mutex processingErrorMutex;
+
+  try {
+    m_scanner.scanBlocks(m_scannerKeyId, blocks, startHeight, count);
+    m_scanPool.run(preprocessedTransactions.size(), [&](size_t index) {
+      PreprocessedTx& item = preprocessedTransactions[index];
+      std::error_code ec = preprocessOutputs(item.blockInfo, *item.tx, item);
+      if (ec) {
+        std::lock_guard<std::mutex> lk(processingErrorMutex);
+        if (!processingError) {
+          processingError = ec;
+        }
+
+        return false;
       }
-    } catch (const std::system_error& e) {
-      processingError = e.code();
-    } catch (const std::exception&) {
-      processingError = std::make_error_code(std::errc::operation_canceled);
-    }
+
+      return true;
+    });
+  } catch (const std::system_error& e) {
+    processingError = e.code();
+  } catch (const std::exception&) {
+    processingError = std::make_error_code(std::errc::operation_canceled);
   }
 
   std::vector<Crypto::Hash> blockHashes = getBlockHashes(blocks, count);
   if (!processingError) {
     m_observerManager.notify(&IBlockchainConsumerObserver::onBlocksAdded, this, blockHashes);
 
-    // sort by block height and transaction index in block
-    std::sort(preprocessedTransactions.begin(), preprocessedTransactions.end(), [](const PreprocessedTx& a, const PreprocessedTx& b) {
-      return std::tie(a.blockInfo.height, a.blockInfo.transactionIndex) < std::tie(b.blockInfo.height, b.blockInfo.transactionIndex);
-    });
-
     for (const auto& tx : preprocessedTransactions) {
       processTransaction(tx.blockInfo, *tx.tx, tx);
     }
@@ -505,7 +478,9 @@ std::error_code TransfersConsumer::createTransfers(
 
 std::error_code TransfersConsumer::preprocessOutputs(const TransactionBlockInfo& blockInfo, const ITransactionReader& tx, PreprocessInfo& info) {
   std::unordered_map<PublicKey, std::vector<uint32_t>> outputs;
-  findMyOutputs(tx, m_viewSecret, m_spendKeys, outputs);
+  if (!m_scanner.getOutputs(m_scannerKeyId, blockInfo.height, tx.getTransactionHash(), outputs)) {
+    findMyOutputs(tx, m_viewSecret, m_spendKeys, outputs);
+  }
   if (outputs.empty()) {
     return std::error_code();
   }
@@ -39,6 +39,8 @@
 
 #include "IBlockchainSynchronizer.h"
 #include "ITransfersSynchronizer.h"
+#include "Common/ThreadPool.h"
+#include "TransfersScanner.h"
 #include "TransfersSubscription.h"
 #include "TypeHelpers.h"
 
@@ -56,7 +58,9 @@ class INode;
 class TransfersConsumer: public IObservableImpl<IBlockchainConsumerObserver, IBlockchainConsumer> {
 public:
 
-  TransfersConsumer(const DynexCN::Currency& currency, INode& node, Logging::ILogger& logger, const Crypto::SecretKey& viewSecret);
+  TransfersConsumer(const DynexCN::Currency& currency, INode& node, Logging::ILogger& logger, const Crypto::SecretKey& viewSecret,
+    Tools::ThreadPool& scanPool, TransfersScanner& scanner);
+  ~TransfersConsumer();
 
   ITransfersSubscription& addSubscription(const AccountSubscription& subscription);
   // returns true if no subscribers left
@@ -112,6 +116,9 @@ private:
   INode& m_node;
   const DynexCN::Currency& m_currency;
   Logging::LoggerRef m_logger;
+  Tools::ThreadPool& m_scanPool;
+  TransfersScanner& m_scanner;
+  size_t m_scannerKeyId;
 };
 
 }
@@ -0,0 +1,259 @@
+// Copyright (c) 2021-2023, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+#include "TransfersScanner.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+#include "DynexCNCore/DynexCNBasic.h"
+
+using namespace Crypto;
+
+namespace DynexCN {
+
+namespace {
+
+const uint32_t UNKNOWN_HEIGHT = std::numeric_limits<uint32_t>::max();
+
+}
+
+TransfersScanner::TransfersScanner(Tools::ThreadPool& threadPool) :
+  m_threadPool(threadPool),
+  m_nextKeyId(0),
+  m_batchEnd(nullptr),
+  m_batchLastBlockHash(NULL_HASH),
+  m_batchEndHeight(0) {
+}
+
+size_t TransfersScanner::addViewKey(const SecretKey& viewSecretKey, const std::unordered_set<PublicKey>& spendKeys,
+  const SynchronizationStart& syncStart) {
+
+  ViewKey key;
+  key.secretKey = viewSecretKey;
+  // a malformed view key finds nothing, just like generate_key_derivation() failing for it
+  PublicKey viewPublicKey;
+  key.isValid = secret_key_to_public_key(viewSecretKey, viewPublicKey);
+  key.spendKeys = &spendKeys;
+  key.syncStart = &syncStart;
+  key.nextHeight = UNKNOWN_HEIGHT;
+  key.scannedFrom = UNKNOWN_HEIGHT;
+
+  size_t keyId = m_nextKeyId++;
+  m_viewKeys.emplace(keyId, key);
+  return keyId;
+}
+
+void TransfersScanner::removeViewKey(size_t keyId) {
+  m_viewKeys.erase(keyId);
+}
+
+void TransfersScanner::reset() {
+  m_batchEnd = nullptr;
+  m_hits.clear();
+
+  for (auto& kv : m_viewKeys) {
+    kv.second.scannedFrom = UNKNOWN_HEIGHT;
+  }
+}
+
+void TransfersScanner::scanBlocks(size_t keyId, const CompleteBlock* blocks, uint32_t startHeight, uint32_t count) {
+  assert(count > 0);
+
+  auto it = m_viewKeys.find(keyId);
+  assert(it != m_viewKeys.end());
+  ViewKey& key = it->second;
+
+  std::vector<ScanRequest> requests;
+  if (blocks + count != m_batchEnd || blocks[count - 1].blockHash != m_batchLastBlockHash) {
+    // new batch: scan it for every key that is expected to get these blocks, the other keys scan on demand
+    reset();
+    m_batchEnd = blocks + count;
+    m_batchLastBlockHash = blocks[count - 1].blockHash;
+    m_batchEndHeight = startHeight + count;
+
+    for (auto& kv : m_viewKeys) {
+      uint32_t nextHeight = kv.first == keyId ? startHeight : kv.second.nextHeight;
+      if (nextHeight < m_batchEndHeight) {
+        requests.push_back({ kv.first, &kv.second, std::max(nextHeight, startHeight), m_batchEndHeight });
+      }
+    }
+  } else if (key.scannedFrom > startHeight) {
+    requests.push_back({ keyId, &key, startHeight, std::min(key.scannedFrom, m_batchEndHeight) });
+  }
+
+  if (!requests.empty()) {
+    scan(blocks, startHeight, count, requests);
+
+    for (const auto& request : requests) {
+      auto& scannedFrom = m_viewKeys[request.keyId].scannedFrom;
+      scannedFrom = std::min(scannedFrom, request.fromHeight);
+    }
+  }
+
+  key.nextHeight = startHeight + count;
+}
+
+bool TransfersScanner::getOutputs(size_t keyId, uint32_t height, const Hash& transactionHash, Outputs& outputs) const {
+  auto it = m_viewKeys.find(keyId);
+  if (it == m_viewKeys.end() || height < it->second.scannedFrom || height >= m_batchEndHeight) {
+    return false;
+  }
+
+  auto hitsIt = m_hits.find(transactionHash);
+  if (hitsIt != m_hits.end()) {
+    for (const auto& hit : hitsIt->second) {
+      if (hit.keyId == keyId) {
+        outputs[hit.spendKey].push_back(hit.outputIndex);
+      }
+    }
+  }
+
+  return true;
+}
+
+void TransfersScanner::scan(const CompleteBlock* blocks, uint32_t startHeight, uint32_t count, const std::vector<ScanRequest>& requests) {
+  struct Item {
+    const ITransactionReader* tx;
+    const std::vector<const ScanRequest*>* requests;
+    std::vector<Hit> hits;
+  };
+
+  std::vector<std::vector<const ScanRequest*>> blockRequests(count);
+  std::vector<Item> items;
+
+  for (uint32_t i = 0; i < count; ++i) {
+    const auto& block = blocks[i].block;
+    if (!block.is_initialized()) {
+      continue;
+    }
+
+    uint32_t height = startHeight + i;
+    for (const auto& request : requests) {
+      const ViewKey& key = *request.key;
+      if (!key.isValid || height < request.fromHeight || height >= request.toHeight) {
+        continue;
+      }
+
+      // filter by syncStartTimestamp
+      if (key.syncStart->timestamp && block->timestamp < key.syncStart->timestamp) {
+        continue;
+      }
+
+      blockRequests[i].push_back(&request);
+    }
+
+    if (blockRequests[i].empty()) {
+      continue;
+    }
+
+    for (const auto& tx : blocks[i].transactions) {
+      if (tx->getTransactionPublicKey() != NULL_PUBLIC_KEY) {
+        items.push_back({ tx.get(), &blockRequests[i], {} });
+      }
+    }
+  }
+
+  m_threadPool.run(items.size(), [&items](size_t index) {
+    Item& item = items[index];
+    scanTransaction(*item.tx, *item.requests, item.hits);
+    return true;
+  });
+
+  for (auto& item : items) {
+    if (!item.hits.empty()) {
+      auto& hits = m_hits[item.tx->getTransactionHash()];
+      hits.insert(hits.end(), item.hits.begin(), item.hits.end());
+    }
+  }
+}
+
+void TransfersScanner::scanTransaction(const ITransactionReader& tx, const std::vector<const ScanRequest*>& requests, std::vector<Hit>& hits) {
+  size_t keyCount = requests.size();
+
+  std::vector<SecretKey> viewKeys;
+  viewKeys.reserve(keyCount);
+  for (const auto* request : requests) {
+    viewKeys.push_back(request->key->secretKey);
+  }
+
+  std::vector<KeyDerivation> derivations(keyCount);
+  if (!generate_key_derivations(tx.getTransactionPublicKey(), viewKeys.data(), keyCount, derivations.data())) {
+    return;
+  }
+
+  std::vector<PublicKey> spendKeys(keyCount);
+  auto checkOutputKey = [&](const PublicKey& key, size_t keyIndex, size_t outputIndex) {
+    if (!underive_public_keys(derivations.data(), keyCount, keyIndex, key, spendKeys.data())) {
+      return;
+    }
+
+    for (size_t i = 0; i < keyCount; ++i) {
+      if (requests[i]->key->spendKeys->count(spendKeys[i]) != 0) {
+        hits.push_back({ requests[i]->keyId, spendKeys[i], static_cast<uint32_t>(outputIndex) });
+      }
+    }
+  };
+
+  size_t keyIndex = 0;
+  size_t outputCount = tx.getOutputCount();
+
+  for (size_t idx = 0; idx < outputCount; ++idx) {
+    auto outType = tx.getOutputType(idx);
+
+    if (outType == TransactionTypes::OutputType::Key) {
+      uint64_t amount;
+      KeyOutput out;
+      tx.getOutput(idx, out, amount);
+
+      checkOutputKey(out.key, keyIndex, idx);
+      ++keyIndex;
+
+    } else if (outType == TransactionTypes::OutputType::Multisignature) {
+      uint64_t amount;
+      MultisignatureOutput out;
+      tx.getOutput(idx, out, amount);
+
+      for (const auto& key : out.keys) {
+        checkOutputKey(key, idx, idx);
+        ++keyIndex;
+      }
+    }
+  }
+}
+
+}
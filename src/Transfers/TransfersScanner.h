@@ -0,0 +1,112 @@
+// Copyright (c) 2021-2023, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+#pragma once
+
+#include "CommonTypes.h"
+#include "ITransfersSynchronizer.h"
+#include "Common/ThreadPool.h"
+
+#include "crypto/crypto.h"
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace DynexCN {
+
+// Finds the outputs addressed to the view keys of all consumers of a TransfersSyncronizer.
+// Every transaction of a block batch is decoded once and checked against all view keys that are going to receive
+// the batch, so for the consumers that follow the first one a batch only costs lookups.
+class TransfersScanner {
+public:
+  // spend public key -> indexes of the outputs addressed to it
+  typedef std::unordered_map<Crypto::PublicKey, std::vector<uint32_t>> Outputs;
+
+  explicit TransfersScanner(Tools::ThreadPool& threadPool);
+
+  // spendKeys and syncStart belong to the caller and must stay valid until removeViewKey()
+  size_t addViewKey(const Crypto::SecretKey& viewSecretKey, const std::unordered_set<Crypto::PublicKey>& spendKeys,
+    const SynchronizationStart& syncStart);
+  void removeViewKey(size_t keyId);
+  // forgets all scan results, must be called when the spend keys of a view key change
+  void reset();
+
+  // Scans blocks for keyId unless that has been done already. The first call for a batch also scans it for
+  // the other view keys whose next expected height falls into it.
+  void scanBlocks(size_t keyId, const CompleteBlock* blocks, uint32_t startHeight, uint32_t count);
+  // returns false if the transaction at this height has not been scanned for keyId
+  bool getOutputs(size_t keyId, uint32_t height, const Crypto::Hash& transactionHash, Outputs& outputs) const;
+
+private:
+  struct ViewKey {
+    Crypto::SecretKey secretKey;
+    bool isValid;
+    const std::unordered_set<Crypto::PublicKey>* spendKeys;
+    const SynchronizationStart* syncStart;
+    uint32_t nextHeight;  // start height of the next scanBlocks call, UINT32_MAX if unknown
+    uint32_t scannedFrom; // the current batch has been scanned for this key from this height on
+  };
+
+  struct ScanRequest {
+    size_t keyId;
+    const ViewKey* key;
+    uint32_t fromHeight;
+    uint32_t toHeight;
+  };
+
+  struct Hit {
+    size_t keyId;
+    Crypto::PublicKey spendKey;
+    uint32_t outputIndex;
+  };
+
+  void scan(const CompleteBlock* blocks, uint32_t startHeight, uint32_t count, const std::vector<ScanRequest>& requests);
+  static void scanTransaction(const ITransactionReader& tx, const std::vector<const ScanRequest*>& requests, std::vector<Hit>& hits);
+
+  Tools::ThreadPool& m_threadPool;
+  std::unordered_map<size_t, ViewKey> m_viewKeys;
+  size_t m_nextKeyId;
+
+  // current batch, identified by its end and its last block
+  const CompleteBlock* m_batchEnd;
+  Crypto::Hash m_batchLastBlockHash;
+  uint32_t m_batchEndHeight;
+  // transaction hash -> outputs found in it
+  std::unordered_map<Crypto::Hash, std::vector<Hit>> m_hits;
+};
+
+}
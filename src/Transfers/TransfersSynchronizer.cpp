@@ -52,7 +52,7 @@ namespace DynexCN {
 const uint32_t TRANSFERS_STORAGE_ARCHIVE_VERSION = 0;
 
 TransfersSyncronizer::TransfersSyncronizer(const DynexCN::Currency& currency, Logging::ILogger& logger, IBlockchainSynchronizer& sync, INode& node) :
-  m_currency(currency), m_logger(logger, "TransfersSyncronizer"), m_sync(sync), m_node(node) {
+  m_currency(currency), m_logger(logger, "TransfersSyncronizer"), m_scanner(m_scanPool), m_sync(sync), m_node(node) {
 }
 
 TransfersSyncronizer::~TransfersSyncronizer() {
@@ -73,7 +73,7 @@ ITransfersSubscription& TransfersSyncronizer::addSubscription(const AccountSubsc
 
   if (it == m_consumers.end()) {
     std::unique_ptr<TransfersConsumer> consumer(
-      new TransfersConsumer(m_currency, m_node, m_logger.getLogger(), acc.keys.viewSecretKey));
+      new TransfersConsumer(m_currency, m_node, m_logger.getLogger(), acc.keys.viewSecretKey, m_scanPool, m_scanner));
 
     m_sync.addConsumer(consumer.get());
     consumer->addObserver(this);
@@ -40,6 +40,8 @@
 #include "Common/ObserverManager.h"
 #include "ITransfersSynchronizer.h"
 #include "IBlockchainSynchronizer.h"
+#include "Common/ThreadPool.h"
+#include "TransfersScanner.h"
 #include "TypeHelpers.h"
 
 #include <unordered_map>
@@ -83,6 +85,10 @@ public:
 private:
   Logging::LoggerRef m_logger;
 
+  // shared by all consumers, they are fed one after another by the blockchain synchronizer
+  Tools::ThreadPool m_scanPool;
+  TransfersScanner m_scanner;
+
   // map { view public key -> consumer }
   typedef std::unordered_map<Crypto::PublicKey, std::unique_ptr<TransfersConsumer>> ConsumersContainer;
   ConsumersContainer m_consumers;
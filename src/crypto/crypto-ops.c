@@ -1944,11 +1944,31 @@ static void ge_cached_cmov(ge_cached *t, const ge_cached *u, unsigned char b) {
   fe_cmov(t->T2d, u->T2d, b);
 }
 
+void ge_sm_precomp(ge_smp Ai, const ge_p3 *A) {
+  ge_p1p1 t;
+  ge_p3 u;
+  int i;
+
+  ge_p3_to_cached(&Ai[0], A);
+  for (i = 0; i < 7; i++) {
+    ge_add(&t, A, &Ai[i]);
+    ge_p1p1_to_p3(&u, &t);
+    ge_p3_to_cached(&Ai[i + 1], &u);
+  }
+}
+
 /* Assumes that a[31] <= 127 */
 void ge_scalarmult(ge_p2 *r, const unsigned char *a, const ge_p3 *A) {
+  ge_smp Ai; /* 1 * A, 2 * A, ..., 8 * A */
+
+  ge_sm_precomp(Ai, A);
+  ge_scalarmult_precomp(r, a, Ai);
+}
+
+/* Assumes that a[31] <= 127 */
+void ge_scalarmult_precomp(ge_p2 *r, const unsigned char *a, const ge_smp Ai) {
   signed char e[64];
   int carry, carry2, i;
-  ge_cached Ai[8]; /* 1 * A, 2 * A, ..., 8 * A */
   ge_p1p1 t;
   ge_p3 u;
 
@@ -1965,13 +1985,6 @@ void ge_scalarmult(ge_p2 *r, const unsigned char *a, const ge_p3 *A) {
   e[62] = carry - (carry2 << 4); /* -8..7 */
   e[63] = carry2; /* 0..8 */
 
-  ge_p3_to_cached(&Ai[0], A);
-  for (i = 0; i < 7; i++) {
-    ge_add(&t, A, &Ai[i]);
-    ge_p1p1_to_p3(&u, &t);
-    ge_p3_to_cached(&Ai[i + 1], &u);
-  }
-
   ge_p2_0(r);
   for (i = 63; i >= 0; i--) {
     signed char b = e[i];
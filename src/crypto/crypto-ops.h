@@ -101,6 +101,9 @@ void sc_reduce(unsigned char *);
 /* New code */
 
 void ge_scalarmult(ge_p2 *, const unsigned char *, const ge_p3 *);
+typedef ge_cached ge_smp[8];
+void ge_sm_precomp(ge_smp, const ge_p3 *);
+void ge_scalarmult_precomp(ge_p2 *, const unsigned char *, const ge_smp);
 void ge_double_scalarmult_precomp_vartime(ge_p2 *, const unsigned char *, const ge_p3 *, const unsigned char *, const ge_dsmp);
 void ge_mul8(ge_p1p1 *, const ge_p2 *);
 extern const fe fe_ma2;
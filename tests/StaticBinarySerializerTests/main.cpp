@@ -0,0 +1,492 @@
+// Copyright (c) 2021-2023, Dynex Developers
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+// 
+// Parts of this project are originally copyright by:
+// Copyright (c) 2012-2016, The CN developers, The Bytecoin developers
+// Copyright (c) 2014-2018, The Monero project
+// Copyright (c) 2014-2018, The Forknote developers
+// Copyright (c) 2018, The TurtleCoin developers
+// Copyright (c) 2016-2018, The Karbowanec developers
+// Copyright (c) 2017-2022, The CROAT.community developers
+
+
+
+// Differential test of writeBinary and readBinary against serialize() with the binary stream
+// serializers: random values have to encode to the same bytes, and mutated or truncated blobs
+// have to be accepted or rejected alike and decode to the same values.
+
+#include <cstdio>
+#include <random>
+
+#include "Common/MemoryInputStream.h"
+#include "Common/StreamTools.h"
+#include "Common/StringTools.h"
+#include "Common/VectorOutputStream.h"
+#include "DynexCNConfig.h"
+#include "DynexCNCore/DynexCNSerialization.h"
+#include "DynexCNCore/DynexCNTools.h"
+#include "DynexCNCore/TransactionExtra.h"
+#include "Serialization/BinaryInputStreamSerializer.h"
+#include "Serialization/BinaryOutputStreamSerializer.h"
+
+using namespace DynexCN;
+
+namespace {
+
+const size_t VALUE_COUNT = 1500;
+const size_t MUTATION_COUNT = 24;
+
+std::mt19937_64 generator(20231017);
+size_t failures = 0;
+
+uint64_t random(uint64_t max) {
+  return std::uniform_int_distribution<uint64_t>(0, max)(generator);
+}
+
+// mostly small values, as in real data, and now and then one of any length
+uint64_t randomVarint() {
+  switch (random(3)) {
+  case 0: return random(0x7f);
+  case 1: return random(0x3fff);
+  case 2: return random(0xffffffff);
+  default: return generator();
+  }
+}
+
+template<class T>
+void randomPod(T& value) {
+  uint8_t* data = reinterpret_cast<uint8_t*>(&value);
+  for (size_t i = 0; i < sizeof(value); ++i) {
+    data[i] = static_cast<uint8_t>(random(0xff));
+  }
+}
+
+template<class T>
+std::vector<T> randomPods(size_t maxCount) {
+  std::vector<T> values(random(maxCount));
+  for (T& value : values) {
+    randomPod(value);
+  }
+
+  return values;
+}
+
+TransactionInput randomInput() {
+  switch (random(2)) {
+  case 0: {
+    BaseInput input;
+    input.blockIndex = static_cast<uint32_t>(randomVarint());
+    return input;
+  }
+  case 1: {
+    KeyInput input;
+    input.amount = randomVarint();
+    input.outputIndexes.resize(random(4));
+    for (uint32_t& index : input.outputIndexes) {
+      index = static_cast<uint32_t>(randomVarint());
+    }
+
+    randomPod(input.keyImage);
+    return input;
+  }
+  default: {
+    MultisignatureInput input;
+    input.amount = randomVarint();
+    input.signatureCount = static_cast<uint8_t>(random(3));
+    input.outputIndex = static_cast<uint32_t>(randomVarint());
+    return input;
+  }
+  }
+}
+
+TransactionOutput randomOutput() {
+  TransactionOutput output;
+  output.amount = randomVarint();
+  if (random(1) == 0) {
+    KeyOutput target;
+    randomPod(target.key);
+    output.target = target;
+  } else {
+    MultisignatureOutput target;
+    target.keys = randomPods<Crypto::PublicKey>(3);
+    target.requiredSignatureCount = static_cast<uint8_t>(random(3));
+    output.target = target;
+  }
+
+  return output;
+}
+
+void randomPrefix(TransactionPrefix& prefix) {
+  // a version above the current one is rejected by both
+  prefix.version = random(15) == 0 ? CURRENT_TRANSACTION_VERSION + 1 : static_cast<uint8_t>(random(CURRENT_TRANSACTION_VERSION));
+  prefix.unlockTime = randomVarint();
+  prefix.inputs.clear();
+  for (size_t i = random(4); i > 0; --i) {
+    prefix.inputs.push_back(randomInput());
+  }
+
+  prefix.outputs.clear();
+  for (size_t i = random(4); i > 0; --i) {
+    prefix.outputs.push_back(randomOutput());
+  }
+
+  prefix.extra = randomPods<uint8_t>(random(1) == 0 ? 0 : 48);
+}
+
+size_t signatureCount(const TransactionInput& input) {
+  if (input.type() == typeid(KeyInput)) {
+    return boost::get<KeyInput>(input).outputIndexes.size();
+  } else if (input.type() == typeid(MultisignatureInput)) {
+    return boost::get<MultisignatureInput>(input).signatureCount;
+  }
+
+  return 0;
+}
+
+void randomTransaction(Transaction& tx) {
+  randomPrefix(tx);
+  tx.signatures.clear();
+  if (random(7) == 0) {
+    return;
+  }
+
+  for (const TransactionInput& input : tx.inputs) {
+    tx.signatures.emplace_back(signatureCount(input));
+    for (Crypto::Signature& signature : tx.signatures.back()) {
+      randomPod(signature);
+    }
+  }
+
+  // a signature too many or too few is rejected by both
+  if (!tx.signatures.empty() && random(15) == 0) {
+    tx.signatures[random(tx.signatures.size() - 1)].emplace_back();
+  }
+}
+
+void randomCoinbase(Transaction& tx) {
+  randomTransaction(tx);
+  BaseInput input;
+  input.blockIndex = static_cast<uint32_t>(randomVarint());
+  tx.inputs.assign(1, input);
+  tx.signatures.clear();
+}
+
+void randomHeader(BlockHeader& header) {
+  header.majorVersion = static_cast<uint8_t>(random(BLOCK_MAJOR_VERSION_4 + 1));
+  header.minorVersion = static_cast<uint8_t>(random(2));
+  randomPod(header.nonce);
+  header.timestamp = randomVarint();
+  randomPod(header.previousBlockHash);
+}
+
+void randomBlock(Block& block) {
+  randomHeader(block);
+  randomCoinbase(block.baseTransaction);
+  block.transactionHashes = randomPods<Crypto::Hash>(6);
+
+  ParentBlock& parent = block.parentBlock;
+  parent = ParentBlock();
+  if (block.majorVersion == BLOCK_MAJOR_VERSION_2 || block.majorVersion == BLOCK_MAJOR_VERSION_3) {
+    parent.majorVersion = static_cast<uint8_t>(random(2));
+    parent.minorVersion = static_cast<uint8_t>(random(2));
+    randomPod(parent.previousBlockHash);
+    parent.transactionCount = static_cast<uint16_t>(1 + random(9));
+    parent.baseTransactionBranch.resize(Crypto::tree_depth(parent.transactionCount));
+    for (Crypto::Hash& hash : parent.baseTransactionBranch) {
+      randomPod(hash);
+    }
+
+    randomCoinbase(parent.baseTransaction);
+    TransactionExtraMergeTag tag;
+    tag.depth = static_cast<size_t>(random(3));
+    randomPod(tag.merkleRoot);
+    parent.baseTransaction.extra.clear();
+    appendMergeMiningTagToExtra(parent.baseTransaction.extra, tag);
+    parent.blockchainBranch.resize(tag.depth);
+    for (Crypto::Hash& hash : parent.blockchainBranch) {
+      randomPod(hash);
+    }
+  }
+}
+
+bool equal(const TransactionInput& a, const TransactionInput& b) {
+  if (a.which() != b.which()) {
+    return false;
+  }
+
+  if (a.type() == typeid(BaseInput)) {
+    return boost::get<BaseInput>(a).blockIndex == boost::get<BaseInput>(b).blockIndex;
+  } else if (a.type() == typeid(KeyInput)) {
+    const KeyInput& x = boost::get<KeyInput>(a);
+    const KeyInput& y = boost::get<KeyInput>(b);
+    return x.amount == y.amount && x.outputIndexes == y.outputIndexes && x.keyImage == y.keyImage;
+  } else {
+    const MultisignatureInput& x = boost::get<MultisignatureInput>(a);
+    const MultisignatureInput& y = boost::get<MultisignatureInput>(b);
+    return x.amount == y.amount && x.signatureCount == y.signatureCount && x.outputIndex == y.outputIndex;
+  }
+}
+
+bool equal(const TransactionOutput& a, const TransactionOutput& b) {
+  if (a.amount != b.amount || a.target.which() != b.target.which()) {
+    return false;
+  }
+
+  if (a.target.type() == typeid(KeyOutput)) {
+    return boost::get<KeyOutput>(a.target).key == boost::get<KeyOutput>(b.target).key;
+  } else {
+    const MultisignatureOutput& x = boost::get<MultisignatureOutput>(a.target);
+    const MultisignatureOutput& y = boost::get<MultisignatureOutput>(b.target);
+    return x.keys == y.keys && x.requiredSignatureCount == y.requiredSignatureCount;
+  }
+}
+
+template<class T>
+bool equalVectors(const std::vector<T>& a, const std::vector<T>& b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (!equal(a[i], b[i])) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool equal(const TransactionPrefix& a, const TransactionPrefix& b) {
+  return a.version == b.version && a.unlockTime == b.unlockTime && equalVectors(a.inputs, b.inputs) &&
+    equalVectors(a.outputs, b.outputs) && a.extra == b.extra;
+}
+
+bool equal(const Transaction& a, const Transaction& b) {
+  return equal(static_cast<const TransactionPrefix&>(a), static_cast<const TransactionPrefix&>(b)) && a.signatures == b.signatures;
+}
+
+// the fields each version carries, the others are left as they were
+bool equal(const BlockHeader& a, const BlockHeader& b) {
+  if (a.majorVersion != b.majorVersion || a.minorVersion != b.minorVersion || a.previousBlockHash != b.previousBlockHash) {
+    return false;
+  }
+
+  return a.majorVersion == BLOCK_MAJOR_VERSION_2 || a.majorVersion == BLOCK_MAJOR_VERSION_3 || (a.timestamp == b.timestamp && a.nonce == b.nonce);
+}
+
+bool equal(const ParentBlock& a, const ParentBlock& b) {
+  return a.majorVersion == b.majorVersion && a.minorVersion == b.minorVersion && a.previousBlockHash == b.previousBlockHash &&
+    a.transactionCount == b.transactionCount && a.baseTransactionBranch == b.baseTransactionBranch &&
+    equal(a.baseTransaction, b.baseTransaction) && a.blockchainBranch == b.blockchainBranch;
+}
+
+bool equal(const Block& a, const Block& b) {
+  if (!equal(static_cast<const BlockHeader&>(a), static_cast<const BlockHeader&>(b)) || !equal(a.baseTransaction, b.baseTransaction) ||
+    a.transactionHashes != b.transactionHashes) {
+    return false;
+  }
+
+  if (a.majorVersion == BLOCK_MAJOR_VERSION_2 || a.majorVersion == BLOCK_MAJOR_VERSION_3) {
+    return a.timestamp == b.timestamp && a.nonce == b.nonce && equal(a.parentBlock, b.parentBlock);
+  }
+
+  return true;
+}
+
+// the reference, serialize() with the stream serializers as the generic toBinaryArray uses them
+template<class T>
+bool referenceWrite(const T& value, BinaryArray& blob) {
+  try {
+    Common::VectorOutputStream stream(blob);
+    BinaryOutputStreamSerializer serializer(stream);
+    serialize(const_cast<T&>(value), serializer);
+  } catch (std::exception&) {
+    return false;
+  }
+
+  return true;
+}
+
+// BinaryInputStreamSerializer allocates a whole array or string before reading it, a mutated
+// length would make it allocate gigabytes. Such a length cannot fit in what is left, so the read
+// fails anyway, here it fails before the allocation.
+class BoundedInputSerializer : public BinaryInputStreamSerializer {
+public:
+  explicit BoundedInputSerializer(Common::MemoryInputStream& stream) : BinaryInputStreamSerializer(stream), m_stream(stream) {
+  }
+
+  virtual bool beginArray(size_t& size, Common::StringView name) override {
+    BinaryInputStreamSerializer::beginArray(size, name);
+    if (size > m_stream.unreadSize()) {
+      throw std::runtime_error("array size exceeds the data");
+    }
+
+    return true;
+  }
+
+  virtual bool operator()(std::string& value, Common::StringView name) override {
+    uint64_t size;
+    Common::readVarint(m_stream, size);
+    if (size > m_stream.unreadSize()) {
+      throw std::runtime_error("string size exceeds the data");
+    }
+
+    value.resize(static_cast<size_t>(size));
+    Common::read(m_stream, &value[0], value.size());
+    return true;
+  }
+
+  using BinaryInputStreamSerializer::operator();
+
+private:
+  Common::MemoryInputStream& m_stream;
+};
+
+template<class T>
+bool referenceRead(T& value, const BinaryArray& blob) {
+  try {
+    Common::MemoryInputStream stream(blob.data(), blob.size());
+    BoundedInputSerializer serializer(stream);
+    serialize(value, serializer);
+    return stream.endOfStream();
+  } catch (std::exception&) {
+    return false;
+  }
+}
+
+void fail(const char* type, const char* check, const BinaryArray& blob) {
+  if (failures++ < 10) {
+    printf("%s: %s differs for blob %s\n", type, check, Common::toHex(blob).c_str());
+  }
+}
+
+template<class T>
+void checkRead(const char* type, const BinaryArray& blob, const T& initial) {
+  T referenceValue = initial;
+  T staticValue = initial;
+  bool referenceResult = referenceRead(referenceValue, blob);
+  bool staticResult = fromBinaryArray(staticValue, blob);
+  if (referenceResult != staticResult) {
+    fail(type, "acceptance", blob);
+  } else if (referenceResult && !equal(referenceValue, staticValue)) {
+    fail(type, "decoded value", blob);
+  }
+}
+
+BinaryArray mutate(const BinaryArray& blob) {
+  BinaryArray result = blob;
+  size_t position = result.empty() ? 0 : random(result.size() - 1);
+  switch (random(4)) {
+  case 0:
+    result.resize(random(result.size()));
+    break;
+  case 1:
+    if (!result.empty()) {
+      result[position] ^= static_cast<uint8_t>(1 << random(7));
+    }
+    break;
+  case 2:
+    if (!result.empty()) {
+      result[position] = static_cast<uint8_t>(random(0xff));
+    }
+    break;
+  case 3:
+    result.insert(result.begin() + position, static_cast<uint8_t>(random(0xff)));
+    break;
+  default:
+    if (!result.empty()) {
+      result.erase(result.begin() + position);
+    }
+    break;
+  }
+
+  return result;
+}
+
+template<class T, class Generate>
+void checkType(const char* type, Generate generate) {
+  size_t encoded = 0;
+  for (size_t i = 0; i < VALUE_COUNT; ++i) {
+    T value;
+    generate(value);
+
+    BinaryArray referenceBlob;
+    BinaryArray staticBlob;
+    size_t staticSize;
+    bool referenceResult = referenceWrite(value, referenceBlob);
+    bool staticResult = toBinaryArray(value, staticBlob);
+    bool sizeResult = getObjectBinarySize(value, staticSize);
+    if (referenceResult != staticResult || referenceResult != sizeResult) {
+      fail(type, "write result", referenceBlob);
+      continue;
+    }
+
+    if (!referenceResult) {
+      continue;
+    }
+
+    ++encoded;
+    if (referenceBlob != staticBlob) {
+      fail(type, "encoding", referenceBlob);
+    }
+
+    if (staticSize != referenceBlob.size()) {
+      fail(type, "size", referenceBlob);
+    }
+
+    // decoding into a used value must not keep anything of it
+    T initial;
+    generate(initial);
+    checkRead(type, referenceBlob, initial);
+    for (size_t j = 0; j < MUTATION_COUNT; ++j) {
+      checkRead(type, mutate(referenceBlob), initial);
+    }
+  }
+
+  if (encoded < VALUE_COUNT / 2) {
+    printf("%s: only %zu of %zu random values could be encoded\n", type, encoded, VALUE_COUNT);
+    ++failures;
+  }
+}
+
+}
+
+int main() {
+  checkType<TransactionPrefix>("TransactionPrefix", randomPrefix);
+  checkType<Transaction>("Transaction", randomTransaction);
+  checkType<BlockHeader>("BlockHeader", randomHeader);
+  checkType<Block>("Block", randomBlock);
+
+  if (failures != 0) {
+    printf("%zu differences found\n", failures);
+    return 1;
+  }
+
+  printf("writeBinary and readBinary match serialize()\n");
+  return 0;
+}